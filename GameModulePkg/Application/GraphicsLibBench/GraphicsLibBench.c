@@ -0,0 +1,866 @@
+/** @file
+  Microbenchmarks for every GameGraphicsLib primitive.
+
+  Every workload runs PcdGraphicsBenchIterations times. The results are printed and written
+  as CSV to GraphicsLibBench.csv, on the file system the application was started from.
+  Workloads that parallel rendering speeds up run again on all processors, with "mp" and the
+  processor count appended to their parameters.
+
+**/
+
+#include <Uefi.h>
+#include <Library/PcdLib.h>
+#include <Library/UefiLib.h>
+#include <Library/UefiBootServicesTableLib.h>
+#include <Library/UefiApplicationEntryPoint.h>
+#include <Library/PrintLib.h>
+#include <Library/MemoryAllocationLib.h>
+#include <Library/DebugLib.h>
+#include <Library/BaseLib.h>
+#include <Library/GameGraphicsLib.h>
+#include <Protocol/LoadedImage.h>
+#include <Protocol/SimpleFileSystem.h>
+
+#define BENCH_CSV_FILE_NAME L"GraphicsLibBench.csv"
+#define BENCH_CSV_HEADER "workload,parameters,operations,ns_per_op,mpixels_per_s,blt_mbytes_per_s\n"
+#define BENCH_TEXT "Sphinx of quartz"
+#define TSC_CALIBRATION_MICROSECONDS 10000
+
+//
+// String token ID of help message text.
+// Shell supports to find help message in the resource section of an application image if
+// .MAN file is not found. This global variable is added to make build tool recognizes
+// that the help string is consumed by user and then build tool will add the string into
+// the resource section. Thus the application can use '-?' option to show help message in
+// Shell.
+//
+GLOBAL_REMOVE_IF_UNREFERENCED EFI_STRING_ID mStringHelpTokenId = STRING_TOKEN(STR_BENCH_HELP_INFORMATION);
+
+/// @brief State shared by all workloads
+typedef struct
+{
+  GAME_GRAPHICS_LIB_DATA *Data;
+  EFI_FILE_PROTOCOL *Csv; // Result file, NULL if it could not be created
+  UINT64 TscFrequency;    // Time stamp counter ticks per second
+  UINT32 Iterations;      // Operations run by every workload
+  UINT32 Processors;      // Processors drawing large operations, see EnableParallelRendering
+} BENCH_CONTEXT;
+
+/// @brief Measures the time stamp counter frequency against the boot services stall
+/// @return Time stamp counter ticks per second
+STATIC
+UINT64
+CalibrateTsc(
+    VOID)
+{
+  UINT64 Start;
+
+  Start = AsmReadTsc();
+  gBS->Stall(TSC_CALIBRATION_MICROSECONDS);
+  return MultU64x32(AsmReadTsc() - Start, 1000000 / TSC_CALIBRATION_MICROSECONDS);
+}
+
+/// @brief Returns the next value of a linear congruential generator, good enough to pick benchmark cells
+STATIC
+UINT32
+NextRandom(
+    IN OUT UINT32 *State)
+{
+  *State = *State * 1664525 + 1013904223;
+  return *State >> 8;
+}
+
+/// @brief Creates the CSV file next to the application image, replacing an older one
+/// @param ImageHandle The handle of the application image
+/// @return The opened file, or NULL if the file system is not writable
+STATIC
+EFI_FILE_PROTOCOL *
+OpenCsvFile(
+    IN EFI_HANDLE ImageHandle)
+{
+  EFI_LOADED_IMAGE_PROTOCOL *LoadedImage;
+  EFI_SIMPLE_FILE_SYSTEM_PROTOCOL *FileSystem;
+  EFI_FILE_PROTOCOL *Root;
+  EFI_FILE_PROTOCOL *File;
+  EFI_STATUS Status;
+
+  Status = gBS->HandleProtocol(ImageHandle, &gEfiLoadedImageProtocolGuid, (VOID **)&LoadedImage);
+  if (EFI_ERROR(Status))
+  {
+    return NULL;
+  }
+
+  Status = gBS->HandleProtocol(LoadedImage->DeviceHandle, &gEfiSimpleFileSystemProtocolGuid, (VOID **)&FileSystem);
+  if (EFI_ERROR(Status))
+  {
+    DEBUG((EFI_D_ERROR, "OpenCsvFile: Image was not loaded from a file system: %r\n", Status));
+    return NULL;
+  }
+
+  Status = FileSystem->OpenVolume(FileSystem, &Root);
+  if (EFI_ERROR(Status))
+  {
+    return NULL;
+  }
+
+  // Deleting the results of an older run, so the file does not keep a longer tail
+  Status = Root->Open(Root, &File, BENCH_CSV_FILE_NAME, EFI_FILE_MODE_READ | EFI_FILE_MODE_WRITE, 0);
+  if (!EFI_ERROR(Status))
+  {
+    File->Delete(File);
+  }
+
+  Status = Root->Open(Root, &File, BENCH_CSV_FILE_NAME, EFI_FILE_MODE_READ | EFI_FILE_MODE_WRITE | EFI_FILE_MODE_CREATE, 0);
+  Root->Close(Root);
+  if (EFI_ERROR(Status))
+  {
+    DEBUG((EFI_D_ERROR, "OpenCsvFile: Failed to create %s: %r\n", BENCH_CSV_FILE_NAME, Status));
+    return NULL;
+  }
+
+  return File;
+}
+
+/// @brief Appends a line to the CSV file
+STATIC
+VOID
+WriteCsvLine(
+    IN BENCH_CONTEXT *Bench,
+    IN CHAR8 *Line)
+{
+  UINTN Size = AsciiStrLen(Line);
+
+  if (Bench->Csv != NULL)
+  {
+    Bench->Csv->Write(Bench->Csv, &Size, Line);
+  }
+}
+
+/// @brief Converts time stamp counter cycles to nanoseconds without overflowing for long runs
+STATIC
+UINT64
+CyclesToNanoseconds(
+    IN BENCH_CONTEXT *Bench,
+    IN UINT64 Cycles)
+{
+  UINT64 Seconds;
+  UINT64 Remainder;
+
+  Seconds = DivU64x64Remainder(Cycles, Bench->TscFrequency, &Remainder);
+  return MultU64x32(Seconds, 1000000000) + DivU64x64Remainder(MultU64x32(Remainder, 1000000000), Bench->TscFrequency, NULL);
+}
+
+/// @brief Prints the result of a workload and appends it to the CSV file
+/// @param Bench The benchmark context
+/// @param Workload Name of the measured function
+/// @param Parameters Parameters of the workload, without commas
+/// @param Operations Number of measured calls
+/// @param Pixels Pixels written to the back buffer by all calls
+/// @param BltBytes Bytes copied to the video buffer by all calls
+/// @param Cycles Time stamp counter cycles spent in all calls
+STATIC
+VOID
+ReportResult(
+    IN BENCH_CONTEXT *Bench,
+    IN CONST CHAR8 *Workload,
+    IN CONST CHAR8 *Parameters,
+    IN UINT64 Operations,
+    IN UINT64 Pixels,
+    IN UINT64 BltBytes,
+    IN UINT64 Cycles)
+{
+  CHAR8 Line[160];
+  CHAR8 Processors[16];
+  UINT64 Nanoseconds;
+
+  Nanoseconds = MAX(CyclesToNanoseconds(Bench, Cycles), 1);
+
+  Processors[0] = '\0';
+  if (Bench->Processors > 1)
+  {
+    AsciiSPrint(Processors, sizeof(Processors), " mp %u", Bench->Processors);
+  }
+
+  // Pixels and bytes per nanosecond times 1000 are millions per second
+  AsciiSPrint(Line, sizeof(Line), "%a,%a%a,%lu,%lu,%lu,%lu\n",
+              Workload,
+              Parameters,
+              Processors,
+              Operations,
+              DivU64x64Remainder(Nanoseconds, Operations, NULL),
+              DivU64x64Remainder(MultU64x32(Pixels, 1000), Nanoseconds, NULL),
+              DivU64x64Remainder(MultU64x32(BltBytes, 1000), Nanoseconds, NULL));
+
+  Print(L"%a", Line);
+  WriteCsvLine(Bench, Line);
+}
+
+/// @brief Measures DrawRectangle for square sizes from a single pixel to larger than the screen
+STATIC
+VOID
+BenchmarkDrawRectangle(
+    IN BENCH_CONTEXT *Bench)
+{
+  GAME_GRAPHICS_LIB_DATA *Data = Bench->Data;
+  EFI_GRAPHICS_OUTPUT_BLT_PIXEL Color = {32, 64, 128, 0};
+  UINT32 Sizes[] = {1, 8, 64, 256, 1024};
+  CHAR8 Parameters[32];
+  UINT64 Start;
+  UINT64 Cycles;
+  UINT64 Pixels;
+
+  for (UINTN i = 0; i < ARRAY_SIZE(Sizes); i++)
+  {
+    Start = AsmReadTsc();
+    for (UINT32 j = 0; j < Bench->Iterations; j++)
+    {
+      Color.Blue = (UINT8)j;
+      DrawRectangle(Data, 0, 0, Sizes[i], Sizes[i], &Color);
+    }
+    // Large fills may still be running on the application processors
+    WaitForRenderJobs(Data);
+    Cycles = AsmReadTsc() - Start;
+
+    // Rectangles are clipped to the screen, so only the visible pixels count
+    Pixels = MultU64x32((UINT64)MIN(Sizes[i], Data->Screen.HorizontalResolution) * MIN(Sizes[i], Data->Screen.VerticalResolution), Bench->Iterations);
+    AsciiSPrint(Parameters, sizeof(Parameters), "%ux%u", Sizes[i], Sizes[i]);
+    ReportResult(Bench, "DrawRectangle", Parameters, Bench->Iterations, Pixels, 0, Cycles);
+  }
+
+  // The damage of the workload is not part of the next one
+  UpdateVideoBuffer(Data);
+}
+
+/// @brief Measures ClearScreen
+STATIC
+VOID
+BenchmarkClearScreen(
+    IN BENCH_CONTEXT *Bench)
+{
+  GAME_GRAPHICS_LIB_DATA *Data = Bench->Data;
+  UINT64 Start;
+  UINT64 Cycles;
+  UINT64 Pixels;
+
+  Start = AsmReadTsc();
+  for (UINT32 j = 0; j < Bench->Iterations; j++)
+  {
+    ClearScreen(Data);
+  }
+  WaitForRenderJobs(Data);
+  Cycles = AsmReadTsc() - Start;
+
+  Pixels = MultU64x32((UINT64)Data->Screen.HorizontalResolution * Data->Screen.VerticalResolution, Bench->Iterations);
+  ReportResult(Bench, "ClearScreen", "full", Bench->Iterations, Pixels, 0, Cycles);
+
+  UpdateVideoBuffer(Data);
+}
+
+/// @brief Measures DrawText for every size multiplier used by the applications
+STATIC
+VOID
+BenchmarkDrawText(
+    IN BENCH_CONTEXT *Bench)
+{
+  GAME_GRAPHICS_LIB_DATA *Data = Bench->Data;
+  EFI_GRAPHICS_OUTPUT_BLT_PIXEL White = {255, 255, 255, 0};
+  EFI_GRAPHICS_OUTPUT_BLT_PIXEL Black = {0, 0, 0, 0};
+  UINT32 Scales[] = {1, 2, 4};
+  UINT32 Length = sizeof(BENCH_TEXT) - 1;
+  CHAR8 Parameters[32];
+  UINT64 Start;
+  UINT64 Cycles;
+  UINT64 Pixels;
+
+  for (UINTN i = 0; i < ARRAY_SIZE(Scales); i++)
+  {
+    // The first call fills the glyph cache, the measured calls are the steady state of a game
+    DrawText(Data, 0, 0, BENCH_TEXT, &White, &Black, Scales[i]);
+
+    Start = AsmReadTsc();
+    for (UINT32 j = 0; j < Bench->Iterations; j++)
+    {
+      DrawText(Data, 0, 0, BENCH_TEXT, &White, &Black, Scales[i]);
+    }
+    Cycles = AsmReadTsc() - Start;
+
+    Pixels = MultU64x32((UINT64)MIN(Length * 8 * Scales[i], Data->Screen.HorizontalResolution) * MIN(8 * Scales[i], Data->Screen.VerticalResolution), Bench->Iterations);
+    AsciiSPrint(Parameters, sizeof(Parameters), "%u chars scale %u", Length, Scales[i]);
+    ReportResult(Bench, "DrawText", Parameters, Bench->Iterations, Pixels, 0, Cycles);
+  }
+
+  UpdateVideoBuffer(Data);
+}
+
+/// @brief Measures DrawGrid for several grid sizes with a small, a medium and a full fraction of the cells changing every frame
+STATIC
+VOID
+BenchmarkDrawGrid(
+    IN BENCH_CONTEXT *Bench)
+{
+  GAME_GRAPHICS_LIB_DATA *Data = Bench->Data;
+  GAME_GRAPHICS_LIB_GRID Grid;
+  EFI_GRAPHICS_OUTPUT_BLT_PIXEL Color = {0, 0, 0, 0};
+  UINT32 GridSizes[][2] = {{60, 50}, {200, 150}, {1000, 1000}};
+  UINT32 ChurnPercent[] = {1, 10, 100};
+  UINT32 Cells;
+  UINT32 Changes;
+  UINT32 Random = 1;
+  CHAR8 Parameters[32];
+  UINT64 ScreenPixels;
+  UINT64 Start;
+  UINT64 Cycles;
+  UINT64 Repainted;
+  UINTN RepaintedCells;
+
+  ScreenPixels = (UINT64)Data->Screen.HorizontalResolution * Data->Screen.VerticalResolution;
+
+  for (UINTN i = 0; i < ARRAY_SIZE(GridSizes); i++)
+  {
+    if (EFI_ERROR(CreateCustomGrid(&Grid, Data->Screen.HorizontalResolution, Data->Screen.VerticalResolution, GridSizes[i][0], GridSizes[i][1], NULL)))
+    {
+      DEBUG((EFI_D_ERROR, "BenchmarkDrawGrid: Failed to create a %ux%u grid\n", GridSizes[i][0], GridSizes[i][1]));
+      continue;
+    }
+
+    Cells = GridSizes[i][0] * GridSizes[i][1];
+    DrawGrid(Data, &Grid, 0, 0);
+
+    for (UINTN j = 0; j < ARRAY_SIZE(ChurnPercent); j++)
+    {
+      Changes = MAX(Cells / 100 * ChurnPercent[j], 1);
+      Cycles = 0;
+      Repainted = 0;
+
+      for (UINT32 Frame = 0; Frame < Bench->Iterations; Frame++)
+      {
+        Color.Green = (UINT8)Frame;
+        for (UINT32 k = 0; k < Changes; k++)
+        {
+          FillCellInGrid(&Grid, NextRandom(&Random) % GridSizes[i][0], NextRandom(&Random) % GridSizes[i][1], &Color);
+        }
+
+        // Only drawing is measured, marking the cells costs the same for every grid strategy
+        Start = AsmReadTsc();
+        DrawGridEx(Data, &Grid, 0, 0, NULL, 0, &RepaintedCells);
+        Cycles += AsmReadTsc() - Start;
+        Repainted += RepaintedCells;
+      }
+
+      // Cells differ by at most a pixel in size, so the average cell area is close enough
+      AsciiSPrint(Parameters, sizeof(Parameters), "%ux%u churn %u%%", GridSizes[i][0], GridSizes[i][1], ChurnPercent[j]);
+      ReportResult(Bench, "DrawGrid", Parameters, Bench->Iterations, DivU64x64Remainder(MultU64x64(Repainted, ScreenPixels), Cells, NULL), 0, Cycles);
+    }
+
+    DeleteGrid(&Grid);
+    UpdateVideoBuffer(Data);
+  }
+}
+
+/// @brief Measures moving a 600x600 grid, redrawing it at the new position compared to scrolling it on screen
+STATIC
+VOID
+BenchmarkMoveGrid(
+    IN BENCH_CONTEXT *Bench)
+{
+  GAME_GRAPHICS_LIB_DATA *Data = Bench->Data;
+  GAME_GRAPHICS_LIB_GRID Grid;
+  GAME_GRAPHICS_LIB_RECTANGLE Exposed[GAME_GRAPHICS_LIB_MAX_SCROLL_EXPOSED];
+  EFI_GRAPHICS_OUTPUT_BLT_PIXEL Red = {0, 0, 255, 0};
+  EFI_GRAPHICS_OUTPUT_BLT_PIXEL Black = {0, 0, 0, 0};
+  UINTN ExposedCount;
+  INT32 x;
+  INT32 y;
+  INT32 PreviousX;
+  INT32 PreviousY;
+  UINT64 Start;
+  UINT64 Cycles;
+
+  if (EFI_ERROR(CreateCustomGrid(&Grid, 600, 600, 21, 21, NULL)))
+  {
+    DEBUG((EFI_D_ERROR, "BenchmarkMoveGrid: Failed to create the grid\n"));
+    return;
+  }
+
+  for (UINT32 i = 0; i < Grid.VerticalCellsCount; i++)
+  {
+    for (UINT32 j = 0; j < Grid.HorizontalCellsCount; j++)
+    {
+      if ((i + j) % 2 == 0)
+      {
+        FillCellInGrid(&Grid, i, j, &Red);
+      }
+    }
+  }
+
+  for (UINT32 Scroll = 0; Scroll < 2; Scroll++)
+  {
+    ClearScreen(Data);
+    DrawGrid(Data, &Grid, 0, 0);
+    UpdateVideoBuffer(Data);
+    PreviousX = 0;
+    PreviousY = 0;
+
+    // Every frame is presented, a moving grid is only useful on screen
+    ResetPresentStats(Data);
+    Start = AsmReadTsc();
+    for (UINT32 Frame = 1; Frame <= Bench->Iterations; Frame++)
+    {
+      x = (Frame * 12) % 240;
+      y = (Frame * 6) % 120;
+
+      if (Scroll == 1)
+      {
+        ScrollRectangle(Data, MIN(x, PreviousX), MIN(y, PreviousY), 600 + ABS(x - PreviousX), 600 + ABS(y - PreviousY),
+                        x - PreviousX, y - PreviousY, Exposed, &ExposedCount);
+        for (UINTN i = 0; i < ExposedCount; i++)
+        {
+          DrawRectangle(Data, Exposed[i].x, Exposed[i].y, Exposed[i].Width, Exposed[i].Height, &Black);
+        }
+      }
+      else
+      {
+        // Resizing to the same size marks every cell as changed, like creating the grid again
+        DrawRectangle(Data, PreviousX, PreviousY, 600, 600, &Black);
+        ResizeGrid(&Grid, 600, 600);
+        DrawGrid(Data, &Grid, x, y);
+      }
+      PresentDamage(Data);
+
+      PreviousX = x;
+      PreviousY = y;
+    }
+    Cycles = AsmReadTsc() - Start;
+
+    // Bytes moved by the firmware within video memory are not part of PresentStats
+    ReportResult(Bench, "MoveGrid", Scroll == 1 ? "600x600 scroll" : "600x600 redraw", Bench->Iterations,
+                 MultU64x32(600 * 600, Bench->Iterations), Data->PresentStats.TotalBytes, Cycles);
+  }
+
+  DeleteGrid(&Grid);
+}
+
+/// @brief Measures full screen and partial updates of the video buffer in every supported present mode
+STATIC
+VOID
+BenchmarkPresent(
+    IN BENCH_CONTEXT *Bench)
+{
+  GAME_GRAPHICS_LIB_DATA *Data = Bench->Data;
+  UINT32 PartialSizes[] = {16, 64, 256};
+  CHAR8 Parameters[32];
+  UINT32 Width;
+  UINT32 Height;
+
+  for (INT32 Mode = GameGraphicsPresentBlt; Mode <= GameGraphicsPresentDirect; Mode++)
+  {
+    if (EFI_ERROR(SetPresentMode(Data, (GAME_GRAPHICS_LIB_PRESENT_MODE)Mode)))
+    {
+      DEBUG((EFI_D_INFO, "BenchmarkPresent: Present mode %d is not supported\n", Mode));
+      continue;
+    }
+
+    ResetPresentStats(Data);
+    for (UINT32 j = 0; j < Bench->Iterations; j++)
+    {
+      UpdateVideoBuffer(Data);
+    }
+
+    AsciiSPrint(Parameters, sizeof(Parameters), "%a %ux%u",
+                Mode == GameGraphicsPresentBlt ? "blt" : "direct",
+                Data->Screen.HorizontalResolution, Data->Screen.VerticalResolution);
+    ReportResult(Bench, "UpdateVideoBuffer", Parameters, Data->PresentStats.PresentCount,
+                 MultU64x32((UINT64)Data->Screen.HorizontalResolution * Data->Screen.VerticalResolution, Bench->Iterations),
+                 Data->PresentStats.TotalBytes, Data->PresentStats.TotalCycles);
+
+    for (UINTN i = 0; i < ARRAY_SIZE(PartialSizes); i++)
+    {
+      Width = MIN(PartialSizes[i], Data->Screen.HorizontalResolution);
+      Height = MIN(PartialSizes[i], Data->Screen.VerticalResolution);
+
+      ResetPresentStats(Data);
+      for (UINT32 j = 0; j < Bench->Iterations; j++)
+      {
+        SmartUpdateVideoBuffer(Data, 0, 0, Width, Height);
+      }
+
+      AsciiSPrint(Parameters, sizeof(Parameters), "%a %ux%u", Mode == GameGraphicsPresentBlt ? "blt" : "direct", Width, Height);
+      ReportResult(Bench, "SmartUpdateVideoBuffer", Parameters, Data->PresentStats.PresentCount,
+                   MultU64x32((UINT64)Width * Height, Bench->Iterations),
+                   Data->PresentStats.TotalBytes, Data->PresentStats.TotalCycles);
+    }
+  }
+
+  SetPresentMode(Data, GameGraphicsPresentBlt);
+}
+
+/// @brief Measures full screen direct presents with the firmware caching of the framebuffer and with write combining
+STATIC
+VOID
+BenchmarkWriteCombining(
+    IN BENCH_CONTEXT *Bench)
+{
+  GAME_GRAPHICS_LIB_DATA *Data = Bench->Data;
+  CHAR8 Parameters[32];
+  EFI_STATUS Status;
+
+  if (EFI_ERROR(SetPresentMode(Data, GameGraphicsPresentDirect)))
+  {
+    DEBUG((EFI_D_INFO, "BenchmarkWriteCombining: No linear framebuffer\n"));
+    return;
+  }
+
+  for (UINT32 Pass = 0; Pass < 2; Pass++)
+  {
+    if (Pass == 1)
+    {
+      Status = SetFrameBufferWriteCombining(Data, TRUE);
+      if (EFI_ERROR(Status))
+      {
+        DEBUG((EFI_D_INFO, "BenchmarkWriteCombining: Write combining is not available: %r\n", Status));
+        break;
+      }
+    }
+
+    ResetPresentStats(Data);
+    for (UINT32 j = 0; j < Bench->Iterations; j++)
+    {
+      UpdateVideoBuffer(Data);
+    }
+
+    // The bandwidth before and after is the blt_mbytes_per_s column of the two lines
+    AsciiSPrint(Parameters, sizeof(Parameters), "direct %a %ux%u", Pass == 0 ? "fw" : "wc",
+                Data->Screen.HorizontalResolution, Data->Screen.VerticalResolution);
+    ReportResult(Bench, "UpdateVideoBuffer", Parameters, Data->PresentStats.PresentCount,
+                 MultU64x32((UINT64)Data->Screen.HorizontalResolution * Data->Screen.VerticalResolution, Bench->Iterations),
+                 Data->PresentStats.TotalBytes, Data->PresentStats.TotalCycles);
+  }
+
+  // The later benchmarks measure the framebuffer as the firmware set it up
+  SetFrameBufferWriteCombining(Data, FALSE);
+  SetPresentMode(Data, GameGraphicsPresentBlt);
+}
+
+/// @brief Measures frames that repaint the whole screen and present it directly, on the BSP and on a present processor
+STATIC
+VOID
+BenchmarkAsyncPresent(
+    IN BENCH_CONTEXT *Bench)
+{
+  GAME_GRAPHICS_LIB_DATA *Data = Bench->Data;
+  EFI_GRAPHICS_OUTPUT_BLT_PIXEL Color = {0, 0, 0, 0};
+  CHAR8 Parameters[32];
+  UINT64 Pixels;
+  UINT64 Start;
+  UINT64 Cycles;
+
+  if (EFI_ERROR(SetPresentMode(Data, GameGraphicsPresentDirect)))
+  {
+    DEBUG((EFI_D_INFO, "BenchmarkAsyncPresent: No linear framebuffer\n"));
+    return;
+  }
+
+  Pixels = MultU64x32((UINT64)Data->Screen.HorizontalResolution * Data->Screen.VerticalResolution, Bench->Iterations);
+
+  // Without a present processor SwapAndPresent presents on the BSP, which is the baseline
+  for (UINT32 Async = 0; Async < 2; Async++)
+  {
+    if ((Async == 1) && EFI_ERROR(EnableAsyncPresent(Data)))
+    {
+      break;
+    }
+
+    ResetPresentStats(Data);
+    Start = AsmReadTsc();
+    for (UINT32 j = 0; j < Bench->Iterations; j++)
+    {
+      Color.Red = (UINT8)j;
+      DrawRectangle(Data, 0, 0, Data->Screen.HorizontalResolution, Data->Screen.VerticalResolution, &Color);
+      SwapAndPresent(Data);
+    }
+    WaitForPresent(Data);
+    Cycles = AsmReadTsc() - Start;
+
+    AsciiSPrint(Parameters, sizeof(Parameters), "%a %ux%u", Async == 1 ? "async" : "sync",
+                Data->Screen.HorizontalResolution, Data->Screen.VerticalResolution);
+    ReportResult(Bench, "DrawAndSwapAndPresent", Parameters, Bench->Iterations, Pixels, Data->PresentStats.TotalBytes, Cycles);
+
+    if (Async == 1)
+    {
+      DEBUG((EFI_D_INFO, "BenchmarkAsyncPresent: %lu of %lu present cycles hidden\n",
+             Data->PresentStats.AsyncCycles - MIN(Data->PresentStats.AsyncWaitCycles, Data->PresentStats.AsyncCycles),
+             Data->PresentStats.AsyncCycles));
+      DisableAsyncPresent(Data);
+    }
+  }
+
+  SetPresentMode(Data, GameGraphicsPresentBlt);
+  UpdateVideoBuffer(Data);
+}
+
+/// @brief Measures frames drawn at a low render resolution and scaled up to the screen, in every supported present mode
+STATIC
+VOID
+BenchmarkScaledPresent(
+    IN BENCH_CONTEXT *Bench)
+{
+  GAME_GRAPHICS_LIB_DATA *Data = Bench->Data;
+  GAME_GRAPHICS_LIB_SCREEN_DATA Resolutions[] = {{320, 240}, {640, 360}};
+  EFI_GRAPHICS_OUTPUT_BLT_PIXEL Color = {0, 0, 0, 0};
+  CHAR8 Parameters[32];
+  UINT64 Start;
+  UINT64 Cycles;
+
+  for (UINTN i = 0; i < ARRAY_SIZE(Resolutions); i++)
+  {
+    if (EFI_ERROR(SetRenderResolution(Data, Resolutions[i].HorizontalResolution, Resolutions[i].VerticalResolution)))
+    {
+      continue;
+    }
+
+    for (INT32 Mode = GameGraphicsPresentBlt; Mode <= GameGraphicsPresentDirect; Mode++)
+    {
+      if (EFI_ERROR(SetPresentMode(Data, (GAME_GRAPHICS_LIB_PRESENT_MODE)Mode)))
+      {
+        continue;
+      }
+
+      ResetPresentStats(Data);
+      Start = AsmReadTsc();
+      for (UINT32 j = 0; j < Bench->Iterations; j++)
+      {
+        Color.Green = (UINT8)j;
+        DrawRectangle(Data, 0, 0, Data->Screen.HorizontalResolution, Data->Screen.VerticalResolution, &Color);
+        UpdateVideoBuffer(Data);
+      }
+      Cycles = AsmReadTsc() - Start;
+
+      AsciiSPrint(Parameters, sizeof(Parameters), "%a %ux%u x%u", Mode == GameGraphicsPresentBlt ? "blt" : "direct",
+                  Data->Screen.HorizontalResolution, Data->Screen.VerticalResolution, Data->Scale);
+      ReportResult(Bench, "DrawAndUpdateScaled", Parameters, Bench->Iterations,
+                   MultU64x32((UINT64)Data->Output.HorizontalResolution * Data->Output.VerticalResolution, Bench->Iterations),
+                   Data->PresentStats.TotalBytes, Cycles);
+    }
+  }
+
+  // Back to the resolution of the mode for the remaining workloads
+  SetPresentMode(Data, GameGraphicsPresentBlt);
+  SetRenderResolution(Data, 0, 0);
+}
+
+/// @brief Measures frames that repaint the whole screen with 32-bit pixels and with palette indices, in every supported present mode
+STATIC
+VOID
+BenchmarkPalette(
+    IN BENCH_CONTEXT *Bench)
+{
+  GAME_GRAPHICS_LIB_DATA *Data = Bench->Data;
+  EFI_GRAPHICS_OUTPUT_BLT_PIXEL Colors[16];
+  CHAR8 Parameters[32];
+  UINT64 Start;
+  UINT64 Cycles;
+
+  for (UINT32 i = 0; i < ARRAY_SIZE(Colors); i++)
+  {
+    Colors[i].Blue = (UINT8)(i * 16);
+    Colors[i].Green = (UINT8)(255 - i * 16);
+    Colors[i].Red = (UINT8)(i * 8);
+    Colors[i].Reserved = 0;
+  }
+
+  for (UINT32 Palette = 0; Palette < 2; Palette++)
+  {
+    if ((Palette == 1) && EFI_ERROR(EnablePaletteMode(Data, Colors, ARRAY_SIZE(Colors))))
+    {
+      DEBUG((EFI_D_INFO, "BenchmarkPalette: Palette mode is not available\n"));
+      break;
+    }
+
+    for (INT32 Mode = GameGraphicsPresentBlt; Mode <= GameGraphicsPresentDirect; Mode++)
+    {
+      if (EFI_ERROR(SetPresentMode(Data, (GAME_GRAPHICS_LIB_PRESENT_MODE)Mode)))
+      {
+        continue;
+      }
+
+      ResetPresentStats(Data);
+      Start = AsmReadTsc();
+      for (UINT32 j = 0; j < Bench->Iterations; j++)
+      {
+        DrawRectangle(Data, 0, 0, Data->Screen.HorizontalResolution, Data->Screen.VerticalResolution, &Colors[j % ARRAY_SIZE(Colors)]);
+        UpdateVideoBuffer(Data);
+      }
+      Cycles = AsmReadTsc() - Start;
+
+      AsciiSPrint(Parameters, sizeof(Parameters), "%a %a %ux%u", Mode == GameGraphicsPresentBlt ? "blt" : "direct",
+                  Palette == 0 ? "bgra" : "index8", Data->Screen.HorizontalResolution, Data->Screen.VerticalResolution);
+      ReportResult(Bench, "DrawAndUpdatePalette", Parameters, Bench->Iterations,
+                   MultU64x32((UINT64)Data->Screen.HorizontalResolution * Data->Screen.VerticalResolution, Bench->Iterations),
+                   Data->PresentStats.TotalBytes, Cycles);
+    }
+  }
+
+  // The remaining workloads draw 32-bit pixels
+  SetPresentMode(Data, GameGraphicsPresentBlt);
+  DisablePaletteMode(Data);
+}
+
+/// @brief Measures frames that only change a score bar layer above a board layer, and frames that show or hide a keyed overlay
+STATIC
+VOID
+BenchmarkLayers(
+    IN BENCH_CONTEXT *Bench)
+{
+  GAME_GRAPHICS_LIB_DATA *Data = Bench->Data;
+  EFI_GRAPHICS_OUTPUT_BLT_PIXEL Board = {40, 90, 40, 0};
+  EFI_GRAPHICS_OUTPUT_BLT_PIXEL White = {255, 255, 255, 0};
+  EFI_GRAPHICS_OUTPUT_BLT_PIXEL Black = {0, 0, 0, 0};
+  EFI_GRAPHICS_OUTPUT_BLT_PIXEL Key = {255, 0, 255, 0};
+  GAME_GRAPHICS_LIB_LAYER BoardLayer;
+  GAME_GRAPHICS_LIB_LAYER HudLayer;
+  GAME_GRAPHICS_LIB_LAYER OverlayLayer;
+  UINT32 Width = Data->Screen.HorizontalResolution;
+  UINT32 Height = Data->Screen.VerticalResolution;
+  CHAR8 Parameters[32];
+  CHAR8 Text[16];
+  UINT64 Start;
+  UINT64 Cycles;
+
+  if (EFI_ERROR(CreateLayer(Data, &BoardLayer, 0, 32, Width, Height - 32, 0)))
+  {
+    DEBUG((EFI_D_INFO, "BenchmarkLayers: Layers are not available\n"));
+    return;
+  }
+  CreateLayer(Data, &HudLayer, 0, 0, Width, 32, 1);
+  CreateLayer(Data, &OverlayLayer, 0, 0, Width, Height, 2);
+  SetLayerColorKey(Data, &OverlayLayer, &Key);
+
+  BeginLayerDrawing(Data, &BoardLayer);
+  DrawRectangle(Data, 0, 0, Width, Height - 32, &Board);
+  EndLayerDrawing(Data);
+  BeginLayerDrawing(Data, &OverlayLayer);
+  DrawRectangle(Data, 0, 0, Width, Height, &Key);
+  DrawText(Data, Width / 2 - 160, Height / 2 - 32, "Game Over!", &White, &Black, 4);
+  EndLayerDrawing(Data);
+  SetLayerVisible(Data, &OverlayLayer, FALSE);
+  UpdateVideoBuffer(Data);
+
+  // A counter in the score bar, like the FPS display of the games
+  ResetPresentStats(Data);
+  Start = AsmReadTsc();
+  for (UINT32 j = 0; j < Bench->Iterations; j++)
+  {
+    AsciiSPrint(Text, sizeof(Text), "%u", j % 1000);
+    BeginLayerDrawing(Data, &HudLayer);
+    DrawText(Data, Width - 56, 8, Text, &White, &Black, 2);
+    EndLayerDrawing(Data);
+    PresentDamage(Data);
+  }
+  Cycles = AsmReadTsc() - Start;
+
+  AsciiSPrint(Parameters, sizeof(Parameters), "hud %ux%u", Width, Height);
+  ReportResult(Bench, "CompositeLayers", Parameters, Bench->Iterations,
+               DivU64x32(Data->PresentStats.TotalBytes, sizeof(EFI_GRAPHICS_OUTPUT_BLT_PIXEL)),
+               Data->PresentStats.TotalBytes, Cycles);
+
+  // Every frame shows or hides the overlay, the board is not drawn again
+  ResetPresentStats(Data);
+  Start = AsmReadTsc();
+  for (UINT32 j = 0; j < Bench->Iterations; j++)
+  {
+    SetLayerVisible(Data, &OverlayLayer, (j % 2) == 0);
+    PresentDamage(Data);
+  }
+  Cycles = AsmReadTsc() - Start;
+
+  AsciiSPrint(Parameters, sizeof(Parameters), "overlay %ux%u", Width, Height);
+  ReportResult(Bench, "CompositeLayers", Parameters, Bench->Iterations,
+               DivU64x32(Data->PresentStats.TotalBytes, sizeof(EFI_GRAPHICS_OUTPUT_BLT_PIXEL)),
+               Data->PresentStats.TotalBytes, Cycles);
+
+  // The back buffer is drawn directly again by the remaining workloads
+  DeleteLayer(Data, &OverlayLayer);
+  DeleteLayer(Data, &HudLayer);
+  DeleteLayer(Data, &BoardLayer);
+  UpdateVideoBuffer(Data);
+}
+
+/**
+  The user Entry Point for Application. The user code starts with this function
+  as the real entry point for the application.
+
+  @param[in] ImageHandle    The firmware allocated handle for the EFI image.
+  @param[in] SystemTable    A pointer to the EFI System Table.
+
+  @retval EFI_SUCCESS       The entry point is executed successfully.
+  @retval other             Some error occurs when executing this entry point.
+
+**/
+EFI_STATUS
+EFIAPI
+UefiGraphicsLibBenchMain(
+    IN EFI_HANDLE ImageHandle,
+    IN EFI_SYSTEM_TABLE *SystemTable)
+{
+  EFI_STATUS Status;
+  GAME_GRAPHICS_LIB_DATA GraphicsLibData;
+  BENCH_CONTEXT Bench;
+
+  Status = InitializeGraphicMode(&GraphicsLibData);
+  if (Status != EFI_SUCCESS)
+  {
+    DEBUG((EFI_D_ERROR, "Failed to enable graphic mode.\n"));
+    return Status;
+  }
+
+  Bench.Data = &GraphicsLibData;
+  Bench.Iterations = MAX(PcdGet32(PcdGraphicsBenchIterations), 1);
+  Bench.Processors = 1;
+  Bench.TscFrequency = CalibrateTsc();
+  Bench.Csv = OpenCsvFile(ImageHandle);
+  if (Bench.Csv == NULL)
+  {
+    Print(L"Results are only printed, %s could not be created\n", BENCH_CSV_FILE_NAME);
+  }
+
+  DEBUG((EFI_D_INFO, "GraphicsLibBench: %ux%u, %u iterations, TSC frequency %lu Hz\n",
+         GraphicsLibData.Screen.HorizontalResolution, GraphicsLibData.Screen.VerticalResolution,
+         Bench.Iterations, Bench.TscFrequency));
+
+  Print(L"%a", BENCH_CSV_HEADER);
+  WriteCsvLine(&Bench, BENCH_CSV_HEADER);
+
+  BenchmarkDrawRectangle(&Bench);
+  BenchmarkClearScreen(&Bench);
+  BenchmarkDrawText(&Bench);
+  BenchmarkDrawGrid(&Bench);
+  BenchmarkMoveGrid(&Bench);
+  BenchmarkPresent(&Bench);
+  BenchmarkWriteCombining(&Bench);
+  BenchmarkAsyncPresent(&Bench);
+  BenchmarkScaledPresent(&Bench);
+  BenchmarkPalette(&Bench);
+  BenchmarkLayers(&Bench);
+
+  // Same workloads again, to compare the scaling with the processor count of the virtual machine
+  if (!EFI_ERROR(EnableParallelRendering(&GraphicsLibData, 0)))
+  {
+    Bench.Processors = GraphicsLibData.RenderProcessors;
+    BenchmarkDrawRectangle(&Bench);
+    BenchmarkClearScreen(&Bench);
+    BenchmarkDrawGrid(&Bench);
+    DisableParallelRendering(&GraphicsLibData);
+  }
+
+  if (Bench.Csv != NULL)
+  {
+    Bench.Csv->Flush(Bench.Csv);
+    Bench.Csv->Close(Bench.Csv);
+  }
+
+  ClearScreen(&GraphicsLibData);
+  UpdateVideoBuffer(&GraphicsLibData);
+  FinishGraphicMode(&GraphicsLibData);
+
+  return EFI_SUCCESS;
+}
@@ -11,8 +11,15 @@
 #include <Library/PrintLib.h>
 #include <Library/MemoryAllocationLib.h>
 #include <Library/DebugLib.h>
+#include <Library/BaseLib.h>
 #include <Library/GameGraphicsLib.h>
 
+#define PRESENT_BENCHMARK_ITERATIONS 100
+#define RECTANGLE_BENCHMARK_ITERATIONS 200
+#define TSC_CALIBRATION_MICROSECONDS 10000
+#define GRID_BENCHMARK_CELLS 1000
+#define GRID_BENCHMARK_FRAMES 20
+
 //
 // String token ID of help message text.
 // Shell supports to find help message in the resource section of an application image if
@@ -23,6 +30,165 @@
 //
 GLOBAL_REMOVE_IF_UNREFERENCED EFI_STRING_ID mStringHelpTokenId = STRING_TOKEN(STR_TEST_HELP_INFORMATION);
 
+/// @brief Per pixel DrawRectangle implementation that the library used before span fills, kept as a benchmark baseline
+STATIC
+VOID
+ReferenceDrawRectangle(
+    IN GAME_GRAPHICS_LIB_DATA *Data,
+    IN INT32 x,
+    IN INT32 y,
+    IN INT32 HorizontalSize,
+    IN INT32 VerticalSize,
+    IN EFI_GRAPHICS_OUTPUT_BLT_PIXEL *Color)
+{
+  for (INT32 i = 0; i < VerticalSize; i++)
+  {
+    for (INT32 j = 0; j < HorizontalSize; j++)
+    {
+      if ((x + j >= (INT32)Data->Screen.HorizontalResolution) ||
+          (y + i >= (INT32)Data->Screen.VerticalResolution) ||
+          (x + j < 0) ||
+          (y + i < 0))
+      {
+        continue;
+      }
+
+      Data->BackBuffer[(y + i) * Data->BackBufferStride + (x + j)] = *Color;
+    }
+  }
+}
+
+/// @brief Measures the time stamp counter frequency against the boot services stall
+/// @return Time stamp counter ticks per second
+STATIC
+UINT64
+CalibrateTsc(
+    VOID)
+{
+  UINT64 Start;
+
+  Start = AsmReadTsc();
+  gBS->Stall(TSC_CALIBRATION_MICROSECONDS);
+  return MultU64x32(AsmReadTsc() - Start, 1000000 / TSC_CALIBRATION_MICROSECONDS);
+}
+
+/// @brief Compares the fill rate of DrawRectangle with the per pixel reference implementation
+/// @param Data The data structure that is used to store the library variables
+STATIC
+VOID
+BenchmarkDrawRectangle(
+    IN GAME_GRAPHICS_LIB_DATA *Data)
+{
+  EFI_GRAPHICS_OUTPUT_BLT_PIXEL Color = {32, 64, 128, 0};
+  UINT32 Sizes[] = {8, 16, 64, 256, 1024};
+  UINT64 TscFrequency;
+  UINT64 Pixels;
+  UINT64 Start;
+  UINT64 ReferenceCycles;
+  UINT64 SpanCycles;
+
+  TscFrequency = CalibrateTsc();
+  DEBUG((EFI_D_INFO, "DrawRectangle benchmark, TSC frequency: %lu Hz\n", TscFrequency));
+
+  for (UINTN i = 0; i < ARRAY_SIZE(Sizes); i++)
+  {
+    Pixels = MultU64x32((UINT64)Sizes[i] * Sizes[i], RECTANGLE_BENCHMARK_ITERATIONS);
+
+    Start = AsmReadTsc();
+    for (INT32 j = 0; j < RECTANGLE_BENCHMARK_ITERATIONS; j++)
+    {
+      ReferenceDrawRectangle(Data, j % 7, j % 5, Sizes[i], Sizes[i], &Color);
+    }
+    ReferenceCycles = AsmReadTsc() - Start + 1;
+
+    Start = AsmReadTsc();
+    for (INT32 j = 0; j < RECTANGLE_BENCHMARK_ITERATIONS; j++)
+    {
+      DrawRectangle(Data, j % 7, j % 5, Sizes[i], Sizes[i], &Color);
+    }
+    SpanCycles = AsmReadTsc() - Start + 1;
+
+    // Pixels are clipped to the screen in both versions, so large sizes report the on screen fill rate
+    DEBUG((EFI_D_INFO, "  %ux%u: reference %lu Mpixels/s, span %lu Mpixels/s\n",
+           Sizes[i], Sizes[i],
+           DivU64x64Remainder(MultU64x64(Pixels, TscFrequency), MultU64x32(ReferenceCycles, 1000000), NULL),
+           DivU64x64Remainder(MultU64x64(Pixels, TscFrequency), MultU64x32(SpanCycles, 1000000), NULL)));
+  }
+
+  ClearScreen(Data);
+}
+
+/// @brief Returns the next value of a linear congruential generator, good enough to pick benchmark cells
+STATIC
+UINT32
+NextRandom(
+    IN OUT UINT32 *State)
+{
+  *State = *State * 1664525 + 1013904223;
+  return *State >> 8;
+}
+
+/// @brief Measures DrawGrid on a large grid with a small and a big fraction of cells changing every frame
+/// @param Data The data structure that is used to store the library variables
+STATIC
+VOID
+BenchmarkDrawGrid(
+    IN GAME_GRAPHICS_LIB_DATA *Data)
+{
+  GAME_GRAPHICS_LIB_GRID Grid;
+  EFI_GRAPHICS_OUTPUT_BLT_PIXEL Color = {0, 0, 0, 0};
+  UINT32 ChurnPercent[] = {1, 50};
+  UINT32 Changes;
+  UINT32 Random = 1;
+  UINT64 TscFrequency;
+  UINT64 Start;
+  UINT64 Cycles;
+  UINTN Repainted;
+
+  if (EFI_ERROR(CreateCustomGrid(&Grid,
+                                 Data->Screen.HorizontalResolution,
+                                 Data->Screen.VerticalResolution,
+                                 GRID_BENCHMARK_CELLS,
+                                 GRID_BENCHMARK_CELLS,
+                                 NULL)))
+  {
+    DEBUG((EFI_D_ERROR, "Failed to create benchmark grid.\n"));
+    return;
+  }
+
+  TscFrequency = CalibrateTsc();
+  DrawGrid(Data, &Grid, 0, 0);
+
+  for (UINTN i = 0; i < ARRAY_SIZE(ChurnPercent); i++)
+  {
+    Changes = GRID_BENCHMARK_CELLS * GRID_BENCHMARK_CELLS / 100 * ChurnPercent[i];
+    Cycles = 0;
+    Repainted = 0;
+
+    for (INT32 Frame = 0; Frame < GRID_BENCHMARK_FRAMES; Frame++)
+    {
+      for (UINT32 j = 0; j < Changes; j++)
+      {
+        Color.Green = (UINT8)Frame;
+        FillCellInGrid(&Grid, NextRandom(&Random) % GRID_BENCHMARK_CELLS, NextRandom(&Random) % GRID_BENCHMARK_CELLS, &Color);
+      }
+
+      // Only drawing is measured, marking the cells is the same for every strategy
+      Start = AsmReadTsc();
+      DrawGridEx(Data, &Grid, 0, 0, NULL, 0, &Repainted);
+      Cycles += AsmReadTsc() - Start;
+    }
+
+    DEBUG((EFI_D_INFO, "DrawGrid %ux%u, %u%% churn: %lu cells, %lu us per frame\n",
+           GRID_BENCHMARK_CELLS, GRID_BENCHMARK_CELLS, ChurnPercent[i],
+           (UINT64)Repainted,
+           DivU64x64Remainder(MultU64x32(Cycles, 1000000), MultU64x32(TscFrequency, GRID_BENCHMARK_FRAMES), NULL)));
+  }
+
+  DeleteGrid(&Grid);
+  ClearScreen(Data);
+}
+
 /**
   The user Entry Point for Application. The user code starts with this function
   as the real entry point for the application.
@@ -82,6 +248,30 @@ UefiGraphicsLibTestMain(
 
   gBS->Stall(3000000);
 
+  BenchmarkDrawRectangle(&GraphicsLibData);
+  BenchmarkDrawGrid(&GraphicsLibData);
+
+  // Comparing the cost of a full screen update for every available present mode
+  for (INT32 Mode = GameGraphicsPresentBlt; Mode <= GameGraphicsPresentDirect; Mode++)
+  {
+    if (EFI_ERROR(SetPresentMode(&GraphicsLibData, (GAME_GRAPHICS_LIB_PRESENT_MODE)Mode)))
+    {
+      DEBUG((EFI_D_INFO, "Present mode %d: unsupported\n", Mode));
+      continue;
+    }
+
+    ResetPresentStats(&GraphicsLibData);
+    for (INT32 i = 0; i < PRESENT_BENCHMARK_ITERATIONS; i++)
+    {
+      UpdateVideoBuffer(&GraphicsLibData);
+    }
+
+    DEBUG((EFI_D_INFO, "Present mode %d: %lu bytes, %lu cycles per update\n",
+           Mode,
+           DivU64x64Remainder(GraphicsLibData.PresentStats.TotalBytes, GraphicsLibData.PresentStats.PresentCount, NULL),
+           DivU64x64Remainder(GraphicsLibData.PresentStats.TotalCycles, GraphicsLibData.PresentStats.PresentCount, NULL)));
+  }
+
   Status = ClearScreen(&GraphicsLibData);
   if (Status != EFI_SUCCESS)
   {
@@ -11,11 +11,244 @@
 #include <Library/MemoryAllocationLib.h>
 #include <Library/DebugLib.h>
 #include <Library/GameGraphicsLib.h>
+#include <Library/GameLoopLib.h>
+#include <Library/GameInputLib.h>
+#include <Library/GameProfileLib.h>
+#include <Library/BaseLib.h>
+#include <Library/BaseMemoryLib.h>
 #include <Snake.h>
 
 // Global constant for console input
 extern EFI_SIMPLE_TEXT_INPUT_PROTOCOL *cin;
 
+/// @brief Returns the direction that keeps the snake on a cycle through every cell of the board
+/// @param head The head of the snake
+/// @return The direction of the next move
+/// @note The cycle runs back and forth through columns 1 and up, row by row, and returns to the top along column 0.
+///       It needs an even number of rows
+STATIC
+Direction
+benchmarkDirection(
+    IN Point head)
+{
+  if (head.x == 0)
+  {
+    return head.y == 0 ? RIGHT : UP;
+  }
+
+  if (head.y % 2 == 0)
+  {
+    return head.x < HORIZONTAL_CELLS - 1 ? RIGHT : DOWN;
+  }
+
+  if (head.x > 1 || head.y == VERTICAL_CELLS - 1)
+  {
+    return LEFT;
+  }
+
+  return DOWN;
+}
+
+/// @brief Grows a snake until it covers the whole board and measures the time of every move
+/// @param body An allocated snake body, its snake is replaced
+/// @param cyclesPerSecond Frequency of the time stamp counter
+/// @note The snake eats on every move, so every move includes placing food on a board that gets fuller each time
+STATIC
+VOID
+benchmarkSnake(
+    IN SnakeBody *body,
+    IN UINT64 cyclesPerSecond)
+{
+  UINT32 worstSize = 0;
+  UINT64 start;
+  UINT64 cycles;
+  UINT64 worstCycles = 0;
+  UINT64 totalCycles = 0;
+  UINT32 moves = 0;
+  BOOLEAN collided;
+  BOOLEAN foodPlaced = TRUE;
+  Point food;
+
+  initSnake(body);
+  snakeAteFood = FALSE;
+
+  for (UINT32 move = 0; move < MAX_SNAKE_SIZE; move++)
+  {
+    start = GetGameLoopCycleCounter();
+
+    collided = moveSnake(body, benchmarkDirection(snakeHead(body)), 0, 0);
+    snakeAteFood = TRUE;
+    foodPlaced = generateRandomPoint(&food, (UINT32)start);
+
+    cycles = GetGameLoopCycleCounter() - start;
+    totalCycles += cycles;
+    moves++;
+    if (cycles > worstCycles)
+    {
+      worstCycles = cycles;
+      worstSize = body->length;
+    }
+
+    if (collided)
+    {
+      DEBUG((EFI_D_ERROR, "benchmarkSnake: Snake collided with itself at length %u\n", body->length));
+      break;
+    }
+  }
+
+  // Once the last move covered the last cell there must be no room left for food
+  if (foodPlaced)
+  {
+    DEBUG((EFI_D_ERROR, "benchmarkSnake: Food was placed on a full board\n"));
+  }
+
+  Print(L"Snake benchmark: length %u, worst move %lu ns at length %u, average move %lu ns\n",
+        body->length,
+        DivU64x64Remainder(MultU64x32(worstCycles, 1000000000), cyclesPerSecond, NULL),
+        worstSize,
+        DivU64x32(DivU64x64Remainder(MultU64x32(totalCycles, 1000000000), cyclesPerSecond, NULL), moves));
+  snakeAteFood = FALSE;
+}
+
+/// @brief Moves the snake, feeds it and places new food
+/// @param game The game context. @see GAME_CONTEXT
+/// @return FALSE once the game is over, because the snake collided with itself or covers the whole board
+STATIC
+BOOLEAN
+advanceSnake(
+    IN GAME_CONTEXT *game)
+{
+  EFI_GRAPHICS_OUTPUT_BLT_PIXEL Red = {0, 0, 255, 0};
+  EFI_GRAPHICS_OUTPUT_BLT_PIXEL Green = {0, 255, 0, 0};
+
+  takeTurn(game);
+  setNewDirection(&game->direction, game->nextDirection);
+
+  if (moveSnake(game->body, game->direction, game->screenWidth, game->screenHeight) && !game->firstMove)
+  {
+    return FALSE;
+  }
+
+  drawSnake(game->Grid, game->body, &Red);
+  snakeAteFood = FALSE;
+
+  // The snake grows by one cell on its next move
+  if (checkIfSnakeAteFood(game->body, game->food))
+  {
+    game->score += 10;
+    snakeAteFood = TRUE;
+
+    // update score text, only its pixels are composited again
+    GAME_PROFILE_BEGIN(game->Profile, GameProfilePhaseText);
+    BeginLayerDrawing(game->GraphicsLibData, game->HudLayer);
+    drawScore(game->GraphicsLibData, gWhite, gBlack, game->score, game->screenWidth, game->screenHeight);
+    EndLayerDrawing(game->GraphicsLibData);
+    GAME_PROFILE_END(game->Profile, GameProfilePhaseText);
+
+    // The time spent sleeping before this frame varies, which makes it a usable seed.
+    // Without a free cell left the snake covers the whole board, which wins the game
+    if (!generateRandomPoint(&game->food, (UINT32)game->Loop->Stats.LastIdleCycles))
+    {
+      game->won = TRUE;
+      return FALSE;
+    }
+  }
+
+  drawFood(game->Grid, game->food, &Green);
+
+  return TRUE;
+}
+
+/// @brief Runs the game logic for one move of the snake
+/// @param Context The game context. @see GAME_CONTEXT
+/// @return EFI_SUCCESS, the game ends by stopping the game loop
+EFI_STATUS
+EFIAPI
+tickGame(
+    IN VOID *Context)
+{
+  GAME_CONTEXT *game = (GAME_CONTEXT *)Context;
+  GAME_INPUT_EVENT event;
+
+  // Every key pressed since the last move is handled, turns are queued so fast double turns are not lost
+  GAME_PROFILE_BEGIN(game->Profile, GameProfilePhaseInput);
+  while (GetGameInputEvent(game->Input, &event) == EFI_SUCCESS)
+  {
+    if (event.Key.ScanCode == SCAN_ESC)
+    {
+      StopGameLoop(game->Loop);
+      GAME_PROFILE_END(game->Profile, GameProfilePhaseInput);
+      return EFI_SUCCESS;
+    }
+
+    game->firstMove = FALSE;
+    queueTurn(game, event.Key);
+  }
+  GAME_PROFILE_END(game->Profile, GameProfilePhaseInput);
+
+  // The move that ends the game is timed as well
+  GAME_PROFILE_BEGIN(game->Profile, GameProfilePhaseLogic);
+  if (!advanceSnake(game))
+  {
+    StopGameLoop(game->Loop);
+  }
+  GAME_PROFILE_END(game->Profile, GameProfilePhaseLogic);
+
+  return EFI_SUCCESS;
+}
+
+/// @brief Draws one frame, the snake head is drawn part of the way into its next cell
+/// @param Context The game context. @see GAME_CONTEXT
+/// @param Alpha Time since the last move of the snake, GAME_LOOP_ALPHA_ONE is a whole move
+/// @return EFI_SUCCESS
+EFI_STATUS
+EFIAPI
+renderFrame(
+    IN VOID *Context,
+    IN UINT32 Alpha)
+{
+  GAME_CONTEXT *game = (GAME_CONTEXT *)Context;
+  EFI_GRAPHICS_OUTPUT_BLT_PIXEL Red = {0, 0, 255, 0};
+
+  game->frames++;
+  GAME_PROFILE_FRAME(game->Profile);
+
+  if (game->FpsContext->Updated)
+  {
+    game->FpsContext->Updated = FALSE;
+    GAME_PROFILE_BEGIN(game->Profile, GameProfilePhaseText);
+    BeginLayerDrawing(game->GraphicsLibData, game->HudLayer);
+    displayFpsCounter(game->GraphicsLibData, game->FpsContext->Fps);
+    EndLayerDrawing(game->GraphicsLibData);
+    GAME_PROFILE_END(game->Profile, GameProfilePhaseText);
+  }
+
+  GAME_PROFILE_BEGIN(game->Profile, GameProfilePhaseGrid);
+  BeginLayerDrawing(game->GraphicsLibData, game->BoardLayer);
+  clearHeadLead(game);
+  DrawGrid(game->GraphicsLibData, game->Grid, 0, 0);
+  drawHeadLead(game, Alpha, &Red);
+  EndLayerDrawing(game->GraphicsLibData);
+  GAME_PROFILE_END(game->Profile, GameProfilePhaseGrid);
+
+  // The frame time graph sits in the middle of the score bar, where it does not cover the board
+  if (FeaturePcdGet(PcdGameProfileEnable))
+  {
+    BeginLayerDrawing(game->GraphicsLibData, game->HudLayer);
+    DrawGameProfileOverlay(game->Profile, game->GraphicsLibData, (INT32)(game->screenWidth - GAME_PROFILE_GRAPH_FRAMES) / 2, 4, BOARD_Y_OFFSET - 8);
+    EndLayerDrawing(game->GraphicsLibData);
+  }
+
+  // Only the cells and text drawn since the last frame are composited and copied to the screen. With asynchronous present the
+  // copy runs on another processor while the next frame is drawn, so the latency does not include it
+  GAME_PROFILE_BEGIN(game->Profile, GameProfilePhasePresent);
+  SwapAndPresent(game->GraphicsLibData);
+  GAME_PROFILE_END(game->Profile, GameProfilePhasePresent);
+  GameInputFramePresented(game->Input);
+
+  return EFI_SUCCESS;
+}
+
 // Entry point for the application so i use UEFI convention
 EFI_STATUS
 EFIAPI SnakeMain(
@@ -24,10 +257,11 @@ EFIAPI SnakeMain(
 {
   // Uefi variables
   EFI_STATUS status;
-  EFI_EVENT FrameTimerEvent;
   EFI_EVENT FpsDisplayEvent;
-  EFI_STATUS keyStatus;
   EFI_INPUT_KEY key;
+  GAME_LOOP Loop;
+  GAME_LOOP_CONFIG LoopConfig;
+  GAME_INPUT Input;
 
   // Colors definitions
   EFI_GRAPHICS_OUTPUT_BLT_PIXEL Red = {0, 0, 255, 0};
@@ -38,26 +272,33 @@ EFIAPI SnakeMain(
   // Game graphics library structures
   GAME_GRAPHICS_LIB_DATA GraphicsLibData;
   GAME_GRAPHICS_LIB_GRID MainGrid;
-  UINT32 screenWidth;
-  UINT32 screenHeight;
+  GAME_GRAPHICS_LIB_LAYER BoardLayer;
+  GAME_GRAPHICS_LIB_LAYER HudLayer;
+  GAME_GRAPHICS_LIB_LAYER MessageLayer;
+  GAME_GRAPHICS_LIB_MODE_REQUEST ModeRequest;
 
   // Game variables
-  Point snakeParts[MAX_SNAKE_SIZE];
-  UINT32 snakeSize = 1;
-  Direction direction = NONE;
-  Direction nextDirection = NONE;
-  BOOLEAN firstMove = TRUE;
-  Point food;
-  UINT32 score = 0;
+  SnakeBody body;
+  GAME_CONTEXT game;
 
   // Frame counting related variables
-  UINT32 subFrames = 0;
-  UINT32 frames = 0;
-  FPS_CONTEXT FpsContext = {&frames, &GraphicsLibData};
+  FPS_CONTEXT FpsContext = {&game.frames, 0, FALSE};
 
   // initialize global variables
   initGlobalVariables(ImageHandle, SystemTable);
 
+  // Failures jump to Exit, which releases everything in reverse order of setup. Releasing what was never set up
+  // does nothing
+  FpsDisplayEvent = NULL;
+  game.Profile = NULL;
+  ZeroMem(&Loop, sizeof(Loop));
+  ZeroMem(&Input, sizeof(Input));
+  ZeroMem(&body, sizeof(body));
+  ZeroMem(&MainGrid, sizeof(MainGrid));
+  ZeroMem(&BoardLayer, sizeof(BoardLayer));
+  ZeroMem(&HudLayer, sizeof(HudLayer));
+  ZeroMem(&MessageLayer, sizeof(MessageLayer));
+
   // Initialize the graphics library
   status = InitializeGraphicMode(&GraphicsLibData);
   if (status != EFI_SUCCESS)
@@ -66,57 +307,159 @@ EFIAPI SnakeMain(
     return status;
   }
 
-  // Create a timer event for the game loop
-  status = gBS->CreateEvent(EVT_TIMER, TPL_NOTIFY, NULL, NULL, &FrameTimerEvent);
+  // The smallest mode the board fits on is the cheapest to present, the firmware mode is kept if none is found
+  ModeRequest.MinHorizontalResolution = MAX(MIN_SCREEN_WIDTH, PcdGet32(PcdSnakeRenderWidth));
+  ModeRequest.MinVerticalResolution = MAX(MIN_SCREEN_HEIGHT, PcdGet32(PcdSnakeRenderHeight));
+  ModeRequest.GridHorizontalCellsCount = HORIZONTAL_CELLS;
+  ModeRequest.GridVerticalCellsCount = VERTICAL_CELLS;
+  ModeRequest.GridVerticalOffset = BOARD_Y_OFFSET;
+  status = SelectGraphicMode(&GraphicsLibData, &ModeRequest);
   if (status != EFI_SUCCESS)
   {
-    Print(L"Failed to create timer event: %r\n", status);
-    return status;
+    DEBUG((EFI_D_WARN, "Failed to select a graphics mode: %r\n", status));
   }
 
-  // Set the timer event to fire every 1/FPS seconds
-  status = gBS->SetTimer(FrameTimerEvent, TimerPeriodic, 10000000 / PcdGet32(PcdTestFramerate));
+  // The board is drawn at a lower resolution if configured, the screen shows it scaled up. Drawing at the
+  // resolution of the mode is fine as well, so a failure is not fatal
+  status = SetRenderResolution(&GraphicsLibData, PcdGet32(PcdSnakeRenderWidth), PcdGet32(PcdSnakeRenderHeight));
   if (status != EFI_SUCCESS)
   {
-    Print(L"Failed to set timer: %r\n", status);
-    gBS->CloseEvent(FrameTimerEvent);
-    return status;
+    DEBUG((EFI_D_WARN, "Failed to set the render resolution: %r\n", status));
+  }
+
+  // Direct presents write the framebuffer a lot faster with write combining, FinishGraphicMode restores the
+  // caching the firmware set up. It can only be changed while no other processor draws or presents
+  status = SetFrameBufferWriteCombining(&GraphicsLibData, TRUE);
+  if (status != EFI_SUCCESS)
+  {
+    DEBUG((EFI_D_WARN, "Failed to enable write combining for the framebuffer: %r\n", status));
+  }
+
+  // Frames are copied to the screen by another processor if the firmware allows it, otherwise SwapAndPresent
+  // presents them right away
+  EnableAsyncPresent(&GraphicsLibData);
+
+  // Create the game loop, the snake moves PcdTestFramerate times per second and the board is drawn
+  // PcdRenderFramerate times per second, the loop sleeps in between
+  LoopConfig.TickRate = PcdGet32(PcdTestFramerate);
+  LoopConfig.RenderRate = PcdGet32(PcdRenderFramerate);
+  LoopConfig.MaxCatchUpTicks = MAX_CATCH_UP_TICKS;
+  LoopConfig.MaxFrameSkip = MAX_FRAME_SKIP;
+  LoopConfig.WaitMode = GameLoopWaitForEvent;
+  status = InitializeGameLoop(&Loop, &LoopConfig);
+  if (status != EFI_SUCCESS)
+  {
+    Print(L"Failed to create game loop: %r\n", status);
+    goto Exit;
+  }
+
+  status = createSnakeBody(&body);
+  if (status != EFI_SUCCESS)
+  {
+    DEBUG((EFI_D_ERROR, "Failed to allocate the snake.\n"));
+    goto Exit;
+  }
+
+  // Benchmark builds only measure the game logic, no game is played
+  if (FeaturePcdGet(PcdSnakeBenchmark))
+  {
+    benchmarkSnake(&body, Loop.Stats.CyclesPerSecond);
+    status = EFI_SUCCESS;
+    goto Exit;
+  }
+
+  // Key strokes are queued with their arrival time from now on
+  status = InitializeGameInput(&Input);
+  if (status != EFI_SUCCESS)
+  {
+    Print(L"Failed to initialize input: %r\n", status);
+    goto Exit;
   }
 
+  game.GraphicsLibData = &GraphicsLibData;
+  game.Grid = &MainGrid;
+  game.BoardLayer = &BoardLayer;
+  game.HudLayer = &HudLayer;
+  game.MessageLayer = &MessageLayer;
+  game.Loop = &Loop;
+  game.Input = &Input;
+  game.FpsContext = &FpsContext;
+  game.body = &body;
+  game.direction = NONE;
+  game.nextDirection = NONE;
+  game.turnCount = 0;
+  game.firstMove = TRUE;
+  game.won = FALSE;
+  game.score = 0;
+  game.frames = 0;
+  game.leadDrawn = FALSE;
+
   // Get the screen resolution variables
-  screenWidth = GraphicsLibData.Screen.HorizontalResolution;
-  screenHeight = GraphicsLibData.Screen.VerticalResolution;
+  game.screenWidth = GraphicsLibData.Screen.HorizontalResolution;
+  game.screenHeight = GraphicsLibData.Screen.VerticalResolution;
 
   // Create the grid used for the game board
-  status = CreateCustomGrid(&MainGrid, screenWidth, screenHeight - 32, HORIZONTAL_CELLS, VERTICAL_CELLS, NULL); // subtract 32 for score display
+  status = CreateCustomGrid(&MainGrid, game.screenWidth, game.screenHeight - BOARD_Y_OFFSET, HORIZONTAL_CELLS, VERTICAL_CELLS, NULL); // subtract the score display
   if (status != EFI_SUCCESS)
   {
     DEBUG((EFI_D_ERROR, "Failed to create grid.\n"));
-    return status;
+    goto Exit;
   }
 
-  // Start screen handling
-  printStartMessage(&GraphicsLibData, White, Black, screenWidth, screenHeight);
-  while (1)
+  // The board, the score bar and the messages are separate layers, so each of them is drawn only when it changes.
+  // The board and the score bar stay hidden behind the start message until the game starts
+  status = CreateLayer(&GraphicsLibData, &BoardLayer, 0, BOARD_Y_OFFSET, game.screenWidth, game.screenHeight - BOARD_Y_OFFSET, 0);
+  if (status == EFI_SUCCESS)
+  {
+    status = CreateLayer(&GraphicsLibData, &HudLayer, 0, 0, game.screenWidth, BOARD_Y_OFFSET, 1);
+  }
+  if (status == EFI_SUCCESS)
   {
-    keyStatus = cin->ReadKeyStroke(cin, &key);
-    if (keyStatus == EFI_SUCCESS)
+    status = CreateLayer(&GraphicsLibData, &MessageLayer, 0, 0, game.screenWidth, game.screenHeight, 2);
+  }
+  if (status != EFI_SUCCESS)
+  {
+    DEBUG((EFI_D_ERROR, "Failed to create layers: %r\n", status));
+    goto Exit;
+  }
+  SetLayerColorKey(&GraphicsLibData, &MessageLayer, &gMessageKey);
+  SetLayerVisible(&GraphicsLibData, &BoardLayer, FALSE);
+  SetLayerVisible(&GraphicsLibData, &HudLayer, FALSE);
+
+  // Profiling builds time every phase of the game, the profile is only allocated for them
+  if (FeaturePcdGet(PcdGameProfileEnable))
+  {
+    game.Profile = AllocatePool(sizeof(GAME_PROFILE));
+    if (game.Profile == NULL || InitializeGameProfile(game.Profile, LoopConfig.RenderRate) != EFI_SUCCESS)
     {
-      break;
+      DEBUG((EFI_D_ERROR, "Failed to initialize the profiler.\n"));
+      status = EFI_OUT_OF_RESOURCES;
+      goto Exit;
     }
   }
 
-  // Initialize the game parameters
-  initSnake(snakeParts, snakeSize);
-  generateRandomPoint(&food, snakeParts, snakeSize, subFrames);
+  // Start screen handling
+  printStartMessage(&GraphicsLibData, &MessageLayer, White, Black, game.screenWidth, game.screenHeight);
+  GameLoopWaitForKey(&Loop, &key);
+  FlushGameInput(&Input);
 
-  // Draw the initial screen state
-  ClearScreen(&GraphicsLibData);
-  drawFood(&MainGrid, food, &Green);
-  drawScore(&GraphicsLibData, White, Black, score, screenWidth, screenHeight);
-  DrawRectangle(&GraphicsLibData, 0, 31, screenWidth, 1, &White);
-  displayFpsCounter(&GraphicsLibData, &frames);
-  DrawGrid(&GraphicsLibData, &MainGrid, 0, 32);
+  // Initialize the game parameters
+  initSnake(&body);
+  generateRandomPoint(&game.food, 0);
+
+  // Draw the initial screen state, the message layer is hidden instead of drawn over
+  drawFood(&MainGrid, game.food, &Green);
+  BeginLayerDrawing(&GraphicsLibData, &HudLayer);
+  drawScore(&GraphicsLibData, White, Black, game.score, game.screenWidth, game.screenHeight);
+  DrawRectangle(&GraphicsLibData, 0, BOARD_Y_OFFSET - 1, game.screenWidth, 1, &White);
+  displayFpsCounter(&GraphicsLibData, 0);
+  EndLayerDrawing(&GraphicsLibData);
+  BeginLayerDrawing(&GraphicsLibData, &BoardLayer);
+  DrawGrid(&GraphicsLibData, &MainGrid, 0, 0);
+  EndLayerDrawing(&GraphicsLibData);
+  SetLayerVisible(&GraphicsLibData, &MessageLayer, FALSE);
+  SetLayerVisible(&GraphicsLibData, &BoardLayer, TRUE);
+  SetLayerVisible(&GraphicsLibData, &HudLayer, TRUE);
   UpdateVideoBuffer(&GraphicsLibData);
 
   // Create a timer event for the FPS display
@@ -124,7 +467,7 @@ EFIAPI SnakeMain(
   if (status != EFI_SUCCESS)
   {
     Print(L"Failed to create timer event: %r\n", status);
-    return status;
+    goto Exit;
   }
 
   // Set the timer event to fire every FPS_DISPLAY_RATE seconds
@@ -132,91 +475,61 @@ EFIAPI SnakeMain(
   if (status != EFI_SUCCESS)
   {
     Print(L"Failed to set timer: %r\n", status);
-    gBS->CloseEvent(FpsDisplayEvent);
-    return status;
+    goto Exit;
   }
 
-  // Main game loop
-  while (1)
+  // Main game loop, runs until the snake collides with itself, covers the whole board or ESC is pressed
+  status = RunGameLoop(&Loop, NULL, tickGame, renderFrame, &game);
+  if (status != EFI_SUCCESS)
   {
-    // Input handling
-    keyStatus = cin->ReadKeyStroke(cin, &key);
-    if (key.ScanCode == SCAN_ESC)
-    {
-      break;
-    }
-    if (keyStatus == EFI_SUCCESS)
-    {
-      firstMove = FALSE;
-      changeDirection(key, &nextDirection);
-    }
-    subFrames++;
-    status = gBS->CheckEvent(FrameTimerEvent);
-    if ((RETURN_STATUS)status == EFI_NOT_READY)
-    {
-      // If event hasn't been signaled, frame is not done yet. Jumping to start of the loop.
-      continue;
-    }
-    frames++;
-
-    //
-    // Game logic
-    //
-
-    setNewDirection(&direction, nextDirection);
-
-    moveSnake(snakeParts, snakeSize, direction, screenWidth, screenHeight);
-    if (checkCollision(snakeParts, snakeSize) && !firstMove)
-    {
-      break;
-    }
-
-    drawSnake(&MainGrid, snakeParts, snakeSize, &Red);
-    snakeAteFood = FALSE;
-
-    if (checkIfSnakeAteFood(snakeParts, snakeSize, food))
-    {
-      snakeSize++;
-      score += 10;
-      snakeAteFood = TRUE;
-      generateRandomPoint(&food, snakeParts, snakeSize, subFrames);
-
-      // update score rectangle
-      drawScore(&GraphicsLibData, White, Black, score, screenWidth, screenHeight);
-      SmartUpdateVideoBuffer(&GraphicsLibData, 112, 8, 96, 16);
-    }
-
-    drawFood(&MainGrid, food, &Green);
-    DrawGrid(&GraphicsLibData, &MainGrid, 0, 32);
-
-    if (snakeAteFood)
-    {
-      UpdateCellInGrid(&GraphicsLibData, &MainGrid, 0, 32, food.x, food.y);
-    }
-
-    UpdateCellInGrid(&GraphicsLibData, &MainGrid, 0, 32, snakeParts[0].x, snakeParts[0].y);
-    UpdateCellInGrid(&GraphicsLibData, &MainGrid, 0, 32, SnakeBeforeBack.x, SnakeBeforeBack.y);
+    DEBUG((EFI_D_ERROR, "Game loop failed: %r\n", status));
+    goto Exit;
+  }
+  DEBUG((EFI_D_INFO, "Game loop: %lu frames, %lu ticks, %lu skipped frames, %lu dropped ticks, %u%% of the time idle\n",
+         Loop.Stats.FrameCount, Loop.Stats.TickCount, Loop.Stats.SkippedFrames, Loop.Stats.DroppedTicks, GetGameLoopIdlePercent(&Loop)));
+  if (Input.Stats.Samples > 0)
+  {
+    DEBUG((EFI_D_INFO, "Input to photon latency: %lu us average, %lu us max, %lu samples\n",
+           DivU64x64Remainder(MultU64x32(DivU64x64Remainder(Input.Stats.TotalLatencyCycles, Input.Stats.Samples, NULL), 1000000), Loop.Stats.CyclesPerSecond, NULL),
+           DivU64x64Remainder(MultU64x32(Input.Stats.MaxLatencyCycles, 1000000), Loop.Stats.CyclesPerSecond, NULL),
+           Input.Stats.Samples));
+  }
+  if (game.Profile != NULL)
+  {
+    GameProfileReport(game.Profile);
   }
 
-  // Cleanup
-  gBS->CloseEvent(FrameTimerEvent);
+  // The FPS counter stops before the game over message covers the board
   gBS->CloseEvent(FpsDisplayEvent);
-  DeleteGrid(&MainGrid);
+  FpsDisplayEvent = NULL;
 
   // Game over screen handling
-  printGameOverMessage(&GraphicsLibData, White, Black, Red, screenWidth, screenHeight, score);
-  while (1)
+  printGameOverMessage(&GraphicsLibData, &MessageLayer, White, Black, Red, game.screenWidth, game.screenHeight, game.score, game.won);
+  GameLoopWaitForKey(&Loop, &key);
+
+Exit:
+  if (FpsDisplayEvent != NULL)
   {
-    keyStatus = cin->ReadKeyStroke(cin, &key);
-    if (keyStatus == EFI_SUCCESS)
-    {
-      break;
-    }
+    gBS->CloseEvent(FpsDisplayEvent);
   }
+  if (game.Profile != NULL)
+  {
+    FreePool(game.Profile);
+  }
+  DeleteLayer(&GraphicsLibData, &MessageLayer);
+  DeleteLayer(&GraphicsLibData, &HudLayer);
+  DeleteLayer(&GraphicsLibData, &BoardLayer);
 
+  // The screen is left black on every path, also when the game loop failed
   ClearScreen(&GraphicsLibData);
   UpdateVideoBuffer(&GraphicsLibData);
+  DeleteGrid(&MainGrid);
+  FinishGameInput(&Input);
+  deleteSnakeBody(&body);
+  FinishGameLoop(&Loop);
+
+  // Stops the async present and restores the framebuffer caching and the mode on every path
   FinishGraphicMode(&GraphicsLibData);
 
-  return EFI_SUCCESS;
-}
\ No newline at end of file
+  return status;
+}
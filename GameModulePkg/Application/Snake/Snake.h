@@ -2,22 +2,50 @@
 #define SNAKE_H
 
 #include <Uefi.h>
+#include <Library/MemoryAllocationLib.h>
 #include <Library/RngLib.h>
 #include <Protocol/Rng.h>
+#include <Library/GameGraphicsLib.h>
+#include <Library/GameLoopLib.h>
+#include <Library/GameInputLib.h>
+#include <Library/GameProfileLib.h>
 
 #define HORIZONTAL_CELLS 60
 #define VERTICAL_CELLS 50
-#define MAX_SNAKE_SIZE HORIZONTAL_CELLS *VERTICAL_CELLS
+#define MAX_SNAKE_SIZE (HORIZONTAL_CELLS * VERTICAL_CELLS)
+
 
 #define FPS_DISPLAY_RATE_SECONDS 3
 #define FPS_DISPLAY_RATE (FPS_DISPLAY_RATE_SECONDS * 10000000)
 
+// Game loop limits, a stalled frame runs at most this many moves, and at most this many frames are skipped in a row
+#define MAX_CATCH_UP_TICKS 3
+#define MAX_FRAME_SKIP 2
+
+// Pixel position of the top of the board, the score is displayed above it
+#define BOARD_Y_OFFSET 32
+
+// Smallest screen the game selects, every cell of the board is at least 10x8 pixels on it
+#define MIN_SCREEN_WIDTH 640
+#define MIN_SCREEN_HEIGHT 480
+
+// Number of turns that can be pressed ahead of the moves of the snake
+#define TURN_QUEUE_SIZE 3
+
 typedef struct Point
 {
     UINT32 x;
     UINT32 y;
 } Point;
 
+/// @brief Cells covered by the snake, stored as a ring buffer so that moving and growing take constant time
+typedef struct SnakeBody
+{
+    Point *parts;  // MAX_SNAKE_SIZE cells, allocated by createSnakeBody
+    UINT32 head;   // Index of the head in parts, the following cells towards the tail wrap around the end of the array
+    UINT32 length; // Number of cells covered by the snake
+} SnakeBody;
+
 typedef enum Direction
 {
     UP,
@@ -30,17 +58,54 @@ typedef enum Direction
 typedef struct FPS_CONTEXT
 {
     UINT32 *FrameCount;
-    GAME_GRAPHICS_LIB_DATA *Data;
+    UINT32 Fps;      // Frames per second measured by the last FPS display event
+    BOOLEAN Updated; // Set by the FPS display event, the game loop redraws the counter and clears it
 } FPS_CONTEXT;
 
+typedef struct GAME_CONTEXT
+{
+    GAME_GRAPHICS_LIB_DATA *GraphicsLibData;
+    GAME_GRAPHICS_LIB_GRID *Grid;
+    GAME_GRAPHICS_LIB_LAYER *BoardLayer;   // The grid, below the score bar
+    GAME_GRAPHICS_LIB_LAYER *HudLayer;     // Score, FPS counter and the separator line above the board
+    GAME_GRAPHICS_LIB_LAYER *MessageLayer; // Start and game over messages, keyed so the layers below show around the text
+    GAME_LOOP *Loop;
+    GAME_INPUT *Input;
+    GAME_PROFILE *Profile; // NULL unless PcdGameProfileEnable is TRUE
+    FPS_CONTEXT *FpsContext;
+    SnakeBody *body;
+    Direction direction;
+    Direction nextDirection;
+    Direction turns[TURN_QUEUE_SIZE]; // Turns pressed but not made yet, the oldest first
+    UINT32 turnCount;                 // Number of valid entries in turns
+    BOOLEAN firstMove;
+    BOOLEAN won; // Set when the snake covers the whole board, which ends the game
+    Point food;
+    UINT32 score;
+    UINT32 frames; // Frames since the last FPS display event, reset by FpsDisplayCallback
+    UINT32 screenWidth;
+    UINT32 screenHeight;
+    BOOLEAN leadDrawn; // TRUE if the head lead was drawn into leadCell during the last frame
+    Point leadCell;    // Cell the head moves into on the next tick
+} GAME_CONTEXT;
+
 EFI_SIMPLE_TEXT_INPUT_PROTOCOL *cin = NULL;
 UINT32 seedBase = 1;
 Point SnakeBeforeBack = {0, 0};
 BOOLEAN snakeAteFood = FALSE;
 
+// Set of the board cells that the snake does not cover. freeCells holds the first freeCellCount cell indices in any order,
+// freeCellPosition holds the position of every cell in freeCells, a position of freeCellCount or more means the cell is covered
+UINT16 freeCells[MAX_SNAKE_SIZE];
+UINT16 freeCellPosition[MAX_SNAKE_SIZE];
+UINT32 freeCellCount = 0;
+
 EFI_GRAPHICS_OUTPUT_BLT_PIXEL gBlack = {0, 0, 0, 0};
 EFI_GRAPHICS_OUTPUT_BLT_PIXEL gWhite = {255, 255, 255, 0};
 
+// Color key of the message layer, the game never draws with it
+EFI_GRAPHICS_OUTPUT_BLT_PIXEL gMessageKey = {255, 0, 255, 0};
+
 void initGlobalVariables(EFI_HANDLE handle, EFI_SYSTEM_TABLE *SystemTable)
 {
     cin = SystemTable->ConIn;
@@ -110,39 +175,143 @@ void updateHead(Point *point, Direction direction)
     }
 }
 
-/// @brief Initializes the snake parts to the default position
-/// @param snakeParts Array of points that represent the snake
-/// @param snakeSize Size of the snake
-void initSnake(Point *snakeParts, UINT32 snakeSize)
+/// @brief Returns the index of a cell in the free cell set
+/// @param point The cell
+/// @return Index of the cell
+UINT32 cellIndex(Point point)
+{
+    return point.y * HORIZONTAL_CELLS + point.x;
+}
+
+/// @brief Checks if a cell is covered by the snake
+/// @param point The cell to check
+/// @return TRUE if the cell is covered by the snake, otherwise FALSE
+BOOLEAN isCellOccupied(Point point)
+{
+    return freeCellPosition[cellIndex(point)] >= freeCellCount;
+}
+
+/// @brief Marks a cell as covered or no longer covered by the snake
+/// @param point The cell to mark
+/// @param occupied TRUE if the snake covers the cell
+/// @note A covered cell is swapped with the last free cell and the set shrinks by one, a freed cell is appended
+void setCellOccupied(Point point, BOOLEAN occupied)
 {
-    for (UINT32 i = 0; i < snakeSize; i++)
+    UINT32 index = cellIndex(point);
+    UINT32 position = freeCellPosition[index];
+    UINT32 last;
+
+    if (occupied == (position >= freeCellCount))
+    {
+        return;
+    }
+
+    if (occupied)
     {
-        snakeParts[i].x = 0;
-        snakeParts[i].y = 0;
+        last = freeCells[freeCellCount - 1];
+        freeCells[position] = (UINT16)last;
+        freeCellPosition[last] = (UINT16)position;
+        freeCellCount--;
+        freeCells[freeCellCount] = (UINT16)index;
+        freeCellPosition[index] = (UINT16)freeCellCount;
+    }
+    else
+    {
+        last = freeCells[freeCellCount];
+        freeCells[position] = (UINT16)last;
+        freeCellPosition[last] = (UINT16)position;
+        freeCells[freeCellCount] = (UINT16)index;
+        freeCellPosition[index] = (UINT16)freeCellCount;
+        freeCellCount++;
     }
 }
 
+/// @brief Allocates the ring buffer of a snake body
+/// @param body The body to allocate
+/// @return EFI_SUCCESS if the function executed successfully, otherwise an error code.
+EFI_STATUS createSnakeBody(SnakeBody *body)
+{
+    body->parts = AllocatePool(MAX_SNAKE_SIZE * sizeof(Point));
+    if (body->parts == NULL)
+    {
+        return EFI_OUT_OF_RESOURCES;
+    }
+
+    body->head = 0;
+    body->length = 0;
+    return EFI_SUCCESS;
+}
+
+/// @brief Frees the ring buffer of a snake body
+/// @param body The body to free
+void deleteSnakeBody(SnakeBody *body)
+{
+    if (body->parts != NULL)
+    {
+        FreePool(body->parts);
+        body->parts = NULL;
+    }
+}
+
+/// @brief Returns the cell of the snake head
+/// @param body The body of the snake
+/// @return The cell of the head
+Point snakeHead(SnakeBody *body)
+{
+    return body->parts[body->head];
+}
+
+/// @brief Returns the cell at the back of the snake
+/// @param body The body of the snake
+/// @return The cell of the tail
+Point snakeTail(SnakeBody *body)
+{
+    return body->parts[(body->head + body->length - 1) % MAX_SNAKE_SIZE];
+}
+
+/// @brief Initializes the snake to a single cell in the top left corner
+/// @param body The body of the snake
+/// @note Also resets the free cell set to every cell but the one of the new snake
+void initSnake(SnakeBody *body)
+{
+    for (UINT32 i = 0; i < MAX_SNAKE_SIZE; i++)
+    {
+        freeCells[i] = (UINT16)i;
+        freeCellPosition[i] = (UINT16)i;
+    }
+    freeCellCount = MAX_SNAKE_SIZE;
+
+    body->head = 0;
+    body->length = 1;
+    body->parts[0].x = 0;
+    body->parts[0].y = 0;
+    setCellOccupied(body->parts[0], TRUE);
+}
+
 /// @brief Draws the snake on the grid
 /// @param grid The grid that will be drawn on
-/// @param snakeParts Array of points that represent the snake
-/// @param snakeSize Size of the snake
+/// @param body The body of the snake
 /// @param color The color of the snake
 /// @return EFI_SUCCESS if the function executed successfully, otherwise an error code.
-EFI_STATUS drawSnake(GAME_GRAPHICS_LIB_GRID *grid, Point *snakeParts, UINT32 snakeSize, EFI_GRAPHICS_OUTPUT_BLT_PIXEL *color)
+/// @note Only the cells that changed during the last move are filled
+EFI_STATUS drawSnake(GAME_GRAPHICS_LIB_GRID *grid, SnakeBody *body, EFI_GRAPHICS_OUTPUT_BLT_PIXEL *color)
 {
     EFI_STATUS status;
+    Point head = snakeHead(body);
+    Point tail = snakeTail(body);
+
     if (!snakeAteFood)
     {
         FillCellInGrid(grid, SnakeBeforeBack.x, SnakeBeforeBack.y, &gBlack);
     }
 
     // filling in last and first cell of the snake
-    status = FillCellInGrid(grid, snakeParts[0].x, snakeParts[0].y, color);
+    status = FillCellInGrid(grid, head.x, head.y, color);
     if (EFI_ERROR(status))
     {
         return status;
     }
-    status = FillCellInGrid(grid, snakeParts[snakeSize - 1].x, snakeParts[snakeSize - 1].y, color);
+    status = FillCellInGrid(grid, tail.x, tail.y, color);
     if (EFI_ERROR(status))
     {
         return status;
@@ -151,25 +320,37 @@ EFI_STATUS drawSnake(GAME_GRAPHICS_LIB_GRID *grid, Point *snakeParts, UINT32 sna
     return EFI_SUCCESS;
 }
 
-/// @brief Moves every snake part to the position of the part in front of it
-/// @param snakeParts Array of points that represent the snake
-/// @param snakeSize Size of the snake
+/// @brief Moves the snake one cell in the current direction
+/// @param body The body of the snake
 /// @param direction Current direction of the snake
 /// @param screenWidth Width of the screen
 /// @param screenHeight Height of the screen
-/// @note Also updates the position of the part of the snake that was at the back of the snake during the last move
-void moveSnake(Point *snakeParts, UINT32 snakeSize, Direction direction, UINT32 screenWidth, UINT32 screenHeight)
+/// @return TRUE if the head moved into a cell that is covered by the snake, otherwise FALSE
+/// @note The new head is pushed in front of the old one and the tail is dropped, the other cells stay where they are
+/// @note If the snake ate during the last move, the tail is kept and the snake grows by one cell.
+///       Otherwise SnakeBeforeBack is updated to the cell the tail left
+/// @note The tail leaves its cell before the head moves, so the head can follow the tail into the cell it just left
+BOOLEAN moveSnake(SnakeBody *body, Direction direction, UINT32 screenWidth, UINT32 screenHeight)
 {
-    if (!snakeAteFood)
-    {
-        SnakeBeforeBack = snakeParts[snakeSize - 1];
-    }
-    for (UINT32 i = snakeSize - 1; i > 0; i--)
+    Point head = snakeHead(body);
+    BOOLEAN collided;
+
+    if (!snakeAteFood || body->length == MAX_SNAKE_SIZE)
     {
-        snakeParts[i] = snakeParts[i - 1];
+        SnakeBeforeBack = snakeTail(body);
+        setCellOccupied(SnakeBeforeBack, FALSE);
+        body->length--;
     }
 
-    updateHead(&snakeParts[0], direction);
+    updateHead(&head, direction);
+    body->head = (body->head + MAX_SNAKE_SIZE - 1) % MAX_SNAKE_SIZE;
+    body->parts[body->head] = head;
+    body->length++;
+
+    collided = isCellOccupied(head);
+    setCellOccupied(head, TRUE);
+
+    return collided;
 }
 
 /// @brief Sets the new direction of the snake based on the current direction and the next direction
@@ -244,64 +425,140 @@ void changeDirection(EFI_INPUT_KEY key, Direction *direction)
     }
 }
 
-/// @brief Checks if the snake collided with itself
-/// @param snakeParts Array of points that represent the snake
-/// @param snakeSize Size of the snake
-/// @return TRUE if the snake collided with itself, otherwise FALSE
-BOOLEAN checkCollision(Point *snakeParts, UINT32 snakeSize)
+/// @brief Queues the turn requested by a key, so that several turns pressed between two moves are all made
+/// @param game The game context
+/// @param key The key that was pressed
+/// @note Turns back into the last queued direction and repeated directions are ignored, as is every turn past TURN_QUEUE_SIZE
+void queueTurn(GAME_CONTEXT *game, EFI_INPUT_KEY key)
+{
+    Direction last = game->turnCount > 0 ? game->turns[game->turnCount - 1] : game->direction;
+    Direction turn = last;
+
+    changeDirection(key, &turn);
+    if (turn == last || game->turnCount == TURN_QUEUE_SIZE)
+    {
+        return;
+    }
+
+    game->turns[game->turnCount] = turn;
+    game->turnCount++;
+}
+
+/// @brief Takes the oldest queued turn as the next direction of the snake
+/// @param game The game context
+void takeTurn(GAME_CONTEXT *game)
 {
-    for (UINT32 i = 1; i < snakeSize; i++)
+    if (game->turnCount == 0)
     {
-        if (snakeParts[0].x == snakeParts[i].x && snakeParts[0].y == snakeParts[i].y)
-        {
-            return TRUE;
-        }
+        return;
+    }
+
+    game->nextDirection = game->turns[0];
+    game->turnCount--;
+    for (UINT32 i = 0; i < game->turnCount; i++)
+    {
+        game->turns[i] = game->turns[i + 1];
+    }
+}
+
+/// @brief Marks the cell covered by the head lead for redrawing, so the next DrawGrid erases the lead
+/// @param game The game context
+void clearHeadLead(GAME_CONTEXT *game)
+{
+    GAME_GRAPHICS_LIB_GRID *grid = game->Grid;
+
+    if (game->leadDrawn)
+    {
+        // Refilling the cell with its own color only makes DrawGrid repaint it
+        FillCellInGrid(grid, game->leadCell.x, game->leadCell.y, &grid->ColorsBitmap[game->leadCell.y * grid->HorizontalCellsCount + game->leadCell.x]);
+        game->leadDrawn = FALSE;
     }
-    return FALSE;
 }
 
-/// @brief Checks if a point is in the snake
-/// @param snakeParts Array of points that represent the snake
-/// @param snakeSize Size of the snake
-/// @param point Point to check
-/// @return TRUE if the point is in the snake, otherwise FALSE
-/// @note This function is used to check if the food is in the snake. Used for point generation
-BOOLEAN checkIfPointIsInSnake(Point *snakeParts, UINT32 snakeSize, Point point)
+/// @brief Draws the part of the next cell that the snake head moved into since the last move
+/// @param game The game context
+/// @param alpha Time since the last move, GAME_LOOP_ALPHA_ONE is the time between two moves
+/// @param color The color of the snake
+/// @note Has to be called after DrawGrid, and clearHeadLead has to be called before the next DrawGrid. Coordinates are the ones of the board layer
+void drawHeadLead(GAME_CONTEXT *game, UINT32 alpha, EFI_GRAPHICS_OUTPUT_BLT_PIXEL *color)
 {
-    for (UINT32 i = 0; i < snakeSize; i++)
+    GAME_GRAPHICS_LIB_GRID *grid = game->Grid;
+    Point next = snakeHead(game->body);
+    UINT32 x;
+    UINT32 y;
+    UINT32 width;
+    UINT32 height;
+    UINT32 lead;
+
+    if (game->direction == NONE)
     {
-        if (snakeParts[i].x == point.x && snakeParts[i].y == point.y)
+        return;
+    }
+
+    updateHead(&next, game->direction);
+    x = grid->ColumnOffsets[next.x];
+    y = grid->RowOffsets[next.y];
+    width = grid->ColumnOffsets[next.x + 1] - x;
+    height = grid->RowOffsets[next.y + 1] - y;
+
+    if (game->direction == LEFT || game->direction == RIGHT)
+    {
+        lead = width * alpha / GAME_LOOP_ALPHA_ONE;
+        if (game->direction == LEFT)
         {
-            return TRUE;
+            x += width - lead;
         }
+        width = lead;
     }
-    return FALSE;
+    else
+    {
+        lead = height * alpha / GAME_LOOP_ALPHA_ONE;
+        if (game->direction == UP)
+        {
+            y += height - lead;
+        }
+        height = lead;
+    }
+
+    if (width == 0 || height == 0)
+    {
+        return;
+    }
+
+    DrawRectangle(game->GraphicsLibData, x, y, width, height, color);
+    game->leadCell = next;
+    game->leadDrawn = TRUE;
 }
 
 /// @brief Generates a random point that is not in the snake
 /// @param point Pointer to the point that will be generated. The point will be updated by the function
-/// @param snakeParts Array of points that represent the snake
-/// @param snakeSize Size of the snake
 /// @param seed Seed for the random number generator.
-void generateRandomPoint(Point *point, Point *snakeParts, UINT32 snakeSize, UINT32 seed)
+/// @return TRUE if a free cell was found, FALSE if the snake covers the whole board
+/// @note Picks one entry of the free cell set, so every free cell is equally likely and the time does not depend on the snake
+BOOLEAN generateRandomPoint(Point *point, UINT32 seed)
 {
-    point->x = simple_rng(seed, 0, HORIZONTAL_CELLS - 1);
-    point->y = simple_rng(seed, 0, VERTICAL_CELLS - 1);
-    while (checkIfPointIsInSnake(snakeParts, snakeSize, *point))
+    UINT32 index;
+
+    if (freeCellCount == 0)
     {
-        point->x = simple_rng(seed, 0, HORIZONTAL_CELLS - 1);
-        point->y = simple_rng(seed, 0, VERTICAL_CELLS - 1);
+        return FALSE;
     }
+
+    index = freeCells[simple_rng(seed, 0, freeCellCount - 1)];
+    point->x = index % HORIZONTAL_CELLS;
+    point->y = index / HORIZONTAL_CELLS;
+    return TRUE;
 }
 
 /// @brief Checks if the snake ate the food in the current game state
-/// @param snakeParts Array of points that represent the snake
-/// @param snakeSize Size of the snake
+/// @param body The body of the snake
 /// @param food Point that represents the food
 /// @return TRUE if the snake head is inside the food, otherwise FALSE
-BOOLEAN checkIfSnakeAteFood(Point *snakeParts, UINT32 snakeSize, Point food)
+BOOLEAN checkIfSnakeAteFood(SnakeBody *body, Point food)
 {
-    if (snakeParts[0].x == food.x && snakeParts[0].y == food.y)
+    Point head = snakeHead(body);
+
+    if (head.x == food.x && head.y == food.y)
     {
         return TRUE;
     }
@@ -317,40 +574,78 @@ void drawFood(GAME_GRAPHICS_LIB_GRID *grid, Point food, EFI_GRAPHICS_OUTPUT_BLT_
     FillCellInGrid(grid, food.x, food.y, color);
 }
 
+/// @brief Clears the message layer to its color key and starts drawing into it
+/// @param GraphicsLibData The data structure that is used to store the library variables
+/// @param messageLayer The layer of the messages, it covers the whole screen
+void beginMessage(GAME_GRAPHICS_LIB_DATA *GraphicsLibData, GAME_GRAPHICS_LIB_LAYER *messageLayer)
+{
+    BeginLayerDrawing(GraphicsLibData, messageLayer);
+    DrawRectangle(GraphicsLibData, 0, 0, messageLayer->Size.HorizontalResolution, messageLayer->Size.VerticalResolution, &gMessageKey);
+}
+
+/// @brief Shows the message drawn since beginMessage on top of the other layers
+/// @param GraphicsLibData The data structure that is used to store the library variables
+/// @param messageLayer The layer of the messages
+void showMessage(GAME_GRAPHICS_LIB_DATA *GraphicsLibData, GAME_GRAPHICS_LIB_LAYER *messageLayer)
+{
+    EndLayerDrawing(GraphicsLibData);
+    SetLayerVisible(GraphicsLibData, messageLayer, TRUE);
+    PresentDamage(GraphicsLibData);
+}
+
+/// @brief Moves a text position left or up without wrapping around
+/// @param position Position the text is placed relative to, like the center of the screen
+/// @param distance Distance to move the text back by
+/// @return position - distance, or 0 if the screen is too small for that
+UINT32 textPosition(UINT32 position, UINT32 distance)
+{
+    return (position > distance) ? position - distance : 0;
+}
+
 /// @brief Prints the start message of the game
 /// @param GraphicsLibData The data structure that is used to store the library variables
+/// @param messageLayer The layer of the messages
 /// @param White The color white
 /// @param Black The color black
 /// @param screenWidth Width of the screen
 /// @param screenHeight Height of the screen
-void printStartMessage(GAME_GRAPHICS_LIB_DATA *GraphicsLibData, EFI_GRAPHICS_OUTPUT_BLT_PIXEL White, EFI_GRAPHICS_OUTPUT_BLT_PIXEL Black, UINT32 screenWidth, UINT32 screenHeight)
+void printStartMessage(GAME_GRAPHICS_LIB_DATA *GraphicsLibData, GAME_GRAPHICS_LIB_LAYER *messageLayer, EFI_GRAPHICS_OUTPUT_BLT_PIXEL White, EFI_GRAPHICS_OUTPUT_BLT_PIXEL Black, UINT32 screenWidth, UINT32 screenHeight)
 {
-    ClearScreen(GraphicsLibData);
-    DrawText(GraphicsLibData, screenWidth / 2 - 272, screenHeight / 2 - 32, "Welcome to Snake!", &White, &Black, 4);
-    DrawText(GraphicsLibData, screenWidth / 2 - 176, screenHeight / 2 + 16, "Use arrow keys to move", &White, &Black, 2);
-    DrawText(GraphicsLibData, screenWidth / 2 - 200, screenHeight / 2 + 48, "Press any key to start...", &White, &Black, 2);
-    UpdateVideoBuffer(GraphicsLibData);
+    beginMessage(GraphicsLibData, messageLayer);
+    DrawText(GraphicsLibData, textPosition(screenWidth / 2, 272), textPosition(screenHeight / 2, 32), "Welcome to Snake!", &White, &Black, 4);
+    DrawText(GraphicsLibData, textPosition(screenWidth / 2, 176), screenHeight / 2 + 16, "Use arrow keys to move", &White, &Black, 2);
+    DrawText(GraphicsLibData, textPosition(screenWidth / 2, 200), screenHeight / 2 + 48, "Press any key to start...", &White, &Black, 2);
+    showMessage(GraphicsLibData, messageLayer);
 }
 
-/// @brief Prints the game over message
+/// @brief Prints the game over message on top of the final board
 /// @param GraphicsLibData The data structure that is used to store the library variables
+/// @param messageLayer The layer of the messages
 /// @param White The color white
 /// @param Black The color black
 /// @param Red The color red
 /// @param screenWidth Width of the screen
 /// @param screenHeight Height of the screen
 /// @param score The current score
-void printGameOverMessage(GAME_GRAPHICS_LIB_DATA *GraphicsLibData, EFI_GRAPHICS_OUTPUT_BLT_PIXEL White, EFI_GRAPHICS_OUTPUT_BLT_PIXEL Black, EFI_GRAPHICS_OUTPUT_BLT_PIXEL Red, UINT32 screenWidth, UINT32 screenHeight, UINT32 score)
+/// @param won TRUE if the game ended because the snake covers the whole board
+void printGameOverMessage(GAME_GRAPHICS_LIB_DATA *GraphicsLibData, GAME_GRAPHICS_LIB_LAYER *messageLayer, EFI_GRAPHICS_OUTPUT_BLT_PIXEL White, EFI_GRAPHICS_OUTPUT_BLT_PIXEL Black, EFI_GRAPHICS_OUTPUT_BLT_PIXEL Red, UINT32 screenWidth, UINT32 screenHeight, UINT32 score, BOOLEAN won)
 {
     CHAR8 textScore[16];
 
     AsciiSPrint(textScore, sizeof(textScore), "%u", score);
-    ClearScreen(GraphicsLibData);
-    DrawText(GraphicsLibData, screenWidth / 2 - 160, screenHeight / 2 - 32, "Game Over!", &Red, &Black, 4);
-    DrawText(GraphicsLibData, screenWidth / 2 - 200, screenHeight / 2 + 16, "Score: ", &White, &Black, 2);
-    DrawText(GraphicsLibData, screenWidth / 2 - 72, screenHeight / 2 + 16, textScore, &White, &Black, 2);
-    DrawText(GraphicsLibData, screenWidth / 2 - 200, screenHeight / 2 + 48, "Press any key to continue...", &White, &Black, 2);
-    UpdateVideoBuffer(GraphicsLibData);
+    beginMessage(GraphicsLibData, messageLayer);
+    if (won)
+    {
+        DrawText(GraphicsLibData, textPosition(screenWidth / 2, 128), textPosition(screenHeight / 2, 32), "You Win!", &White, &Black, 4);
+    }
+    else
+    {
+        DrawText(GraphicsLibData, textPosition(screenWidth / 2, 160), textPosition(screenHeight / 2, 32), "Game Over!", &Red, &Black, 4);
+    }
+    DrawText(GraphicsLibData, textPosition(screenWidth / 2, 200), screenHeight / 2 + 16, "Score: ", &White, &Black, 2);
+    DrawText(GraphicsLibData, textPosition(screenWidth / 2, 72), screenHeight / 2 + 16, textScore, &White, &Black, 2);
+    DrawText(GraphicsLibData, textPosition(screenWidth / 2, 200), screenHeight / 2 + 48, "Press any key to continue...", &White, &Black, 2);
+    showMessage(GraphicsLibData, messageLayer);
 }
 
 /// @brief Draws the score on the screen at constant location
@@ -360,6 +655,7 @@ void printGameOverMessage(GAME_GRAPHICS_LIB_DATA *GraphicsLibData, EFI_GRAPHICS_
 /// @param score The current score
 /// @param screenWidth Width of the screen
 /// @param screenHeight Height of the screen
+/// @note Has to be drawn into the HUD layer, see BeginLayerDrawing
 void drawScore(GAME_GRAPHICS_LIB_DATA *GraphicsLibData, EFI_GRAPHICS_OUTPUT_BLT_PIXEL White, EFI_GRAPHICS_OUTPUT_BLT_PIXEL Black, UINT32 score, UINT32 screenWidth, UINT32 screenHeight)
 {
     CHAR8 textScore[16];
@@ -371,30 +667,29 @@ void drawScore(GAME_GRAPHICS_LIB_DATA *GraphicsLibData, EFI_GRAPHICS_OUTPUT_BLT_
 
 /// @brief Displays the frames per second counter on the screen
 /// @param GraphicsLibData The data structure that is used to store the library variables
-/// @param frames Pointer to the frame count
-/// @note This function is called inside the FPS display callback
-void displayFpsCounter(GAME_GRAPHICS_LIB_DATA *GraphicsLibData, UINT32 *frames)
+/// @param fps The frames per second value to display
+/// @note Has to be drawn into the HUD layer, the counter is presented together with the rest of the frame by PresentDamage
+void displayFpsCounter(GAME_GRAPHICS_LIB_DATA *GraphicsLibData, UINT32 fps)
 {
-    UINT32 FPS = *frames / FPS_DISPLAY_RATE_SECONDS;
     CHAR8 textFPS[16];
 
-    AsciiSPrint(textFPS, sizeof(textFPS), "%u", FPS);
-    DrawText(GraphicsLibData, GraphicsLibData->Screen.HorizontalResolution - 120, 8, "FPS: ", &gWhite, &gBlack, 2);
-    DrawText(GraphicsLibData, GraphicsLibData->Screen.HorizontalResolution - 56, 8, textFPS, &gWhite, &gBlack, 2);
-    SmartUpdateVideoBuffer(GraphicsLibData, GraphicsLibData->Screen.HorizontalResolution - 120, 8, 120, 16);
+    AsciiSPrint(textFPS, sizeof(textFPS), "%u", fps);
+    DrawText(GraphicsLibData, textPosition(GraphicsLibData->Screen.HorizontalResolution, 120), 8, "FPS: ", &gWhite, &gBlack, 2);
+    DrawText(GraphicsLibData, textPosition(GraphicsLibData->Screen.HorizontalResolution, 56), 8, textFPS, &gWhite, &gBlack, 2);
 }
 
 /// @brief Callback function for the FPS display event
 /// @param Event The event that was signaled
-/// @param Context The context that was passed to the event. Contains the frame count and the graphics library data. @see FPS_CONTEXT
+/// @param Context The context that was passed to the event. Contains the frame count and the measured FPS. @see FPS_CONTEXT
 /// @note Also sets frames counter back to 0
+/// @note Drawing is left to the game loop, so that the callback never modifies the back buffer or the damage list in the middle of a frame
 VOID EFIAPI FpsDisplayCallback(IN EFI_EVENT Event, IN VOID *Context)
 {
-    UINT32 *Frames = ((FPS_CONTEXT *)Context)->FrameCount;
-    GAME_GRAPHICS_LIB_DATA *data = ((FPS_CONTEXT *)Context)->Data;
+    FPS_CONTEXT *fpsContext = (FPS_CONTEXT *)Context;
 
-    displayFpsCounter(data, Frames);
-    *Frames = 0;
+    fpsContext->Fps = *fpsContext->FrameCount / FPS_DISPLAY_RATE_SECONDS;
+    fpsContext->Updated = TRUE;
+    *fpsContext->FrameCount = 0;
 }
 
 #endif
\ No newline at end of file
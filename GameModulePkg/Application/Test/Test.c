@@ -12,6 +12,7 @@
 #include <Library/MemoryAllocationLib.h>
 #include <Library/DebugLib.h>
 #include <Library/GameGraphicsLib.h>
+#include <Library/GameLoopLib.h>
 
 //
 // String token ID of help message text.
@@ -23,6 +24,111 @@
 //
 GLOBAL_REMOVE_IF_UNREFERENCED EFI_STRING_ID mStringHelpTokenId = STRING_TOKEN(STR_TEST_HELP_INFORMATION);
 
+// Size of the moving grid in pixels
+#define TEST_GRID_SIZE 600
+
+/// @brief State shared between the entry point and the frame handler
+typedef struct
+{
+  GAME_GRAPHICS_LIB_DATA *GraphicsLibData;
+  GAME_LOOP *Loop;
+  UINT32 FrameCounter; // Number of steps the scene moved
+  GAME_GRAPHICS_LIB_GRID Grid;
+  INT32 GridX;         // Position the grid was drawn at in the previous frame
+  INT32 GridY;
+  BOOLEAN GridDrawn;   // FALSE until the grid was drawn once
+} TEST_CONTEXT;
+
+/// @brief Moves the test scene by one step
+/// @param Context The test context. @see TEST_CONTEXT
+/// @return EFI_SUCCESS, the loop is stopped after PcdTestTimes steps
+STATIC
+EFI_STATUS
+EFIAPI
+TestTick(
+    IN VOID *Context)
+{
+  TEST_CONTEXT *Test = (TEST_CONTEXT *)Context;
+
+  Test->FrameCounter++;
+  if (Test->FrameCounter >= PcdGet32(PcdTestTimes))
+  {
+    StopGameLoop(Test->Loop);
+  }
+
+  return EFI_SUCCESS;
+}
+
+/// @brief Draws one frame of the test scene
+/// @param Context The test context. @see TEST_CONTEXT
+/// @param Alpha Time since the last step, the grid is drawn this far towards its next position
+/// @return EFI_SUCCESS
+STATIC
+EFI_STATUS
+EFIAPI
+TestRender(
+    IN VOID *Context,
+    IN UINT32 Alpha)
+{
+  TEST_CONTEXT *Test = (TEST_CONTEXT *)Context;
+  EFI_GRAPHICS_OUTPUT_BLT_PIXEL Black = {0, 0, 0, 0};
+  EFI_GRAPHICS_OUTPUT_BLT_PIXEL LightGray = {192, 192, 192, 0};
+  GAME_GRAPHICS_LIB_RECTANGLE Exposed[GAME_GRAPHICS_LIB_MAX_SCROLL_EXPOSED];
+  UINTN ExposedCount;
+  INT32 GridX;
+  INT32 GridY;
+
+  //
+  // Here goes stuff that happens once during a frame,
+  // so like rendering, game logic etc.
+  //
+
+  // The grid moves 12 pixels right and 6 pixels down every step
+  GridX = 100 + Test->FrameCounter * 12 + 12 * Alpha / GAME_LOOP_ALPHA_ONE;
+  GridY = 100 + Test->FrameCounter * 6 + 6 * Alpha / GAME_LOOP_ALPHA_ONE;
+
+  if (!Test->GridDrawn)
+  {
+    DrawGrid(Test->GraphicsLibData, &Test->Grid, GridX, GridY);
+    Test->GridDrawn = TRUE;
+  }
+  else if ((GridX != Test->GridX) || (GridY != Test->GridY))
+  {
+    // The area covering the old and the new position is moved on screen, only the strips the grid left are cleared
+    ScrollRectangle(Test->GraphicsLibData,
+                    MIN(GridX, Test->GridX),
+                    MIN(GridY, Test->GridY),
+                    TEST_GRID_SIZE + ABS(GridX - Test->GridX),
+                    TEST_GRID_SIZE + ABS(GridY - Test->GridY),
+                    GridX - Test->GridX,
+                    GridY - Test->GridY,
+                    Exposed,
+                    &ExposedCount);
+    for (UINTN i = 0; i < ExposedCount; i++)
+    {
+      DrawRectangle(Test->GraphicsLibData, Exposed[i].x, Exposed[i].y, Exposed[i].Width, Exposed[i].Height, &Black);
+    }
+  }
+  Test->GridX = GridX;
+  Test->GridY = GridY;
+
+  DrawText(Test->GraphicsLibData,
+           8, 8,
+           "This is a random string of text!",
+           &LightGray,
+           &Black,
+           2);
+
+  PresentDamage(Test->GraphicsLibData);
+
+  DEBUG((EFI_D_INFO, "Step: %d, Idle: %lu of %lu cycles\n",
+         Test->FrameCounter + 1,
+         Test->Loop->Stats.LastIdleCycles,
+         Test->Loop->Stats.LastFrameCycles));
+
+  return EFI_SUCCESS;
+}
+
 /**
   The user Entry Point for Application. The user code starts with this function
   as the real entry point for the application.
@@ -40,30 +146,23 @@ UefiTestMain(
     IN EFI_HANDLE ImageHandle,
     IN EFI_SYSTEM_TABLE *SystemTable)
 {
-  EFI_EVENT FrameTimerEvent;
-  UINT32 FrameCounter;
-  UINT32 SubFramesCounter;
   EFI_STATUS Status;
   GAME_GRAPHICS_LIB_DATA GraphicsLibData;
+  GAME_LOOP Loop;
+  GAME_LOOP_CONFIG LoopConfig;
+  TEST_CONTEXT Test;
   EFI_GRAPHICS_OUTPUT_BLT_PIXEL Red = {0, 0, 255, 0};
-  EFI_GRAPHICS_OUTPUT_BLT_PIXEL Black = {0, 0, 0, 0};
-  EFI_GRAPHICS_OUTPUT_BLT_PIXEL LightGray = {192, 192, 192, 0};
-  GAME_GRAPHICS_LIB_GRID MainGrid;
 
-  // Create a timer event
-  Status = gBS->CreateEvent(EVT_TIMER, TPL_NOTIFY, NULL, NULL, &FrameTimerEvent);
+  // Create the frame loop, the scene moves PcdTestFramerate times per second and is drawn PcdRenderFramerate times per second
+  LoopConfig.TickRate = PcdGet32(PcdTestFramerate);
+  LoopConfig.RenderRate = PcdGet32(PcdRenderFramerate);
+  LoopConfig.MaxCatchUpTicks = 4;
+  LoopConfig.MaxFrameSkip = 2;
+  LoopConfig.WaitMode = GameLoopWaitForEvent;
+  Status = InitializeGameLoop(&Loop, &LoopConfig);
   if (EFI_ERROR(Status))
   {
-    Print(L"Failed to create timer event: %r\n", Status);
-    return Status;
-  }
-
-  // Set the timer to trigger in 1/30th of a second (about 33.33 milliseconds)
-  Status = gBS->SetTimer(FrameTimerEvent, TimerPeriodic, 10000000 / PcdGet32(PcdTestFramerate));
-  if (EFI_ERROR(Status))
-  {
-    Print(L"Failed to set timer: %r\n", Status);
-    gBS->CloseEvent(FrameTimerEvent);
+    Print(L"Failed to create game loop: %r\n", Status);
     return Status;
   }
 
@@ -71,90 +170,55 @@ UefiTestMain(
   if (Status != EFI_SUCCESS)
   {
     DEBUG((EFI_D_ERROR, "Failed to enable graphic mode.\n"));
+    FinishGameLoop(&Loop);
     return Status;
   }
 
   ClearScreen(&GraphicsLibData);
   UpdateVideoBuffer(&GraphicsLibData);
 
-  FrameCounter = 0;
-  SubFramesCounter = 0;
-  // Loop to perform the operation at constant intervals
-  // This will be smth like a main game loop
-  while (FrameCounter < PcdGet32(PcdTestTimes))
-  {
-
-    // This is timer for checking whether its time to finish the frame
-    Status = gBS->CheckEvent(FrameTimerEvent);
-    if ((RETURN_STATUS)Status == EFI_NOT_READY)
-    {
-      SubFramesCounter++;
-
-      //
-      // stuff here happens multiple times in a 'frame' so
-      // do stuff like input handling here
-      //
-      continue;
-    }
-    else if (EFI_ERROR(Status))
-    {
-      DEBUG((EFI_D_ERROR, "Failed to check timer event: %r\n", Status));
-      gBS->CloseEvent(FrameTimerEvent);
-      return Status;
-    }
-
-    //
-    // Here goes stuff that happens once during a frame,
-    // so like rendering, game logic etc.
-    //
-    ClearScreen(&GraphicsLibData);
+  Test.GraphicsLibData = &GraphicsLibData;
+  Test.Loop = &Loop;
+  Test.FrameCounter = 0;
+  Test.GridDrawn = FALSE;
 
-    CreateCustomGrid(&MainGrid,
-                     600, 600,
-                     21, 21,
-                     NULL);
+  // The grid is filled once, moving it later only shifts the pixels already on screen
+  Status = CreateCustomGrid(&Test.Grid, TEST_GRID_SIZE, TEST_GRID_SIZE, 21, 21, NULL);
+  if (EFI_ERROR(Status))
+  {
+    DEBUG((EFI_D_ERROR, "Failed to create grid: %r\n", Status));
+    FinishGraphicMode(&GraphicsLibData);
+    FinishGameLoop(&Loop);
+    return Status;
+  }
 
-    for (INT32 i = 0; i < MainGrid.VerticalCellsCount; i++)
+  for (UINT32 i = 0; i < Test.Grid.VerticalCellsCount; i++)
+  {
+    for (UINT32 j = 0; j < Test.Grid.HorizontalCellsCount; j++)
     {
-      for (INT32 j = 0; j < MainGrid.HorizontalCellsCount; j++)
+      if ((i + j) % 2 == 0)
       {
-        if ((i + j) % 2 == 0)
-        {
-          FillCellInGrid(&MainGrid, i, j, &Red);
-        }
+        FillCellInGrid(&Test.Grid, i, j, &Red);
       }
     }
+  }
 
-    DrawGrid(&GraphicsLibData,
-             &MainGrid,
-             100 + FrameCounter * 12,
-             100 + FrameCounter * 6);
-
-    DeleteGrid(&MainGrid);
-
-    DrawText(&GraphicsLibData,
-             8, 8,
-             "This is a random string of text!",
-             &LightGray,
-             &Black,
-             2);
-
-    UpdateVideoBuffer(&GraphicsLibData);
-
-    // DEBUG ((EFI_D_INFO,"Frame finished."));
-    DEBUG((EFI_D_INFO, "Frame: %d, Subframes: %d\n",
-           FrameCounter + 1,
-           SubFramesCounter + 1));
-    SubFramesCounter = 0;
-    FrameCounter++;
+  // Sleeps between the frames instead of polling the timer, no input handler since the test ignores keys
+  Status = RunGameLoop(&Loop, NULL, TestTick, TestRender, &Test);
+  if (EFI_ERROR(Status))
+  {
+    DEBUG((EFI_D_ERROR, "Game loop failed: %r\n", Status));
   }
+  DEBUG((EFI_D_INFO, "Frames: %lu, skipped: %lu, idle: %u%% of the time\n",
+         Loop.Stats.FrameCount, Loop.Stats.SkippedFrames, GetGameLoopIdlePercent(&Loop)));
 
   ClearScreen(&GraphicsLibData);
   UpdateVideoBuffer(&GraphicsLibData);
 
   // Clean up
-  gBS->CloseEvent(FrameTimerEvent);
+  DeleteGrid(&Test.Grid);
+  FinishGameLoop(&Loop);
   FinishGraphicMode(&GraphicsLibData);
 
-  return EFI_SUCCESS;
+  return Status;
 }
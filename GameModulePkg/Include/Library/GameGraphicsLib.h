@@ -8,10 +8,87 @@
 /// @section Initialization
 /// To use the library, the InitializeGraphicMode function must be called first, and the FinishGraphicMode function must be called after the library is no longer needed.
 ///
+/// @section Mode selection
+/// By default the library uses the mode the firmware left active. SelectGraphicMode enumerates every mode of the
+/// Graphics Output Protocol and switches to the cheapest one that satisfies the needs of the game, described by
+/// GAME_GRAPHICS_LIB_MODE_REQUEST. Modes with fewer pixels, a pixel format the back buffer can be copied to without
+/// conversion, and a size the grid of the game divides evenly are preferred. FinishGraphicMode restores the original mode.
+///
 /// @section Drawing
 /// All drawing functions change the back buffer, which is then copied to the video buffer with an update function.
 /// Therefore to see the changes on the screen, an update function must be called, for example UpdateVideoBuffer.
 /// It is possilble to update only a specific area of the screen, which can be done with the SmartUpdateVideoBuffer function.
+/// The back buffer is allocated in whole pages and its rows are padded to GAME_GRAPHICS_LIB_BACK_BUFFER_ALIGNMENT bytes,
+/// so every row starts on a cache line and vector stores never split one. Row y starts at BackBuffer[y * BackBufferStride],
+/// or at byte y * BackBufferStride of a palette back buffer.
+///
+/// @section Present
+/// By default the back buffer is copied to the screen with the Graphics Output Protocol Blt function.
+/// If the firmware exposes a linear 32-bit framebuffer, SetPresentMode can switch the update functions to write
+/// the changed rows directly into the framebuffer, which skips the firmware Blt implementation entirely.
+/// The back buffer always holds EFI_GRAPHICS_OUTPUT_BLT_PIXEL values, so colors passed to the drawing functions are
+/// used as they are. RGB and PixelBitMask framebuffers get their pixels converted with shift and mask tables derived
+/// from the mode information, see GAME_GRAPHICS_LIB_PIXEL_LAYOUT, by the same streaming copy that writes them.
+/// Firmware often maps the framebuffer uncached, where every streaming store is a separate bus transaction.
+/// SetFrameBufferWriteCombining asks the GCD memory space map for write-combining instead, FinishGraphicMode and
+/// SelectGraphicMode restore the attributes the firmware set.
+/// Every update function records the amount of bytes copied and the time stamp counter cycles it took in PresentStats.
+///
+/// @section Render resolution
+/// SetRenderResolution makes the back buffer smaller than the screen, for example 320x240 or 640x360. Everything is
+/// drawn at that resolution, Screen holds it and all coordinates are in its pixels. The update functions scale every
+/// pixel up by the largest integer factor that fits the screen and center the picture, the borders stay black.
+/// Drawing and damage tracking touch only the small back buffer, so most of the frame time is saved on large screens.
+///
+/// @section Palette
+/// EnablePaletteMode replaces the back buffer with one that stores a single byte per pixel, an index into a palette of
+/// up to GAME_GRAPHICS_LIB_PALETTE_SIZE colors. Games that only use a handful of colors need a quarter of the memory,
+/// and fills, clears, scrolls and back buffer copies move a quarter of the bytes. The drawing functions still take
+/// colors, which are replaced by the index of the closest palette entry before anything is drawn, and grid cells keep
+/// their colors. The update functions expand the indices through lookup tables that hold every palette entry already
+/// in the pixel format of the framebuffer, or of Blt. SetPaletteColors changes entries of the palette, every pixel
+/// drawn with them changes its color with the next present, without drawing anything again.
+///
+/// @section Layers
+/// CreateLayer adds a surface with its own pixels to a stack that is composited onto the back buffer, ordered by the z
+/// value of every layer. Drawing functions called between BeginLayerDrawing and EndLayerDrawing draw into the layer,
+/// with coordinates relative to its top left corner, and record their damage in the damage list of the layer.
+/// Layers can be moved, hidden and reordered without drawing them again, and pixels of a transparent layer that have
+/// its color key let the layers below show through. The update functions first composite every area that some layer
+/// changed since the last present, and only those, then present them like any other damage. While layers exist the
+/// back buffer belongs to the compositor, areas no visible layer covers are black.
+///
+/// @section Asynchronous present
+/// With a linear framebuffer and the MP Services Protocol, EnableAsyncPresent allocates a second back buffer and starts
+/// a present procedure on an application processor. SwapAndPresent then hands the damaged areas of the finished frame
+/// to that processor, which writes them into the framebuffer while the next frame is drawn into the other back buffer.
+/// Before drawing continues, the damaged areas are copied into the other back buffer, so both hold the same picture
+/// as long as everything is drawn with library functions, and applications can keep drawing only what changed. WaitForPresent waits for the copy, every update
+/// function does so on its own. PresentStats.AsyncCycles and AsyncWaitCycles show how much of the copy was hidden.
+/// The present processor sleeps while there is nothing to present, so a game waiting for a key does not keep it busy.
+/// Without a framebuffer or MP services, SwapAndPresent is the same as PresentDamage.
+///
+/// @section Damage
+/// Every drawing function records the area of the back buffer it changed in a damage list stored in the data structure.
+/// Overlapping and adjacent areas are merged, and the list never grows past the limit set by SetMaxDamageRectangles,
+/// instead the two areas whose union wastes the least pixels are merged.
+/// PresentDamage copies exactly the damaged areas to the video buffer and empties the list, so applications do not have
+/// to calculate update rectangles on their own. UpdateVideoBuffer empties the list as well.
+///
+/// @section Scrolling
+/// ScrollRectangle moves the content of an area of the screen, for example a moving grid or a scrolling board.
+/// The firmware moves the pixels within video memory with the Graphics Output Protocol Blt EfiBltVideoToVideo
+/// operation and the back buffer is moved the same way, so nothing has to be drawn or presented again except the
+/// exposed strips the content moved away from, which ScrollRectangle reports to the caller.
+///
+/// @section Parallel rendering
+/// EnableParallelRendering starts a render worker on the application processors reported by the MP Services Protocol.
+/// Large fills, ClearScreen and DrawGrid calls that repaint many cells are then split into horizontal strips, the
+/// workers draw one strip each and the BSP draws the last one. Input and game logic stay on the BSP.
+/// A fill may still be running on the application processors when DrawRectangle or ClearScreen return, every other
+/// drawing and update function waits for it first, so the results are the same as drawing on the BSP alone.
+/// Idle workers sleep, see EnableParallelRendering for the cost of keeping them between jobs.
+/// Without MP services, or without enabled application processors, everything is drawn on the BSP.
 ///
 /// @section Grid
 /// The library provides a grid data structure that allows for easy drawing of a colored grid on the screen.
@@ -20,11 +97,16 @@
 /// Important to note is the fact, that the grid has to be deleted after it is no longer needed, to free the memory allocated by the grid.
 /// The grid can be cleared with the ClearGrid function, which paints all cells black.
 /// The UpdateCellInGrid function is used to update the video buffer with the corresponding area of the back buffer in the data structure at grid coordinates of the specified cell in the grid structure.
+/// Instead of a color, a cell can show a pattern registered with SetGridCellPattern, see FillCellInGridWithPattern.
+/// Every pattern is scaled once to the sizes of the grid cells, so drawing a patterned cell only copies its pixel rows.
 ///
 ///
 /// @section Text
 /// The library provides a function to draw a string of text on the screen. It uses a 8x8 font to draw each character.
 /// The bitmap of the font is located in the Font8x8.h file in the same directory as this file.
+/// Characters are rasterized once for each combination of size multipiler and colors and kept in a glyph cache,
+/// so drawing a character that was drawn before only copies its pixel rows. The memory used by the cache is limited
+/// by a budget, see SetGlyphCacheBudget, and the least recently used characters are evicted first.
 
 /// @brief Data structure that stores the screen resolution
 typedef struct
@@ -33,13 +115,125 @@ typedef struct
     UINT32 VerticalResolution;
 } GAME_GRAPHICS_LIB_SCREEN_DATA;
 
+/// @brief Default memory budget of the glyph cache in bytes
+#define GAME_GRAPHICS_LIB_DEFAULT_GLYPH_CACHE_BUDGET (256 * 1024)
+
+/// @brief Alignment of the back buffer rows in bytes, one cache line
+#define GAME_GRAPHICS_LIB_BACK_BUFFER_ALIGNMENT 64
+
+/// @brief Number of entries of the palette, every back buffer pixel is a UINT8 index if a palette is enabled
+#define GAME_GRAPHICS_LIB_PALETTE_SIZE 256
+
+/// @brief Maximum number of rectangles that can be stored in the damage list
+#define GAME_GRAPHICS_LIB_MAX_DAMAGE_RECTANGLES 32
+
+/// @brief Maximum number of layers that can exist at the same time
+#define GAME_GRAPHICS_LIB_MAX_LAYERS 8
+
+/// @brief Maximum number of areas ScrollRectangle reports as exposed, one band of rows and one band of columns
+#define GAME_GRAPHICS_LIB_MAX_SCROLL_EXPOSED 2
+
+/// @brief Rectangle area on the screen, in pixels
+typedef struct
+{
+    UINT32 x;      // X coordinate of the top left corner
+    UINT32 y;      // Y coordinate of the top left corner
+    UINT32 Width;  // Horizontal size
+    UINT32 Height; // Vertical size
+} GAME_GRAPHICS_LIB_RECTANGLE;
+
+/// @brief Data structure that stores the areas of the back buffer that changed since the last present
+typedef struct
+{
+    GAME_GRAPHICS_LIB_RECTANGLE Rectangles[GAME_GRAPHICS_LIB_MAX_DAMAGE_RECTANGLES]; // Damaged areas, clipped to the screen
+    UINT32 Count;                                                                  // Number of valid entries in Rectangles
+    UINT32 MaxCount;                                                               // Limit of the list, see SetMaxDamageRectangles
+} GAME_GRAPHICS_LIB_DAMAGE;
+
+/// @brief Surface that is composited onto the back buffer, see the Layers section
+/// @details
+/// The pixels are stored like the back buffer, as colors or palette indices, in rows padded to
+/// GAME_GRAPHICS_LIB_BACK_BUFFER_ALIGNMENT bytes. The position, order, visibility and color key are changed with the
+/// layer functions, which damage the areas of the screen that show something else afterwards.
+///
+/// Related functions: CreateLayer, DeleteLayer, BeginLayerDrawing, EndLayerDrawing, MoveLayer, SetLayerOrder, SetLayerVisible, SetLayerColorKey, CompositeLayers
+typedef struct
+{
+    EFI_GRAPHICS_OUTPUT_BLT_PIXEL *Buffer;  // Pixels of the layer, UINT8 palette indices if a palette is enabled
+    UINTN SizeOfBuffer;                     // Size of Buffer in bytes, including the padding of the rows
+    UINT32 Stride;                          // Pixels from one row to the next, at least Size.HorizontalResolution
+    GAME_GRAPHICS_LIB_SCREEN_DATA Size;     // Resolution of the layer
+    INT32 x;                                // Position of the top left corner on the screen, the layer may be partly off screen
+    INT32 y;
+    INT32 z;                                // Layers with a higher z cover the ones with a lower z, equal values keep the order of creation
+    EFI_GRAPHICS_OUTPUT_BLT_PIXEL ColorKey; // Color the layers below show through, the reserved byte is ignored
+    BOOLEAN Transparent;                    // TRUE if pixels of the ColorKey color are not composited
+    BOOLEAN Visible;                        // Hidden layers keep their pixels but are not composited
+    GAME_GRAPHICS_LIB_DAMAGE Damage;        // Areas drawn since the last composition, in pixels of the layer
+} GAME_GRAPHICS_LIB_LAYER;
+
+/// @brief Methods of copying the back buffer to the video buffer
+typedef enum
+{
+    GameGraphicsPresentBlt,   // Graphics Output Protocol Blt BufferToVideo. Works with every pixel format
+    GameGraphicsPresentDirect // Streaming stores straight into the linear framebuffer. Requires a 32-bit BGR, RGB or PixelBitMask format
+} GAME_GRAPHICS_LIB_PRESENT_MODE;
+
+/// @brief Conversion of back buffer pixels to the pixels of a linear framebuffer, derived from the mode information
+/// @details Channel i (blue, green, red) of a back buffer pixel P is stored in the framebuffer as
+///          ((P >> RightShift[i]) & Mask[i]) << LeftShift[i]. Narrow channels keep the top bits of the color,
+///          channels wider than 8 bits get the color in their top bits. Reserved bits are written as 0
+typedef struct
+{
+    UINT32 RightShift[3]; // Moves the kept bits of the channel down to bit 0
+    UINT32 Mask[3];       // Bits of the channel that are kept
+    UINT32 LeftShift[3];  // Moves them to their position in the framebuffer pixel
+} GAME_GRAPHICS_LIB_PIXEL_LAYOUT;
+
+/// @brief Data structure that stores the cost of copying the back buffer to the video buffer
+typedef struct
+{
+    UINT64 LastBytes;    // Bytes copied by the last update function call
+    UINT64 LastCycles;   // Time stamp counter cycles spent in the last update function call
+    UINT64 TotalBytes;   // Bytes copied since the last ResetPresentStats call
+    UINT64 TotalCycles;  // Time stamp counter cycles spent since the last ResetPresentStats call
+    UINT64 PresentCount; // Number of update function calls since the last ResetPresentStats call
+    UINT64 AsyncCycles;     // Part of TotalCycles spent on the present processor, see SwapAndPresent
+    UINT64 AsyncWaitCycles; // Cycles WaitForPresent waited for the present processor, the rest of AsyncCycles was hidden
+} GAME_GRAPHICS_LIB_PRESENT_STATS;
+
 /// @brief Data structure that stores the library variables
 typedef struct
 {
-    EFI_GRAPHICS_OUTPUT_PROTOCOL *GraphicsOutput; // Graphics Output Protocol instance pointer
-    EFI_GRAPHICS_OUTPUT_BLT_PIXEL *BackBuffer;    // Back buffer that will be used to draw on the screen
-    UINTN SizeOfBackBuffer;                       // Size of the back buffer in bytes
-    GAME_GRAPHICS_LIB_SCREEN_DATA Screen;         // Screen data structure
+    EFI_GRAPHICS_OUTPUT_PROTOCOL *GraphicsOutput;  // Graphics Output Protocol instance pointer
+    EFI_GRAPHICS_OUTPUT_BLT_PIXEL *BackBuffer;     // Back buffer that will be used to draw on the screen, UINT8 palette indices if Palette is set
+    EFI_GRAPHICS_OUTPUT_BLT_PIXEL *BackBuffers[2]; // BackBuffer is one of them, the second is NULL unless asynchronous present is enabled
+    UINTN SizeOfBackBuffer;                        // Size of the back buffer in bytes, including the padding of the rows
+    UINT32 BackBufferStride;                       // Pixels from one back buffer row to the next, at least Screen.HorizontalResolution
+    UINT32 BackBufferPixelSize;                    // Bytes per back buffer pixel, 1 if Palette is set, otherwise 4
+    GAME_GRAPHICS_LIB_SCREEN_DATA Screen;          // Screen data structure
+    GAME_GRAPHICS_LIB_PRESENT_MODE PresentMode;    // Method used by the update functions, GameGraphicsPresentBlt by default
+    BOOLEAN DirectPresentSupported;                // TRUE if the current mode allows GameGraphicsPresentDirect
+    EFI_GRAPHICS_PIXEL_FORMAT PixelFormat;         // Pixel format of the current mode
+    UINT32 *FrameBuffer;                           // Linear framebuffer of the current mode, NULL if there is none
+    UINT32 PixelsPerScanLine;                      // Framebuffer stride in pixels
+    UINT64 FrameBufferAttributes;                  // GCD memory attributes the firmware set for the framebuffer, 0 if unknown
+    BOOLEAN FrameBufferWriteCombining;             // TRUE while SetFrameBufferWriteCombining has changed the attributes
+    GAME_GRAPHICS_LIB_PIXEL_LAYOUT PixelLayout;    // Conversion used by direct present, unused for BGR framebuffers
+    GAME_GRAPHICS_LIB_PRESENT_STATS PresentStats;  // Cost of the update functions
+    GAME_GRAPHICS_LIB_DAMAGE Damage;               // Areas changed since the last present
+    VOID *GlyphCache;                              // Rasterized characters, internal to the library
+    VOID *Renderer;                                // Parallel rendering state, internal to the library, NULL if disabled
+    UINT32 RenderProcessors;                       // Processors that draw large operations, including the BSP
+    VOID *Presenter;                               // Asynchronous present state, internal to the library, NULL if disabled
+    VOID *Palette;                                 // Palette of the back buffer, internal to the library, NULL if the back buffer holds colors
+    VOID *Compositor;                              // Layer stack, internal to the library, NULL if no layer exists
+    GAME_GRAPHICS_LIB_SCREEN_DATA Output;          // Resolution of the current mode, larger than Screen if a render resolution is set
+    UINT32 Scale;                                  // Integer factor the back buffer is scaled up by when presented, 1 by default
+    UINT32 OutputX;                                // Left border of the scaled back buffer on screen, the borders stay black
+    UINT32 OutputY;                                // Top border of the scaled back buffer on screen
+    EFI_GRAPHICS_OUTPUT_BLT_PIXEL *ScaledRows;     // Staging rows for Blt presents of a scaled or palette back buffer, NULL if there is neither
+    UINT32 OriginalMode;                           // Mode that was active before InitializeGraphicMode, restored by FinishGraphicMode
 } GAME_GRAPHICS_LIB_DATA;
 
 /// @brief Grid data structure that allows for easy drawing of a colored grid on the screen
@@ -47,7 +241,16 @@ typedef struct
 /// The grid is divided into cells, each cell can be colored with a specific color,
 /// described by the ColorsBitmap field.
 ///
-/// Related functions: CreateCustomGrid, DrawGrid, FillCellInGrid, DeleteGrid, ClearGrid, UpdateCellInGrid
+/// The pixel position of every cell is stored in the ColumnOffsets and RowOffsets tables,
+/// which are built by CreateCustomGrid and ResizeGrid, so the geometry of a cell can be looked up in constant time.
+///
+/// Changed cells are marked in DirtyBitmap, one bit per cell, and their indices are appended to DirtyQueue,
+/// so DrawGrid only visits the cells that changed. If more cells change than the queue can hold,
+/// DrawGrid scans DirtyBitmap a 64 bit word at a time instead.
+///
+/// Cells can show a pattern instead of their color, PatternsBitmap stores the pattern number of every cell.
+///
+/// Related functions: CreateCustomGrid, ResizeGrid, DrawGrid, DrawGridEx, FillCellInGrid, FillCellInGridWithPattern, SetGridCellPattern, DeleteGrid, ClearGrid, UpdateCellInGrid, GetCellAtPosition
 typedef struct
 {
     UINT32 HorizontalSize;                       // Total horizontal size of the grid
@@ -55,19 +258,45 @@ typedef struct
     UINT32 HorizontalCellsCount;                 // Number of horizontal cells in the grid
     UINT32 VerticalCellsCount;                   // Number of vertical cells in the grid
     EFI_GRAPHICS_OUTPUT_BLT_PIXEL *ColorsBitmap; // Bitmap that stores the color of each cell in the grid
-    BOOLEAN *DirtyBitmap;                        // Bitmap that stores the information about which cells have been changed
+    UINT64 *DirtyBitmap;                         // Bitset that stores the information about which cells have been changed
+    UINT32 *DirtyQueue;                          // Indices of the changed cells, valid unless DirtyQueueOverflow is set
+    UINT32 DirtyQueueCount;                      // Number of indices in DirtyQueue
+    UINT32 DirtyQueueSize;                       // Capacity of DirtyQueue
+    BOOLEAN DirtyQueueOverflow;                  // TRUE if DirtyQueue could not hold all changed cells
+    UINT32 *ColumnOffsets;                       // HorizontalCellsCount + 1 pixel offsets of the cell columns, the last one equals HorizontalSize
+    UINT32 *RowOffsets;                          // VerticalCellsCount + 1 pixel offsets of the cell rows, the last one equals VerticalSize
+    UINT8 *PatternsBitmap;                       // Pattern of each cell, 0 if the cell is filled with its color from ColorsBitmap
+    VOID *Patterns;                              // Patterns scaled to the cell sizes, internal to the library, NULL if none was set
 } GAME_GRAPHICS_LIB_GRID;
 
+/// @brief Highest pattern number of a grid, pattern 0 stands for a plain color fill
+#define GAME_GRAPHICS_LIB_MAX_GRID_PATTERNS 255
+
 /// @brief Grid cell pattern data structure
-/// This is used to store the pattern of the cell in the grid
-/// Currently unused
+/// @details
+/// Describes a picture of SizeX x SizeY pixels, stored row by row, that is stretched over a whole cell of the grid.
+/// Because cell sizes are calculated with division with remainder, the cells of a grid have two widths and two heights
+/// that differ by one pixel. SetGridCellPattern scales the pattern to all four combinations with nearest neighbour
+/// sampling, and ResizeGrid scales it again when the cell sizes change.
+///
+/// Related functions: SetGridCellPattern, FillCellInGridWithPattern
 typedef struct
 {
-    UINT32 SizeX;
-    UINT32 SizeY;
-    EFI_GRAPHICS_OUTPUT_BLT_PIXEL *Pattern;
+    UINT32 SizeX;                           // Horizontal size of the pattern
+    UINT32 SizeY;                           // Vertical size of the pattern
+    EFI_GRAPHICS_OUTPUT_BLT_PIXEL *Pattern; // SizeX * SizeY pixels, row by row
 } GAME_GRAPHICS_LIB_GRID_CELL_PATTERN;
 
+/// @brief Needs of a game that SelectGraphicMode picks a mode for
+typedef struct
+{
+    UINT32 MinHorizontalResolution;  // Smallest screen the game can be played on
+    UINT32 MinVerticalResolution;
+    UINT32 GridHorizontalCellsCount; // Cells of the main grid of the game, 0 if it has none
+    UINT32 GridVerticalCellsCount;
+    UINT32 GridVerticalOffset;       // Rows above the grid, like a score display. The grid covers the rest of the screen
+} GAME_GRAPHICS_LIB_MODE_REQUEST;
+
 /// @brief Prints the information of the specific mode of the Graphics Output Protocol
 /// @param ModeInfo The mode information of the Graphics Output Protocol
 /// @return EFI_SUCCESS if the function executed successfully, otherwise an error code.
@@ -76,13 +305,13 @@ EFIAPI
 PrintModeQueryInfo(
     IN EFI_GRAPHICS_OUTPUT_MODE_INFORMATION *ModeInfo);
 
-/// @brief Prints the information of the current mode of the Graphics Output Protocol
-/// @param Mode The mode of the Graphics Output Protocol
+/// @brief Prints the current mode of the Graphics Output Protocol, and the information of every mode it supports
+/// @param GraphicsOutput Graphics Output Protocol instance, every mode is read with QueryMode
 /// @return EFI_SUCCESS if the function executed successfully, otherwise an error code.
 EFI_STATUS
 EFIAPI
 PrintGraphicsOutputProtocolMode(
-    IN EFI_GRAPHICS_OUTPUT_PROTOCOL_MODE *Mode);
+    IN EFI_GRAPHICS_OUTPUT_PROTOCOL *GraphicsOutput);
 
 /// @brief Sets up the library variables to be used in the library.
 /// @param Data The data structure that will be used to store the library variables
@@ -103,6 +332,22 @@ EFIAPI
 FinishGraphicMode(
     IN OUT GAME_GRAPHICS_LIB_DATA *Data);
 
+/// @brief Switches to the cheapest mode of the Graphics Output Protocol that satisfies the request
+/// @param Data The data structure that is used to store the library variables
+/// @param Request Needs of the game
+/// @return EFI_SUCCESS if the function executed successfully, EFI_NOT_FOUND if no mode satisfies the request,
+///         EFI_ALREADY_STARTED if asynchronous present or a render resolution is enabled or a layer exists, otherwise an
+///         error code.
+/// @note Has to be called right after InitializeGraphicMode, before SetRenderResolution. The back buffer is replaced, the render resolution and the
+///       present mode are reset, and the screen is black afterwards
+/// @note The cost of a mode is its pixel count, weighted by how expensive its pixel format is to present to, plus the
+///       pixels that make the cells of the requested grid differ in size. The current mode wins ties
+EFI_STATUS
+EFIAPI
+SelectGraphicMode(
+    IN OUT GAME_GRAPHICS_LIB_DATA *Data,
+    IN GAME_GRAPHICS_LIB_MODE_REQUEST *Request);
+
 /// @brief Draws a color filled rectangle on the screen
 /// @param Data The data structure that is used to store the library variables
 /// @param x x coordinate of the top left corner of the rectangle
@@ -124,6 +369,7 @@ DrawRectangle(
 /// @brief Clears the screen by painting it black
 /// @param Data The data structure that is used to store the library variables
 /// @return EFI_SUCCESS if the function executed successfully, otherwise an error code.
+/// @note With a palette the screen is painted with the entry closest to black
 /// @note Requires using a function that updates the video buffer to see the changes on the screen
 EFI_STATUS
 EFIAPI
@@ -133,7 +379,9 @@ ClearScreen(
 /// @brief Updates the video buffer with the back buffer in the data structure
 /// @param Data The data structure that is used to store the library variables. It contains the back buffer that will be copied to the video buffer
 /// @return EFI_SUCCESS if the function executed successfully, otherwise an error code.
-/// @note This copies the back buffer in data structure to the video buffer using Blt BufferToVideo
+/// @note This copies the back buffer in data structure to the video buffer using Blt BufferToVideo, or directly if GameGraphicsPresentDirect is selected
+/// @note The damage list is emptied, since the whole screen is up to date afterwards
+/// @note Layers are composited first, see CompositeLayers
 EFI_STATUS
 EFIAPI
 UpdateVideoBuffer(
@@ -146,8 +394,10 @@ UpdateVideoBuffer(
 /// @param HorizontalSize Horizontal size of the area that will be updated
 /// @param VerticalSize Vertical size of the area that will be updated
 /// @return EFI_SUCCESS if the function executed successfully, otherwise an error code.
-/// @note This copies the specified area of the back buffer in data structure to the video buffer using Blt BufferToVideo
+/// @note This copies the specified area of the back buffer in data structure to the video buffer using Blt BufferToVideo, or directly if GameGraphicsPresentDirect is selected
+/// @note The area is clipped to the screen, parts of it that are off screen are ignored
 /// @note Using this function is highly preferable to using UpdateVideoBuffer, since it can drastically reduce the amount of bytes that need to be copied to video buffer
+/// @note Layers are composited first, see CompositeLayers
 EFI_STATUS
 EFIAPI
 SmartUpdateVideoBuffer(
@@ -157,6 +407,365 @@ SmartUpdateVideoBuffer(
     IN INT32 HorizontalSize,
     IN INT32 VerticalSize);
 
+/// @brief Selects the method used by the update functions to copy the back buffer to the video buffer
+/// @param Data The data structure that is used to store the library variables
+/// @param Mode The present mode that will be used from now on
+/// @return EFI_SUCCESS if the function executed successfully, EFI_UNSUPPORTED if the current graphics mode has no usable linear framebuffer.
+/// @note GameGraphicsPresentDirect is only available if DirectPresentSupported is TRUE. PixelBltOnly modes, and PixelBitMask
+///       modes with channel masks that are not contiguous, always use Blt.
+EFI_STATUS
+EFIAPI
+SetPresentMode(
+    IN GAME_GRAPHICS_LIB_DATA *Data,
+    IN GAME_GRAPHICS_LIB_PRESENT_MODE Mode);
+
+/// @brief Maps the linear framebuffer write-combining, or restores the attributes the firmware set
+/// @param Data The data structure that is used to store the library variables
+/// @param Enable TRUE to switch the framebuffer to EFI_MEMORY_WC, FALSE to restore FrameBufferAttributes
+/// @return EFI_SUCCESS if the function executed successfully, EFI_UNSUPPORTED if the current mode has no linear
+///         framebuffer or its memory space can not be write-combining, otherwise an error code of the GCD services.
+/// @note Only GameGraphicsPresentDirect writes the framebuffer with the processor, Blt is not affected.
+///       Succeeds without changes if the firmware already mapped the framebuffer write-combining.
+EFI_STATUS
+EFIAPI
+SetFrameBufferWriteCombining(
+    IN GAME_GRAPHICS_LIB_DATA *Data,
+    IN BOOLEAN Enable);
+
+/// @brief Sets all counters in PresentStats back to 0
+/// @param Data The data structure that is used to store the library variables
+/// @return EFI_SUCCESS if the function executed successfully, otherwise an error code.
+EFI_STATUS
+EFIAPI
+ResetPresentStats(
+    IN GAME_GRAPHICS_LIB_DATA *Data);
+
+/// @brief Replaces the back buffer with one of the given resolution, which is scaled up to the screen when presented
+/// @param Data The data structure that is used to store the library variables
+/// @param Width Horizontal resolution of the back buffer, 0 together with Height uses the resolution of the mode
+/// @param Height Vertical resolution of the back buffer
+/// @return EFI_SUCCESS if the function executed successfully, EFI_UNSUPPORTED if the resolution is larger than the
+///         screen, EFI_ALREADY_STARTED if asynchronous present is enabled or a layer exists, otherwise an error code.
+/// @note The new back buffer and the whole screen are black. Grids created before have to be resized to the new Screen
+/// @note Has to be called before EnableAsyncPresent and CreateLayer
+EFI_STATUS
+EFIAPI
+SetRenderResolution(
+    IN GAME_GRAPHICS_LIB_DATA *Data,
+    IN UINT32 Width,
+    IN UINT32 Height);
+
+/// @brief Replaces the back buffer with one that stores palette indices, see the Palette section
+/// @param Data The data structure that is used to store the library variables
+/// @param Colors Colors of the first Count palette entries, the other entries are black
+/// @param Count Number of colors, from 1 to GAME_GRAPHICS_LIB_PALETTE_SIZE
+/// @return EFI_SUCCESS if the function executed successfully, EFI_ALREADY_STARTED if the back buffer has to be
+///         replaced while asynchronous present is enabled or a layer exists, EFI_NOT_READY if a layer is being
+///         drawn, otherwise an error code.
+/// @note The new back buffer holds entry 0 everywhere and the whole screen is black. Calling it again with a palette
+///       enabled only replaces the palette, the back buffer is kept
+/// @note Has to be called before EnableAsyncPresent and CreateLayer. The render resolution is kept
+EFI_STATUS
+EFIAPI
+EnablePaletteMode(
+    IN GAME_GRAPHICS_LIB_DATA *Data,
+    IN CONST EFI_GRAPHICS_OUTPUT_BLT_PIXEL *Colors,
+    IN UINT32 Count);
+
+/// @brief Replaces the palette back buffer with one that stores colors again
+/// @param Data The data structure that is used to store the library variables
+/// @return EFI_SUCCESS if the function executed successfully, EFI_ALREADY_STARTED if asynchronous present is
+///         enabled or a layer exists, otherwise an error code.
+/// @note The new back buffer and the whole screen are black
+EFI_STATUS
+EFIAPI
+DisablePaletteMode(
+    IN GAME_GRAPHICS_LIB_DATA *Data);
+
+/// @brief Changes the colors of palette entries, pixels drawn with them change their color with the next present
+/// @param Data The data structure that is used to store the library variables
+/// @param FirstIndex First entry to change
+/// @param Count Number of entries to change, FirstIndex + Count can not exceed GAME_GRAPHICS_LIB_PALETTE_SIZE
+/// @param Colors New colors of the entries
+/// @return EFI_SUCCESS if the function executed successfully, EFI_NOT_STARTED if no palette is enabled, EFI_NOT_READY
+///         if a layer is being drawn, otherwise an error code.
+/// @note The whole screen is added to the damage list, so PresentDamage shows the new colors
+/// @note Entries past the colors passed to EnablePaletteMode become available to the drawing functions
+EFI_STATUS
+EFIAPI
+SetPaletteColors(
+    IN GAME_GRAPHICS_LIB_DATA *Data,
+    IN UINT32 FirstIndex,
+    IN UINT32 Count,
+    IN CONST EFI_GRAPHICS_OUTPUT_BLT_PIXEL *Colors);
+
+/// @brief Marks an area of the back buffer as changed, so that it will be copied by the next PresentDamage call
+/// @param Data The data structure that is used to store the library variables
+/// @param x X coordinate of the top left corner of the area
+/// @param y Y coordinate of the top left corner of the area
+/// @param HorizontalSize Horizontal size of the area
+/// @param VerticalSize Vertical size of the area
+/// @return EFI_SUCCESS if the function executed successfully, otherwise an error code.
+/// @note All drawing functions of the library call this on their own. It is only needed when the back buffer is modified directly
+EFI_STATUS
+EFIAPI
+AddDamageRectangle(
+    IN GAME_GRAPHICS_LIB_DATA *Data,
+    IN INT32 x,
+    IN INT32 y,
+    IN INT32 HorizontalSize,
+    IN INT32 VerticalSize);
+
+/// @brief Sets the maximum number of rectangles kept in the damage list
+/// @param Data The data structure that is used to store the library variables
+/// @param MaxCount New limit, between 1 and GAME_GRAPHICS_LIB_MAX_DAMAGE_RECTANGLES
+/// @return EFI_SUCCESS if the function executed successfully, EFI_INVALID_PARAMETER if MaxCount is out of range.
+/// @note Lower limits mean fewer, but bigger copies. If the list already holds more rectangles, they are merged
+EFI_STATUS
+EFIAPI
+SetMaxDamageRectangles(
+    IN GAME_GRAPHICS_LIB_DATA *Data,
+    IN UINT32 MaxCount);
+
+/// @brief Copies every damaged area of the back buffer to the video buffer and empties the damage list
+/// @param Data The data structure that is used to store the library variables
+/// @return EFI_SUCCESS if the function executed successfully, otherwise an error code.
+/// @note This uses the present mode selected with SetPresentMode. PresentStats describe the whole call
+/// @note Layers are composited first, see CompositeLayers
+EFI_STATUS
+EFIAPI
+PresentDamage(
+    IN GAME_GRAPHICS_LIB_DATA *Data);
+
+/// @brief Moves the content of an area of the screen and the back buffer by the specified distance
+/// @param Data The data structure that is used to store the library variables
+/// @param x X coordinate of the top left corner of the area, can be negative
+/// @param y Y coordinate of the top left corner of the area, can be negative
+/// @param HorizontalSize Horizontal size of the area
+/// @param VerticalSize Vertical size of the area
+/// @param DeltaX Horizontal distance the content moves, positive values move it to the right
+/// @param DeltaY Vertical distance the content moves, positive values move it down
+/// @param Exposed Optional array of GAME_GRAPHICS_LIB_MAX_SCROLL_EXPOSED entries, receives the parts of the area that
+///                still show the old content and have to be drawn again by the caller
+/// @param ExposedCount Optional, receives the number of entries stored in Exposed
+/// @return EFI_SUCCESS if the function executed successfully, EFI_UNSUPPORTED if layers exist and none is being drawn,
+///         otherwise an error code.
+/// @note Content moved out of the area or off the screen is dropped, nothing outside of the area is changed
+/// @note Damaged areas the content moves out of are presented first, so the screen shows the same pixels as the back buffer
+/// @note Between BeginLayerDrawing and EndLayerDrawing only the pixels of the layer are moved, and the area they moved to
+///       is damaged, since the screen also shows the layers above and below
+EFI_STATUS
+EFIAPI
+ScrollRectangle(
+    IN GAME_GRAPHICS_LIB_DATA *Data,
+    IN INT32 x,
+    IN INT32 y,
+    IN INT32 HorizontalSize,
+    IN INT32 VerticalSize,
+    IN INT32 DeltaX,
+    IN INT32 DeltaY,
+    OUT GAME_GRAPHICS_LIB_RECTANGLE *Exposed OPTIONAL,
+    OUT UINTN *ExposedCount OPTIONAL);
+
+/// @brief Creates a layer and adds it to the layer stack, see the Layers section
+/// @param Data The data structure that is used to store the library variables
+/// @param Layer The layer data structure that will be initialized
+/// @param x X coordinate of the top left corner of the layer on the screen, can be negative
+/// @param y Y coordinate of the top left corner of the layer on the screen, can be negative
+/// @param Width Horizontal size of the layer
+/// @param Height Vertical size of the layer
+/// @param z Position in the stack, layers with a higher z cover the ones with a lower z
+/// @return EFI_SUCCESS if the function executed successfully, EFI_OUT_OF_RESOURCES if GAME_GRAPHICS_LIB_MAX_LAYERS
+///         layers exist already or the pixels can not be allocated, otherwise an error code.
+/// @note The layer is visible, opaque and cleared like a new back buffer. DeleteLayer has to be called after the layer
+///       is no longer needed
+/// @note The render resolution, the palette mode and the graphics mode can not change while layers exist
+EFI_STATUS
+EFIAPI
+CreateLayer(
+    IN GAME_GRAPHICS_LIB_DATA *Data,
+    OUT GAME_GRAPHICS_LIB_LAYER *Layer,
+    IN INT32 x,
+    IN INT32 y,
+    IN UINT32 Width,
+    IN UINT32 Height,
+    IN INT32 z);
+
+/// @brief Removes a layer from the layer stack and frees its pixels
+/// @param Data The data structure that is used to store the library variables
+/// @param Layer The layer data structure that will be deleted
+/// @return EFI_SUCCESS if the function executed successfully, EFI_NOT_READY if the layer is being drawn, otherwise an error code.
+/// @note The area of the layer is composited again. Once the last layer is deleted, the back buffer keeps the composited
+///       picture and the drawing functions draw into it again
+EFI_STATUS
+EFIAPI
+DeleteLayer(
+    IN GAME_GRAPHICS_LIB_DATA *Data,
+    IN GAME_GRAPHICS_LIB_LAYER *Layer);
+
+/// @brief Makes the drawing functions draw into a layer instead of the back buffer
+/// @param Data The data structure that is used to store the library variables
+/// @param Layer The layer that will be drawn into
+/// @return EFI_SUCCESS if the function executed successfully, EFI_NOT_READY if another layer is being drawn, otherwise an error code.
+/// @note Screen, BackBuffer and Damage describe the layer until EndLayerDrawing, so coordinates are relative to the layer and
+///       clipped to it. The update functions return EFI_NOT_READY in between
+EFI_STATUS
+EFIAPI
+BeginLayerDrawing(
+    IN GAME_GRAPHICS_LIB_DATA *Data,
+    IN GAME_GRAPHICS_LIB_LAYER *Layer);
+
+/// @brief Makes the drawing functions draw into the back buffer again, the damage recorded in between stays with the layer
+/// @param Data The data structure that is used to store the library variables
+/// @return EFI_SUCCESS if the function executed successfully, EFI_NOT_STARTED if no layer is being drawn, otherwise an error code.
+EFI_STATUS
+EFIAPI
+EndLayerDrawing(
+    IN GAME_GRAPHICS_LIB_DATA *Data);
+
+/// @brief Moves a layer to another position on the screen, its pixels are kept
+/// @param Data The data structure that is used to store the library variables
+/// @param Layer The layer that will be moved
+/// @param x New X coordinate of the top left corner of the layer, can be negative
+/// @param y New Y coordinate of the top left corner of the layer, can be negative
+/// @return EFI_SUCCESS if the function executed successfully, otherwise an error code.
+/// @note The old and the new area of the layer are composited again
+EFI_STATUS
+EFIAPI
+MoveLayer(
+    IN GAME_GRAPHICS_LIB_DATA *Data,
+    IN GAME_GRAPHICS_LIB_LAYER *Layer,
+    IN INT32 x,
+    IN INT32 y);
+
+/// @brief Moves a layer to another position in the layer stack
+/// @param Data The data structure that is used to store the library variables
+/// @param Layer The layer that will be reordered
+/// @param z New position, the layer is placed above all other layers with the same z
+/// @return EFI_SUCCESS if the function executed successfully, otherwise an error code.
+EFI_STATUS
+EFIAPI
+SetLayerOrder(
+    IN GAME_GRAPHICS_LIB_DATA *Data,
+    IN GAME_GRAPHICS_LIB_LAYER *Layer,
+    IN INT32 z);
+
+/// @brief Shows or hides a layer without drawing it again
+/// @param Data The data structure that is used to store the library variables
+/// @param Layer The layer that will be shown or hidden
+/// @param Visible TRUE to composite the layer, FALSE to show the layers below it instead
+/// @return EFI_SUCCESS if the function executed successfully, otherwise an error code.
+/// @note Hidden layers can still be drawn into, their damage is dropped since showing them composites their whole area
+EFI_STATUS
+EFIAPI
+SetLayerVisible(
+    IN GAME_GRAPHICS_LIB_DATA *Data,
+    IN GAME_GRAPHICS_LIB_LAYER *Layer,
+    IN BOOLEAN Visible);
+
+/// @brief Sets the color of a layer that lets the layers below show through
+/// @param Data The data structure that is used to store the library variables
+/// @param Layer The layer that will become transparent or opaque
+/// @param ColorKey Color of the transparent pixels, or NULL to make the layer opaque
+/// @return EFI_SUCCESS if the function executed successfully, otherwise an error code.
+/// @note With a palette the key is the entry closest to ColorKey when the layer is composited
+EFI_STATUS
+EFIAPI
+SetLayerColorKey(
+    IN GAME_GRAPHICS_LIB_DATA *Data,
+    IN GAME_GRAPHICS_LIB_LAYER *Layer,
+    IN CONST EFI_GRAPHICS_OUTPUT_BLT_PIXEL *ColorKey OPTIONAL);
+
+/// @brief Composites every area some layer changed in since the last call into the back buffer, and damages it
+/// @param Data The data structure that is used to store the library variables
+/// @return EFI_SUCCESS if the function executed successfully, EFI_NOT_READY if a layer is being drawn, otherwise an error code.
+/// @note Every update function calls this first, it is only needed to read the composited back buffer before a present
+/// @note Opaque layers that cover a whole area hide everything below them, the layers below are not read there
+EFI_STATUS
+EFIAPI
+CompositeLayers(
+    IN GAME_GRAPHICS_LIB_DATA *Data);
+
+/// @brief Copies finished frames to the framebuffer on an application processor from now on, see SwapAndPresent
+/// @param Data The data structure that is used to store the library variables
+/// @return EFI_SUCCESS if the function executed successfully, EFI_UNSUPPORTED if the current mode has no linear
+///         framebuffer or there is no idle application processor, EFI_NOT_READY if a layer is being drawn, otherwise
+///         an error code.
+/// @note Has to be called before EnableParallelRendering, which otherwise uses every application processor
+/// @note BackBuffer changes with every SwapAndPresent call, it must not be cached by the application
+/// @note Between presents the present processor spins for a few microseconds and then sleeps in MWAIT. Processors
+///       without MWAIT return it to MP services once no frame was presented for a fraction of a second, and the
+///       next SwapAndPresent starts it again, presenting on the BSP until MP services can run it.
+EFI_STATUS
+EFIAPI
+EnableAsyncPresent(
+    IN GAME_GRAPHICS_LIB_DATA *Data);
+
+/// @brief Stops the present processor and frees the second back buffer
+/// @param Data The data structure that is used to store the library variables
+/// @return EFI_SUCCESS if the function executed successfully, EFI_NOT_READY if a layer is being drawn, otherwise an error code.
+/// @note Called by FinishGraphicMode
+EFI_STATUS
+EFIAPI
+DisableAsyncPresent(
+    IN GAME_GRAPHICS_LIB_DATA *Data);
+
+/// @brief Starts copying the damaged areas of the finished frame to the screen and continues in the other back buffer
+/// @param Data The data structure that is used to store the library variables
+/// @return EFI_SUCCESS if the function executed successfully, otherwise an error code.
+/// @note Waits for the previous present first. Falls back to PresentDamage if asynchronous present is disabled
+/// @note Layers are composited first, see CompositeLayers
+/// @note The BSP still copies the damaged areas into the other back buffer before returning, while the present
+///       processor writes them to the screen. The copy moves the damaged bytes of the back buffer once, without
+///       the scaling, conversion and framebuffer writes that the present processor takes over.
+EFI_STATUS
+EFIAPI
+SwapAndPresent(
+    IN GAME_GRAPHICS_LIB_DATA *Data);
+
+/// @brief Waits until the present processor finished copying the last frame, so its back buffer can be reused
+/// @param Data The data structure that is used to store the library variables
+/// @return EFI_SUCCESS if the function executed successfully, otherwise an error code.
+EFI_STATUS
+EFIAPI
+WaitForPresent(
+    IN GAME_GRAPHICS_LIB_DATA *Data);
+
+/// @brief Starts drawing large operations on the application processors as well as on the BSP
+/// @param Data The data structure that is used to store the library variables
+/// @param MaxApplicationProcessors Maximum number of application processors that draw, 0 uses every enabled one
+/// @return EFI_SUCCESS if at least one application processor draws, EFI_UNSUPPORTED if there are no MP services
+///         or no enabled application processors, otherwise an error code.
+/// @note The application processors stay reserved until DisableParallelRendering or FinishGraphicMode, and are not
+///       available to other users of the MP Services Protocol until then
+/// @note Between jobs every worker spins for a few microseconds, so the strips of a busy frame start right away, and
+///       then sleeps in MWAIT. Processors without MWAIT keep spinning, one core per worker at full load, until no job
+///       came for a fraction of a second, then return to MP services. The next job starts them again, but MP services
+///       may take up to a timer period to accept them, the BSP draws their strips in the meantime.
+EFI_STATUS
+EFIAPI
+EnableParallelRendering(
+    IN GAME_GRAPHICS_LIB_DATA *Data,
+    IN UINT32 MaxApplicationProcessors);
+
+/// @brief Stops the render workers, all drawing is done on the BSP again
+/// @param Data The data structure that is used to store the library variables
+/// @return EFI_SUCCESS if the function executed successfully, otherwise an error code.
+/// @note Called by FinishGraphicMode
+EFI_STATUS
+EFIAPI
+DisableParallelRendering(
+    IN GAME_GRAPHICS_LIB_DATA *Data);
+
+/// @brief Waits until the application processors finished drawing
+/// @param Data The data structure that is used to store the library variables
+/// @return EFI_SUCCESS if the function executed successfully, otherwise an error code.
+/// @note Only needed before reading BackBuffer directly, the library functions wait on their own
+EFI_STATUS
+EFIAPI
+WaitForRenderJobs(
+    IN GAME_GRAPHICS_LIB_DATA *Data);
+
 /// @brief Creates a grid with the specified number of cells and size of the cells
 /// @param Grid The grid data structure that will be created
 /// @param GridHorizontalSize Horizontal size of the grid
@@ -166,6 +775,7 @@ SmartUpdateVideoBuffer(
 /// @param Bitmap Optional bitmap that will be used to color fill the cells in the grid. If NULL, a new bitmap is created with all cells colored black
 /// @return EFI_SUCCESS if the function executed successfully, otherwise an error code.
 /// @note The grid abstracts from using DrawRectangle, allowing the user to color fill cells in the grid with use of FillCellInGrid
+/// @note On success the grid owns Bitmap and DeleteGrid frees it, on failure Bitmap is left to the caller
 EFI_STATUS
 EFIAPI
 CreateCustomGrid(
@@ -176,6 +786,39 @@ CreateCustomGrid(
     IN UINT32 VerticalCellsCount,
     IN EFI_GRAPHICS_OUTPUT_BLT_PIXEL *Bitmap OPTIONAL);
 
+/// @brief Changes the pixel size of the grid, keeping the number of cells and their colors
+/// @param Grid The grid data structure that will be resized
+/// @param GridHorizontalSize New horizontal size of the grid
+/// @param GridVerticalSize New vertical size of the grid
+/// @return EFI_SUCCESS if the function executed successfully, otherwise an error code.
+/// @note All cells are marked as changed, so the next DrawGrid call repaints the whole grid
+EFI_STATUS
+EFIAPI
+ResizeGrid(
+    IN GAME_GRAPHICS_LIB_GRID *Grid,
+    IN UINT32 GridHorizontalSize,
+    IN UINT32 GridVerticalSize);
+
+/// @brief Finds the cell of the grid that contains the specified pixel
+/// @param Grid The grid data structure that will be searched
+/// @param xOffset X coordinate (pixel position) of the top left corner of the grid
+/// @param yOffset Y coordinate (pixel position) of the top left corner of the grid
+/// @param PixelX X coordinate of the pixel
+/// @param PixelY Y coordinate of the pixel
+/// @param x X coordinate (index) of the cell containing the pixel
+/// @param y Y coordinate (index) of the cell containing the pixel
+/// @return EFI_SUCCESS if the pixel is inside of the grid, EFI_NOT_FOUND if it is not, otherwise an error code.
+EFI_STATUS
+EFIAPI
+GetCellAtPosition(
+    IN GAME_GRAPHICS_LIB_GRID *Grid,
+    IN INT32 xOffset,
+    IN INT32 yOffset,
+    IN INT32 PixelX,
+    IN INT32 PixelY,
+    OUT UINT32 *x,
+    OUT UINT32 *y);
+
 /// @brief Updates the color of a cell in the grid at the specified grid coordinates
 /// @param Grid The grid data structure that will be used to fill the cell
 /// @param x X coordinate of the cell in the grid
@@ -191,6 +834,35 @@ FillCellInGrid(
     IN UINT32 y,
     IN EFI_GRAPHICS_OUTPUT_BLT_PIXEL *Color);
 
+/// @brief Registers a pattern that cells of the grid can show instead of a color
+/// @param Grid The grid data structure that will store the pattern
+/// @param PatternId Number of the pattern, from 1 to GAME_GRAPHICS_LIB_MAX_GRID_PATTERNS
+/// @param Pattern The pattern, or NULL to remove the pattern. The pixels are copied, so the caller can free them afterwards
+/// @return EFI_SUCCESS if the function executed successfully, otherwise an error code.
+/// @note Cells showing the pattern are drawn again by the next DrawGrid call. Cells whose pattern is removed show their color
+EFI_STATUS
+EFIAPI
+SetGridCellPattern(
+    IN GAME_GRAPHICS_LIB_GRID *Grid,
+    IN UINT8 PatternId,
+    IN GAME_GRAPHICS_LIB_GRID_CELL_PATTERN *Pattern OPTIONAL);
+
+/// @brief Makes a cell of the grid show a pattern at the specified grid coordinates
+/// @param Grid The grid data structure that will be used to fill the cell
+/// @param x X coordinate of the cell in the grid
+/// @param y Y coordinate of the cell in the grid
+/// @param PatternId Number of a pattern registered with SetGridCellPattern, or 0 to show the color of the cell again
+/// @return EFI_SUCCESS if the function executed successfully, otherwise an error code.
+/// @note The grid has to be drawn again on the screen after the cell is filled to see the changes
+/// @note FillCellInGrid resets the cell to a plain color fill
+EFI_STATUS
+EFIAPI
+FillCellInGridWithPattern(
+    IN GAME_GRAPHICS_LIB_GRID *Grid,
+    IN UINT32 x,
+    IN UINT32 y,
+    IN UINT8 PatternId);
+
 /// @brief Clears the grid by painting all cells black
 /// @param Grid The grid data structure that will be cleared
 /// @return EFI_SUCCESS if the function executed successfully, otherwise an error code.
@@ -207,6 +879,7 @@ ClearGrid(
 /// @param y Y coordinate of the top left corner of the grid
 /// @return EFI_SUCCESS if the function executed successfully, otherwise an error code.
 /// @note Requires using a function that updates the video buffer to see the changes on the screen
+/// @note Only the cells changed since the previous call are drawn
 EFI_STATUS
 EFIAPI
 DrawGrid(
@@ -215,6 +888,27 @@ DrawGrid(
     IN UINT32 x,
     IN UINT32 y);
 
+/// @brief Draws the grid on the screen at specified coordinates and reports the repainted areas
+/// @param Data The data structure that is used to store the library variables
+/// @param Grid The grid data structure that will be drawn
+/// @param x X coordinate of the top left corner of the grid
+/// @param y Y coordinate of the top left corner of the grid
+/// @param Rectangles Optional array that receives the screen areas of the repainted cells, before clipping to the screen
+/// @param MaxRectangles Number of entries in Rectangles
+/// @param RectangleCount Optional, receives the number of repainted cells. If it is bigger than MaxRectangles, only the first MaxRectangles areas were stored
+/// @return EFI_SUCCESS if the function executed successfully, otherwise an error code.
+/// @note The repainted areas are also added to the damage list, see PresentDamage
+EFI_STATUS
+EFIAPI
+DrawGridEx(
+    IN GAME_GRAPHICS_LIB_DATA *Data,
+    IN GAME_GRAPHICS_LIB_GRID *Grid,
+    IN UINT32 x,
+    IN UINT32 y,
+    OUT GAME_GRAPHICS_LIB_RECTANGLE *Rectangles OPTIONAL,
+    IN UINTN MaxRectangles,
+    OUT UINTN *RectangleCount OPTIONAL);
+
 /// @brief Updates the area of the video buffer with the corresponding area of the back buffer in the data structure at grid coordinates of the specified cell in the grid structure
 /// @param Data The data structure that is used to store the library variables
 /// @param Grid The grid data structure that will be used to update the video buffer
@@ -242,6 +936,17 @@ EFIAPI
 DeleteGrid(
     IN GAME_GRAPHICS_LIB_GRID *Grid);
 
+/// @brief Sets the maximum amount of memory used by the glyph cache
+/// @param Data The data structure that is used to store the library variables
+/// @param BudgetBytes New budget in bytes. Characters bigger than the budget are drawn without being cached
+/// @return EFI_SUCCESS if the function executed successfully, otherwise an error code.
+/// @note Cached characters are evicted until the cache fits into the new budget
+EFI_STATUS
+EFIAPI
+SetGlyphCacheBudget(
+    IN GAME_GRAPHICS_LIB_DATA *Data,
+    IN UINTN BudgetBytes);
+
 /// @brief Draws an 8x8 character on the screen at specified coordinates
 /// @param Data The data structure that is used to store the library variables
 /// @param x X coordinate of the character's top left corner
@@ -252,6 +957,7 @@ DeleteGrid(
 /// @param SizeMultipiler The size multipiler of the character. 1 is the original size of the font
 /// @return EFI_SUCCESS if the function executed successfully, otherwise an error code.
 /// @note Requires using a function that updates the video buffer to see the changes on the screen
+/// @note Characters crossing the right or bottom edge of the screen are clipped, characters starting off screen are not drawn at all
 EFI_STATUS
 EFIAPI
 DrawCharacter(
@@ -273,6 +979,7 @@ DrawCharacter(
 /// @param SizeMultipiler The size multipiler of the text. 1 is the original size of the font
 /// @return EFI_SUCCESS if the function executed successfully, otherwise an error code.
 /// @note Requires using a function that updates the video buffer to see the changes on the screen
+/// @note Text running past the edges of the screen is clipped like the characters of DrawCharacter
 EFI_STATUS
 EFIAPI
 DrawText(
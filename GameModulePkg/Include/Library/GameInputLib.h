@@ -0,0 +1,109 @@
+#ifndef _GAME_INPUT_LIBRARY_H_
+#define _GAME_INPUT_LIBRARY_H_
+
+/// @file
+/// Game Input Library
+/// Keyboard input for games that queues every key stroke with the time it arrived.
+///
+/// @section Usage
+/// InitializeGameInput registers key notification functions with the Simple Text Input Ex protocol of the console.
+/// From then on every key stroke is stored in a ring buffer as soon as the console driver sees it, together with
+/// a time stamp. The game reads the whole queue once per logic tick with GetGameInputEvent. FinishGameInput
+/// unregisters the notification functions.
+///
+/// If the console does not support key notifications, GetGameInputEvent reads the console input itself,
+/// and the time stamp is the time of the read.
+///
+/// Only one GAME_INPUT can be initialized at a time, since key notification functions receive no context.
+///
+/// @section Latency
+/// The time from a key stroke to the frame that shows its result being presented is measured when the game
+/// calls GameInputFramePresented after presenting. For every presented frame, the oldest key event read since the
+/// previous present is used, so the statistics describe the worst case of every frame.
+
+#include <Uefi.h>
+#include <Protocol/SimpleTextInEx.h>
+
+/// @brief Number of key events the ring buffer holds, has to be a power of two
+#define GAME_INPUT_RING_SIZE 64
+
+/// @brief Maximum number of keys that notification functions are registered for
+#define GAME_INPUT_MAX_NOTIFY_KEYS 128
+
+/// @brief A key stroke and the time it arrived
+typedef struct
+{
+    EFI_INPUT_KEY Key;   // The key that was pressed
+    UINT32 ShiftState;   // Shift state reported by the console, 0 if it does not report it
+    UINT64 Timestamp;    // Cycle counter value when the key arrived
+} GAME_INPUT_EVENT;
+
+/// @brief Input to photon latency statistics, in cycles of the counter
+typedef struct
+{
+    UINT64 Samples;             // Number of presented frames that showed the result of a key stroke
+    UINT64 LastLatencyCycles;   // Latency of the last sample
+    UINT64 MaxLatencyCycles;    // Largest latency of all samples
+    UINT64 TotalLatencyCycles;  // Sum of all samples
+    UINT64 DroppedEvents;       // Key strokes lost because the ring buffer was full
+} GAME_INPUT_STATS;
+
+/// @brief Data structure that stores the state of the input library
+/// @note Head is only written by the key notification function and Tail only by GetGameInputEvent,
+///       so the ring buffer needs no lock
+typedef struct
+{
+    EFI_SIMPLE_TEXT_INPUT_EX_PROTOCOL *ConInEx;          // NULL if the console has no Simple Text Input Ex protocol
+    VOID *NotifyHandles[GAME_INPUT_MAX_NOTIFY_KEYS];     // Handles returned by RegisterKeyNotify
+    UINT32 NotifyCount;                                  // Number of valid entries in NotifyHandles
+    GAME_INPUT_EVENT Events[GAME_INPUT_RING_SIZE];       // Ring buffer of key events
+    volatile UINT32 Head;                                // Number of events written, wraps around
+    volatile UINT32 Tail;                                // Number of events read, wraps around
+    UINT64 PendingTimestamp;                             // Time stamp of the oldest event read since the last present, 0 if none
+    GAME_INPUT_STATS Stats;                              // Latency statistics
+} GAME_INPUT;
+
+/// @brief Starts queueing key strokes
+/// @param Input The data structure that is used to store the input variables
+/// @return EFI_SUCCESS if the function executed successfully, otherwise an error code.
+/// @note Falls back to reading the console input in GetGameInputEvent if key notifications are not available
+EFI_STATUS
+EFIAPI
+InitializeGameInput(
+    OUT GAME_INPUT *Input);
+
+/// @brief Reads the oldest queued key event
+/// @param Input The data structure that is used to store the input variables
+/// @param Event Receives the key event
+/// @return EFI_SUCCESS if an event was read, EFI_NOT_READY if the queue is empty, otherwise an error code.
+EFI_STATUS
+EFIAPI
+GetGameInputEvent(
+    IN GAME_INPUT *Input,
+    OUT GAME_INPUT_EVENT *Event);
+
+/// @brief Discards all queued key events, for example keys pressed on a menu screen
+/// @param Input The data structure that is used to store the input variables
+/// @return EFI_SUCCESS if the function executed successfully, otherwise an error code.
+EFI_STATUS
+EFIAPI
+FlushGameInput(
+    IN GAME_INPUT *Input);
+
+/// @brief Records the input to photon latency of a frame that was just presented
+/// @param Input The data structure that is used to store the input variables
+/// @note Call right after the present, frames without key events read since the previous call are not counted
+VOID
+EFIAPI
+GameInputFramePresented(
+    IN GAME_INPUT *Input);
+
+/// @brief Stops queueing key strokes
+/// @param Input The data structure that is used to store the input variables
+/// @return EFI_SUCCESS if the function executed successfully, otherwise an error code.
+EFI_STATUS
+EFIAPI
+FinishGameInput(
+    IN GAME_INPUT *Input);
+
+#endif // _GAME_INPUT_LIBRARY_H_
@@ -0,0 +1,176 @@
+#ifndef _GAME_LOOP_LIBRARY_H_
+#define _GAME_LOOP_LIBRARY_H_
+
+/// @file
+/// Game Loop Library
+/// Frame loop for UEFI applications that sleeps between frames instead of polling the timer and the keyboard.
+///
+/// @section Usage
+/// InitializeGameLoop creates a periodic frame timer, RunGameLoop then runs the game logic in fixed ticks and renders
+/// once every time the timer fires, until StopGameLoop is called or a handler returns an error. FinishGameLoop closes the timer.
+///
+/// @section Timestep
+/// Logic runs at TickRate ticks per second no matter how often frames are rendered. Every frame the elapsed time is added
+/// to an accumulator, and one tick is run for every full tick period in it, at most MaxCatchUpTicks per frame.
+/// Time that is still left after that is dropped, so a long stall does not make the game fast forward afterwards.
+/// The render handler receives the fraction of a tick that is left in the accumulator as Alpha,
+/// so it can draw moving objects in between their last and next logical position.
+/// If the next frame is already due when the ticks finish, rendering is skipped, at most MaxFrameSkip times in a row.
+///
+/// @section Waiting
+/// Between frames the loop does not spin. Depending on the wait mode it either blocks in gBS->WaitForEvent
+/// on the frame timer and the console input WaitForKey event, or halts the processor with CpuSleep until the
+/// next interrupt. All pending keys are passed to the input handler before every tick, so no key stroke is lost.
+///
+/// @section Statistics
+/// The loop measures how much of every frame was spent waiting, see GAME_LOOP_STATS and GetGameLoopIdlePercent.
+/// Time is measured in cycles of the time stamp counter on IA32 and X64, and of the TimerLib performance counter elsewhere.
+/// The counter frequency is measured by InitializeGameLoop against gBS->Stall.
+
+#include <Uefi.h>
+
+/// @brief Methods of waiting for the next frame
+typedef enum
+{
+    GameLoopWaitForEvent, // gBS->WaitForEvent on the frame timer and the console input
+    GameLoopCpuSleep      // CpuSleep until the next interrupt, then checking the events again
+} GAME_LOOP_WAIT_MODE;
+
+/// @brief Alpha value passed to the render handler when a whole tick period is accumulated
+#define GAME_LOOP_ALPHA_ONE 0x10000
+
+/// @brief Settings of the loop
+typedef struct
+{
+    UINT32 TickRate;              // Logic ticks per second
+    UINT32 RenderRate;            // Frames per second, the rate of the frame timer
+    UINT32 MaxCatchUpTicks;       // Most ticks run in one frame, at least 1
+    UINT32 MaxFrameSkip;          // Most frames skipped in a row when the loop falls behind, 0 never skips
+    GAME_LOOP_WAIT_MODE WaitMode; // How the loop waits between frames
+} GAME_LOOP_CONFIG;
+
+/// @brief Timing of the frames and ticks run by the loop
+typedef struct
+{
+    UINT64 FrameCount;       // Number of frames rendered since InitializeGameLoop
+    UINT64 TickCount;        // Number of logic ticks run
+    UINT64 SkippedFrames;    // Number of frames not rendered because the loop fell behind
+    UINT64 DroppedTicks;     // Number of ticks not run because of the MaxCatchUpTicks limit
+    UINT64 CyclesPerSecond;  // Measured frequency of the cycle counter
+    UINT64 LastFrameCycles;  // Time between the last two frame timer wake ups
+    UINT64 LastIdleCycles;   // Time spent waiting before the last frame
+    UINT64 TotalFrameCycles; // Sum of LastFrameCycles over all frames
+    UINT64 TotalIdleCycles;  // Sum of LastIdleCycles over all frames
+} GAME_LOOP_STATS;
+
+/// @brief Called for every key stroke read from the console input
+/// @param Context Context passed to RunGameLoop
+/// @param Key The key that was pressed
+typedef
+VOID
+(EFIAPI *GAME_LOOP_INPUT_HANDLER)(
+    IN VOID *Context,
+    IN EFI_INPUT_KEY *Key);
+
+/// @brief Called once per logic tick
+/// @param Context Context passed to RunGameLoop
+/// @return EFI_SUCCESS to keep the loop running, an error code stops the loop and is returned by RunGameLoop
+typedef
+EFI_STATUS
+(EFIAPI *GAME_LOOP_TICK_HANDLER)(
+    IN VOID *Context);
+
+/// @brief Called once per rendered frame
+/// @param Context Context passed to RunGameLoop
+/// @param Alpha Time since the last tick, from 0 to GAME_LOOP_ALPHA_ONE - 1 of a tick period
+/// @return EFI_SUCCESS to keep the loop running, an error code stops the loop and is returned by RunGameLoop
+typedef
+EFI_STATUS
+(EFIAPI *GAME_LOOP_RENDER_HANDLER)(
+    IN VOID *Context,
+    IN UINT32 Alpha);
+
+/// @brief Data structure that stores the state of the loop
+typedef struct
+{
+    EFI_EVENT FrameTimerEvent;              // Periodic timer that starts every frame
+    EFI_SIMPLE_TEXT_INPUT_PROTOCOL *ConIn;  // Console input that is read by the loop
+    GAME_LOOP_CONFIG Config;                // Settings passed to InitializeGameLoop
+    UINT64 TickCycles;                      // Length of a tick in cycles of the counter
+    BOOLEAN Running;                        // Cleared by StopGameLoop
+    UINT64 FrameStart;                      // Counter value at the start of the current frame
+    GAME_LOOP_STATS Stats;                  // Timing of the frames
+} GAME_LOOP;
+
+/// @brief Creates the frame timer of the loop
+/// @param Loop The data structure that is used to store the loop variables
+/// @param Config Settings of the loop, copied into the loop
+/// @return EFI_SUCCESS if the function executed successfully, otherwise an error code.
+/// @note Measuring the cycle counter frequency stalls for 10 milliseconds
+EFI_STATUS
+EFIAPI
+InitializeGameLoop(
+    OUT GAME_LOOP *Loop,
+    IN GAME_LOOP_CONFIG *Config);
+
+/// @brief Runs ticks and frames until StopGameLoop is called or a handler fails
+/// @param Loop The data structure that is used to store the loop variables
+/// @param InputHandler Optional, called for every key stroke before the next tick. If NULL, the console input is not read
+/// @param TickHandler Called TickRate times per second
+/// @param RenderHandler Optional, called once per frame that is not skipped
+/// @param Context Passed to all handlers
+/// @return EFI_SUCCESS if the loop was stopped with StopGameLoop, otherwise the error code of a handler or of the wait
+EFI_STATUS
+EFIAPI
+RunGameLoop(
+    IN GAME_LOOP *Loop,
+    IN GAME_LOOP_INPUT_HANDLER InputHandler OPTIONAL,
+    IN GAME_LOOP_TICK_HANDLER TickHandler,
+    IN GAME_LOOP_RENDER_HANDLER RenderHandler OPTIONAL,
+    IN VOID *Context OPTIONAL);
+
+/// @brief Makes RunGameLoop return after the current handler
+/// @param Loop The data structure that is used to store the loop variables
+/// @note Can be called from every handler. No more ticks or frames are run once the loop is stopped
+VOID
+EFIAPI
+StopGameLoop(
+    IN GAME_LOOP *Loop);
+
+/// @brief Sleeps until a key is pressed
+/// @param Loop The data structure that is used to store the loop variables
+/// @param Key Optional, receives the key that was pressed
+/// @return EFI_SUCCESS if the function executed successfully, otherwise an error code.
+/// @note Uses the wait mode of the loop, but does not change its statistics
+EFI_STATUS
+EFIAPI
+GameLoopWaitForKey(
+    IN GAME_LOOP *Loop,
+    OUT EFI_INPUT_KEY *Key OPTIONAL);
+
+/// @brief Returns the share of time the loop spent waiting instead of running frames
+/// @param Loop The data structure that is used to store the loop variables
+/// @return Idle time over all frames in percent, 0 if no frame was run yet
+UINT32
+EFIAPI
+GetGameLoopIdlePercent(
+    IN GAME_LOOP *Loop);
+
+/// @brief Reads the cycle counter the loop measures time with
+/// @return Current value of the time stamp counter on IA32 and X64, and of the TimerLib performance counter elsewhere
+/// @note Other libraries read their timestamps with this, so they can be compared with GAME_LOOP_STATS.
+/// @note Can be called on application processors
+UINT64
+EFIAPI
+GetGameLoopCycleCounter(
+    VOID);
+
+/// @brief Closes the frame timer of the loop
+/// @param Loop The data structure that is used to store the loop variables
+/// @return EFI_SUCCESS if the function executed successfully, otherwise an error code.
+EFI_STATUS
+EFIAPI
+FinishGameLoop(
+    IN GAME_LOOP *Loop);
+
+#endif // _GAME_LOOP_LIBRARY_H_
@@ -0,0 +1,186 @@
+#ifndef _GAME_PROFILE_LIBRARY_H_
+#define _GAME_PROFILE_LIBRARY_H_
+
+/// @file
+/// Game Profile Library
+/// Measures how long the phases of every frame take, to find the frames that stall instead of only the average rate.
+///
+/// @section Usage
+/// InitializeGameProfile measures the cycle counter frequency. GAME_PROFILE_BEGIN and GAME_PROFILE_END are placed
+/// around every phase of a frame, and GAME_PROFILE_FRAME once per frame. Phases can be nested, an outer phase then
+/// includes the time of the inner one. GetGameProfilePhaseStats and GameProfileReport summarize every phase with its
+/// minimum, average, 99th percentile and maximum time, DrawGameProfileOverlay draws the time of the recent frames as a graph.
+///
+/// @section Compiling out
+/// The markers only call the library if gEfiGameModulePkgTokenSpaceGuid.PcdGameProfileEnable is TRUE. The PCD is a
+/// feature flag, so with FALSE the compiler drops the calls. Modules that use the markers list the PCD in the [FeaturePcd]
+/// section of their INF, and should guard the other calls with FeaturePcdGet as well.
+///
+/// @section Histograms
+/// Times are counted in log-linear buckets of cycles, every power of two is split into GAME_PROFILE_SUB_BUCKETS buckets.
+/// The 99th percentile is reported as the upper end of its bucket, so it is at most 1 / GAME_PROFILE_SUB_BUCKETS too high.
+/// Time is measured with GetGameLoopCycleCounter of GameLoopLib, so the times match GAME_LOOP_STATS.
+
+#include <Uefi.h>
+#include <Library/PcdLib.h>
+#include <Library/GameGraphicsLib.h>
+
+/// @brief Every power of two is split into 2^GAME_PROFILE_SUB_BUCKET_BITS histogram buckets
+#define GAME_PROFILE_SUB_BUCKET_BITS 2
+#define GAME_PROFILE_SUB_BUCKETS (1 << GAME_PROFILE_SUB_BUCKET_BITS)
+
+/// @brief Number of histogram buckets of every phase, enough for any 64 bit cycle count
+#define GAME_PROFILE_BUCKETS (64 * GAME_PROFILE_SUB_BUCKETS)
+
+/// @brief Number of recent frames shown by the overlay, which is also its width in pixels
+#define GAME_PROFILE_GRAPH_FRAMES 128
+
+/// @brief Phases of a frame that are measured
+typedef enum
+{
+    GameProfilePhaseInput,   // Reading and handling key strokes
+    GameProfilePhaseLogic,   // Game logic of a tick
+    GameProfilePhaseGrid,    // DrawGrid
+    GameProfilePhaseText,    // DrawText and everything drawn with it
+    GameProfilePhasePresent, // Copying the back buffer to the screen
+    GameProfilePhaseFrame,   // Time between two GAME_PROFILE_FRAME markers
+    GameProfilePhaseMax
+} GAME_PROFILE_PHASE;
+
+/// @brief Summary of the times of one phase, in microseconds
+typedef struct
+{
+    UINT64 Count; // Number of times the phase was measured
+    UINT64 Min;
+    UINT64 Average;
+    UINT64 P99;   // 99 out of 100 measurements took at most this long
+    UINT64 Max;
+} GAME_PROFILE_PHASE_STATS;
+
+/// @brief Measurements of one phase
+typedef struct
+{
+    UINT64 Start;                           // Counter value at GAME_PROFILE_BEGIN, 0 if the phase is not running
+    UINT64 Count;                           // Number of measurements
+    UINT64 MinCycles;                       // Shortest measurement
+    UINT64 MaxCycles;                       // Longest measurement
+    UINT64 TotalCycles;                     // Sum of all measurements
+    UINT32 Buckets[GAME_PROFILE_BUCKETS];   // Histogram of the measurements, see GAME_PROFILE_SUB_BUCKETS
+} GAME_PROFILE_PHASE_DATA;
+
+/// @brief Data structure that stores the state of the profiler
+typedef struct
+{
+    UINT64 CyclesPerSecond;                            // Measured frequency of the cycle counter
+    UINT64 TargetFrameCycles;                          // Length of a frame at the target frame rate
+    UINT64 LastFrame;                                  // Counter value at the last GAME_PROFILE_FRAME, 0 before the first
+    UINT64 FrameGraph[GAME_PROFILE_GRAPH_FRAMES];      // Length of the recent frames in cycles, a ring buffer
+    UINT32 FrameGraphNext;                             // Index in FrameGraph that the next frame is written to
+    GAME_PROFILE_PHASE_DATA Phases[GameProfilePhaseMax];
+} GAME_PROFILE;
+
+/// @brief Starts measuring a phase, compiled out unless PcdGameProfileEnable is TRUE
+#define GAME_PROFILE_BEGIN(Profile, Phase)                 \
+    do                                                     \
+    {                                                      \
+        if (FeaturePcdGet(PcdGameProfileEnable))           \
+        {                                                  \
+            GameProfileBegin((Profile), (Phase));          \
+        }                                                  \
+    } while (FALSE)
+
+/// @brief Stops measuring a phase and records its time, compiled out unless PcdGameProfileEnable is TRUE
+#define GAME_PROFILE_END(Profile, Phase)                   \
+    do                                                     \
+    {                                                      \
+        if (FeaturePcdGet(PcdGameProfileEnable))           \
+        {                                                  \
+            GameProfileEnd((Profile), (Phase));            \
+        }                                                  \
+    } while (FALSE)
+
+/// @brief Records the time since the previous frame, compiled out unless PcdGameProfileEnable is TRUE
+#define GAME_PROFILE_FRAME(Profile)                        \
+    do                                                     \
+    {                                                      \
+        if (FeaturePcdGet(PcdGameProfileEnable))           \
+        {                                                  \
+            GameProfileFrame((Profile));                   \
+        }                                                  \
+    } while (FALSE)
+
+/// @brief Resets all measurements and measures the cycle counter frequency
+/// @param Profile The data structure that is used to store the profiler variables
+/// @param TargetFrameRate Frames per second the application aims for, the overlay scales its graph to it
+/// @return EFI_SUCCESS if the function executed successfully, otherwise an error code.
+/// @note Measuring the cycle counter frequency stalls for 10 milliseconds
+EFI_STATUS
+EFIAPI
+InitializeGameProfile(
+    OUT GAME_PROFILE *Profile,
+    IN UINT32 TargetFrameRate);
+
+/// @brief Starts measuring a phase, use GAME_PROFILE_BEGIN instead
+/// @param Profile The data structure that is used to store the profiler variables
+/// @param Phase The phase that starts
+VOID
+EFIAPI
+GameProfileBegin(
+    IN GAME_PROFILE *Profile,
+    IN GAME_PROFILE_PHASE Phase);
+
+/// @brief Stops measuring a phase and records its time, use GAME_PROFILE_END instead
+/// @param Profile The data structure that is used to store the profiler variables
+/// @param Phase The phase that ends
+/// @note Does nothing if the phase was not started
+VOID
+EFIAPI
+GameProfileEnd(
+    IN GAME_PROFILE *Profile,
+    IN GAME_PROFILE_PHASE Phase);
+
+/// @brief Records the time since the previous call as a frame, use GAME_PROFILE_FRAME instead
+/// @param Profile The data structure that is used to store the profiler variables
+VOID
+EFIAPI
+GameProfileFrame(
+    IN GAME_PROFILE *Profile);
+
+/// @brief Summarizes the measurements of a phase
+/// @param Profile The data structure that is used to store the profiler variables
+/// @param Phase The phase to summarize
+/// @param Stats Receives the summary, all zero if the phase was never measured
+/// @return EFI_SUCCESS if the function executed successfully, otherwise an error code.
+EFI_STATUS
+EFIAPI
+GetGameProfilePhaseStats(
+    IN GAME_PROFILE *Profile,
+    IN GAME_PROFILE_PHASE Phase,
+    OUT GAME_PROFILE_PHASE_STATS *Stats);
+
+/// @brief Prints the summary of every measured phase with DEBUG
+/// @param Profile The data structure that is used to store the profiler variables
+VOID
+EFIAPI
+GameProfileReport(
+    IN GAME_PROFILE *Profile);
+
+/// @brief Draws the length of the recent frames as a bar graph into the back buffer
+/// @param Profile The data structure that is used to store the profiler variables
+/// @param Data The data structure that is used to store the graphics library variables
+/// @param x Left edge of the graph
+/// @param y Top edge of the graph
+/// @param Height Height of the graph, twice the target frame time fills it
+/// @return EFI_SUCCESS if the function executed successfully, otherwise an error code.
+/// @note The graph is GAME_PROFILE_GRAPH_FRAMES pixels wide, the newest frame is on the right. A line marks the target
+///       frame time and frames longer than that are drawn red
+EFI_STATUS
+EFIAPI
+DrawGameProfileOverlay(
+    IN GAME_PROFILE *Profile,
+    IN GAME_GRAPHICS_LIB_DATA *Data,
+    IN INT32 x,
+    IN INT32 y,
+    IN UINT32 Height);
+
+#endif // _GAME_PROFILE_LIBRARY_H_
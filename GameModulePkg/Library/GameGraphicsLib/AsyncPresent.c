@@ -0,0 +1,346 @@
+#include <Uefi.h>
+#include <Protocol/MpService.h>
+#include <Library/DebugLib.h>
+#include <Library/BaseLib.h>
+#include <Library/BaseMemoryLib.h>
+#include <Library/MemoryAllocationLib.h>
+#include <Library/UefiBootServicesTableLib.h>
+#include <Library/GameGraphicsLib.h>
+#include "GameGraphicsLibInternal.h"
+
+/// @brief Asynchronous present state, stored in GAME_GRAPHICS_LIB_DATA.Presenter
+typedef struct
+{
+    GAME_GRAPHICS_LIB_DATA View;                                                      // Copy of the library variables for the current present
+    EFI_MP_SERVICES_PROTOCOL *MpServices;
+    INTERNAL_AP_WORKER Worker;                                                        // Present processor, idles between presents
+    volatile UINT32 Generation;                                                       // Incremented by the BSP for every present
+    volatile UINT32 Completed;                                                        // Generation of the last present the processor finished
+    volatile BOOLEAN Quit;                                                            // The procedure returns instead of presenting
+    BOOLEAN Busy;                                                                     // TRUE until the BSP waited for the current present
+    EFI_GRAPHICS_OUTPUT_BLT_PIXEL *Buffer;                                            // Back buffer of the current present
+    GAME_GRAPHICS_LIB_RECTANGLE Rectangles[GAME_GRAPHICS_LIB_MAX_DAMAGE_RECTANGLES]; // Areas of the current present
+    UINT32 Count;
+    UINT64 Cycles;                                                                    // Time the present processor spent on the current present
+} PRESENTER;
+
+/// @brief Copies the areas of the current present to the framebuffer and reports the generation as completed
+STATIC
+VOID
+RunPresent(
+    IN OUT PRESENTER *Presenter,
+    IN UINT32 Generation)
+{
+  GAME_GRAPHICS_LIB_RECTANGLE *Rectangle;
+  UINT64 StartCycles;
+
+  StartCycles = GetGameLoopCycleCounter();
+  for (UINT32 i = 0; i < Presenter->Count; i++)
+  {
+    Rectangle = &Presenter->Rectangles[i];
+    InternalPresentDirect(&Presenter->View, Presenter->Buffer, Rectangle->x, Rectangle->y, Rectangle->Width, Rectangle->Height);
+  }
+  InternalStreamFence();
+  Presenter->Cycles = GetGameLoopCycleCounter() - StartCycles;
+
+  MemoryFence();
+  Presenter->Completed = Generation;
+}
+
+/// @brief Procedure of the present processor, copies back buffers to the framebuffer until DisableAsyncPresent
+///        or until it idled long enough to park, see INTERNAL_AP_WORKER
+/// @note Must not call UEFI services or DEBUG, those are only available on the BSP
+STATIC
+VOID
+EFIAPI
+PresentWorker(
+    IN OUT VOID *Buffer)
+{
+  PRESENTER *Presenter = (PRESENTER *)Buffer;
+  UINT32 Generation;
+
+  // Started again after parking, the present that woke it up is still pending
+  Generation = Presenter->Completed;
+
+  for (;;)
+  {
+    if (!InternalApWorkerWait(&Presenter->Worker, &Presenter->Generation, Generation))
+    {
+      return;
+    }
+    Generation = Presenter->Generation;
+    MemoryFence();
+
+    if (Presenter->Quit)
+    {
+      break;
+    }
+
+    RunPresent(Presenter, Generation);
+  }
+
+  Presenter->Completed = Generation;
+}
+
+/// @brief Returns the back buffer that is not drawn to
+STATIC
+EFI_GRAPHICS_OUTPUT_BLT_PIXEL *
+OtherBackBuffer(
+    IN GAME_GRAPHICS_LIB_DATA *Data)
+{
+  return (Data->BackBuffer == Data->BackBuffers[0]) ? Data->BackBuffers[1] : Data->BackBuffers[0];
+}
+
+EFI_STATUS
+EFIAPI
+EnableAsyncPresent(
+    IN GAME_GRAPHICS_LIB_DATA *Data)
+{
+  EFI_STATUS Status;
+  EFI_MP_SERVICES_PROTOCOL *MpServices;
+  PRESENTER *Presenter;
+
+  if (Data == NULL)
+  {
+    return EFI_INVALID_PARAMETER;
+  }
+
+  if (Data->Presenter != NULL)
+  {
+    return EFI_SUCCESS;
+  }
+
+  // The back buffer variables describe the layer until EndLayerDrawing
+  if (InternalDrawingLayer(Data))
+  {
+    DEBUG((DEBUG_ERROR, "EnableAsyncPresent: A layer is being drawn.\n"));
+    return EFI_NOT_READY;
+  }
+
+  // Application processors can not call Blt, they can only write to a linear framebuffer
+  if (!Data->DirectPresentSupported)
+  {
+    DEBUG((DEBUG_INFO, "EnableAsyncPresent: Current mode has no usable linear framebuffer.\n"));
+    return EFI_UNSUPPORTED;
+  }
+
+  Status = gBS->LocateProtocol(&gEfiMpServiceProtocolGuid, NULL, (VOID **)&MpServices);
+  if (EFI_ERROR(Status))
+  {
+    DEBUG((DEBUG_INFO, "EnableAsyncPresent: No MP services, presenting on the BSP.\n"));
+    return EFI_UNSUPPORTED;
+  }
+
+  Presenter = AllocateZeroPool(sizeof(PRESENTER));
+  if (Presenter == NULL)
+  {
+    return EFI_OUT_OF_RESOURCES;
+  }
+  Presenter->MpServices = MpServices;
+
+  // The second back buffer starts as a copy of the first, from then on only damaged areas differ
+  WaitForRenderJobs(Data);
+  Status = InternalAllocateBackBuffer(Data->SizeOfBackBuffer, &Data->BackBuffers[1]);
+  if (EFI_ERROR(Status))
+  {
+    DEBUG((DEBUG_ERROR, "EnableAsyncPresent: Failed to allocate the second back buffer: %r\n", Status));
+    Data->BackBuffers[1] = NULL;
+    FreePool(Presenter);
+    return Status;
+  }
+  CopyMem(Data->BackBuffers[1], Data->BackBuffers[0], Data->SizeOfBackBuffer);
+
+  Status = InternalStartApWorker(MpServices, 0, &Presenter->Worker, PresentWorker, Presenter);
+  if (EFI_ERROR(Status))
+  {
+    DEBUG((DEBUG_INFO, "EnableAsyncPresent: No idle application processor, presenting on the BSP.\n"));
+    InternalFreeBackBuffer(Data->BackBuffers[1], Data->SizeOfBackBuffer);
+    Data->BackBuffers[1] = NULL;
+    FreePool(Presenter);
+    return EFI_UNSUPPORTED;
+  }
+
+  Data->Presenter = Presenter;
+  DEBUG((DEBUG_INFO, "EnableAsyncPresent: Presenting on processor %lu.\n", (UINT64)Presenter->Worker.Processor));
+
+  return EFI_SUCCESS;
+}
+
+EFI_STATUS
+EFIAPI
+DisableAsyncPresent(
+    IN GAME_GRAPHICS_LIB_DATA *Data)
+{
+  PRESENTER *Presenter;
+
+  if (Data == NULL)
+  {
+    return EFI_INVALID_PARAMETER;
+  }
+
+  Presenter = (PRESENTER *)Data->Presenter;
+  if (Presenter == NULL)
+  {
+    return EFI_SUCCESS;
+  }
+
+  if (InternalDrawingLayer(Data))
+  {
+    DEBUG((DEBUG_ERROR, "DisableAsyncPresent: A layer is being drawn.\n"));
+    return EFI_NOT_READY;
+  }
+
+  WaitForRenderJobs(Data);
+  WaitForPresent(Data);
+
+  Presenter->Quit = TRUE;
+  MemoryFence();
+  Presenter->Generation++;
+  InternalStopApWorker(&Presenter->Worker);
+
+  // Drawing continues in the first back buffer, which is the one FinishGraphicMode frees
+  if (Data->BackBuffer != Data->BackBuffers[0])
+  {
+    CopyMem(Data->BackBuffers[0], Data->BackBuffer, Data->SizeOfBackBuffer);
+    Data->BackBuffer = Data->BackBuffers[0];
+  }
+  InternalFreeBackBuffer(Data->BackBuffers[1], Data->SizeOfBackBuffer);
+  Data->BackBuffers[1] = NULL;
+
+  FreePool(Presenter);
+  Data->Presenter = NULL;
+
+  return EFI_SUCCESS;
+}
+
+EFI_STATUS
+EFIAPI
+WaitForPresent(
+    IN GAME_GRAPHICS_LIB_DATA *Data)
+{
+  PRESENTER *Presenter;
+  UINT64 StartCycles;
+
+  if (Data == NULL)
+  {
+    return EFI_INVALID_PARAMETER;
+  }
+
+  Presenter = (PRESENTER *)Data->Presenter;
+  if ((Presenter == NULL) || !Presenter->Busy)
+  {
+    return EFI_SUCCESS;
+  }
+
+  StartCycles = GetGameLoopCycleCounter();
+  while (Presenter->Completed != Presenter->Generation)
+  {
+    CpuPause();
+  }
+  MemoryFence();
+  Presenter->Busy = FALSE;
+
+  // Only the part of the copy the game loop waited for was not hidden
+  Data->PresentStats.LastCycles = Presenter->Cycles;
+  Data->PresentStats.TotalCycles += Presenter->Cycles;
+  Data->PresentStats.AsyncCycles += Presenter->Cycles;
+  Data->PresentStats.AsyncWaitCycles += GetGameLoopCycleCounter() - StartCycles;
+
+  return EFI_SUCCESS;
+}
+
+VOID
+EFIAPI
+InternalSyncBackBuffers(
+    IN GAME_GRAPHICS_LIB_DATA *Data)
+{
+  EFI_GRAPHICS_OUTPUT_BLT_PIXEL *Other;
+  GAME_GRAPHICS_LIB_RECTANGLE *Rectangle;
+
+  if (Data->Presenter == NULL)
+  {
+    return;
+  }
+
+  Other = OtherBackBuffer(Data);
+  for (UINT32 i = 0; i < Data->Damage.Count; i++)
+  {
+    Rectangle = &Data->Damage.Rectangles[i];
+    for (UINT32 Row = Rectangle->y; Row < Rectangle->y + Rectangle->Height; Row++)
+    {
+      CopyMem(InternalBackBufferPixel(Data, Other, Rectangle->x, Row),
+              InternalBackBufferPixel(Data, Data->BackBuffer, Rectangle->x, Row),
+              (UINTN)Rectangle->Width * Data->BackBufferPixelSize);
+    }
+  }
+}
+
+EFI_STATUS
+EFIAPI
+SwapAndPresent(
+    IN GAME_GRAPHICS_LIB_DATA *Data)
+{
+  EFI_STATUS Status;
+  PRESENTER *Presenter;
+  UINT64 Bytes = 0;
+
+  if (Data == NULL)
+  {
+    return EFI_INVALID_PARAMETER;
+  }
+
+  Presenter = (PRESENTER *)Data->Presenter;
+  if (Presenter == NULL)
+  {
+    return PresentDamage(Data);
+  }
+
+  Status = CompositeLayers(Data);
+  if (EFI_ERROR(Status))
+  {
+    return Status;
+  }
+
+  // The frame has to be complete, and the other buffer no longer read by the present processor
+  WaitForRenderJobs(Data);
+  WaitForPresent(Data);
+
+  if (Data->Damage.Count == 0)
+  {
+    return EFI_SUCCESS;
+  }
+
+  Presenter->Buffer = Data->BackBuffer;
+  Presenter->Count = Data->Damage.Count;
+  for (UINT32 i = 0; i < Data->Damage.Count; i++)
+  {
+    Presenter->Rectangles[i] = Data->Damage.Rectangles[i];
+    Bytes += (UINT64)Data->Damage.Rectangles[i].Width * Data->Damage.Rectangles[i].Height * sizeof(EFI_GRAPHICS_OUTPUT_BLT_PIXEL);
+  }
+  Bytes *= (UINT64)Data->Scale * Data->Scale;
+
+  // The BSP may redirect the back buffer variables to a layer while the present processor reads them
+  CopyMem(&Presenter->View, Data, sizeof(*Data));
+
+  Presenter->Busy = TRUE;
+  MemoryFence();
+  Presenter->Generation++;
+
+  // A present processor that parked after a long idle time may not be available again yet
+  if (!InternalResumeApWorker(Presenter->MpServices, &Presenter->Worker, PresentWorker, Presenter))
+  {
+    RunPresent(Presenter, Presenter->Generation);
+    Data->PresentStats.AsyncWaitCycles += Presenter->Cycles;
+  }
+
+  // The next frame is drawn on top of this one, both buffers are only read until the copy is done
+  InternalSyncBackBuffers(Data);
+  Data->BackBuffer = OtherBackBuffer(Data);
+  Data->Damage.Count = 0;
+
+  Data->PresentStats.LastBytes = Bytes;
+  Data->PresentStats.TotalBytes += Bytes;
+  Data->PresentStats.PresentCount++;
+
+  return EFI_SUCCESS;
+}
@@ -0,0 +1,214 @@
+#include <Library/DebugLib.h>
+#include <Uefi.h>
+#include <Library/GameGraphicsLib.h>
+#include <Library/BaseMemoryLib.h>
+#include "GameGraphicsLibInternal.h"
+
+VOID
+EFIAPI
+InternalUnionRectangle(
+    IN GAME_GRAPHICS_LIB_RECTANGLE *First,
+    IN GAME_GRAPHICS_LIB_RECTANGLE *Second,
+    OUT GAME_GRAPHICS_LIB_RECTANGLE *Union)
+{
+  UINT32 Left = MIN(First->x, Second->x);
+  UINT32 Top = MIN(First->y, Second->y);
+  UINT32 Right = MAX(First->x + First->Width, Second->x + Second->Width);
+  UINT32 Bottom = MAX(First->y + First->Height, Second->y + Second->Height);
+
+  Union->x = Left;
+  Union->y = Top;
+  Union->Width = Right - Left;
+  Union->Height = Bottom - Top;
+}
+
+STATIC
+UINT64
+RectangleArea(
+    IN GAME_GRAPHICS_LIB_RECTANGLE *Rectangle)
+{
+  return (UINT64)Rectangle->Width * Rectangle->Height;
+}
+
+/// @brief Removes a rectangle from the damage list by moving the last entry in its place
+STATIC
+VOID
+RemoveDamage(
+    IN GAME_GRAPHICS_LIB_DAMAGE *Damage,
+    IN UINT32 Index)
+{
+  Damage->Count--;
+  Damage->Rectangles[Index] = Damage->Rectangles[Damage->Count];
+}
+
+/// @brief Inserts an already clipped rectangle into the damage list
+/// @details
+/// The rectangle is merged with every entry for which the union costs no more pixels than copying both separately,
+/// which also covers containment, overlaps and neighbouring cells of a grid or characters of a text.
+/// If the list is still full afterwards, it is merged with the entry that grows the least.
+STATIC
+VOID
+InsertDamage(
+    IN GAME_GRAPHICS_LIB_DAMAGE *Damage,
+    IN GAME_GRAPHICS_LIB_RECTANGLE *Rectangle)
+{
+  GAME_GRAPHICS_LIB_RECTANGLE New = *Rectangle;
+  GAME_GRAPHICS_LIB_RECTANGLE Union;
+  UINT64 Waste;
+  UINT64 BestWaste;
+  UINT32 BestIndex;
+  BOOLEAN Merged;
+
+  do
+  {
+    Merged = FALSE;
+    for (UINT32 i = 0; i < Damage->Count; i++)
+    {
+      InternalUnionRectangle(&New, &Damage->Rectangles[i], &Union);
+      if (RectangleArea(&Union) <= RectangleArea(&New) + RectangleArea(&Damage->Rectangles[i]))
+      {
+        New = Union;
+        RemoveDamage(Damage, i);
+        Merged = TRUE;
+        break;
+      }
+    }
+  } while (Merged);
+
+  while (Damage->Count >= Damage->MaxCount)
+  {
+    BestIndex = 0;
+    BestWaste = MAX_UINT64;
+    for (UINT32 i = 0; i < Damage->Count; i++)
+    {
+      InternalUnionRectangle(&New, &Damage->Rectangles[i], &Union);
+      Waste = RectangleArea(&Union) - RectangleArea(&Damage->Rectangles[i]);
+      if (Waste < BestWaste)
+      {
+        BestWaste = Waste;
+        BestIndex = i;
+      }
+    }
+
+    InternalUnionRectangle(&New, &Damage->Rectangles[BestIndex], &New);
+    RemoveDamage(Damage, BestIndex);
+  }
+
+  Damage->Rectangles[Damage->Count] = New;
+  Damage->Count++;
+}
+
+VOID
+EFIAPI
+InternalInsertDamage(
+    IN GAME_GRAPHICS_LIB_DAMAGE *Damage,
+    IN GAME_GRAPHICS_LIB_RECTANGLE *Rectangle)
+{
+  InsertDamage(Damage, Rectangle);
+}
+
+VOID
+EFIAPI
+InternalAddDamage(
+    IN GAME_GRAPHICS_LIB_DATA *Data,
+    IN GAME_GRAPHICS_LIB_RECTANGLE *Rectangle)
+{
+  InsertDamage(&Data->Damage, Rectangle);
+}
+
+EFI_STATUS
+EFIAPI
+AddDamageRectangle(
+    IN GAME_GRAPHICS_LIB_DATA *Data,
+    IN INT32 x,
+    IN INT32 y,
+    IN INT32 HorizontalSize,
+    IN INT32 VerticalSize)
+{
+  GAME_GRAPHICS_LIB_RECTANGLE Rectangle;
+
+  if (Data == NULL)
+  {
+    return EFI_INVALID_PARAMETER;
+  }
+
+  // Off screen areas can not be presented, so there is nothing to record
+  if (!InternalClipRectangle(Data, x, y, HorizontalSize, VerticalSize, &Rectangle))
+  {
+    return EFI_SUCCESS;
+  }
+
+  InsertDamage(&Data->Damage, &Rectangle);
+  return EFI_SUCCESS;
+}
+
+EFI_STATUS
+EFIAPI
+SetMaxDamageRectangles(
+    IN GAME_GRAPHICS_LIB_DATA *Data,
+    IN UINT32 MaxCount)
+{
+  GAME_GRAPHICS_LIB_RECTANGLE Rectangle;
+
+  if ((Data == NULL) || (MaxCount == 0) || (MaxCount > GAME_GRAPHICS_LIB_MAX_DAMAGE_RECTANGLES))
+  {
+    return EFI_INVALID_PARAMETER;
+  }
+
+  Data->Damage.MaxCount = MaxCount;
+
+  // Reinserting the last entries until the list fits in the new limit
+  while (Data->Damage.Count > MaxCount)
+  {
+    Data->Damage.Count--;
+    Rectangle = Data->Damage.Rectangles[Data->Damage.Count];
+    InsertDamage(&Data->Damage, &Rectangle);
+  }
+
+  return EFI_SUCCESS;
+}
+
+EFI_STATUS
+EFIAPI
+PresentDamage(
+    IN GAME_GRAPHICS_LIB_DATA *Data)
+{
+  EFI_STATUS Status;
+  UINT64 StartCycles;
+  UINT64 Bytes = 0;
+  GAME_GRAPHICS_LIB_RECTANGLE *Rectangle;
+
+  if (Data == NULL)
+  {
+    return EFI_INVALID_PARAMETER;
+  }
+
+  Status = CompositeLayers(Data);
+  if (EFI_ERROR(Status))
+  {
+    return Status;
+  }
+
+  WaitForRenderJobs(Data);
+  WaitForPresent(Data);
+
+  StartCycles = GetGameLoopCycleCounter();
+  for (UINT32 i = 0; i < Data->Damage.Count; i++)
+  {
+    Rectangle = &Data->Damage.Rectangles[i];
+    Status = InternalPresentRectangle(Data, Rectangle->x, Rectangle->y, Rectangle->Width, Rectangle->Height);
+    if (EFI_ERROR(Status))
+    {
+      InternalFinishPresent(Data, StartCycles, Bytes);
+      DEBUG((DEBUG_ERROR, "PresentDamage: Failed to update video buffer: %r\n", Status));
+      return Status;
+    }
+    Bytes += RectangleArea(Rectangle) * sizeof(EFI_GRAPHICS_OUTPUT_BLT_PIXEL);
+  }
+
+  InternalSyncBackBuffers(Data);
+  Data->Damage.Count = 0;
+  InternalFinishPresent(Data, StartCycles, Bytes);
+
+  return EFI_SUCCESS;
+}
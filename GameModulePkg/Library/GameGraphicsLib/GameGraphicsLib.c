@@ -2,10 +2,41 @@
 #include <Uefi.h>
 #include <Protocol/GraphicsOutput.h>
 #include <Library/UefiBootServicesTableLib.h>
+#include <Pi/PiDxeCis.h>
+#include <Library/DxeServicesTableLib.h>
 #include <Library/GameGraphicsLib.h>
-#include <Library/Font8x8.h>
 #include <Library/BaseMemoryLib.h>
 #include <Library/MemoryAllocationLib.h>
+#include <Library/BaseLib.h>
+#include "GameGraphicsLibInternal.h"
+
+// Smallest number of changed cells that can be queued for DrawGrid, for grids with only a few bitset words
+#define GRID_DIRTY_QUEUE_MIN_SIZE 64
+
+// Relative cost of presenting one pixel in a pixel format, used by SelectGraphicMode. The back buffer is copied as is
+// to BGR framebuffers, converted during the copy for RGB and PixelBitMask framebuffers, and the firmware converts
+// every pixel in Blt for the other formats
+#define MODE_COST_BGR 4
+#define MODE_COST_CONVERTED 5
+#define MODE_COST_BLT_ONLY 8
+
+// Bit position of the blue, green and red channel in a back buffer pixel
+STATIC CONST UINT32 mBltChannelShift[3] = {0, 8, 16};
+
+/// @brief Context of a render job that fills a rectangle
+typedef struct
+{
+    GAME_GRAPHICS_LIB_RECTANGLE Rectangle; // Already clipped
+    UINT32 Color;
+} FILL_RECTANGLE_JOB;
+
+/// @brief Context of a render job that draws the changed cells of a grid
+typedef struct
+{
+    GAME_GRAPHICS_LIB_GRID *Grid;
+    UINT32 x;
+    UINT32 y;
+} DRAW_GRID_JOB;
 
 EFI_STATUS
 EFIAPI
@@ -63,13 +94,18 @@ PrintModeQueryInfo(
 EFI_STATUS
 EFIAPI
 PrintGraphicsOutputProtocolMode(
-    EFI_GRAPHICS_OUTPUT_PROTOCOL_MODE *Mode)
+    IN EFI_GRAPHICS_OUTPUT_PROTOCOL *GraphicsOutput)
 {
-  if (Mode == NULL)
+  EFI_GRAPHICS_OUTPUT_PROTOCOL_MODE *Mode;
+  EFI_GRAPHICS_OUTPUT_MODE_INFORMATION *Info;
+  UINTN SizeOfInfo;
+
+  if ((GraphicsOutput == NULL) || (GraphicsOutput->Mode == NULL))
   {
     DEBUG((DEBUG_ERROR, "Invalid EFI_GRAPHICS_OUTPUT_PROTOCOL_MODE pointer (NULL).\n"));
     return EFI_ABORTED;
   }
+  Mode = GraphicsOutput->Mode;
 
   DEBUG((DEBUG_INFO, "EFI_GRAPHICS_OUTPUT_PROTOCOL_MODE:\n"));
   DEBUG((DEBUG_INFO, "  MaxMode: %u\n", Mode->MaxMode));
@@ -78,488 +114,1537 @@ PrintGraphicsOutputProtocolMode(
   DEBUG((DEBUG_INFO, "  FrameBufferBase: 0x%016lx\n", Mode->FrameBufferBase));
   DEBUG((DEBUG_INFO, "  FrameBufferSize: %lu bytes\n", Mode->FrameBufferSize));
 
-  for (INT32 i = 0; i < Mode->MaxMode; i++)
+  for (UINT32 i = 0; i < Mode->MaxMode; i++)
   {
-    DEBUG((EFI_D_INFO, "Mode number: (%d)\n", i));
-    PrintModeQueryInfo(Mode->Info);
+    DEBUG((EFI_D_INFO, "Mode number: (%u)\n", i));
+    if (EFI_ERROR(GraphicsOutput->QueryMode(GraphicsOutput, i, &SizeOfInfo, &Info)))
+    {
+      DEBUG((EFI_D_INFO, "  Not available\n"));
+      continue;
+    }
+    PrintModeQueryInfo(Info);
+    FreePool(Info);
   }
 
   return EFI_SUCCESS;
 }
 
-EFI_STATUS
-EFIAPI
-InitializeGraphicMode(
-    IN OUT GAME_GRAPHICS_LIB_DATA *Data)
+/// @brief Derives the conversion of back buffer pixels to the framebuffer pixels of a mode
+/// @param Info Mode information of the mode
+/// @param Layout Receives the conversion
+/// @return TRUE if the pixels of the mode can be written directly, FALSE for PixelBltOnly and for PixelBitMask
+///         modes whose channel masks are empty or not contiguous
+STATIC
+BOOLEAN
+BuildPixelLayout(
+    IN EFI_GRAPHICS_OUTPUT_MODE_INFORMATION *Info,
+    OUT GAME_GRAPHICS_LIB_PIXEL_LAYOUT *Layout)
 {
-  EFI_STATUS Status;
+  UINT32 Masks[3];
+  UINT32 Position;
+  UINT32 Bits;
 
-  Status = gBS->LocateProtocol(
-      &gEfiGraphicsOutputProtocolGuid,
-      NULL,
-      (VOID **)&Data->GraphicsOutput);
-  if (EFI_ERROR(Status))
+  switch (Info->PixelFormat)
   {
-    return Status;
+  case PixelBlueGreenRedReserved8BitPerColor:
+    Masks[0] = 0x000000FF;
+    Masks[1] = 0x0000FF00;
+    Masks[2] = 0x00FF0000;
+    break;
+  case PixelRedGreenBlueReserved8BitPerColor:
+    Masks[0] = 0x00FF0000;
+    Masks[1] = 0x0000FF00;
+    Masks[2] = 0x000000FF;
+    break;
+  case PixelBitMask:
+    Masks[0] = Info->PixelInformation.BlueMask;
+    Masks[1] = Info->PixelInformation.GreenMask;
+    Masks[2] = Info->PixelInformation.RedMask;
+    break;
+  default:
+    return FALSE;
   }
 
-  // Debug information about the current mode
-  Status = PrintGraphicsOutputProtocolMode(
-      Data->GraphicsOutput->Mode);
-  if (EFI_ERROR(Status))
+  for (UINT32 i = 0; i < 3; i++)
   {
-    return Status;
-  }
-
-  Data->Screen.HorizontalResolution = Data->GraphicsOutput->Mode->Info->HorizontalResolution;
-  Data->Screen.VerticalResolution = Data->GraphicsOutput->Mode->Info->VerticalResolution;
+    if (Masks[i] == 0)
+    {
+      return FALSE;
+    }
 
-  Data->SizeOfBackBuffer =
-      Data->Screen.HorizontalResolution *
-      Data->Screen.VerticalResolution *
-      sizeof(EFI_GRAPHICS_OUTPUT_BLT_PIXEL);
+    Position = (UINT32)LowBitSet32(Masks[i]);
+    Bits = (UINT32)HighBitSet32(Masks[i]) - Position + 1;
+    if ((UINT64)(Masks[i] >> Position) + 1 != LShiftU64(1, Bits))
+    {
+      return FALSE;
+    }
 
-  // Allocating memory for the buffer
-  Status = gBS->AllocatePool(
-      EfiBootServicesData,
-      Data->SizeOfBackBuffer,
-      (VOID **)&Data->BackBuffer);
-  if (EFI_ERROR(Status))
-  {
-    DEBUG((DEBUG_ERROR, "Failed to allocate BackBuffer: %r\n", Status));
-    return Status;
+    if (Bits <= 8)
+    {
+      Layout->RightShift[i] = mBltChannelShift[i] + 8 - Bits;
+      Layout->Mask[i] = (1 << Bits) - 1;
+      Layout->LeftShift[i] = Position;
+    }
+    else
+    {
+      Layout->RightShift[i] = mBltChannelShift[i];
+      Layout->Mask[i] = 0xFF;
+      Layout->LeftShift[i] = Position + Bits - 8;
+    }
   }
 
-  return EFI_SUCCESS;
+  return TRUE;
 }
 
-EFI_STATUS
-EFIAPI
-FinishGraphicMode(
+/// @brief Reads the resolution, pixel format and framebuffer of the current mode
+/// @note The back buffer is not changed, it has to be reallocated if the resolution changed
+STATIC
+VOID
+ReadCurrentMode(
     IN OUT GAME_GRAPHICS_LIB_DATA *Data)
 {
-  EFI_STATUS Status;
-
-  Status = gBS->FreePool(Data->BackBuffer);
-  if (EFI_ERROR(Status))
-  {
-    DEBUG((DEBUG_ERROR, "Failed to free BackBuffer memory pool: %r\n", Status));
-    return Status;
-  }
+  EFI_GCD_MEMORY_SPACE_DESCRIPTOR Descriptor;
 
-  return EFI_SUCCESS;
-}
+  Data->Screen.HorizontalResolution = Data->GraphicsOutput->Mode->Info->HorizontalResolution;
+  Data->Screen.VerticalResolution = Data->GraphicsOutput->Mode->Info->VerticalResolution;
 
-EFI_STATUS
-EFIAPI
-DrawRectangle(
-    IN GAME_GRAPHICS_LIB_DATA *Data,
-    IN INT32 x,
-    IN INT32 y,
-    IN INT32 HorizontalSize,
-    IN INT32 VerticalSize,
-    IN EFI_GRAPHICS_OUTPUT_BLT_PIXEL *Color)
-{
-  if ((Data == NULL) || (Color == NULL))
+  // The back buffer covers the whole screen until SetRenderResolution
+  Data->Output = Data->Screen;
+  Data->Scale = 1;
+  Data->OutputX = 0;
+  Data->OutputY = 0;
+
+  // Direct present is only possible for 32-bit framebuffers that can hold the whole screen and whose pixels
+  // can be converted with shifts and masks, PixelBltOnly modes have to go through Blt
+  Data->PresentMode = GameGraphicsPresentBlt;
+  Data->PixelFormat = Data->GraphicsOutput->Mode->Info->PixelFormat;
+  Data->PixelsPerScanLine = Data->GraphicsOutput->Mode->Info->PixelsPerScanLine;
+  Data->FrameBuffer = NULL;
+  Data->DirectPresentSupported = FALSE;
+  ZeroMem(&Data->PixelLayout, sizeof(Data->PixelLayout));
+  if (BuildPixelLayout(Data->GraphicsOutput->Mode->Info, &Data->PixelLayout) &&
+      (Data->GraphicsOutput->Mode->FrameBufferBase != 0) &&
+      (Data->PixelsPerScanLine >= Data->Screen.HorizontalResolution) &&
+      (Data->GraphicsOutput->Mode->FrameBufferSize >=
+       (UINTN)Data->PixelsPerScanLine * Data->Screen.VerticalResolution * sizeof(UINT32)))
   {
-    return EFI_INVALID_PARAMETER;
+    Data->FrameBuffer = (UINT32 *)(UINTN)Data->GraphicsOutput->Mode->FrameBufferBase;
+    Data->DirectPresentSupported = TRUE;
   }
 
-  for (INT32 i = 0; i < VerticalSize; i++)
+  // The cache type decides how fast direct present can write, SetFrameBufferWriteCombining changes it
+  Data->FrameBufferAttributes = 0;
+  Data->FrameBufferWriteCombining = FALSE;
+  if ((Data->FrameBuffer != NULL) &&
+      !EFI_ERROR(gDS->GetMemorySpaceDescriptor(Data->GraphicsOutput->Mode->FrameBufferBase, &Descriptor)))
   {
-    for (INT32 j = 0; j < HorizontalSize; j++)
-    {
-      // Ignoring off screen pixels
-      if ((x + j >= Data->Screen.HorizontalResolution) ||
-          (y + i >= Data->Screen.VerticalResolution) ||
-          (x + j < 0) ||
-          (y + i < 0))
-      {
-        continue;
-      }
-
-      Data->BackBuffer[(y + i) * Data->Screen.HorizontalResolution + (x + j)] = *Color;
-    }
+    Data->FrameBufferAttributes = Descriptor.Attributes;
+    DEBUG((DEBUG_INFO, "ReadCurrentMode: Framebuffer attributes 0x%lx, capabilities 0x%lx.\n",
+           Descriptor.Attributes, Descriptor.Capabilities));
   }
 
-  return EFI_SUCCESS;
+  // Palette entries are expanded straight into framebuffer pixels, so they follow the pixel format
+  InternalUpdatePaletteLut(Data);
 }
 
-EFI_STATUS
+VOID
 EFIAPI
-ClearScreen(
-    IN GAME_GRAPHICS_LIB_DATA *Data)
+InternalBackBufferLayout(
+    IN UINT32 Width,
+    IN UINT32 Height,
+    IN UINT32 PixelSize,
+    OUT UINT32 *Stride,
+    OUT UINTN *Size)
 {
-  // Filling the buffer with zeros (black)
-  SetMem(Data->BackBuffer, Data->SizeOfBackBuffer, 0);
+  *Stride = (UINT32)ALIGN_VALUE(Width, GAME_GRAPHICS_LIB_BACK_BUFFER_ALIGNMENT / PixelSize);
+  *Size = (UINTN)*Stride * Height * PixelSize;
+}
 
-  return EFI_SUCCESS;
+VOID *
+EFIAPI
+InternalBackBufferPixel(
+    IN GAME_GRAPHICS_LIB_DATA *Data,
+    IN EFI_GRAPHICS_OUTPUT_BLT_PIXEL *Buffer,
+    IN UINT32 x,
+    IN UINT32 y)
+{
+  return (UINT8 *)Buffer + ((UINTN)y * Data->BackBufferStride + x) * Data->BackBufferPixelSize;
 }
 
 EFI_STATUS
 EFIAPI
-UpdateVideoBuffer(
-    IN GAME_GRAPHICS_LIB_DATA *Data)
+InternalAllocateBackBuffer(
+    IN UINTN Size,
+    OUT EFI_GRAPHICS_OUTPUT_BLT_PIXEL **BackBuffer)
 {
   EFI_STATUS Status;
+  EFI_PHYSICAL_ADDRESS Address;
 
-  Status = Data->GraphicsOutput->Blt(
-      Data->GraphicsOutput,
-      Data->BackBuffer,
-      EfiBltBufferToVideo,
-      0,
-      0,
-      0,
-      0,
-      Data->Screen.HorizontalResolution,
-      Data->Screen.VerticalResolution,
-      0);
+  // Pages are aligned far beyond a cache line, so every padded row starts on one
+  Status = gBS->AllocatePages(AllocateAnyPages, EfiBootServicesData, EFI_SIZE_TO_PAGES(Size), &Address);
   if (EFI_ERROR(Status))
   {
-    DEBUG((DEBUG_ERROR, "UpdateVideoBuffer: Failed to update video buffer: %r\n", Status));
     return Status;
   }
 
+  *BackBuffer = (EFI_GRAPHICS_OUTPUT_BLT_PIXEL *)(UINTN)Address;
+  ZeroMem(*BackBuffer, Size);
   return EFI_SUCCESS;
 }
 
+VOID
+EFIAPI
+InternalFreeBackBuffer(
+    IN EFI_GRAPHICS_OUTPUT_BLT_PIXEL *BackBuffer,
+    IN UINTN Size)
+{
+  gBS->FreePages((EFI_PHYSICAL_ADDRESS)(UINTN)BackBuffer, EFI_SIZE_TO_PAGES(Size));
+}
+
 EFI_STATUS
 EFIAPI
-SmartUpdateVideoBuffer(
-    IN GAME_GRAPHICS_LIB_DATA *Data,
-    IN INT32 x,
-    IN INT32 y,
-    IN INT32 HorizontalSize,
-    IN INT32 VerticalSize)
+InitializeGraphicMode(
+    IN OUT GAME_GRAPHICS_LIB_DATA *Data)
 {
   EFI_STATUS Status;
-  INT32 RealX = x < 0 ? 0 : x;
-  INT32 RealY = y < 0 ? 0 : y;
-  INT32 RealWidth = x + HorizontalSize < Data->Screen.HorizontalResolution ? HorizontalSize : Data->Screen.HorizontalResolution - x;
-  INT32 RealHeight = y + VerticalSize < Data->Screen.VerticalResolution ? VerticalSize : Data->Screen.VerticalResolution - y;
 
-  Status = Data->GraphicsOutput->Blt(
-      Data->GraphicsOutput,
-      Data->BackBuffer,
-      EfiBltBufferToVideo,
-      RealX,
-      RealY,
-      RealX,
-      RealY,
-      RealWidth,
-      RealHeight,
-      Data->Screen.HorizontalResolution * sizeof(EFI_GRAPHICS_OUTPUT_BLT_PIXEL));
+  Status = gBS->LocateProtocol(
+      &gEfiGraphicsOutputProtocolGuid,
+      NULL,
+      (VOID **)&Data->GraphicsOutput);
   if (EFI_ERROR(Status))
   {
-    DEBUG((DEBUG_ERROR, "RealX: %d, RealY: %d, RealWidth: %d, RealHeight: %d\n", RealX, RealY, RealWidth, RealHeight));
-    DEBUG((DEBUG_ERROR, "SmartUpdateVideoBuffer: Failed to update video buffer: %r\n", Status));
     return Status;
   }
 
-  return EFI_SUCCESS;
-}
+  // Debug information about the current mode
+  Status = PrintGraphicsOutputProtocolMode(
+      Data->GraphicsOutput);
+  if (EFI_ERROR(Status))
+  {
+    return Status;
+  }
 
-EFI_STATUS
-EFIAPI
-UpdateCellInGrid(
-    IN GAME_GRAPHICS_LIB_DATA *Data,
-    IN GAME_GRAPHICS_LIB_GRID *Grid,
-    IN INT32 xOffset,
-    IN INT32 yOffset,
-    IN INT32 x,
-    IN INT32 y)
-{
-  UINT32 VerticalOffset = 0;
-  UINT32 HorizontalOffset = 0;
-  UINT32 CurrentCellHorizontalSize = 0;
-  UINT32 CurrentCellVerticalSize = 0;
-  UINT32 HorizontalRemainder = 0;
-  UINT32 VerticalRemainder = 0;
+  Data->OriginalMode = Data->GraphicsOutput->Mode->Mode;
+  Data->ScaledRows = NULL;
+  Data->Palette = NULL;
+  Data->Compositor = NULL;
+  Data->BackBufferPixelSize = sizeof(EFI_GRAPHICS_OUTPUT_BLT_PIXEL);
+  ReadCurrentMode(Data);
+  ZeroMem(&Data->PresentStats, sizeof(Data->PresentStats));
 
-  if ((Data == NULL) || (Grid == NULL))
+  InternalSelectKernels();
+
+  // Text drawing falls back to rasterizing every character if the cache can not be created
+  Status = InternalCreateGlyphCache(Data);
+  if (EFI_ERROR(Status))
   {
-    return EFI_INVALID_PARAMETER;
+    DEBUG((DEBUG_ERROR, "Failed to create glyph cache: %r\n", Status));
   }
 
-  // Calculating the size of each cell using division with remainder,
-  // to not create unintended 1 pixel gaps
-  for (INT32 i = 0; i < Grid->VerticalCellsCount; i++)
-  {
-    CurrentCellVerticalSize = Grid->VerticalSize / Grid->VerticalCellsCount;
-    VerticalRemainder += Grid->VerticalSize % Grid->VerticalCellsCount;
-    if (VerticalRemainder >= Grid->VerticalCellsCount)
-    {
-      VerticalRemainder -= Grid->VerticalCellsCount;
-      CurrentCellVerticalSize++;
-    }
-    for (INT32 j = 0; j < Grid->HorizontalCellsCount; j++)
-    {
-      // Ignoring cells in a row until we are in a correct row
-      if (i != y)
-      {
-        continue;
-      }
+  Data->Damage.Count = 0;
+  Data->Damage.MaxCount = GAME_GRAPHICS_LIB_MAX_DAMAGE_RECTANGLES;
 
-      CurrentCellHorizontalSize = Grid->HorizontalSize / Grid->HorizontalCellsCount;
-      HorizontalRemainder += Grid->HorizontalSize % Grid->HorizontalCellsCount;
-      if (HorizontalRemainder >= Grid->HorizontalCellsCount)
-      {
-        HorizontalRemainder -= Grid->HorizontalCellsCount;
-        CurrentCellHorizontalSize++;
-      }
+  // Drawing runs on the BSP only until EnableParallelRendering, presenting until EnableAsyncPresent
+  Data->Renderer = NULL;
+  Data->RenderProcessors = 1;
+  Data->Presenter = NULL;
 
-      if (i == y && j == x)
-      {
-        SmartUpdateVideoBuffer(Data,
-                               xOffset + HorizontalOffset - 1,
-                               yOffset + VerticalOffset - 1,
-                               CurrentCellHorizontalSize + 2,
-                               CurrentCellVerticalSize + 2);
-        return EFI_SUCCESS;
-      }
+  InternalBackBufferLayout(
+      Data->Screen.HorizontalResolution,
+      Data->Screen.VerticalResolution,
+      Data->BackBufferPixelSize,
+      &Data->BackBufferStride,
+      &Data->SizeOfBackBuffer);
 
-      HorizontalOffset += CurrentCellHorizontalSize;
-    }
-    VerticalOffset += CurrentCellVerticalSize;
-    HorizontalOffset = 0;
+  // Allocating memory for the buffer
+  Status = InternalAllocateBackBuffer(Data->SizeOfBackBuffer, &Data->BackBuffer);
+  if (EFI_ERROR(Status))
+  {
+    DEBUG((DEBUG_ERROR, "Failed to allocate BackBuffer: %r\n", Status));
+    return Status;
   }
+  Data->BackBuffers[0] = Data->BackBuffer;
+  Data->BackBuffers[1] = NULL;
+
   return EFI_SUCCESS;
 }
 
 EFI_STATUS
 EFIAPI
-CreateCustomGrid(
-    IN OUT GAME_GRAPHICS_LIB_GRID *Grid,
-    IN UINT32 GridHorizontalSize,
-    IN UINT32 GridVerticalSize,
-    IN UINT32 HorizontalCellsCount,
-    IN UINT32 VerticalCellsCount,
-    IN EFI_GRAPHICS_OUTPUT_BLT_PIXEL *Bitmap OPTIONAL)
+FinishGraphicMode(
+    IN OUT GAME_GRAPHICS_LIB_DATA *Data)
 {
-  if (Grid == NULL)
+  EFI_STATUS Status;
+
+  // Gives the back buffer fields back before anything else frees them
+  InternalDestroyCompositor(Data);
+  DisableParallelRendering(Data);
+  DisableAsyncPresent(Data);
+  InternalDestroyGlyphCache(Data);
+
+  if (Data->ScaledRows != NULL)
   {
-    return EFI_INVALID_PARAMETER;
+    gBS->FreePool(Data->ScaledRows);
+    Data->ScaledRows = NULL;
   }
 
-  Grid->HorizontalSize = GridHorizontalSize;
-  Grid->VerticalSize = GridVerticalSize;
-  Grid->HorizontalCellsCount = HorizontalCellsCount;
-  Grid->VerticalCellsCount = VerticalCellsCount;
+  InternalFreeBackBuffer(Data->BackBuffer, Data->SizeOfBackBuffer);
 
-  // If a bitmap is provided, use it
-  // else create a new bitmap with all cells colored black
-  if (Bitmap != NULL)
+  if (Data->Palette != NULL)
   {
-    Grid->ColorsBitmap = Bitmap;
+    FreePool(Data->Palette);
+    Data->Palette = NULL;
   }
-  else
+
+  // A failure only leaves the framebuffer write-combining, the mode is restored anyway
+  Status = SetFrameBufferWriteCombining(Data, FALSE);
+  if (EFI_ERROR(Status))
   {
-    Grid->ColorsBitmap = AllocatePool(HorizontalCellsCount * VerticalCellsCount * sizeof(EFI_GRAPHICS_OUTPUT_BLT_PIXEL));
-    if (Grid->ColorsBitmap == NULL)
+    DEBUG((DEBUG_WARN, "Failed to restore the framebuffer attributes: %r\n", Status));
+  }
+
+  // The firmware and the next application expect the screen the way it was before
+  if (Data->GraphicsOutput->Mode->Mode != Data->OriginalMode)
+  {
+    Status = Data->GraphicsOutput->SetMode(Data->GraphicsOutput, Data->OriginalMode);
+    if (EFI_ERROR(Status))
     {
-      DEBUG((DEBUG_ERROR, "Failed to allocate ColorsBitmap memory pool.\n"));
-      return EFI_OUT_OF_RESOURCES;
+      DEBUG((DEBUG_ERROR, "Failed to restore mode %u: %r\n", Data->OriginalMode, Status));
+      return Status;
     }
-
-    // Filling the bitmap with zeros (black)
-    SetMem(Grid->ColorsBitmap, HorizontalCellsCount * VerticalCellsCount * sizeof(EFI_GRAPHICS_OUTPUT_BLT_PIXEL), 0);
   }
 
-  Grid->DirtyBitmap = AllocatePool(HorizontalCellsCount * VerticalCellsCount * sizeof(BOOLEAN));
-  SetMem(Grid->DirtyBitmap, HorizontalCellsCount * VerticalCellsCount * sizeof(BOOLEAN), TRUE);
-
   return EFI_SUCCESS;
 }
 
-EFI_STATUS
-EFIAPI
-DrawGrid(
-    IN GAME_GRAPHICS_LIB_DATA *Data,
-    IN GAME_GRAPHICS_LIB_GRID *Grid,
-    IN UINT32 x,
-    IN UINT32 y)
+/// @brief Estimates the cost of presenting a frame in a mode
+/// @param Info Mode information returned by QueryMode
+/// @param Request Needs of the game
+/// @param Cost Pixels of the mode plus the pixels that make the grid cells uneven, times the cost of the pixel format
+/// @return TRUE if the mode satisfies the request, otherwise FALSE and Cost is not modified
+STATIC
+BOOLEAN
+ModeCost(
+    IN EFI_GRAPHICS_OUTPUT_MODE_INFORMATION *Info,
+    IN GAME_GRAPHICS_LIB_MODE_REQUEST *Request,
+    OUT UINT64 *Cost)
 {
-  UINT32 VerticalOffset = 0;
-  UINT32 HorizontalOffset = 0;
-  UINT32 CurrentCellHorizontalSize = 0;
-  UINT32 CurrentCellVerticalSize = 0;
-  UINT32 HorizontalRemainder = 0;
-  UINT32 VerticalRemainder = 0;
-
-  if ((Data == NULL) || (Grid == NULL))
+  UINT32 Width = Info->HorizontalResolution;
+  UINT32 Height = Info->VerticalResolution;
+  UINT32 GridHeight;
+  UINT64 Uneven = 0;
+  UINT32 FormatCost;
+  GAME_GRAPHICS_LIB_PIXEL_LAYOUT Layout;
+
+  if ((Width < Request->MinHorizontalResolution) || (Height < Request->MinVerticalResolution))
   {
-    return EFI_INVALID_PARAMETER;
+    return FALSE;
   }
 
-  // Calculating the size of each cell using division with remainder,
-  // to not create unintended 1 pixel gaps
-  for (INT32 i = 0; i < Grid->VerticalCellsCount; i++)
+  if ((Request->GridHorizontalCellsCount != 0) && (Request->GridVerticalCellsCount != 0))
   {
-    CurrentCellVerticalSize = Grid->VerticalSize / Grid->VerticalCellsCount;
-    VerticalRemainder += Grid->VerticalSize % Grid->VerticalCellsCount;
-    if (VerticalRemainder >= Grid->VerticalCellsCount)
+    // Every cell has to be at least one pixel in size
+    if ((Height <= Request->GridVerticalOffset) || (Width < Request->GridHorizontalCellsCount) ||
+        (Height - Request->GridVerticalOffset < Request->GridVerticalCellsCount))
     {
-      VerticalRemainder -= Grid->VerticalCellsCount;
-      CurrentCellVerticalSize++;
+      return FALSE;
     }
-    for (INT32 j = 0; j < Grid->HorizontalCellsCount; j++)
-    {
-      CurrentCellHorizontalSize = Grid->HorizontalSize / Grid->HorizontalCellsCount;
-      HorizontalRemainder += Grid->HorizontalSize % Grid->HorizontalCellsCount;
-      if (HorizontalRemainder >= Grid->HorizontalCellsCount)
-      {
-        HorizontalRemainder -= Grid->HorizontalCellsCount;
-        CurrentCellHorizontalSize++;
-      }
 
-      if (Grid->DirtyBitmap[i * Grid->HorizontalCellsCount + j])
-      {
-        // Intentionally ignoring return status of DrawRectangle
-        // This allows for the grid to be fully drawn even if some cells are off screen
-        DrawRectangle(Data,
-                      x + HorizontalOffset,
-                      y + VerticalOffset,
-                      CurrentCellHorizontalSize,
-                      CurrentCellVerticalSize,
-                      &Grid->ColorsBitmap[i * Grid->HorizontalCellsCount + j]);
-
-        Grid->DirtyBitmap[i * Grid->HorizontalCellsCount + j] = FALSE;
-      }
+    // Columns and rows of the remainder make some cells one pixel larger than the others, see CreateCustomGrid
+    GridHeight = Height - Request->GridVerticalOffset;
+    Uneven = (UINT64)(Width % Request->GridHorizontalCellsCount) * GridHeight +
+             (UINT64)(GridHeight % Request->GridVerticalCellsCount) * Width;
+  }
 
-      HorizontalOffset += CurrentCellHorizontalSize;
-    }
-    VerticalOffset += CurrentCellVerticalSize;
-    HorizontalOffset = 0;
+  if (Info->PixelFormat == PixelBlueGreenRedReserved8BitPerColor)
+  {
+    FormatCost = MODE_COST_BGR;
+  }
+  else if (BuildPixelLayout(Info, &Layout))
+  {
+    FormatCost = MODE_COST_CONVERTED;
+  }
+  else
+  {
+    FormatCost = MODE_COST_BLT_ONLY;
   }
 
-  return EFI_SUCCESS;
+  *Cost = ((UINT64)Width * Height + Uneven) * FormatCost;
+  return TRUE;
 }
 
 EFI_STATUS
 EFIAPI
-FillCellInGrid(
-    IN GAME_GRAPHICS_LIB_GRID *Grid,
-    IN UINT32 x,
-    IN UINT32 y,
-    IN EFI_GRAPHICS_OUTPUT_BLT_PIXEL *Color)
+SelectGraphicMode(
+    IN OUT GAME_GRAPHICS_LIB_DATA *Data,
+    IN GAME_GRAPHICS_LIB_MODE_REQUEST *Request)
 {
-  if ((Grid == NULL) || (Color == NULL))
+  EFI_STATUS Status;
+  EFI_GRAPHICS_OUTPUT_PROTOCOL *GraphicsOutput;
+  EFI_GRAPHICS_OUTPUT_MODE_INFORMATION *Info;
+  UINTN SizeOfInfo;
+  UINT64 Cost;
+  UINT64 BestCost = MAX_UINT64;
+  UINT32 BestMode = MAX_UINT32;
+  UINT32 PreviousMode;
+
+  if ((Data == NULL) || (Request == NULL))
   {
     return EFI_INVALID_PARAMETER;
   }
 
-  Grid->ColorsBitmap[y * Grid->HorizontalCellsCount + x] = *Color;
-  Grid->DirtyBitmap[y * Grid->HorizontalCellsCount + x] = TRUE;
-  return EFI_SUCCESS;
-}
-
-EFI_STATUS
-EFIAPI
-DeleteGrid(
-    IN GAME_GRAPHICS_LIB_GRID *Grid)
-{
-  if (Grid == NULL)
+  // The second back buffer of the present processor, a render target or the layers would have the size of the old mode
+  if ((Data->Presenter != NULL) || (Data->Compositor != NULL) ||
+      (Data->Screen.HorizontalResolution != Data->Output.HorizontalResolution) ||
+      (Data->Screen.VerticalResolution != Data->Output.VerticalResolution))
   {
-    return EFI_INVALID_PARAMETER;
+    DEBUG((DEBUG_ERROR, "SelectGraphicMode: Asynchronous present, layers or a render resolution is enabled.\n"));
+    return EFI_ALREADY_STARTED;
   }
 
-  if (Grid->ColorsBitmap != NULL)
+  GraphicsOutput = Data->GraphicsOutput;
+  for (UINT32 i = 0; i < GraphicsOutput->Mode->MaxMode; i++)
   {
-    FreePool(Grid->ColorsBitmap);
+    if (EFI_ERROR(GraphicsOutput->QueryMode(GraphicsOutput, i, &SizeOfInfo, &Info)))
+    {
+      continue;
+    }
+
+    if (ModeCost(Info, Request, &Cost) &&
+        ((Cost < BestCost) || ((Cost == BestCost) && (i == GraphicsOutput->Mode->Mode))))
+    {
+      BestCost = Cost;
+      BestMode = i;
+    }
+    FreePool(Info);
   }
 
-  if (Grid->DirtyBitmap != NULL)
+  if (BestMode == MAX_UINT32)
   {
-    FreePool(Grid->DirtyBitmap);
+    DEBUG((DEBUG_ERROR, "SelectGraphicMode: No mode of at least %ux%u fits the request.\n",
+           Request->MinHorizontalResolution, Request->MinVerticalResolution));
+    return EFI_NOT_FOUND;
   }
 
-  return EFI_SUCCESS;
-}
+  if (BestMode == GraphicsOutput->Mode->Mode)
+  {
+    DEBUG((DEBUG_INFO, "SelectGraphicMode: Keeping mode %u.\n", BestMode));
+    return EFI_SUCCESS;
+  }
 
-EFI_STATUS
+  // The attributes belong to the framebuffer of the old mode, the new one is read with the mode
+  Status = SetFrameBufferWriteCombining(Data, FALSE);
+  if (EFI_ERROR(Status))
+  {
+    DEBUG((DEBUG_ERROR, "SelectGraphicMode: Failed to restore the framebuffer attributes: %r\n", Status));
+    return Status;
+  }
+
+  // Render jobs still write into the back buffer of the old mode
+  WaitForRenderJobs(Data);
+  PreviousMode = GraphicsOutput->Mode->Mode;
+  Status = GraphicsOutput->SetMode(GraphicsOutput, BestMode);
+  if (EFI_ERROR(Status))
+  {
+    DEBUG((DEBUG_ERROR, "SelectGraphicMode: Failed to set mode %u: %r\n", BestMode, Status));
+    return Status;
+  }
+
+  ReadCurrentMode(Data);
+  DEBUG((DEBUG_INFO, "SelectGraphicMode: Switched to mode %u, %ux%u.\n",
+         BestMode, Data->Screen.HorizontalResolution, Data->Screen.VerticalResolution));
+
+  // Allocates a back buffer of the new resolution and clears the screen
+  Status = SetRenderResolution(Data, 0, 0);
+  if (EFI_ERROR(Status))
+  {
+    // The back buffer still has the size of the previous mode
+    DEBUG((DEBUG_ERROR, "SelectGraphicMode: Going back to mode %u: %r\n", PreviousMode, Status));
+    GraphicsOutput->SetMode(GraphicsOutput, PreviousMode);
+    ReadCurrentMode(Data);
+    return Status;
+  }
+
+  return EFI_SUCCESS;
+}
+
+/// @brief Fills an already clipped rectangle of the back buffer
+/// @param Color Value of the pixels, see InternalPixelValue
+/// @note Also runs on application processors, see INTERNAL_STRIP_FUNCTION
+STATIC
+VOID
+FillRectangle(
+    IN GAME_GRAPHICS_LIB_DATA *Data,
+    IN GAME_GRAPHICS_LIB_RECTANGLE *Rectangle,
+    IN UINT32 Color,
+    IN INTERNAL_FILL_SPAN FillSpan)
+{
+  UINT8 *FirstRow;
+  UINT8 *Row;
+  UINTN RowStride;
+  UINTN RowBytes;
+
+  if (Rectangle->Height == 0)
+  {
+    return;
+  }
+
+  FirstRow = InternalBackBufferPixel(Data, Data->BackBuffer, Rectangle->x, Rectangle->y);
+  RowStride = (UINTN)Data->BackBufferStride * Data->BackBufferPixelSize;
+  RowBytes = (UINTN)Rectangle->Width * Data->BackBufferPixelSize;
+
+  // Palette indices are single bytes, every row is set like a byte string
+  if (Data->Palette != NULL)
+  {
+    for (UINT32 i = 0; i < Rectangle->Height; i++)
+    {
+      SetMem(FirstRow + i * RowStride, RowBytes, (UINT8)Color);
+    }
+    return;
+  }
+
+  // Only the first row is filled pixel by pixel, the remaining rows are copies of it
+  FillSpan((UINT32 *)FirstRow, Rectangle->Width, Color);
+
+  Row = FirstRow;
+  for (UINT32 i = 1; i < Rectangle->Height; i++)
+  {
+    Row += RowStride;
+    CopyMem(Row, FirstRow, RowBytes);
+  }
+}
+
+/// @brief Fills one horizontal strip of a FILL_RECTANGLE_JOB
+STATIC
+VOID
+EFIAPI
+FillRectangleStrip(
+    IN GAME_GRAPHICS_LIB_DATA *Data,
+    IN CONST VOID *Context,
+    IN UINT32 Strip,
+    IN UINT32 StripCount,
+    IN INTERNAL_FILL_SPAN FillSpan)
+{
+  CONST FILL_RECTANGLE_JOB *Job = (CONST FILL_RECTANGLE_JOB *)Context;
+  GAME_GRAPHICS_LIB_RECTANGLE Rectangle = Job->Rectangle;
+  UINT32 Begin;
+  UINT32 End;
+
+  InternalStripRange(Job->Rectangle.Height, Strip, StripCount, &Begin, &End);
+  Rectangle.y += Begin;
+  Rectangle.Height = End - Begin;
+  FillRectangle(Data, &Rectangle, Job->Color, FillSpan);
+}
+
+/// @brief Fills an already clipped rectangle, split across the application processors if it is large enough
+/// @note The fill may still be running when this returns, see WaitForRenderJobs
+STATIC
+VOID
+FillRectangleParallel(
+    IN GAME_GRAPHICS_LIB_DATA *Data,
+    IN GAME_GRAPHICS_LIB_RECTANGLE *Rectangle,
+    IN UINT32 Color)
+{
+  FILL_RECTANGLE_JOB Job;
+
+  if ((UINT64)Rectangle->Width * Rectangle->Height >= INTERNAL_RENDER_JOB_MIN_PIXELS)
+  {
+    Job.Rectangle = *Rectangle;
+    Job.Color = Color;
+    if (InternalRunStripJob(Data, FillRectangleStrip, &Job, sizeof(Job), Rectangle->Height))
+    {
+      return;
+    }
+  }
+
+  WaitForRenderJobs(Data);
+  FillRectangle(Data, Rectangle, Color, gInternalFillSpan);
+}
+
+EFI_STATUS
+EFIAPI
+DrawRectangle(
+    IN GAME_GRAPHICS_LIB_DATA *Data,
+    IN INT32 x,
+    IN INT32 y,
+    IN INT32 HorizontalSize,
+    IN INT32 VerticalSize,
+    IN EFI_GRAPHICS_OUTPUT_BLT_PIXEL *Color)
+{
+  GAME_GRAPHICS_LIB_RECTANGLE Rectangle;
+
+  if ((Data == NULL) || (Color == NULL))
+  {
+    return EFI_INVALID_PARAMETER;
+  }
+
+  // Clipping once, so the fill itself never has to check for off screen pixels
+  if (!InternalClipRectangle(Data, x, y, HorizontalSize, VerticalSize, &Rectangle))
+  {
+    return EFI_SUCCESS;
+  }
+
+  FillRectangleParallel(Data, &Rectangle, InternalPixelValue(Data, Color));
+  InternalAddDamage(Data, &Rectangle);
+
+  return EFI_SUCCESS;
+}
+
+EFI_STATUS
+EFIAPI
+ClearScreen(
+    IN GAME_GRAPHICS_LIB_DATA *Data)
+{
+  GAME_GRAPHICS_LIB_RECTANGLE Screen = {0, 0, Data->Screen.HorizontalResolution, Data->Screen.VerticalResolution};
+  EFI_GRAPHICS_OUTPUT_BLT_PIXEL Black = {0, 0, 0, 0};
+  UINT32 Value;
+
+  // Black is zero, or a single byte palette index, so the whole buffer can be set byte by byte
+  Value = InternalPixelValue(Data, &Black);
+  if (Data->Renderer != NULL)
+  {
+    FillRectangleParallel(Data, &Screen, Value);
+  }
+  else
+  {
+    SetMem(Data->BackBuffer, Data->SizeOfBackBuffer, (UINT8)Value);
+  }
+
+  AddDamageRectangle(Data, 0, 0, Data->Screen.HorizontalResolution, Data->Screen.VerticalResolution);
+
+  return EFI_SUCCESS;
+}
+
+BOOLEAN
+EFIAPI
+InternalClipRectangle(
+    IN GAME_GRAPHICS_LIB_DATA *Data,
+    IN INT32 x,
+    IN INT32 y,
+    IN INT32 HorizontalSize,
+    IN INT32 VerticalSize,
+    OUT GAME_GRAPHICS_LIB_RECTANGLE *Rectangle)
+{
+  INT64 Left = x < 0 ? 0 : x;
+  INT64 Top = y < 0 ? 0 : y;
+  INT64 Right = (INT64)x + HorizontalSize;
+  INT64 Bottom = (INT64)y + VerticalSize;
+
+  if (Right > Data->Screen.HorizontalResolution)
+  {
+    Right = Data->Screen.HorizontalResolution;
+  }
+  if (Bottom > Data->Screen.VerticalResolution)
+  {
+    Bottom = Data->Screen.VerticalResolution;
+  }
+
+  if ((Right <= Left) || (Bottom <= Top))
+  {
+    return FALSE;
+  }
+
+  Rectangle->x = (UINT32)Left;
+  Rectangle->y = (UINT32)Top;
+  Rectangle->Width = (UINT32)(Right - Left);
+  Rectangle->Height = (UINT32)(Bottom - Top);
+  return TRUE;
+}
+
+EFI_STATUS
+EFIAPI
+SetPresentMode(
+    IN GAME_GRAPHICS_LIB_DATA *Data,
+    IN GAME_GRAPHICS_LIB_PRESENT_MODE Mode)
+{
+  if (Data == NULL)
+  {
+    return EFI_INVALID_PARAMETER;
+  }
+
+  if ((Mode == GameGraphicsPresentDirect) && !Data->DirectPresentSupported)
+  {
+    DEBUG((DEBUG_ERROR, "SetPresentMode: Current mode has no usable linear framebuffer.\n"));
+    return EFI_UNSUPPORTED;
+  }
+
+  if ((Mode == GameGraphicsPresentDirect) && !Data->FrameBufferWriteCombining &&
+      ((Data->FrameBufferAttributes & EFI_MEMORY_WC) == 0))
+  {
+    DEBUG((DEBUG_INFO, "SetPresentMode: Framebuffer is not write-combining, see SetFrameBufferWriteCombining.\n"));
+  }
+
+  Data->PresentMode = Mode;
+  return EFI_SUCCESS;
+}
+
+EFI_STATUS
+EFIAPI
+SetFrameBufferWriteCombining(
+    IN GAME_GRAPHICS_LIB_DATA *Data,
+    IN BOOLEAN Enable)
+{
+  EFI_STATUS Status;
+  EFI_GCD_MEMORY_SPACE_DESCRIPTOR Descriptor;
+  EFI_PHYSICAL_ADDRESS Base;
+  UINT64 Length;
+
+  if (Data == NULL)
+  {
+    return EFI_INVALID_PARAMETER;
+  }
+
+  if (Enable == Data->FrameBufferWriteCombining)
+  {
+    return EFI_SUCCESS;
+  }
+
+  if (Enable && ((Data->FrameBuffer == NULL) || (Data->FrameBufferAttributes == 0)))
+  {
+    DEBUG((DEBUG_ERROR, "SetFrameBufferWriteCombining: Current mode has no usable linear framebuffer.\n"));
+    return EFI_UNSUPPORTED;
+  }
+
+  if (Enable && ((Data->FrameBufferAttributes & EFI_MEMORY_WC) != 0))
+  {
+    return EFI_SUCCESS;
+  }
+
+  // The firmware updates the cache settings of every processor, which needs the application processors idle
+  if ((Data->Renderer != NULL) || (Data->Presenter != NULL))
+  {
+    DEBUG((DEBUG_ERROR, "SetFrameBufferWriteCombining: Parallel rendering or asynchronous present is enabled.\n"));
+    return EFI_ALREADY_STARTED;
+  }
+
+  Base = Data->GraphicsOutput->Mode->FrameBufferBase;
+  Length = EFI_PAGES_TO_SIZE(EFI_SIZE_TO_PAGES(Data->GraphicsOutput->Mode->FrameBufferSize));
+  if (!Enable)
+  {
+    Status = gDS->SetMemorySpaceAttributes(Base, Length, Data->FrameBufferAttributes);
+    if (EFI_ERROR(Status))
+    {
+      return Status;
+    }
+
+    Data->FrameBufferWriteCombining = FALSE;
+    return EFI_SUCCESS;
+  }
+
+  Status = gDS->GetMemorySpaceDescriptor(Base, &Descriptor);
+  if (EFI_ERROR(Status))
+  {
+    return Status;
+  }
+  if ((Descriptor.Capabilities & EFI_MEMORY_WC) == 0)
+  {
+    DEBUG((DEBUG_WARN, "SetFrameBufferWriteCombining: Framebuffer can not be write-combining.\n"));
+    return EFI_UNSUPPORTED;
+  }
+
+  // Only the cache type changes, access attributes like EFI_MEMORY_XP are kept
+  Status = gDS->SetMemorySpaceAttributes(Base, Length, (Data->FrameBufferAttributes & ~EFI_MEMORY_CACHETYPE_MASK) | EFI_MEMORY_WC);
+  if (EFI_ERROR(Status))
+  {
+    DEBUG((DEBUG_ERROR, "SetFrameBufferWriteCombining: Failed to set the attributes: %r\n", Status));
+    return Status;
+  }
+
+  Data->FrameBufferWriteCombining = TRUE;
+  return EFI_SUCCESS;
+}
+
+EFI_STATUS
+EFIAPI
+ResetPresentStats(
+    IN GAME_GRAPHICS_LIB_DATA *Data)
+{
+  if (Data == NULL)
+  {
+    return EFI_INVALID_PARAMETER;
+  }
+
+  ZeroMem(&Data->PresentStats, sizeof(Data->PresentStats));
+  return EFI_SUCCESS;
+}
+
+VOID
+EFIAPI
+InternalPresentDirect(
+    IN GAME_GRAPHICS_LIB_DATA *Data,
+    IN EFI_GRAPHICS_OUTPUT_BLT_PIXEL *Buffer,
+    IN UINT32 x,
+    IN UINT32 y,
+    IN UINT32 Width,
+    IN UINT32 Height)
+{
+  INTERNAL_PALETTE *Palette = Data->Palette;
+  UINT32 *Source;
+  UINT32 *Destination;
+
+  if (Data->Scale > 1)
+  {
+    InternalPresentScaledDirect(Data, Buffer, x, y, Width, Height);
+    return;
+  }
+
+  for (UINT32 Row = y; Row < y + Height; Row++)
+  {
+    Source = InternalBackBufferPixel(Data, Buffer, x, Row);
+    // A render target smaller than the mode is centered even if it is not scaled
+    Destination = &Data->FrameBuffer[((UINTN)Data->OutputY + Row) * Data->PixelsPerScanLine + Data->OutputX + x];
+
+    // The lookup table is already in the framebuffer format, the expansion is the conversion
+    if (Palette != NULL)
+    {
+      gInternalExpandSpan(Destination, (UINT8 *)Source, Width, Palette->FrameBufferColors);
+    }
+    else if (Data->PixelFormat == PixelBlueGreenRedReserved8BitPerColor)
+    {
+      InternalStreamCopy32(Destination, Source, Width);
+    }
+    else
+    {
+      gInternalConvertSpan(Destination, Source, Width, &Data->PixelLayout);
+    }
+  }
+}
+
+EFI_STATUS
+EFIAPI
+InternalPresentRectangle(
+    IN GAME_GRAPHICS_LIB_DATA *Data,
+    IN UINT32 x,
+    IN UINT32 y,
+    IN UINT32 Width,
+    IN UINT32 Height)
+{
+  if ((Width == 0) || (Height == 0))
+  {
+    return EFI_SUCCESS;
+  }
+
+  if (Data->Scale > 1)
+  {
+    return InternalPresentScaled(Data, x, y, Width, Height);
+  }
+
+  if (Data->PresentMode == GameGraphicsPresentDirect)
+  {
+    InternalPresentDirect(Data, Data->BackBuffer, x, y, Width, Height);
+    return EFI_SUCCESS;
+  }
+
+  // Blt only understands colors, palette indices are expanded into the staging rows first
+  if (Data->Palette != NULL)
+  {
+    return InternalPresentScaled(Data, x, y, Width, Height);
+  }
+
+  return Data->GraphicsOutput->Blt(
+      Data->GraphicsOutput,
+      Data->BackBuffer,
+      EfiBltBufferToVideo,
+      x,
+      y,
+      Data->OutputX + x,
+      Data->OutputY + y,
+      Width,
+      Height,
+      Data->BackBufferStride * sizeof(EFI_GRAPHICS_OUTPUT_BLT_PIXEL));
+}
+
+VOID
+EFIAPI
+InternalFinishPresent(
+    IN GAME_GRAPHICS_LIB_DATA *Data,
+    IN UINT64 StartCycles,
+    IN UINT64 Bytes)
+{
+  if (Data->PresentMode == GameGraphicsPresentDirect)
+  {
+    InternalStreamFence();
+  }
+
+  // Callers count back buffer pixels, every one of them is written Scale * Scale times
+  Bytes *= (UINT64)Data->Scale * Data->Scale;
+  Data->PresentStats.LastBytes = Bytes;
+  Data->PresentStats.LastCycles = GetGameLoopCycleCounter() - StartCycles;
+  Data->PresentStats.TotalBytes += Bytes;
+  Data->PresentStats.TotalCycles += Data->PresentStats.LastCycles;
+  Data->PresentStats.PresentCount++;
+}
+
+EFI_STATUS
+EFIAPI
+UpdateVideoBuffer(
+    IN GAME_GRAPHICS_LIB_DATA *Data)
+{
+  EFI_STATUS Status;
+  UINT64 StartCycles;
+
+  Status = CompositeLayers(Data);
+  if (EFI_ERROR(Status))
+  {
+    return Status;
+  }
+
+  WaitForRenderJobs(Data);
+  WaitForPresent(Data);
+
+  StartCycles = GetGameLoopCycleCounter();
+  Status = InternalPresentRectangle(
+      Data,
+      0,
+      0,
+      Data->Screen.HorizontalResolution,
+      Data->Screen.VerticalResolution);
+  if (EFI_ERROR(Status))
+  {
+    InternalFinishPresent(Data, StartCycles, 0);
+    DEBUG((DEBUG_ERROR, "UpdateVideoBuffer: Failed to update video buffer: %r\n", Status));
+    return Status;
+  }
+
+  // Whole screen is up to date, so is every damaged area
+  InternalSyncBackBuffers(Data);
+  Data->Damage.Count = 0;
+  InternalFinishPresent(
+      Data,
+      StartCycles,
+      (UINT64)Data->Screen.HorizontalResolution * Data->Screen.VerticalResolution * sizeof(EFI_GRAPHICS_OUTPUT_BLT_PIXEL));
+
+  return EFI_SUCCESS;
+}
+
+EFI_STATUS
+EFIAPI
+SmartUpdateVideoBuffer(
+    IN GAME_GRAPHICS_LIB_DATA *Data,
+    IN INT32 x,
+    IN INT32 y,
+    IN INT32 HorizontalSize,
+    IN INT32 VerticalSize)
+{
+  EFI_STATUS Status;
+  UINT64 StartCycles;
+  GAME_GRAPHICS_LIB_RECTANGLE Rectangle;
+
+  Status = CompositeLayers(Data);
+  if (EFI_ERROR(Status))
+  {
+    return Status;
+  }
+
+  WaitForRenderJobs(Data);
+  WaitForPresent(Data);
+
+  StartCycles = GetGameLoopCycleCounter();
+  if (!InternalClipRectangle(Data, x, y, HorizontalSize, VerticalSize, &Rectangle))
+  {
+    InternalFinishPresent(Data, StartCycles, 0);
+    return EFI_SUCCESS;
+  }
+
+  Status = InternalPresentRectangle(Data, Rectangle.x, Rectangle.y, Rectangle.Width, Rectangle.Height);
+  if (EFI_ERROR(Status))
+  {
+    InternalFinishPresent(Data, StartCycles, 0);
+    DEBUG((DEBUG_ERROR, "RealX: %d, RealY: %d, RealWidth: %d, RealHeight: %d\n", Rectangle.x, Rectangle.y, Rectangle.Width, Rectangle.Height));
+    DEBUG((DEBUG_ERROR, "SmartUpdateVideoBuffer: Failed to update video buffer: %r\n", Status));
+    return Status;
+  }
+
+  InternalFinishPresent(Data, StartCycles, (UINT64)Rectangle.Width * Rectangle.Height * sizeof(EFI_GRAPHICS_OUTPUT_BLT_PIXEL));
+
+  return EFI_SUCCESS;
+}
+
+/// @brief Fills an offset table with the positions of the cell borders along one axis
+/// @param Offsets Table with CellsCount + 1 entries. Entry i is the pixel offset of cell i, the last entry is the total size
+/// @param TotalSize Size of the grid along the axis
+/// @param CellsCount Number of cells along the axis
+/// @note Cell sizes are calculated using division with remainder, to not create unintended 1 pixel gaps
+STATIC
+VOID
+BuildGridOffsets(
+    OUT UINT32 *Offsets,
+    IN UINT32 TotalSize,
+    IN UINT32 CellsCount)
+{
+  UINT32 Offset = 0;
+  UINT32 CellSize;
+  UINT32 Remainder = 0;
+
+  for (UINT32 i = 0; i < CellsCount; i++)
+  {
+    Offsets[i] = Offset;
+
+    CellSize = TotalSize / CellsCount;
+    Remainder += TotalSize % CellsCount;
+    if (Remainder >= CellsCount)
+    {
+      Remainder -= CellsCount;
+      CellSize++;
+    }
+    Offset += CellSize;
+  }
+  Offsets[CellsCount] = Offset;
+}
+
+/// @brief Finds the cell that contains a pixel offset along one axis
+/// @return Index of the cell, or CellsCount if the offset is outside of the grid
+/// @note The first guess is exact up to one cell, since all cells differ in size by at most one pixel
+STATIC
+UINT32
+FindGridCell(
+    IN UINT32 *Offsets,
+    IN UINT32 TotalSize,
+    IN UINT32 CellsCount,
+    IN UINT32 Offset)
+{
+  UINT32 Cell;
+
+  if (Offset >= Offsets[CellsCount])
+  {
+    return CellsCount;
+  }
+
+  Cell = (UINT32)DivU64x32((UINT64)Offset * CellsCount, TotalSize);
+  if (Cell >= CellsCount)
+  {
+    Cell = CellsCount - 1;
+  }
+  while (Offset < Offsets[Cell])
+  {
+    Cell--;
+  }
+  while (Offset >= Offsets[Cell + 1])
+  {
+    Cell++;
+  }
+
+  return Cell;
+}
+
+/// @brief Number of 64 bit words in the dirty bitset of a grid
+STATIC
+UINTN
+GridDirtyWords(
+    IN GAME_GRAPHICS_LIB_GRID *Grid)
+{
+  return ((UINTN)Grid->HorizontalCellsCount * Grid->VerticalCellsCount + 63) / 64;
+}
+
+/// @brief Marks a single cell as changed
+/// @note Cells already marked are not queued again, so the queue never holds duplicates
+STATIC
+VOID
+MarkGridCellDirty(
+    IN GAME_GRAPHICS_LIB_GRID *Grid,
+    IN UINT32 Index)
+{
+  UINT64 Bit = LShiftU64(1, Index % 64);
+
+  if ((Grid->DirtyBitmap[Index / 64] & Bit) != 0)
+  {
+    return;
+  }
+  Grid->DirtyBitmap[Index / 64] |= Bit;
+
+  if (Grid->DirtyQueueCount < Grid->DirtyQueueSize)
+  {
+    Grid->DirtyQueue[Grid->DirtyQueueCount++] = Index;
+  }
+  else
+  {
+    Grid->DirtyQueueOverflow = TRUE;
+  }
+}
+
+/// @brief Marks every cell of the grid as changed
+STATIC
+VOID
+MarkGridDirty(
+    IN GAME_GRAPHICS_LIB_GRID *Grid)
+{
+  UINTN Words = GridDirtyWords(Grid);
+  UINT32 UsedBits = (UINT32)(((UINTN)Grid->HorizontalCellsCount * Grid->VerticalCellsCount) % 64);
+
+  SetMem(Grid->DirtyBitmap, Words * sizeof(UINT64), 0xFF);
+
+  // Bits past the last cell stay clear, so the word scan in DrawGridEx never finds them
+  if (UsedBits != 0)
+  {
+    Grid->DirtyBitmap[Words - 1] = LShiftU64(1, UsedBits) - 1;
+  }
+
+  Grid->DirtyQueueCount = 0;
+  Grid->DirtyQueueOverflow = TRUE;
+}
+
+/// @brief Calculates the area of a cell of the grid drawn at x, y
+STATIC
+VOID
+GetGridCellRectangle(
+    IN GAME_GRAPHICS_LIB_GRID *Grid,
+    IN UINT32 x,
+    IN UINT32 y,
+    IN UINT32 Index,
+    OUT GAME_GRAPHICS_LIB_RECTANGLE *Cell)
+{
+  UINT32 Column = Index % Grid->HorizontalCellsCount;
+  UINT32 Row = Index / Grid->HorizontalCellsCount;
+
+  Cell->x = x + Grid->ColumnOffsets[Column];
+  Cell->y = y + Grid->RowOffsets[Row];
+  Cell->Width = Grid->ColumnOffsets[Column + 1] - Grid->ColumnOffsets[Column];
+  Cell->Height = Grid->RowOffsets[Row + 1] - Grid->RowOffsets[Row];
+}
+
+/// @brief Draws the pattern of a cell on the BSP and records its damage
+/// @return FALSE if the cell has no usable pattern and has to be filled with its color
+STATIC
+BOOLEAN
+DrawGridPatternCell(
+    IN GAME_GRAPHICS_LIB_DATA *Data,
+    IN GAME_GRAPHICS_LIB_GRID *Grid,
+    IN UINT32 Index,
+    IN GAME_GRAPHICS_LIB_RECTANGLE *Cell)
+{
+  GAME_GRAPHICS_LIB_RECTANGLE Visible;
+
+  if (Grid->PatternsBitmap[Index] == 0)
+  {
+    return FALSE;
+  }
+
+  if (!InternalClipRectangle(Data, Cell->x, Cell->y, Cell->Width, Cell->Height, &Visible))
+  {
+    return TRUE;
+  }
+
+  WaitForRenderJobs(Data);
+  if (!InternalDrawGridPattern(Data, Grid, Index, Cell, &Visible))
+  {
+    return FALSE;
+  }
+  InternalAddDamage(Data, &Visible);
+
+  return TRUE;
+}
+
+/// @brief Draws one cell of the grid and optionally records its area
+/// @param PaintedArea Not NULL if a render job already filled the cell, then the cell is only added to this area
+///                    and the caller records the damage. Width is 0 while the area is empty
+STATIC
+VOID
+DrawGridCell(
+    IN GAME_GRAPHICS_LIB_DATA *Data,
+    IN GAME_GRAPHICS_LIB_GRID *Grid,
+    IN UINT32 x,
+    IN UINT32 y,
+    IN UINT32 Index,
+    IN OUT GAME_GRAPHICS_LIB_RECTANGLE *PaintedArea OPTIONAL,
+    OUT GAME_GRAPHICS_LIB_RECTANGLE *Rectangles OPTIONAL,
+    IN UINTN MaxRectangles,
+    IN OUT UINTN *Count)
+{
+  GAME_GRAPHICS_LIB_RECTANGLE Cell;
+
+  GetGridCellRectangle(Grid, x, y, Index, &Cell);
+
+  // Intentionally ignoring return status of DrawRectangle
+  // This allows for the grid to be fully drawn even if some cells are off screen
+  if (PaintedArea != NULL)
+  {
+    if (PaintedArea->Width == 0)
+    {
+      *PaintedArea = Cell;
+    }
+    else
+    {
+      InternalUnionRectangle(PaintedArea, &Cell, PaintedArea);
+    }
+  }
+  else if (!DrawGridPatternCell(Data, Grid, Index, &Cell))
+  {
+    DrawRectangle(Data, Cell.x, Cell.y, Cell.Width, Cell.Height, &Grid->ColorsBitmap[Index]);
+  }
+
+  if ((Rectangles != NULL) && (*Count < MaxRectangles))
+  {
+    Rectangles[*Count] = Cell;
+  }
+  (*Count)++;
+}
+
+/// @brief Records the area a render job painted in one strip of the grid as a single damage rectangle
+/// @param PaintedArea Bounds of the changed cells of the strip, emptied afterwards
+STATIC
+VOID
+AddGridStripDamage(
+    IN GAME_GRAPHICS_LIB_DATA *Data,
+    IN OUT GAME_GRAPHICS_LIB_RECTANGLE *PaintedArea)
+{
+  if (PaintedArea->Width != 0)
+  {
+    AddDamageRectangle(Data, PaintedArea->x, PaintedArea->y, PaintedArea->Width, PaintedArea->Height);
+    PaintedArea->Width = 0;
+  }
+}
+
+/// @brief Fills the changed cells of one band of grid rows of a DRAW_GRID_JOB
+/// @note Cells of different grid rows never share pixel rows, so the strips do not overlap
+STATIC
+VOID
+EFIAPI
+DrawGridStrip(
+    IN GAME_GRAPHICS_LIB_DATA *Data,
+    IN CONST VOID *Context,
+    IN UINT32 Strip,
+    IN UINT32 StripCount,
+    IN INTERNAL_FILL_SPAN FillSpan)
+{
+  CONST DRAW_GRID_JOB *Job = (CONST DRAW_GRID_JOB *)Context;
+  GAME_GRAPHICS_LIB_GRID *Grid = Job->Grid;
+  GAME_GRAPHICS_LIB_RECTANGLE Cell;
+  GAME_GRAPHICS_LIB_RECTANGLE Visible;
+  UINT32 FirstRow;
+  UINT32 EndRow;
+  UINTN First;
+  UINTN End;
+  UINT64 Word;
+  UINT32 Index;
+
+  InternalStripRange(Grid->VerticalCellsCount, Strip, StripCount, &FirstRow, &EndRow);
+  First = (UINTN)FirstRow * Grid->HorizontalCellsCount;
+  End = (UINTN)EndRow * Grid->HorizontalCellsCount;
+  if (First == End)
+  {
+    return;
+  }
+
+  for (UINTN i = First / 64; i <= (End - 1) / 64; i++)
+  {
+    // The first and last word are shared with the neighbouring strips
+    Word = Grid->DirtyBitmap[i];
+    if (i * 64 < First)
+    {
+      Word &= LShiftU64(MAX_UINT64, First % 64);
+    }
+    if ((i + 1) * 64 > End)
+    {
+      Word &= LShiftU64(1, End % 64) - 1;
+    }
+
+    while (Word != 0)
+    {
+      Index = (UINT32)(i * 64) + (UINT32)LowBitSet64(Word);
+      Word &= Word - 1;
+
+      GetGridCellRectangle(Grid, Job->x, Job->y, Index, &Cell);
+      if (InternalClipRectangle(Data, Cell.x, Cell.y, Cell.Width, Cell.Height, &Visible) &&
+          !InternalDrawGridPattern(Data, Grid, Index, &Cell, &Visible))
+      {
+        FillRectangle(Data, &Visible, InternalPixelValue(Data, &Grid->ColorsBitmap[Index]), FillSpan);
+      }
+    }
+  }
+}
+
+EFI_STATUS
 EFIAPI
-ClearGrid(
-    IN GAME_GRAPHICS_LIB_GRID *Grid)
+UpdateCellInGrid(
+    IN GAME_GRAPHICS_LIB_DATA *Data,
+    IN GAME_GRAPHICS_LIB_GRID *Grid,
+    IN INT32 xOffset,
+    IN INT32 yOffset,
+    IN INT32 x,
+    IN INT32 y)
+{
+  if ((Data == NULL) || (Grid == NULL))
+  {
+    return EFI_INVALID_PARAMETER;
+  }
+
+  if ((x < 0) || (y < 0) || ((UINT32)x >= Grid->HorizontalCellsCount) || ((UINT32)y >= Grid->VerticalCellsCount))
+  {
+    return EFI_SUCCESS;
+  }
+
+  SmartUpdateVideoBuffer(Data,
+                         xOffset + Grid->ColumnOffsets[x] - 1,
+                         yOffset + Grid->RowOffsets[y] - 1,
+                         Grid->ColumnOffsets[x + 1] - Grid->ColumnOffsets[x] + 2,
+                         Grid->RowOffsets[y + 1] - Grid->RowOffsets[y] + 2);
+  return EFI_SUCCESS;
+}
+
+EFI_STATUS
+EFIAPI
+GetCellAtPosition(
+    IN GAME_GRAPHICS_LIB_GRID *Grid,
+    IN INT32 xOffset,
+    IN INT32 yOffset,
+    IN INT32 PixelX,
+    IN INT32 PixelY,
+    OUT UINT32 *x,
+    OUT UINT32 *y)
+{
+  UINT32 CellX;
+  UINT32 CellY;
+
+  if ((Grid == NULL) || (x == NULL) || (y == NULL))
+  {
+    return EFI_INVALID_PARAMETER;
+  }
+
+  if ((PixelX < xOffset) || (PixelY < yOffset))
+  {
+    return EFI_NOT_FOUND;
+  }
+
+  CellX = FindGridCell(Grid->ColumnOffsets, Grid->HorizontalSize, Grid->HorizontalCellsCount, (UINT32)(PixelX - xOffset));
+  CellY = FindGridCell(Grid->RowOffsets, Grid->VerticalSize, Grid->VerticalCellsCount, (UINT32)(PixelY - yOffset));
+  if ((CellX >= Grid->HorizontalCellsCount) || (CellY >= Grid->VerticalCellsCount))
+  {
+    return EFI_NOT_FOUND;
+  }
+
+  *x = CellX;
+  *y = CellY;
+  return EFI_SUCCESS;
+}
+
+EFI_STATUS
+EFIAPI
+CreateCustomGrid(
+    IN OUT GAME_GRAPHICS_LIB_GRID *Grid,
+    IN UINT32 GridHorizontalSize,
+    IN UINT32 GridVerticalSize,
+    IN UINT32 HorizontalCellsCount,
+    IN UINT32 VerticalCellsCount,
+    IN EFI_GRAPHICS_OUTPUT_BLT_PIXEL *Bitmap OPTIONAL)
+{
+  UINT64 CellCount;
+
+  if ((Grid == NULL) || (HorizontalCellsCount == 0) || (VerticalCellsCount == 0))
+  {
+    return EFI_INVALID_PARAMETER;
+  }
+
+  // Cells are indexed with 32 bit numbers and the offset tables hold one entry more than there are columns and rows,
+  // so neither count may reach MAX_UINT32. None of the tables may be larger than the address space either
+  CellCount = MultU64x32(HorizontalCellsCount, VerticalCellsCount);
+  if ((HorizontalCellsCount == MAX_UINT32) || (VerticalCellsCount == MAX_UINT32) || (CellCount > MAX_UINT32) ||
+      (MultU64x32(CellCount, sizeof(EFI_GRAPHICS_OUTPUT_BLT_PIXEL)) > MAX_UINTN) ||
+      (MultU64x32((UINT64)HorizontalCellsCount + 1, sizeof(UINT32)) > MAX_UINTN) ||
+      (MultU64x32((UINT64)VerticalCellsCount + 1, sizeof(UINT32)) > MAX_UINTN))
+  {
+    return EFI_INVALID_PARAMETER;
+  }
+
+  Grid->HorizontalSize = GridHorizontalSize;
+  Grid->VerticalSize = GridVerticalSize;
+  Grid->HorizontalCellsCount = HorizontalCellsCount;
+  Grid->VerticalCellsCount = VerticalCellsCount;
+  Grid->ColorsBitmap = NULL;
+  Grid->DirtyBitmap = NULL;
+  Grid->DirtyQueue = NULL;
+  Grid->PatternsBitmap = NULL;
+  Grid->Patterns = NULL;
+
+  // Cell geometry is calculated once here, so drawing and lookups never have to repeat it
+  Grid->ColumnOffsets = AllocatePool(((UINTN)HorizontalCellsCount + 1) * sizeof(UINT32));
+  Grid->RowOffsets = AllocatePool(((UINTN)VerticalCellsCount + 1) * sizeof(UINT32));
+  if ((Grid->ColumnOffsets == NULL) || (Grid->RowOffsets == NULL))
+  {
+    DEBUG((DEBUG_ERROR, "Failed to allocate grid offset tables.\n"));
+    DeleteGrid(Grid);
+    return EFI_OUT_OF_RESOURCES;
+  }
+  BuildGridOffsets(Grid->ColumnOffsets, GridHorizontalSize, HorizontalCellsCount);
+  BuildGridOffsets(Grid->RowOffsets, GridVerticalSize, VerticalCellsCount);
+
+  // If a bitmap is provided, the grid takes it over once everything else is allocated, so a failure leaves it to
+  // the caller. Otherwise a new bitmap is created with all cells colored black
+  if (Bitmap == NULL)
+  {
+    Grid->ColorsBitmap = AllocatePool(HorizontalCellsCount * VerticalCellsCount * sizeof(EFI_GRAPHICS_OUTPUT_BLT_PIXEL));
+    if (Grid->ColorsBitmap == NULL)
+    {
+      DEBUG((DEBUG_ERROR, "Failed to allocate ColorsBitmap memory pool.\n"));
+      DeleteGrid(Grid);
+      return EFI_OUT_OF_RESOURCES;
+    }
+
+    // Filling the bitmap with zeros (black)
+    SetMem(Grid->ColorsBitmap, HorizontalCellsCount * VerticalCellsCount * sizeof(EFI_GRAPHICS_OUTPUT_BLT_PIXEL), 0);
+  }
+
+  // The queue is only useful while it is shorter than the bitset, past that a word scan is just as fast
+  Grid->DirtyQueueSize = (UINT32)GridDirtyWords(Grid) + GRID_DIRTY_QUEUE_MIN_SIZE;
+  Grid->DirtyBitmap = AllocatePool(GridDirtyWords(Grid) * sizeof(UINT64));
+  Grid->DirtyQueue = AllocatePool(Grid->DirtyQueueSize * sizeof(UINT32));
+  if ((Grid->DirtyBitmap == NULL) || (Grid->DirtyQueue == NULL))
+  {
+    DEBUG((DEBUG_ERROR, "Failed to allocate DirtyBitmap memory pool.\n"));
+    DeleteGrid(Grid);
+    return EFI_OUT_OF_RESOURCES;
+  }
+  // Every cell starts as a plain color fill
+  Grid->PatternsBitmap = AllocateZeroPool(HorizontalCellsCount * VerticalCellsCount * sizeof(UINT8));
+  if (Grid->PatternsBitmap == NULL)
+  {
+    DEBUG((DEBUG_ERROR, "Failed to allocate PatternsBitmap memory pool.\n"));
+    DeleteGrid(Grid);
+    return EFI_OUT_OF_RESOURCES;
+  }
+
+  if (Bitmap != NULL)
+  {
+    Grid->ColorsBitmap = Bitmap;
+  }
+
+  MarkGridDirty(Grid);
+
+  return EFI_SUCCESS;
+}
+
+EFI_STATUS
+EFIAPI
+ResizeGrid(
+    IN GAME_GRAPHICS_LIB_GRID *Grid,
+    IN UINT32 GridHorizontalSize,
+    IN UINT32 GridVerticalSize)
 {
   if (Grid == NULL)
   {
     return EFI_INVALID_PARAMETER;
   }
 
-  SetMem(Grid->ColorsBitmap, Grid->HorizontalCellsCount * Grid->VerticalCellsCount * sizeof(EFI_GRAPHICS_OUTPUT_BLT_PIXEL), 0);
-  SetMem(Grid->DirtyBitmap, Grid->HorizontalCellsCount * Grid->VerticalCellsCount * sizeof(BOOLEAN), TRUE);
+  Grid->HorizontalSize = GridHorizontalSize;
+  Grid->VerticalSize = GridVerticalSize;
+  BuildGridOffsets(Grid->ColumnOffsets, GridHorizontalSize, Grid->HorizontalCellsCount);
+  BuildGridOffsets(Grid->RowOffsets, GridVerticalSize, Grid->VerticalCellsCount);
+
+  // Patterns that can not be scaled are drawn with the cell color instead, the grid stays usable
+  if (EFI_ERROR(InternalScaleGridPatterns(Grid)))
+  {
+    DEBUG((DEBUG_ERROR, "ResizeGrid: Failed to scale grid patterns.\n"));
+  }
+
+  // Every cell moved, so all of them have to be drawn again
+  MarkGridDirty(Grid);
 
   return EFI_SUCCESS;
 }
 
 EFI_STATUS
 EFIAPI
-DrawCharacter(
+DrawGrid(
+    IN GAME_GRAPHICS_LIB_DATA *Data,
+    IN GAME_GRAPHICS_LIB_GRID *Grid,
+    IN UINT32 x,
+    IN UINT32 y)
+{
+  return DrawGridEx(Data, Grid, x, y, NULL, 0, NULL);
+}
+
+EFI_STATUS
+EFIAPI
+DrawGridEx(
     IN GAME_GRAPHICS_LIB_DATA *Data,
+    IN GAME_GRAPHICS_LIB_GRID *Grid,
     IN UINT32 x,
     IN UINT32 y,
-    IN CHAR8 Character,
-    IN EFI_GRAPHICS_OUTPUT_BLT_PIXEL *ForegroundColor,
-    IN EFI_GRAPHICS_OUTPUT_BLT_PIXEL *BackgroundColor,
-    IN UINT32 SizeMultipiler)
+    OUT GAME_GRAPHICS_LIB_RECTANGLE *Rectangles OPTIONAL,
+    IN UINTN MaxRectangles,
+    OUT UINTN *RectangleCount OPTIONAL)
 {
-  UINTN FontHeight = FONT_VERTICAL_SIZE;
-  UINTN FontWidth = FONT_HORIZONTAL_SIZE;
-  UINT32 CurrentX = x;
-  UINT32 CurrentY = y;
-  UINTN CurrentCharacter = (UINTN)Character;
+  UINTN Count = 0;
+  UINTN Words;
+  UINT64 Word;
+  UINT32 Index;
+  DRAW_GRID_JOB Job;
+  BOOLEAN Painted;
+  GAME_GRAPHICS_LIB_RECTANGLE PaintedArea;
+  UINT32 StripCount;
+  UINT32 Strip;
+  UINT32 StripBegin;
+  UINT32 StripEnd;
 
-  if (CurrentCharacter >= FONT_CHARACTER_COUNT)
+  if ((Data == NULL) || (Grid == NULL))
   {
-    DEBUG((DEBUG_ERROR, "DrawCharacter: Invalid character. \n"));
     return EFI_INVALID_PARAMETER;
   }
 
-  if (CurrentX < 0 || CurrentY < 0 ||
-      CurrentX >= Data->Screen.HorizontalResolution ||
-      CurrentY >= Data->Screen.VerticalResolution)
+  if (Grid->DirtyQueueOverflow)
   {
-    DEBUG((DEBUG_ERROR, "DrawCharacter: Coordinates out of screen bounds.\n"));
-    return EFI_INVALID_PARAMETER;
-  }
+    // Many cells changed, so the application processors fill them in bands of grid rows.
+    // The bitset is only cleared once they are done, the caller may change the grid as soon as this returns
+    Job.Grid = Grid;
+    Job.x = x;
+    Job.y = y;
+    StripCount = InternalRenderStripCount(Data, Grid->VerticalCellsCount);
+    Painted = InternalRunStripJob(Data, DrawGridStrip, &Job, sizeof(Job), Grid->VerticalCellsCount);
+    if (Painted)
+    {
+      WaitForRenderJobs(Data);
+    }
 
-  for (UINTN BitmapRow = 0; BitmapRow < FontHeight; BitmapRow++)
-  {
-    for (UINTN BitmapColumn = 0; BitmapColumn < FontWidth; BitmapColumn++)
+    // The cells painted by the job are damaged as one rectangle per strip, so the damage list does not fill up.
+    // Cells are visited in order, so all cells of a strip come one after another
+    PaintedArea.Width = 0;
+    Strip = 0;
+    StripEnd = 0;
+    if (Painted)
     {
-      // If the pixel is out of screen bounds, skip it
-      if (CurrentX + SizeMultipiler >= Data->Screen.HorizontalResolution ||
-          CurrentY + SizeMultipiler >= Data->Screen.VerticalResolution)
-      {
-        continue;
-      }
+      InternalStripRange(Grid->VerticalCellsCount, Strip, StripCount, &StripBegin, &StripEnd);
+    }
 
-      // Using 8x8 font bitmap, we extract the bit of the current pixel
-      // of the current character
-      if ((gFont8x8_basic[CurrentCharacter][BitmapRow] >> BitmapColumn) & 0x1)
-      {
-        for (INTN i = 0; i < SizeMultipiler; i++)
-        {
-          for (INTN j = 0; j < SizeMultipiler; j++)
-          {
-            Data->BackBuffer[(CurrentY + i) * Data->Screen.HorizontalResolution + (CurrentX + j)] = *ForegroundColor;
-          }
-        }
-      }
-      else
+    // Too many cells changed to be queued, visiting every set bit of the bitset instead
+    Words = GridDirtyWords(Grid);
+    for (UINTN i = 0; i < Words; i++)
+    {
+      Word = Grid->DirtyBitmap[i];
+      Grid->DirtyBitmap[i] = 0;
+      while (Word != 0)
       {
-        for (INTN i = 0; i < SizeMultipiler; i++)
+        Index = (UINT32)(i * 64) + (UINT32)LowBitSet64(Word);
+        Word &= Word - 1;
+        if (Painted)
         {
-          for (INTN j = 0; j < SizeMultipiler; j++)
+          while (Index / Grid->HorizontalCellsCount >= StripEnd)
           {
-            Data->BackBuffer[(CurrentY + i) * Data->Screen.HorizontalResolution + (CurrentX + j)] = *BackgroundColor;
+            AddGridStripDamage(Data, &PaintedArea);
+            Strip++;
+            InternalStripRange(Grid->VerticalCellsCount, Strip, StripCount, &StripBegin, &StripEnd);
           }
         }
+        DrawGridCell(Data, Grid, x, y, Index, Painted ? &PaintedArea : NULL, Rectangles, MaxRectangles, &Count);
       }
-      CurrentX += SizeMultipiler;
     }
-    CurrentY += SizeMultipiler;
-    CurrentX = x;
+    AddGridStripDamage(Data, &PaintedArea);
+  }
+  else
+  {
+    for (UINT32 i = 0; i < Grid->DirtyQueueCount; i++)
+    {
+      Index = Grid->DirtyQueue[i];
+      Grid->DirtyBitmap[Index / 64] &= ~LShiftU64(1, Index % 64);
+      DrawGridCell(Data, Grid, x, y, Index, NULL, Rectangles, MaxRectangles, &Count);
+    }
+  }
+
+  Grid->DirtyQueueCount = 0;
+  Grid->DirtyQueueOverflow = FALSE;
+
+  if (RectangleCount != NULL)
+  {
+    *RectangleCount = Count;
   }
 
   return EFI_SUCCESS;
@@ -567,35 +1652,148 @@ DrawCharacter(
 
 EFI_STATUS
 EFIAPI
-DrawText(
-    IN GAME_GRAPHICS_LIB_DATA *Data,
+FillCellInGrid(
+    IN GAME_GRAPHICS_LIB_GRID *Grid,
+    IN UINT32 x,
+    IN UINT32 y,
+    IN EFI_GRAPHICS_OUTPUT_BLT_PIXEL *Color)
+{
+  if ((Grid == NULL) || (Color == NULL))
+  {
+    return EFI_INVALID_PARAMETER;
+  }
+
+  if ((x >= Grid->HorizontalCellsCount) || (y >= Grid->VerticalCellsCount))
+  {
+    return EFI_INVALID_PARAMETER;
+  }
+
+  Grid->ColorsBitmap[y * Grid->HorizontalCellsCount + x] = *Color;
+  Grid->PatternsBitmap[y * Grid->HorizontalCellsCount + x] = 0;
+  MarkGridCellDirty(Grid, y * Grid->HorizontalCellsCount + x);
+  return EFI_SUCCESS;
+}
+
+EFI_STATUS
+EFIAPI
+FillCellInGridWithPattern(
+    IN GAME_GRAPHICS_LIB_GRID *Grid,
     IN UINT32 x,
     IN UINT32 y,
-    IN CHAR8 *Text,
-    IN EFI_GRAPHICS_OUTPUT_BLT_PIXEL *ForegroundColor,
-    IN EFI_GRAPHICS_OUTPUT_BLT_PIXEL *BackgroundColor,
-    IN UINT32 SizeMultipiler)
+    IN UINT8 PatternId)
+{
+  if (Grid == NULL)
+  {
+    return EFI_INVALID_PARAMETER;
+  }
+
+  if ((x >= Grid->HorizontalCellsCount) || (y >= Grid->VerticalCellsCount))
+  {
+    return EFI_INVALID_PARAMETER;
+  }
+
+  Grid->PatternsBitmap[y * Grid->HorizontalCellsCount + x] = PatternId;
+  MarkGridCellDirty(Grid, y * Grid->HorizontalCellsCount + x);
+  return EFI_SUCCESS;
+}
+
+EFI_STATUS
+EFIAPI
+SetGridCellPattern(
+    IN GAME_GRAPHICS_LIB_GRID *Grid,
+    IN UINT8 PatternId,
+    IN GAME_GRAPHICS_LIB_GRID_CELL_PATTERN *Pattern OPTIONAL)
 {
   EFI_STATUS Status;
-  UINTN PosX = x;
-  UINTN PosY = y;
+  UINT32 Cells;
 
-  while (*Text != '\0')
+  if ((Grid == NULL) || (PatternId == 0))
   {
-    Status = DrawCharacter(Data,
-                           PosX, PosY,
-                           *Text,
-                           ForegroundColor,
-                           BackgroundColor,
-                           SizeMultipiler);
-    if (EFI_ERROR(Status))
+    return EFI_INVALID_PARAMETER;
+  }
+
+  if ((Pattern != NULL) && ((Pattern->Pattern == NULL) || (Pattern->SizeX == 0) || (Pattern->SizeY == 0)))
+  {
+    return EFI_INVALID_PARAMETER;
+  }
+
+  Status = InternalSetGridPattern(Grid, PatternId, Pattern);
+  if (EFI_ERROR(Status))
+  {
+    DEBUG((DEBUG_ERROR, "SetGridCellPattern: Failed to store pattern %u: %r\n", PatternId, Status));
+  }
+
+  // Also after a failure, the cells showing the pattern fall back to their color
+  Cells = Grid->HorizontalCellsCount * Grid->VerticalCellsCount;
+  for (UINT32 i = 0; i < Cells; i++)
+  {
+    if (Grid->PatternsBitmap[i] == PatternId)
     {
-      DEBUG((DEBUG_ERROR, "DrawText: DrawCharacter failed: %r\n", Status));
-      return Status;
+      MarkGridCellDirty(Grid, i);
     }
-    PosX += FONT_HORIZONTAL_SIZE * SizeMultipiler;
-    Text++;
   }
 
+  return Status;
+}
+
+EFI_STATUS
+EFIAPI
+DeleteGrid(
+    IN GAME_GRAPHICS_LIB_GRID *Grid)
+{
+  if (Grid == NULL)
+  {
+    return EFI_INVALID_PARAMETER;
+  }
+
+  if (Grid->ColorsBitmap != NULL)
+  {
+    FreePool(Grid->ColorsBitmap);
+  }
+
+  if (Grid->DirtyBitmap != NULL)
+  {
+    FreePool(Grid->DirtyBitmap);
+  }
+
+  if (Grid->DirtyQueue != NULL)
+  {
+    FreePool(Grid->DirtyQueue);
+  }
+
+  if (Grid->ColumnOffsets != NULL)
+  {
+    FreePool(Grid->ColumnOffsets);
+  }
+
+  if (Grid->RowOffsets != NULL)
+  {
+    FreePool(Grid->RowOffsets);
+  }
+
+  if (Grid->PatternsBitmap != NULL)
+  {
+    FreePool(Grid->PatternsBitmap);
+  }
+
+  InternalFreeGridPatterns(Grid);
+
+  return EFI_SUCCESS;
+}
+
+EFI_STATUS
+EFIAPI
+ClearGrid(
+    IN GAME_GRAPHICS_LIB_GRID *Grid)
+{
+  if (Grid == NULL)
+  {
+    return EFI_INVALID_PARAMETER;
+  }
+
+  SetMem(Grid->ColorsBitmap, Grid->HorizontalCellsCount * Grid->VerticalCellsCount * sizeof(EFI_GRAPHICS_OUTPUT_BLT_PIXEL), 0);
+  SetMem(Grid->PatternsBitmap, Grid->HorizontalCellsCount * Grid->VerticalCellsCount * sizeof(UINT8), 0);
+  MarkGridDirty(Grid);
+
   return EFI_SUCCESS;
-}
\ No newline at end of file
+}
@@ -0,0 +1,610 @@
+#ifndef _GAME_GRAPHICS_LIBRARY_INTERNAL_H_
+#define _GAME_GRAPHICS_LIBRARY_INTERNAL_H_
+
+/// @file
+/// Game Graphics Library internal definitions
+/// Functions declared here are shared between the source files of the library and are not part of its public interface.
+/// Kernels that have an architecture specific implementation live in the X64 directory, portable versions live in the Generic directory.
+/// Builds that define GAME_GRAPHICS_LIB_GENERIC_KERNELS, like the host based unit tests, only use the portable versions.
+
+#include <Uefi.h>
+#include <Protocol/MpService.h>
+#include <Library/GameGraphicsLib.h>
+#include <Library/GameLoopLib.h>
+
+/// @brief Calculates the smallest rectangle that contains both of the rectangles
+/// @note Union may be the same as First or Second
+VOID
+EFIAPI
+InternalUnionRectangle(
+    IN GAME_GRAPHICS_LIB_RECTANGLE *First,
+    IN GAME_GRAPHICS_LIB_RECTANGLE *Second,
+    OUT GAME_GRAPHICS_LIB_RECTANGLE *Union);
+
+/// @brief Clips a rectangle to the screen
+/// @param Data The data structure that is used to store the library variables
+/// @param x X coordinate of the top left corner, can be negative
+/// @param y Y coordinate of the top left corner, can be negative
+/// @param HorizontalSize Horizontal size of the rectangle
+/// @param VerticalSize Vertical size of the rectangle
+/// @param Rectangle The visible part of the rectangle
+/// @return TRUE if any part of the rectangle is on screen, otherwise FALSE and Rectangle is not modified
+BOOLEAN
+EFIAPI
+InternalClipRectangle(
+    IN GAME_GRAPHICS_LIB_DATA *Data,
+    IN INT32 x,
+    IN INT32 y,
+    IN INT32 HorizontalSize,
+    IN INT32 VerticalSize,
+    OUT GAME_GRAPHICS_LIB_RECTANGLE *Rectangle);
+
+/// @brief Calculates the row stride and the size of a back buffer
+/// @param Width Horizontal resolution of the back buffer
+/// @param Height Vertical resolution of the back buffer
+/// @param PixelSize Bytes per pixel, see GAME_GRAPHICS_LIB_DATA.BackBufferPixelSize
+/// @param Stride Receives the pixels from one row to the next, Width rounded up to GAME_GRAPHICS_LIB_BACK_BUFFER_ALIGNMENT bytes
+/// @param Size Receives the size of the back buffer in bytes
+VOID
+EFIAPI
+InternalBackBufferLayout(
+    IN UINT32 Width,
+    IN UINT32 Height,
+    IN UINT32 PixelSize,
+    OUT UINT32 *Stride,
+    OUT UINTN *Size);
+
+/// @brief Returns the address of a pixel of a back buffer, which holds colors or palette indices
+/// @param Data The data structure that is used to store the library variables
+/// @param Buffer Back buffer, BackBuffer or the other one of BackBuffers
+/// @param x X coordinate of the pixel
+/// @param y Y coordinate of the pixel
+VOID *
+EFIAPI
+InternalBackBufferPixel(
+    IN GAME_GRAPHICS_LIB_DATA *Data,
+    IN EFI_GRAPHICS_OUTPUT_BLT_PIXEL *Buffer,
+    IN UINT32 x,
+    IN UINT32 y);
+
+/// @brief Allocates a page aligned back buffer filled with black
+/// @param Size Size of the back buffer in bytes, see InternalBackBufferLayout
+/// @param BackBuffer Receives the back buffer
+/// @return EFI_SUCCESS if the function executed successfully, otherwise the error returned by AllocatePages.
+EFI_STATUS
+EFIAPI
+InternalAllocateBackBuffer(
+    IN UINTN Size,
+    OUT EFI_GRAPHICS_OUTPUT_BLT_PIXEL **BackBuffer);
+
+/// @brief Frees a back buffer allocated by InternalAllocateBackBuffer
+VOID
+EFIAPI
+InternalFreeBackBuffer(
+    IN EFI_GRAPHICS_OUTPUT_BLT_PIXEL *BackBuffer,
+    IN UINTN Size);
+
+/// @brief Palette stored behind GAME_GRAPHICS_LIB_DATA.Palette
+/// @note The lookup tables are read by the application processors while they present
+typedef struct
+{
+    UINT32 Colors[GAME_GRAPHICS_LIB_PALETTE_SIZE];            // Entries as EFI_GRAPHICS_OUTPUT_BLT_PIXEL values, for Blt
+    UINT32 FrameBufferColors[GAME_GRAPHICS_LIB_PALETTE_SIZE]; // The same entries in the pixel format of the framebuffer
+    UINT32 Count;                                             // Entries the drawing functions pick colors from
+} INTERNAL_PALETTE;
+
+/// @brief Returns the value a color is stored as in the back buffer, the color itself or the index of the closest palette entry
+/// @note Also runs on application processors, see INTERNAL_STRIP_FUNCTION
+UINT32
+EFIAPI
+InternalPixelValue(
+    IN GAME_GRAPHICS_LIB_DATA *Data,
+    IN CONST EFI_GRAPHICS_OUTPUT_BLT_PIXEL *Color);
+
+/// @brief Converts the palette to the pixel format of the current mode, see INTERNAL_PALETTE.FrameBufferColors
+/// @note Called whenever the mode or the palette changes. Does nothing if no palette is enabled
+VOID
+EFIAPI
+InternalUpdatePaletteLut(
+    IN GAME_GRAPHICS_LIB_DATA *Data);
+
+/// @brief Records an already clipped rectangle in the damage list
+/// @param Data The data structure that is used to store the library variables
+/// @param Rectangle Area that changed, has to be inside of the screen
+VOID
+EFIAPI
+InternalAddDamage(
+    IN GAME_GRAPHICS_LIB_DATA *Data,
+    IN GAME_GRAPHICS_LIB_RECTANGLE *Rectangle);
+
+/// @brief Inserts an already clipped rectangle into a damage list, merging it like AddDamageRectangle does
+/// @param Damage Damage list of the library, of a layer or of the compositor
+/// @param Rectangle Area that changed
+VOID
+EFIAPI
+InternalInsertDamage(
+    IN GAME_GRAPHICS_LIB_DAMAGE *Damage,
+    IN GAME_GRAPHICS_LIB_RECTANGLE *Rectangle);
+
+/// @brief Checks if the drawing functions draw into a layer, see BeginLayerDrawing
+/// @return TRUE between BeginLayerDrawing and EndLayerDrawing, otherwise FALSE
+BOOLEAN
+EFIAPI
+InternalDrawingLayer(
+    IN GAME_GRAPHICS_LIB_DATA *Data);
+
+/// @brief Ends drawing into a layer and frees the layer stack, the layers themselves are freed by DeleteLayer
+/// @note Called by FinishGraphicMode
+VOID
+EFIAPI
+InternalDestroyCompositor(
+    IN OUT GAME_GRAPHICS_LIB_DATA *Data);
+
+/// @brief Copies an already clipped area of the back buffer to the video buffer with the selected present mode
+/// @return EFI_SUCCESS if the function executed successfully, otherwise the error returned by Blt.
+/// @note InternalFinishPresent has to be called once all rectangles of a present are copied
+EFI_STATUS
+EFIAPI
+InternalPresentRectangle(
+    IN GAME_GRAPHICS_LIB_DATA *Data,
+    IN UINT32 x,
+    IN UINT32 y,
+    IN UINT32 Width,
+    IN UINT32 Height);
+
+/// @brief Copies an already clipped area of a back buffer straight into the linear framebuffer
+/// @param Data The data structure that is used to store the library variables
+/// @param Buffer Back buffer to copy from, BackBuffer or the other one of BackBuffers
+/// @note Uses streaming stores, see InternalStreamFence. Also runs on the present processor
+VOID
+EFIAPI
+InternalPresentDirect(
+    IN GAME_GRAPHICS_LIB_DATA *Data,
+    IN EFI_GRAPHICS_OUTPUT_BLT_PIXEL *Buffer,
+    IN UINT32 x,
+    IN UINT32 y,
+    IN UINT32 Width,
+    IN UINT32 Height);
+
+/// @brief Scales an already clipped area of a back buffer up by Data->Scale straight into the linear framebuffer
+/// @note Called by InternalPresentDirect if a render resolution is set, so it also runs on the present processor
+VOID
+EFIAPI
+InternalPresentScaledDirect(
+    IN GAME_GRAPHICS_LIB_DATA *Data,
+    IN EFI_GRAPHICS_OUTPUT_BLT_PIXEL *Buffer,
+    IN UINT32 x,
+    IN UINT32 y,
+    IN UINT32 Width,
+    IN UINT32 Height);
+
+/// @brief Scales an already clipped area of the back buffer up by Data->Scale into the video buffer
+/// @return EFI_SUCCESS if the function executed successfully, otherwise the error returned by Blt.
+/// @note Called by InternalPresentRectangle if a render resolution is set, and for Blt presents of palette indices,
+///       which have to be expanded into the staging rows even if Data->Scale is 1
+EFI_STATUS
+EFIAPI
+InternalPresentScaled(
+    IN GAME_GRAPHICS_LIB_DATA *Data,
+    IN UINT32 x,
+    IN UINT32 y,
+    IN UINT32 Width,
+    IN UINT32 Height);
+
+/// @brief Completes a present started at StartCycles, fences the streaming stores and updates PresentStats
+/// @param Data The data structure that is used to store the library variables
+/// @param StartCycles Value of GetGameLoopCycleCounter taken before the first copy
+/// @param Bytes Total amount of bytes copied
+VOID
+EFIAPI
+InternalFinishPresent(
+    IN GAME_GRAPHICS_LIB_DATA *Data,
+    IN UINT64 StartCycles,
+    IN UINT64 Bytes);
+
+/// @brief Copies 32-bit pixels using non-temporal stores that bypass the cache
+/// @param Destination Destination of the copy, has to be 4 byte aligned
+/// @param Source Source of the copy
+/// @param Count Number of 32-bit pixels to copy
+/// @note The stores are weakly ordered, InternalStreamFence has to be called after the last copy
+VOID
+EFIAPI
+InternalStreamCopy32(
+    OUT VOID *Destination,
+    IN CONST VOID *Source,
+    IN UINTN Count);
+
+/// @brief Makes all preceding non-temporal stores globally visible
+VOID
+EFIAPI
+InternalStreamFence(
+    VOID);
+
+/// @brief Allocates the glyph cache and stores it in Data->GlyphCache
+/// @return EFI_SUCCESS if the function executed successfully, otherwise EFI_OUT_OF_RESOURCES and Data->GlyphCache is NULL.
+EFI_STATUS
+EFIAPI
+InternalCreateGlyphCache(
+    IN OUT GAME_GRAPHICS_LIB_DATA *Data);
+
+/// @brief Frees the glyph cache and every glyph stored in it
+VOID
+EFIAPI
+InternalDestroyGlyphCache(
+    IN OUT GAME_GRAPHICS_LIB_DATA *Data);
+
+/// @brief Stores a copy of a pattern in the grid and scales it to the current cell sizes
+/// @param Grid The grid data structure that stores the pattern
+/// @param PatternId Pattern to replace, 1 to GAME_GRAPHICS_LIB_MAX_GRID_PATTERNS
+/// @param Pattern New pattern, or NULL to remove it
+/// @return EFI_SUCCESS if the function executed successfully, otherwise EFI_OUT_OF_RESOURCES and the pattern is removed.
+EFI_STATUS
+EFIAPI
+InternalSetGridPattern(
+    IN GAME_GRAPHICS_LIB_GRID *Grid,
+    IN UINT8 PatternId,
+    IN GAME_GRAPHICS_LIB_GRID_CELL_PATTERN *Pattern OPTIONAL);
+
+/// @brief Scales all patterns of the grid again after its cell sizes changed
+/// @return EFI_SUCCESS if the function executed successfully, otherwise EFI_OUT_OF_RESOURCES and the patterns that
+///         could not be scaled are drawn as plain color fills.
+EFI_STATUS
+EFIAPI
+InternalScaleGridPatterns(
+    IN GAME_GRAPHICS_LIB_GRID *Grid);
+
+/// @brief Copies the visible part of the pattern of a cell into the back buffer
+/// @param Data The data structure that is used to store the library variables
+/// @param Grid The grid data structure the cell belongs to
+/// @param Index Index of the cell
+/// @param Cell Area of the whole cell on screen
+/// @param Visible Part of Cell inside of the screen
+/// @return TRUE if the cell was drawn, FALSE if it has no pattern and has to be filled with its color
+/// @note Also runs on application processors, see INTERNAL_STRIP_FUNCTION
+BOOLEAN
+EFIAPI
+InternalDrawGridPattern(
+    IN GAME_GRAPHICS_LIB_DATA *Data,
+    IN GAME_GRAPHICS_LIB_GRID *Grid,
+    IN UINT32 Index,
+    IN GAME_GRAPHICS_LIB_RECTANGLE *Cell,
+    IN GAME_GRAPHICS_LIB_RECTANGLE *Visible);
+
+/// @brief Frees all patterns of the grid
+VOID
+EFIAPI
+InternalFreeGridPatterns(
+    IN GAME_GRAPHICS_LIB_GRID *Grid);
+
+/// @brief Fills a span of 32-bit pixels with a single value
+/// @param Destination First pixel of the span
+/// @param Count Number of pixels to fill
+/// @param Value Pixel value
+typedef
+VOID
+(EFIAPI *INTERNAL_FILL_SPAN)(
+    OUT UINT32 *Destination,
+    IN UINTN Count,
+    IN UINT32 Value);
+
+/// @brief Fill kernel chosen by InternalSelectKernels for the running processor
+extern INTERNAL_FILL_SPAN gInternalFillSpan;
+
+/// @brief Portable fill kernel, used on every architecture without a vectorized version
+VOID
+EFIAPI
+InternalFillSpan32Generic(
+    OUT UINT32 *Destination,
+    IN UINTN Count,
+    IN UINT32 Value);
+
+#if defined(MDE_CPU_X64) && !defined(GAME_GRAPHICS_LIB_GENERIC_KERNELS)
+/// @brief SSE2 fill kernel, 16 byte aligned stores
+VOID
+EFIAPI
+InternalFillSpan32Sse2(
+    OUT UINT32 *Destination,
+    IN UINTN Count,
+    IN UINT32 Value);
+
+/// @brief AVX2 fill kernel, 32 byte aligned stores
+VOID
+EFIAPI
+InternalFillSpan32Avx2(
+    OUT UINT32 *Destination,
+    IN UINTN Count,
+    IN UINT32 Value);
+#endif
+
+/// @brief Writes every source pixel Scale times in a row, which is one row of an integer scaled image
+/// @param Destination First pixel of the scaled row, Count * Scale pixels are written
+/// @param Source Pixels to scale
+/// @param Count Number of source pixels
+/// @param Scale Integer scale factor, at least 1
+typedef
+VOID
+(EFIAPI *INTERNAL_SCALE_SPAN)(
+    OUT UINT32 *Destination,
+    IN CONST UINT32 *Source,
+    IN UINTN Count,
+    IN UINT32 Scale);
+
+/// @brief Scale kernel chosen by InternalSelectKernels, usable on every processor of the system
+extern INTERNAL_SCALE_SPAN gInternalScaleSpan;
+
+/// @brief Portable scale kernel
+VOID
+EFIAPI
+InternalScaleSpan32Generic(
+    OUT UINT32 *Destination,
+    IN CONST UINT32 *Source,
+    IN UINTN Count,
+    IN UINT32 Scale);
+
+#if defined(MDE_CPU_X64) && !defined(GAME_GRAPHICS_LIB_GENERIC_KERNELS)
+/// @brief SSE2 scale kernel, vectorized for the factors 2, 3 and 4
+VOID
+EFIAPI
+InternalScaleSpan32Sse2(
+    OUT UINT32 *Destination,
+    IN CONST UINT32 *Source,
+    IN UINTN Count,
+    IN UINT32 Scale);
+#endif
+
+/// @brief Converts back buffer pixels to the pixel format of the framebuffer
+/// @param Destination First framebuffer pixel, has to be 4 byte aligned
+/// @param Source Back buffer pixels
+/// @param Count Number of pixels
+/// @param Layout Conversion of the framebuffer format, see GAME_GRAPHICS_LIB_DATA.PixelLayout
+typedef
+VOID
+(EFIAPI *INTERNAL_CONVERT_SPAN)(
+    OUT UINT32 *Destination,
+    IN CONST UINT32 *Source,
+    IN UINTN Count,
+    IN CONST GAME_GRAPHICS_LIB_PIXEL_LAYOUT *Layout);
+
+/// @brief Conversion kernel chosen by InternalSelectKernels, usable on every processor of the system
+/// @note May use streaming stores, InternalStreamFence has to be called after the last conversion
+extern INTERNAL_CONVERT_SPAN gInternalConvertSpan;
+
+/// @brief Portable conversion kernel, regular stores
+VOID
+EFIAPI
+InternalConvertSpan32Generic(
+    OUT UINT32 *Destination,
+    IN CONST UINT32 *Source,
+    IN UINTN Count,
+    IN CONST GAME_GRAPHICS_LIB_PIXEL_LAYOUT *Layout);
+
+#if defined(MDE_CPU_X64) && !defined(GAME_GRAPHICS_LIB_GENERIC_KERNELS)
+/// @brief SSE2 conversion kernel, four pixels per streaming store
+VOID
+EFIAPI
+InternalConvertSpan32Sse2(
+    OUT UINT32 *Destination,
+    IN CONST UINT32 *Source,
+    IN UINTN Count,
+    IN CONST GAME_GRAPHICS_LIB_PIXEL_LAYOUT *Layout);
+#endif
+
+/// @brief Expands palette indices to 32-bit pixels through a lookup table
+/// @param Destination First pixel, has to be 4 byte aligned
+/// @param Source Palette indices
+/// @param Count Number of pixels
+/// @param Lookup GAME_GRAPHICS_LIB_PALETTE_SIZE pixels, see INTERNAL_PALETTE
+typedef
+VOID
+(EFIAPI *INTERNAL_EXPAND_SPAN)(
+    OUT UINT32 *Destination,
+    IN CONST UINT8 *Source,
+    IN UINTN Count,
+    IN CONST UINT32 *Lookup);
+
+/// @brief Expansion kernel chosen by InternalSelectKernels, usable on every processor of the system
+/// @note May use streaming stores, InternalStreamFence has to be called after the last expansion
+extern INTERNAL_EXPAND_SPAN gInternalExpandSpan;
+
+/// @brief Portable expansion kernel, regular stores
+VOID
+EFIAPI
+InternalExpandSpan8Generic(
+    OUT UINT32 *Destination,
+    IN CONST UINT8 *Source,
+    IN UINTN Count,
+    IN CONST UINT32 *Lookup);
+
+#if defined(MDE_CPU_X64) && !defined(GAME_GRAPHICS_LIB_GENERIC_KERNELS)
+/// @brief SSE2 expansion kernel, four table loads gathered into every streaming store
+VOID
+EFIAPI
+InternalExpandSpan8Sse2(
+    OUT UINT32 *Destination,
+    IN CONST UINT8 *Source,
+    IN UINTN Count,
+    IN CONST UINT32 *Lookup);
+#endif
+
+/// @brief Returns the fastest fill kernel supported by the running processor, based on CPUID
+/// @note Safe to call on application processors, unlike InternalSelectKernels it does not print anything
+INTERNAL_FILL_SPAN
+EFIAPI
+InternalBestFillSpan(
+    VOID);
+
+/// @brief Picks the fastest kernels supported by the processor, based on CPUID
+/// @note Called by InitializeGraphicMode
+VOID
+EFIAPI
+InternalSelectKernels(
+    VOID);
+
+/// @brief Rectangles with fewer pixels are always filled on the BSP, starting the processors would take longer
+#define INTERNAL_RENDER_JOB_MIN_PIXELS (64 * 1024)
+
+/// @brief Largest context of a render job, in bytes
+#define INTERNAL_RENDER_JOB_CONTEXT_SIZE 64
+
+/// @brief Draws one horizontal strip of a render job
+/// @param Data The data structure that is used to store the library variables
+/// @param Context Copy of the context passed to InternalRunStripJob
+/// @param Strip Index of the strip, strips are ordered from top to bottom
+/// @param StripCount Number of strips the job is split into
+/// @param FillSpan Fill kernel for the processor running the strip
+/// @note Runs on application processors, so it must not call UEFI services or DEBUG, and must not write
+///       anything other than the pixels of its own strip
+typedef
+VOID
+(EFIAPI *INTERNAL_STRIP_FUNCTION)(
+    IN GAME_GRAPHICS_LIB_DATA *Data,
+    IN CONST VOID *Context,
+    IN UINT32 Strip,
+    IN UINT32 StripCount,
+    IN INTERNAL_FILL_SPAN FillSpan);
+
+/// @brief Splits a job into one strip per drawing processor and starts it, the BSP draws the last strip before returning
+/// @param Data The data structure that is used to store the library variables
+/// @param Function Draws a single strip
+/// @param Context Copied into the job, at most INTERNAL_RENDER_JOB_CONTEXT_SIZE bytes
+/// @param ContextSize Size of Context in bytes
+/// @param Units Number of rows the job can be split into, there are never more strips than units
+/// @return TRUE if the job was started, FALSE if parallel rendering is disabled and the caller has to draw on its own
+/// @note The other strips may still be drawn when this returns, see WaitForRenderJobs
+BOOLEAN
+EFIAPI
+InternalRunStripJob(
+    IN GAME_GRAPHICS_LIB_DATA *Data,
+    IN INTERNAL_STRIP_FUNCTION Function,
+    IN CONST VOID *Context,
+    IN UINTN ContextSize,
+    IN UINT32 Units);
+
+/// @brief Starts a procedure on the first enabled and idle application processor, beginning with FirstProcessor
+/// @param MpServices MP Services Protocol instance
+/// @param FirstProcessor Processor number to start searching at
+/// @param Procedure Procedure to start, without waiting for it to return
+/// @param Argument Argument of the procedure
+/// @param Processor Number of the processor running the procedure
+/// @param Event Created by this function, signaled once the procedure returned. The caller closes it
+/// @return EFI_SUCCESS if the procedure was started, EFI_NOT_FOUND if no processor is available, otherwise an error code.
+EFI_STATUS
+EFIAPI
+InternalStartApProcedure(
+    IN EFI_MP_SERVICES_PROTOCOL *MpServices,
+    IN UINTN FirstProcessor,
+    IN EFI_AP_PROCEDURE Procedure,
+    IN VOID *Argument,
+    OUT UINTN *Processor,
+    OUT EFI_EVENT *Event);
+
+/// @brief Pause loops an idle worker spins for before it sleeps in MWAIT, about ten microseconds
+#define INTERNAL_AP_IDLE_SPINS 1024
+
+/// @brief Pause loops an idle worker spins for before it returns to MP services if MWAIT is not usable, a fraction
+///        of a second. MP services may take up to a timer period to notice that the procedure returned, so workers
+///        only park while nothing is drawn, like on a screen waiting for a key
+#define INTERNAL_AP_PARK_SPINS (4 * 1024 * 1024)
+
+/// @brief States of INTERNAL_AP_WORKER.State
+#define INTERNAL_AP_WORKER_RUNNING 0 // The procedure runs and picks up the next job
+#define INTERNAL_AP_WORKER_PARKING 1 // The procedure returns, the BSP has not noticed yet
+#define INTERNAL_AP_WORKER_STOPPED 2 // The BSP noticed the procedure returned and does the jobs of the worker itself
+
+/// @brief Procedure running on an application processor that waits for jobs, published by incrementing a generation
+/// @details
+/// A worker first spins on the generation, so jobs of a busy frame start without any wake up latency. After
+/// INTERNAL_AP_IDLE_SPINS it sleeps in MONITOR/MWAIT on the generation if the processor supports it, so an idle
+/// worker does not keep its core busy. Without MWAIT the procedure returns to MP services after INTERNAL_AP_PARK_SPINS,
+/// which idle the processor, and InternalResumeApWorker starts it again once the BSP publishes the next job.
+typedef struct
+{
+    volatile UINT32 State;   // INTERNAL_AP_WORKER_RUNNING, INTERNAL_AP_WORKER_PARKING or INTERNAL_AP_WORKER_STOPPED
+    BOOLEAN MonitorWait;     // The worker sleeps in MWAIT while it waits
+    UINTN Processor;         // Processor the procedure was last started on
+    EFI_EVENT Event;         // Signaled by MP services once the procedure returned, NULL if it was never started
+} INTERNAL_AP_WORKER;
+
+/// @brief Starts the procedure of a worker on the first enabled and idle application processor, beginning with FirstProcessor
+/// @param MpServices MP Services Protocol instance
+/// @param FirstProcessor Processor number to start searching at
+/// @param Worker Worker state, initialized by this function
+/// @param Procedure Procedure of the worker, waits for jobs with InternalApWorkerWait
+/// @param Argument Argument of the procedure
+/// @return EFI_SUCCESS if the procedure was started, EFI_NOT_FOUND if no processor is available, otherwise an error code.
+EFI_STATUS
+EFIAPI
+InternalStartApWorker(
+    IN EFI_MP_SERVICES_PROTOCOL *MpServices,
+    IN UINTN FirstProcessor,
+    OUT INTERNAL_AP_WORKER *Worker,
+    IN EFI_AP_PROCEDURE Procedure,
+    IN VOID *Argument);
+
+/// @brief Waits on the application processor of a worker until the BSP publishes a new generation
+/// @param Worker Worker state
+/// @param Generation Incremented by the BSP for every job
+/// @param Seen Generation the worker already handled
+/// @return TRUE once Generation differs from Seen, FALSE if the worker parked and its procedure has to return right away
+/// @note Runs on application processors
+BOOLEAN
+EFIAPI
+InternalApWorkerWait(
+    IN OUT INTERNAL_AP_WORKER *Worker,
+    IN volatile UINT32 *Generation,
+    IN UINT32 Seen);
+
+/// @brief Makes sure a worker handles the generation the BSP just published, starting its procedure again if it parked
+/// @param MpServices MP Services Protocol instance
+/// @param Worker Worker state
+/// @param Procedure Procedure of the worker
+/// @param Argument Argument of the procedure
+/// @return TRUE if the worker handles the job, FALSE if it could not be started yet and the BSP has to do the job itself
+/// @note Called on the BSP after the generation was incremented
+BOOLEAN
+EFIAPI
+InternalResumeApWorker(
+    IN EFI_MP_SERVICES_PROTOCOL *MpServices,
+    IN OUT INTERNAL_AP_WORKER *Worker,
+    IN EFI_AP_PROCEDURE Procedure,
+    IN VOID *Argument);
+
+/// @brief Waits until the procedure of a worker returned, after the BSP published a job that makes it quit
+/// @param Worker Worker state
+VOID
+EFIAPI
+InternalStopApWorker(
+    IN OUT INTERNAL_AP_WORKER *Worker);
+
+/// @brief Copies the damaged areas of BackBuffer into the other back buffer, so both hold the same picture again
+/// @note Called by every present function before it empties the damage list, once the present processor is idle.
+///       Does nothing unless asynchronous present is enabled
+/// @note Runs on the BSP and copies the damaged area once, at the render resolution and in the back buffer pixel
+///       format, from cached memory to cached memory. The present moves Scale * Scale times as many pixels into the
+///       framebuffer, so the copy is a fraction of its cost, but it is not hidden: a full 640x360 frame is about
+///       900 KiB. Adding the damage of the last frame to the next present instead would not be enough, applications
+///       only draw what changed and expect the rest of the picture to still be in the back buffer.
+VOID
+EFIAPI
+InternalSyncBackBuffers(
+    IN GAME_GRAPHICS_LIB_DATA *Data);
+
+/// @brief Returns the number of strips InternalRunStripJob splits a job of Units rows into
+/// @return 0 if parallel rendering is disabled or the job is too small to be split
+UINT32
+EFIAPI
+InternalRenderStripCount(
+    IN GAME_GRAPHICS_LIB_DATA *Data,
+    IN UINT32 Units);
+
+/// @brief Calculates the units [Begin, End) of a strip, so that all strips differ in size by at most one unit
+VOID
+EFIAPI
+InternalStripRange(
+    IN UINT32 Units,
+    IN UINT32 Strip,
+    IN UINT32 StripCount,
+    OUT UINT32 *Begin,
+    OUT UINT32 *End);
+
+#endif // _GAME_GRAPHICS_LIBRARY_INTERNAL_H_
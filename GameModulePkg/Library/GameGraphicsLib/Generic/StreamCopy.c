@@ -0,0 +1,25 @@
+#include <Uefi.h>
+#include <Library/BaseMemoryLib.h>
+#include <Library/BaseLib.h>
+#include "GameGraphicsLibInternal.h"
+
+// Portable fallback for architectures without an assembly implementation.
+// Regular stores are used, so the copy goes through the cache.
+
+VOID
+EFIAPI
+InternalStreamCopy32(
+    OUT VOID *Destination,
+    IN CONST VOID *Source,
+    IN UINTN Count)
+{
+  CopyMem(Destination, Source, Count * sizeof(UINT32));
+}
+
+VOID
+EFIAPI
+InternalStreamFence(
+    VOID)
+{
+  MemoryFence();
+}
@@ -0,0 +1,326 @@
+#include <Library/DebugLib.h>
+#include <Uefi.h>
+#include <Library/GameGraphicsLib.h>
+#include <Library/BaseLib.h>
+#include <Library/BaseMemoryLib.h>
+#include <Library/MemoryAllocationLib.h>
+#include "GameGraphicsLibInternal.h"
+
+// Cells are either CellWidth or CellWidth + 1 pixels wide, and CellHeight or CellHeight + 1 pixels high
+#define GRID_PATTERN_TILES 4
+
+/// @brief Pattern of a grid, together with its copies scaled to every cell size of the grid
+typedef struct
+{
+    EFI_GRAPHICS_OUTPUT_BLT_PIXEL *Source;                        // Copy of the pixels passed to SetGridCellPattern
+    UINT32 SourceWidth;
+    UINT32 SourceHeight;
+    EFI_GRAPHICS_OUTPUT_BLT_PIXEL *Pixels;                        // Single allocation holding all tiles
+    EFI_GRAPHICS_OUTPUT_BLT_PIXEL *Tiles[GRID_PATTERN_TILES];     // Indexed by the extra width plus twice the extra height of a cell
+} GRID_PATTERN;
+
+/// @brief Patterns of a grid, stored in GAME_GRAPHICS_LIB_GRID.Patterns
+typedef struct
+{
+    UINT32 CellWidth;                                             // Width of the narrow cells the tiles were scaled to
+    UINT32 CellHeight;                                            // Height of the low cells the tiles were scaled to
+    GRID_PATTERN *Patterns[GAME_GRAPHICS_LIB_MAX_GRID_PATTERNS + 1]; // Entry 0 is never used, it stands for a plain color fill
+} GRID_PATTERNS;
+
+/// @brief Scales a pattern to Width x Height pixels with nearest neighbour sampling
+/// @note Target rows that sample the same source row are copies of the previous row
+STATIC
+VOID
+ScalePattern(
+    IN GRID_PATTERN *Pattern,
+    IN UINT32 Width,
+    IN UINT32 Height,
+    OUT EFI_GRAPHICS_OUTPUT_BLT_PIXEL *Tile)
+{
+  EFI_GRAPHICS_OUTPUT_BLT_PIXEL *SourceRow;
+  EFI_GRAPHICS_OUTPUT_BLT_PIXEL *Row = Tile;
+  UINT32 SourceY;
+  UINT32 PreviousSourceY = MAX_UINT32;
+
+  for (UINT32 y = 0; y < Height; y++)
+  {
+    SourceY = (UINT32)DivU64x32(MultU64x32(y, Pattern->SourceHeight), Height);
+    if (SourceY == PreviousSourceY)
+    {
+      CopyMem(Row, Row - Width, Width * sizeof(EFI_GRAPHICS_OUTPUT_BLT_PIXEL));
+    }
+    else
+    {
+      SourceRow = &Pattern->Source[(UINTN)SourceY * Pattern->SourceWidth];
+      for (UINT32 x = 0; x < Width; x++)
+      {
+        Row[x] = SourceRow[DivU64x32(MultU64x32(x, Pattern->SourceWidth), Width)];
+      }
+    }
+
+    PreviousSourceY = SourceY;
+    Row += Width;
+  }
+}
+
+/// @brief Scales a pattern to all cell sizes of the grid, replacing the previous tiles
+/// @return EFI_SUCCESS if the function executed successfully, otherwise EFI_OUT_OF_RESOURCES and the pattern has no tiles.
+STATIC
+EFI_STATUS
+BuildPatternTiles(
+    IN GRID_PATTERN *Pattern,
+    IN UINT32 CellWidth,
+    IN UINT32 CellHeight)
+{
+  EFI_GRAPHICS_OUTPUT_BLT_PIXEL *Tile;
+  UINTN Pixels = 0;
+  UINT32 Width;
+  UINT32 Height;
+
+  if (Pattern->Pixels != NULL)
+  {
+    FreePool(Pattern->Pixels);
+    Pattern->Pixels = NULL;
+  }
+  ZeroMem(Pattern->Tiles, sizeof(Pattern->Tiles));
+
+  for (UINT32 i = 0; i < GRID_PATTERN_TILES; i++)
+  {
+    Pixels += (UINTN)(CellWidth + (i & 1)) * (CellHeight + (i >> 1));
+  }
+
+  Pattern->Pixels = AllocatePool(Pixels * sizeof(EFI_GRAPHICS_OUTPUT_BLT_PIXEL));
+  if (Pattern->Pixels == NULL)
+  {
+    return EFI_OUT_OF_RESOURCES;
+  }
+
+  Tile = Pattern->Pixels;
+  for (UINT32 i = 0; i < GRID_PATTERN_TILES; i++)
+  {
+    Width = CellWidth + (i & 1);
+    Height = CellHeight + (i >> 1);
+    ScalePattern(Pattern, Width, Height, Tile);
+    Pattern->Tiles[i] = Tile;
+    Tile += (UINTN)Width * Height;
+  }
+
+  return EFI_SUCCESS;
+}
+
+/// @brief Frees a pattern and its tiles
+STATIC
+VOID
+FreePattern(
+    IN GRID_PATTERN *Pattern)
+{
+  if (Pattern->Pixels != NULL)
+  {
+    FreePool(Pattern->Pixels);
+  }
+
+  if (Pattern->Source != NULL)
+  {
+    FreePool(Pattern->Source);
+  }
+
+  FreePool(Pattern);
+}
+
+EFI_STATUS
+EFIAPI
+InternalSetGridPattern(
+    IN GAME_GRAPHICS_LIB_GRID *Grid,
+    IN UINT8 PatternId,
+    IN GAME_GRAPHICS_LIB_GRID_CELL_PATTERN *Pattern OPTIONAL)
+{
+  GRID_PATTERNS *Patterns = (GRID_PATTERNS *)Grid->Patterns;
+  GRID_PATTERN *Entry;
+  EFI_STATUS Status;
+
+  if (Patterns == NULL)
+  {
+    if (Pattern == NULL)
+    {
+      return EFI_SUCCESS;
+    }
+
+    Patterns = AllocateZeroPool(sizeof(GRID_PATTERNS));
+    if (Patterns == NULL)
+    {
+      return EFI_OUT_OF_RESOURCES;
+    }
+    Patterns->CellWidth = Grid->HorizontalSize / Grid->HorizontalCellsCount;
+    Patterns->CellHeight = Grid->VerticalSize / Grid->VerticalCellsCount;
+    Grid->Patterns = Patterns;
+  }
+
+  if (Patterns->Patterns[PatternId] != NULL)
+  {
+    FreePattern(Patterns->Patterns[PatternId]);
+    Patterns->Patterns[PatternId] = NULL;
+  }
+
+  if (Pattern == NULL)
+  {
+    return EFI_SUCCESS;
+  }
+
+  // The pixels are copied, so the tiles can be scaled again by ResizeGrid after the caller freed them
+  Entry = AllocateZeroPool(sizeof(GRID_PATTERN));
+  if (Entry == NULL)
+  {
+    return EFI_OUT_OF_RESOURCES;
+  }
+  Entry->SourceWidth = Pattern->SizeX;
+  Entry->SourceHeight = Pattern->SizeY;
+  Entry->Source = AllocateCopyPool((UINTN)Pattern->SizeX * Pattern->SizeY * sizeof(EFI_GRAPHICS_OUTPUT_BLT_PIXEL), Pattern->Pattern);
+  if (Entry->Source == NULL)
+  {
+    FreePattern(Entry);
+    return EFI_OUT_OF_RESOURCES;
+  }
+
+  Status = BuildPatternTiles(Entry, Patterns->CellWidth, Patterns->CellHeight);
+  if (EFI_ERROR(Status))
+  {
+    FreePattern(Entry);
+    return Status;
+  }
+
+  Patterns->Patterns[PatternId] = Entry;
+
+  return EFI_SUCCESS;
+}
+
+EFI_STATUS
+EFIAPI
+InternalScaleGridPatterns(
+    IN GAME_GRAPHICS_LIB_GRID *Grid)
+{
+  GRID_PATTERNS *Patterns = (GRID_PATTERNS *)Grid->Patterns;
+  EFI_STATUS Status = EFI_SUCCESS;
+  UINT32 CellWidth;
+  UINT32 CellHeight;
+
+  if (Patterns == NULL)
+  {
+    return EFI_SUCCESS;
+  }
+
+  CellWidth = Grid->HorizontalSize / Grid->HorizontalCellsCount;
+  CellHeight = Grid->VerticalSize / Grid->VerticalCellsCount;
+  if ((CellWidth == Patterns->CellWidth) && (CellHeight == Patterns->CellHeight))
+  {
+    return EFI_SUCCESS;
+  }
+
+  Patterns->CellWidth = CellWidth;
+  Patterns->CellHeight = CellHeight;
+  for (UINT32 i = 1; i <= GAME_GRAPHICS_LIB_MAX_GRID_PATTERNS; i++)
+  {
+    // Patterns without tiles are drawn as plain color fills, so one failure does not stop the others
+    if ((Patterns->Patterns[i] != NULL) && EFI_ERROR(BuildPatternTiles(Patterns->Patterns[i], CellWidth, CellHeight)))
+    {
+      Status = EFI_OUT_OF_RESOURCES;
+    }
+  }
+
+  return Status;
+}
+
+BOOLEAN
+EFIAPI
+InternalDrawGridPattern(
+    IN GAME_GRAPHICS_LIB_DATA *Data,
+    IN GAME_GRAPHICS_LIB_GRID *Grid,
+    IN UINT32 Index,
+    IN GAME_GRAPHICS_LIB_RECTANGLE *Cell,
+    IN GAME_GRAPHICS_LIB_RECTANGLE *Visible)
+{
+  GRID_PATTERNS *Patterns = (GRID_PATTERNS *)Grid->Patterns;
+  GRID_PATTERN *Pattern;
+  EFI_GRAPHICS_OUTPUT_BLT_PIXEL *Source;
+  UINT8 *Destination;
+  UINT32 ExtraWidth;
+  UINT32 ExtraHeight;
+  UINTN RowStride;
+  UINTN RowBytes;
+  UINT32 *Pixels;
+  UINT32 Value = 0;
+
+  if ((Patterns == NULL) || (Grid->PatternsBitmap[Index] == 0))
+  {
+    return FALSE;
+  }
+
+  Pattern = Patterns->Patterns[Grid->PatternsBitmap[Index]];
+  if ((Pattern == NULL) || (Pattern->Pixels == NULL))
+  {
+    return FALSE;
+  }
+
+  ExtraWidth = Cell->Width - Patterns->CellWidth;
+  ExtraHeight = Cell->Height - Patterns->CellHeight;
+  if ((ExtraWidth > 1) || (ExtraHeight > 1))
+  {
+    return FALSE;
+  }
+
+  // The tile has exactly the size of the cell, so drawing it is a plain row copy like a cached glyph
+  Source = Pattern->Tiles[ExtraWidth + 2 * ExtraHeight];
+  Source += (UINTN)(Visible->y - Cell->y) * Cell->Width + (Visible->x - Cell->x);
+  Destination = InternalBackBufferPixel(Data, Data->BackBuffer, Visible->x, Visible->y);
+  RowStride = (UINTN)Data->BackBufferStride * Data->BackBufferPixelSize;
+  RowBytes = Visible->Width * sizeof(EFI_GRAPHICS_OUTPUT_BLT_PIXEL);
+  for (UINT32 Row = 0; Row < Visible->Height; Row++)
+  {
+    if (Data->Palette == NULL)
+    {
+      CopyMem(Destination, Source, RowBytes);
+    }
+    else
+    {
+      // The grid does not know the palette, so the tile colors are looked up while drawing. Patterns are made of
+      // runs of the same color, only the first pixel of a run is looked up
+      Pixels = (UINT32 *)Source;
+      for (UINT32 i = 0; i < Visible->Width; i++)
+      {
+        if ((i == 0) || (Pixels[i] != Pixels[i - 1]))
+        {
+          Value = InternalPixelValue(Data, &Source[i]);
+        }
+        Destination[i] = (UINT8)Value;
+      }
+    }
+
+    Source += Cell->Width;
+    Destination += RowStride;
+  }
+
+  return TRUE;
+}
+
+VOID
+EFIAPI
+InternalFreeGridPatterns(
+    IN GAME_GRAPHICS_LIB_GRID *Grid)
+{
+  GRID_PATTERNS *Patterns = (GRID_PATTERNS *)Grid->Patterns;
+
+  if (Patterns == NULL)
+  {
+    return;
+  }
+
+  for (UINT32 i = 1; i <= GAME_GRAPHICS_LIB_MAX_GRID_PATTERNS; i++)
+  {
+    if (Patterns->Patterns[i] != NULL)
+    {
+      FreePattern(Patterns->Patterns[i]);
+    }
+  }
+
+  FreePool(Patterns);
+  Grid->Patterns = NULL;
+}
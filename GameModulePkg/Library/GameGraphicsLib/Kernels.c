@@ -0,0 +1,207 @@
+#include <Library/DebugLib.h>
+#include <Uefi.h>
+#include <Library/BaseLib.h>
+#include "GameGraphicsLibInternal.h"
+
+#define CPUID_VERSION_INFO 0x01
+#define CPUID_STRUCTURED_EXTENDED_FEATURE_FLAGS 0x07
+#define CPUID_ECX_OSXSAVE BIT27
+#define CPUID_ECX_AVX BIT28
+#define CPUID_EDX_SSE2 BIT26
+#define CPUID_EBX_AVX2 BIT5
+#define XCR0_SSE_AVX_STATE (BIT1 | BIT2)
+
+// Selected by InternalSelectKernels, the portable version is used until then
+INTERNAL_FILL_SPAN gInternalFillSpan = InternalFillSpan32Generic;
+INTERNAL_SCALE_SPAN gInternalScaleSpan = InternalScaleSpan32Generic;
+INTERNAL_CONVERT_SPAN gInternalConvertSpan = InternalConvertSpan32Generic;
+INTERNAL_EXPAND_SPAN gInternalExpandSpan = InternalExpandSpan8Generic;
+
+VOID
+EFIAPI
+InternalFillSpan32Generic(
+    OUT UINT32 *Destination,
+    IN UINTN Count,
+    IN UINT32 Value)
+{
+  // Four stores per iteration, so the compiler can keep the loop overhead low
+  while (Count >= 4)
+  {
+    Destination[0] = Value;
+    Destination[1] = Value;
+    Destination[2] = Value;
+    Destination[3] = Value;
+    Destination += 4;
+    Count -= 4;
+  }
+
+  while (Count > 0)
+  {
+    *Destination++ = Value;
+    Count--;
+  }
+}
+
+VOID
+EFIAPI
+InternalScaleSpan32Generic(
+    OUT UINT32 *Destination,
+    IN CONST UINT32 *Source,
+    IN UINTN Count,
+    IN UINT32 Scale)
+{
+  UINT32 Pixel;
+
+  // The common factors get their own loops, so the compiler can unroll the stores
+  switch (Scale)
+  {
+  case 2:
+    for (UINTN i = 0; i < Count; i++)
+    {
+      Pixel = Source[i];
+      Destination[0] = Pixel;
+      Destination[1] = Pixel;
+      Destination += 2;
+    }
+    break;
+
+  case 3:
+    for (UINTN i = 0; i < Count; i++)
+    {
+      Pixel = Source[i];
+      Destination[0] = Pixel;
+      Destination[1] = Pixel;
+      Destination[2] = Pixel;
+      Destination += 3;
+    }
+    break;
+
+  default:
+    for (UINTN i = 0; i < Count; i++)
+    {
+      InternalFillSpan32Generic(Destination, Scale, Source[i]);
+      Destination += Scale;
+    }
+    break;
+  }
+}
+
+VOID
+EFIAPI
+InternalConvertSpan32Generic(
+    OUT UINT32 *Destination,
+    IN CONST UINT32 *Source,
+    IN UINTN Count,
+    IN CONST GAME_GRAPHICS_LIB_PIXEL_LAYOUT *Layout)
+{
+  UINT32 Pixel;
+
+  for (UINTN i = 0; i < Count; i++)
+  {
+    Pixel = Source[i];
+    Destination[i] = (((Pixel >> Layout->RightShift[0]) & Layout->Mask[0]) << Layout->LeftShift[0]) |
+                     (((Pixel >> Layout->RightShift[1]) & Layout->Mask[1]) << Layout->LeftShift[1]) |
+                     (((Pixel >> Layout->RightShift[2]) & Layout->Mask[2]) << Layout->LeftShift[2]);
+  }
+}
+
+VOID
+EFIAPI
+InternalExpandSpan8Generic(
+    OUT UINT32 *Destination,
+    IN CONST UINT8 *Source,
+    IN UINTN Count,
+    IN CONST UINT32 *Lookup)
+{
+  for (UINTN i = 0; i < Count; i++)
+  {
+    Destination[i] = Lookup[Source[i]];
+  }
+}
+
+#if defined(MDE_CPU_X64) && !defined(GAME_GRAPHICS_LIB_GENERIC_KERNELS)
+/// @brief Checks whether the processor supports AVX2 and the firmware enabled the AVX register state
+STATIC
+BOOLEAN
+IsAvx2Usable(
+    VOID)
+{
+  UINT32 MaxLeaf;
+  UINT32 Ebx;
+  UINT32 Ecx;
+
+  AsmCpuid(0, &MaxLeaf, NULL, NULL, NULL);
+  if (MaxLeaf < CPUID_STRUCTURED_EXTENDED_FEATURE_FLAGS)
+  {
+    return FALSE;
+  }
+
+  // XGETBV is only available if OSXSAVE is set, and the YMM state has to be enabled in XCR0
+  AsmCpuid(CPUID_VERSION_INFO, NULL, NULL, &Ecx, NULL);
+  if (((Ecx & CPUID_ECX_OSXSAVE) == 0) || ((Ecx & CPUID_ECX_AVX) == 0))
+  {
+    return FALSE;
+  }
+  if ((AsmXGetBv(0) & XCR0_SSE_AVX_STATE) != XCR0_SSE_AVX_STATE)
+  {
+    return FALSE;
+  }
+
+  AsmCpuidEx(CPUID_STRUCTURED_EXTENDED_FEATURE_FLAGS, 0, NULL, &Ebx, NULL, NULL);
+  return (Ebx & CPUID_EBX_AVX2) != 0;
+}
+#endif
+
+INTERNAL_FILL_SPAN
+EFIAPI
+InternalBestFillSpan(
+    VOID)
+{
+#if defined(MDE_CPU_X64) && !defined(GAME_GRAPHICS_LIB_GENERIC_KERNELS)
+  UINT32 Edx;
+
+  AsmCpuid(CPUID_VERSION_INFO, NULL, NULL, NULL, &Edx);
+  if (IsAvx2Usable())
+  {
+    return InternalFillSpan32Avx2;
+  }
+  if ((Edx & CPUID_EDX_SSE2) != 0)
+  {
+    return InternalFillSpan32Sse2;
+  }
+#endif
+
+  return InternalFillSpan32Generic;
+}
+
+VOID
+EFIAPI
+InternalSelectKernels(
+    VOID)
+{
+  gInternalFillSpan = InternalBestFillSpan();
+
+#if defined(MDE_CPU_X64) && !defined(GAME_GRAPHICS_LIB_GENERIC_KERNELS)
+  // Pixel replication only needs shuffles, and the conversion and the palette expansion are bound by the
+  // framebuffer writes, SSE2 is as fast as AVX2 for all of them
+  if (gInternalFillSpan != InternalFillSpan32Generic)
+  {
+    gInternalScaleSpan = InternalScaleSpan32Sse2;
+    gInternalConvertSpan = InternalConvertSpan32Sse2;
+    gInternalExpandSpan = InternalExpandSpan8Sse2;
+  }
+
+  if (gInternalFillSpan == InternalFillSpan32Avx2)
+  {
+    DEBUG((DEBUG_INFO, "GameGraphicsLib: Using AVX2 kernels.\n"));
+    return;
+  }
+  if (gInternalFillSpan == InternalFillSpan32Sse2)
+  {
+    DEBUG((DEBUG_INFO, "GameGraphicsLib: Using SSE2 kernels.\n"));
+    return;
+  }
+#endif
+
+  DEBUG((DEBUG_INFO, "GameGraphicsLib: Using generic kernels.\n"));
+}
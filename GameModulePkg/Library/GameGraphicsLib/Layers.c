@@ -0,0 +1,679 @@
+#include <Library/DebugLib.h>
+#include <Uefi.h>
+#include <Protocol/GraphicsOutput.h>
+#include <Library/GameGraphicsLib.h>
+#include <Library/BaseLib.h>
+#include <Library/BaseMemoryLib.h>
+#include <Library/MemoryAllocationLib.h>
+#include "GameGraphicsLibInternal.h"
+
+// Bits of a 32-bit pixel that are compared with the color key, the reserved byte is ignored
+#define LAYER_COLOR_MASK 0x00FFFFFF
+
+/// @brief Layer stack, stored in GAME_GRAPHICS_LIB_DATA.Compositor
+typedef struct
+{
+    GAME_GRAPHICS_LIB_LAYER *Layers[GAME_GRAPHICS_LIB_MAX_LAYERS]; // Sorted by z, from the bottom to the top
+    UINT32 Count;                                                  // Number of valid entries in Layers
+    GAME_GRAPHICS_LIB_DAMAGE Damage;                               // Screen areas to composite again because a layer moved, appeared or disappeared
+    GAME_GRAPHICS_LIB_LAYER *Target;                               // Layer between BeginLayerDrawing and EndLayerDrawing, NULL otherwise
+    EFI_GRAPHICS_OUTPUT_BLT_PIXEL *BackBuffer;                     // Back buffer variables of the library while Target is drawn
+    UINTN SizeOfBackBuffer;
+    UINT32 BackBufferStride;
+    GAME_GRAPHICS_LIB_SCREEN_DATA Screen;
+    GAME_GRAPHICS_LIB_DAMAGE ScreenDamage;
+} COMPOSITOR;
+
+/// @brief Returns the resolution of the back buffer, even while a layer is drawn
+STATIC
+GAME_GRAPHICS_LIB_SCREEN_DATA *
+BackBufferScreen(
+    IN GAME_GRAPHICS_LIB_DATA *Data)
+{
+  COMPOSITOR *Compositor = (COMPOSITOR *)Data->Compositor;
+
+  return ((Compositor != NULL) && (Compositor->Target != NULL)) ? &Compositor->Screen : &Data->Screen;
+}
+
+/// @brief Clips an area of the screen, given with coordinates that may lie outside of it
+/// @return TRUE if any part of the area is on screen, otherwise FALSE and Rectangle is not modified
+STATIC
+BOOLEAN
+ClipToScreen(
+    IN GAME_GRAPHICS_LIB_SCREEN_DATA *Screen,
+    IN INT64 x,
+    IN INT64 y,
+    IN UINT32 Width,
+    IN UINT32 Height,
+    OUT GAME_GRAPHICS_LIB_RECTANGLE *Rectangle)
+{
+  INT64 Left = MAX(x, 0);
+  INT64 Top = MAX(y, 0);
+  INT64 Right = MIN(x + Width, (INT64)Screen->HorizontalResolution);
+  INT64 Bottom = MIN(y + Height, (INT64)Screen->VerticalResolution);
+
+  if ((Right <= Left) || (Bottom <= Top))
+  {
+    return FALSE;
+  }
+
+  Rectangle->x = (UINT32)Left;
+  Rectangle->y = (UINT32)Top;
+  Rectangle->Width = (UINT32)(Right - Left);
+  Rectangle->Height = (UINT32)(Bottom - Top);
+  return TRUE;
+}
+
+/// @brief Marks the part of the screen a layer covers to be composited again
+STATIC
+VOID
+DamageLayerArea(
+    IN GAME_GRAPHICS_LIB_DATA *Data,
+    IN GAME_GRAPHICS_LIB_LAYER *Layer)
+{
+  COMPOSITOR *Compositor = (COMPOSITOR *)Data->Compositor;
+  GAME_GRAPHICS_LIB_RECTANGLE Area;
+
+  if (ClipToScreen(BackBufferScreen(Data), Layer->x, Layer->y, Layer->Size.HorizontalResolution, Layer->Size.VerticalResolution, &Area))
+  {
+    InternalInsertDamage(&Compositor->Damage, &Area);
+  }
+}
+
+/// @brief Returns the position of a layer in the stack, or MAX_UINT32 if it is not part of it
+STATIC
+UINT32
+FindLayer(
+    IN COMPOSITOR *Compositor,
+    IN GAME_GRAPHICS_LIB_LAYER *Layer)
+{
+  for (UINT32 i = 0; i < Compositor->Count; i++)
+  {
+    if (Compositor->Layers[i] == Layer)
+    {
+      return i;
+    }
+  }
+
+  return MAX_UINT32;
+}
+
+/// @brief Places a layer in the stack above every layer with the same or a lower z
+STATIC
+VOID
+InsertLayer(
+    IN COMPOSITOR *Compositor,
+    IN GAME_GRAPHICS_LIB_LAYER *Layer)
+{
+  UINT32 Index = Compositor->Count;
+
+  while ((Index > 0) && (Compositor->Layers[Index - 1]->z > Layer->z))
+  {
+    Compositor->Layers[Index] = Compositor->Layers[Index - 1];
+    Index--;
+  }
+
+  Compositor->Layers[Index] = Layer;
+  Compositor->Count++;
+}
+
+/// @brief Removes the layer at a position of the stack, the layers above it move down
+STATIC
+VOID
+RemoveLayer(
+    IN COMPOSITOR *Compositor,
+    IN UINT32 Index)
+{
+  Compositor->Count--;
+  CopyMem(&Compositor->Layers[Index], &Compositor->Layers[Index + 1], (Compositor->Count - Index) * sizeof(GAME_GRAPHICS_LIB_LAYER *));
+}
+
+/// @brief Looks up a layer of the stack for the functions that change it
+/// @return EFI_SUCCESS if the layer is part of the stack, otherwise an error code.
+STATIC
+EFI_STATUS
+CheckLayer(
+    IN GAME_GRAPHICS_LIB_DATA *Data,
+    IN GAME_GRAPHICS_LIB_LAYER *Layer)
+{
+  if ((Data == NULL) || (Layer == NULL))
+  {
+    return EFI_INVALID_PARAMETER;
+  }
+
+  if ((Data->Compositor == NULL) || (FindLayer(Data->Compositor, Layer) == MAX_UINT32))
+  {
+    return EFI_NOT_FOUND;
+  }
+
+  return EFI_SUCCESS;
+}
+
+/// @brief Checks if a layer is visible in the whole area
+STATIC
+BOOLEAN
+LayerCovers(
+    IN GAME_GRAPHICS_LIB_LAYER *Layer,
+    IN GAME_GRAPHICS_LIB_RECTANGLE *Area)
+{
+  return (Layer->x <= (INT64)Area->x) && (Layer->y <= (INT64)Area->y) &&
+         ((INT64)Layer->x + Layer->Size.HorizontalResolution >= (INT64)Area->x + Area->Width) &&
+         ((INT64)Layer->y + Layer->Size.VerticalResolution >= (INT64)Area->y + Area->Height);
+}
+
+/// @brief Copies the pixels of a row that do not have the color key
+STATIC
+VOID
+CopyKeyedRow(
+    OUT UINT8 *Destination,
+    IN CONST UINT8 *Source,
+    IN UINT32 Count,
+    IN UINT32 PixelSize,
+    IN UINT32 Key)
+{
+  UINT32 *Destination32 = (UINT32 *)Destination;
+  CONST UINT32 *Source32 = (CONST UINT32 *)Source;
+
+  // Palette indices are compared as they are
+  if (PixelSize == sizeof(UINT8))
+  {
+    for (UINT32 i = 0; i < Count; i++)
+    {
+      if (Source[i] != (UINT8)Key)
+      {
+        Destination[i] = Source[i];
+      }
+    }
+    return;
+  }
+
+  for (UINT32 i = 0; i < Count; i++)
+  {
+    if (((Source32[i] ^ Key) & LAYER_COLOR_MASK) != 0)
+    {
+      Destination32[i] = Source32[i];
+    }
+  }
+}
+
+/// @brief Calculates the part of a layer that is visible in an area of the screen
+/// @return TRUE if the layer is visible in any part of the area, otherwise FALSE and Part is not modified
+STATIC
+BOOLEAN
+LayerPart(
+    IN GAME_GRAPHICS_LIB_LAYER *Layer,
+    IN GAME_GRAPHICS_LIB_RECTANGLE *Area,
+    OUT GAME_GRAPHICS_LIB_RECTANGLE *Part)
+{
+  INT64 Left = MAX((INT64)Layer->x, (INT64)Area->x);
+  INT64 Top = MAX((INT64)Layer->y, (INT64)Area->y);
+  INT64 Right = MIN((INT64)Layer->x + Layer->Size.HorizontalResolution, (INT64)Area->x + Area->Width);
+  INT64 Bottom = MIN((INT64)Layer->y + Layer->Size.VerticalResolution, (INT64)Area->y + Area->Height);
+
+  if (!Layer->Visible || (Right <= Left) || (Bottom <= Top))
+  {
+    return FALSE;
+  }
+
+  Part->x = (UINT32)Left;
+  Part->y = (UINT32)Top;
+  Part->Width = (UINT32)(Right - Left);
+  Part->Height = (UINT32)(Bottom - Top);
+  return TRUE;
+}
+
+/// @brief Composites one area of the back buffer from the layers that are visible in it
+/// @details
+/// The topmost opaque layer that covers the whole area hides everything below it, so compositing starts there.
+/// Without one the area is painted black first, since no layer has to cover it.
+STATIC
+VOID
+CompositeArea(
+    IN GAME_GRAPHICS_LIB_DATA *Data,
+    IN COMPOSITOR *Compositor,
+    IN GAME_GRAPHICS_LIB_RECTANGLE *Area)
+{
+  EFI_GRAPHICS_OUTPUT_BLT_PIXEL Black = {0, 0, 0, 0};
+  GAME_GRAPHICS_LIB_LAYER *Layer;
+  GAME_GRAPHICS_LIB_RECTANGLE Part;
+  UINT32 PixelSize = Data->BackBufferPixelSize;
+  UINT32 Bottom = 0;
+  BOOLEAN Covered = FALSE;
+  UINT32 Key;
+  UINT8 *Source;
+
+  for (UINT32 i = Compositor->Count; (i > 0) && !Covered; i--)
+  {
+    Layer = Compositor->Layers[i - 1];
+    Covered = Layer->Visible && !Layer->Transparent && LayerCovers(Layer, Area);
+    Bottom = i - 1;
+  }
+
+  if (!Covered)
+  {
+    // Black is 0 in a color back buffer and a single byte index in a palette one, so rows can be set bytewise
+    Bottom = 0;
+    Key = InternalPixelValue(Data, &Black);
+    for (UINT32 Row = Area->y; Row < Area->y + Area->Height; Row++)
+    {
+      SetMem(InternalBackBufferPixel(Data, Data->BackBuffer, Area->x, Row), (UINTN)Area->Width * PixelSize, (UINT8)Key);
+    }
+  }
+
+  for (UINT32 i = Bottom; i < Compositor->Count; i++)
+  {
+    Layer = Compositor->Layers[i];
+    if (!LayerPart(Layer, Area, &Part))
+    {
+      continue;
+    }
+
+    Key = Layer->Transparent ? InternalPixelValue(Data, &Layer->ColorKey) : 0;
+    for (UINT32 Row = Part.y; Row < Part.y + Part.Height; Row++)
+    {
+      Source = (UINT8 *)Layer->Buffer + ((UINTN)(Row - Layer->y) * Layer->Stride + (Part.x - Layer->x)) * PixelSize;
+      if (Layer->Transparent)
+      {
+        CopyKeyedRow(InternalBackBufferPixel(Data, Data->BackBuffer, Part.x, Row), Source, Part.Width, PixelSize, Key);
+      }
+      else
+      {
+        CopyMem(InternalBackBufferPixel(Data, Data->BackBuffer, Part.x, Row), Source, (UINTN)Part.Width * PixelSize);
+      }
+    }
+  }
+
+  InternalAddDamage(Data, Area);
+}
+
+BOOLEAN
+EFIAPI
+InternalDrawingLayer(
+    IN GAME_GRAPHICS_LIB_DATA *Data)
+{
+  return (Data->Compositor != NULL) && (((COMPOSITOR *)Data->Compositor)->Target != NULL);
+}
+
+VOID
+EFIAPI
+InternalDestroyCompositor(
+    IN OUT GAME_GRAPHICS_LIB_DATA *Data)
+{
+  if (Data->Compositor == NULL)
+  {
+    return;
+  }
+
+  // The back buffer variables have to describe the back buffer again before it is freed
+  EndLayerDrawing(Data);
+  FreePool(Data->Compositor);
+  Data->Compositor = NULL;
+}
+
+EFI_STATUS
+EFIAPI
+CreateLayer(
+    IN GAME_GRAPHICS_LIB_DATA *Data,
+    OUT GAME_GRAPHICS_LIB_LAYER *Layer,
+    IN INT32 x,
+    IN INT32 y,
+    IN UINT32 Width,
+    IN UINT32 Height,
+    IN INT32 z)
+{
+  EFI_STATUS Status;
+  COMPOSITOR *Compositor;
+
+  if ((Data == NULL) || (Layer == NULL) || (Width == 0) || (Height == 0))
+  {
+    return EFI_INVALID_PARAMETER;
+  }
+
+  Compositor = (COMPOSITOR *)Data->Compositor;
+  if (Compositor == NULL)
+  {
+    Compositor = AllocateZeroPool(sizeof(COMPOSITOR));
+    if (Compositor == NULL)
+    {
+      return EFI_OUT_OF_RESOURCES;
+    }
+    Compositor->Damage.MaxCount = GAME_GRAPHICS_LIB_MAX_DAMAGE_RECTANGLES;
+  }
+
+  if (Compositor->Count >= GAME_GRAPHICS_LIB_MAX_LAYERS)
+  {
+    DEBUG((DEBUG_ERROR, "CreateLayer: %u layers exist already.\n", Compositor->Count));
+    return EFI_OUT_OF_RESOURCES;
+  }
+
+  ZeroMem(Layer, sizeof(GAME_GRAPHICS_LIB_LAYER));
+  InternalBackBufferLayout(Width, Height, Data->BackBufferPixelSize, &Layer->Stride, &Layer->SizeOfBuffer);
+  Status = InternalAllocateBackBuffer(Layer->SizeOfBuffer, &Layer->Buffer);
+  if (EFI_ERROR(Status))
+  {
+    DEBUG((DEBUG_ERROR, "CreateLayer: Failed to allocate the pixels: %r\n", Status));
+    Layer->Buffer = NULL;
+    if (Data->Compositor == NULL)
+    {
+      FreePool(Compositor);
+    }
+    return Status;
+  }
+
+  Layer->Size.HorizontalResolution = Width;
+  Layer->Size.VerticalResolution = Height;
+  Layer->x = x;
+  Layer->y = y;
+  Layer->z = z;
+  Layer->Visible = TRUE;
+  Layer->Damage.MaxCount = GAME_GRAPHICS_LIB_MAX_DAMAGE_RECTANGLES;
+
+  Data->Compositor = Compositor;
+  InsertLayer(Compositor, Layer);
+  DamageLayerArea(Data, Layer);
+
+  return EFI_SUCCESS;
+}
+
+EFI_STATUS
+EFIAPI
+DeleteLayer(
+    IN GAME_GRAPHICS_LIB_DATA *Data,
+    IN GAME_GRAPHICS_LIB_LAYER *Layer)
+{
+  COMPOSITOR *Compositor;
+  UINT32 Index;
+
+  if ((Data == NULL) || (Layer == NULL))
+  {
+    return EFI_INVALID_PARAMETER;
+  }
+
+  // Layers can outlive FinishGraphicMode, which only drops the stack
+  Compositor = (COMPOSITOR *)Data->Compositor;
+  if (Compositor != NULL)
+  {
+    if (Compositor->Target == Layer)
+    {
+      DEBUG((DEBUG_ERROR, "DeleteLayer: The layer is being drawn.\n"));
+      return EFI_NOT_READY;
+    }
+
+    Index = FindLayer(Compositor, Layer);
+    if (Index != MAX_UINT32)
+    {
+      if (Layer->Visible)
+      {
+        DamageLayerArea(Data, Layer);
+      }
+      RemoveLayer(Compositor, Index);
+    }
+
+    // The area of the last layer turns black, from then on the back buffer is drawn directly
+    if (Compositor->Count == 0)
+    {
+      CompositeLayers(Data);
+      FreePool(Compositor);
+      Data->Compositor = NULL;
+    }
+  }
+
+  if (Layer->Buffer != NULL)
+  {
+    InternalFreeBackBuffer(Layer->Buffer, Layer->SizeOfBuffer);
+    Layer->Buffer = NULL;
+  }
+
+  return EFI_SUCCESS;
+}
+
+EFI_STATUS
+EFIAPI
+BeginLayerDrawing(
+    IN GAME_GRAPHICS_LIB_DATA *Data,
+    IN GAME_GRAPHICS_LIB_LAYER *Layer)
+{
+  EFI_STATUS Status;
+  COMPOSITOR *Compositor;
+
+  Status = CheckLayer(Data, Layer);
+  if (EFI_ERROR(Status))
+  {
+    return Status;
+  }
+
+  Compositor = (COMPOSITOR *)Data->Compositor;
+  if (Compositor->Target != NULL)
+  {
+    DEBUG((DEBUG_ERROR, "BeginLayerDrawing: Another layer is being drawn.\n"));
+    return EFI_NOT_READY;
+  }
+
+  // Fills that are still running read the back buffer variables
+  WaitForRenderJobs(Data);
+
+  Compositor->BackBuffer = Data->BackBuffer;
+  Compositor->SizeOfBackBuffer = Data->SizeOfBackBuffer;
+  Compositor->BackBufferStride = Data->BackBufferStride;
+  Compositor->Screen = Data->Screen;
+  CopyMem(&Compositor->ScreenDamage, &Data->Damage, sizeof(GAME_GRAPHICS_LIB_DAMAGE));
+
+  Data->BackBuffer = Layer->Buffer;
+  Data->SizeOfBackBuffer = Layer->SizeOfBuffer;
+  Data->BackBufferStride = Layer->Stride;
+  Data->Screen = Layer->Size;
+  CopyMem(&Data->Damage, &Layer->Damage, sizeof(GAME_GRAPHICS_LIB_DAMAGE));
+  Compositor->Target = Layer;
+
+  return EFI_SUCCESS;
+}
+
+EFI_STATUS
+EFIAPI
+EndLayerDrawing(
+    IN GAME_GRAPHICS_LIB_DATA *Data)
+{
+  COMPOSITOR *Compositor;
+  GAME_GRAPHICS_LIB_LAYER *Layer;
+
+  if (Data == NULL)
+  {
+    return EFI_INVALID_PARAMETER;
+  }
+
+  Compositor = (COMPOSITOR *)Data->Compositor;
+  if ((Compositor == NULL) || (Compositor->Target == NULL))
+  {
+    return EFI_NOT_STARTED;
+  }
+
+  WaitForRenderJobs(Data);
+
+  Layer = Compositor->Target;
+  CopyMem(&Layer->Damage, &Data->Damage, sizeof(GAME_GRAPHICS_LIB_DAMAGE));
+
+  Data->BackBuffer = Compositor->BackBuffer;
+  Data->SizeOfBackBuffer = Compositor->SizeOfBackBuffer;
+  Data->BackBufferStride = Compositor->BackBufferStride;
+  Data->Screen = Compositor->Screen;
+  CopyMem(&Data->Damage, &Compositor->ScreenDamage, sizeof(GAME_GRAPHICS_LIB_DAMAGE));
+  Compositor->Target = NULL;
+
+  return EFI_SUCCESS;
+}
+
+EFI_STATUS
+EFIAPI
+MoveLayer(
+    IN GAME_GRAPHICS_LIB_DATA *Data,
+    IN GAME_GRAPHICS_LIB_LAYER *Layer,
+    IN INT32 x,
+    IN INT32 y)
+{
+  EFI_STATUS Status;
+
+  Status = CheckLayer(Data, Layer);
+  if (EFI_ERROR(Status))
+  {
+    return Status;
+  }
+
+  if ((Layer->x == x) && (Layer->y == y))
+  {
+    return EFI_SUCCESS;
+  }
+
+  // What the layer covered shows the layers below again, and the new area shows the layer
+  if (Layer->Visible)
+  {
+    DamageLayerArea(Data, Layer);
+  }
+  Layer->x = x;
+  Layer->y = y;
+  if (Layer->Visible)
+  {
+    DamageLayerArea(Data, Layer);
+  }
+
+  return EFI_SUCCESS;
+}
+
+EFI_STATUS
+EFIAPI
+SetLayerOrder(
+    IN GAME_GRAPHICS_LIB_DATA *Data,
+    IN GAME_GRAPHICS_LIB_LAYER *Layer,
+    IN INT32 z)
+{
+  EFI_STATUS Status;
+  COMPOSITOR *Compositor;
+
+  Status = CheckLayer(Data, Layer);
+  if (EFI_ERROR(Status))
+  {
+    return Status;
+  }
+
+  Compositor = (COMPOSITOR *)Data->Compositor;
+  RemoveLayer(Compositor, FindLayer(Compositor, Layer));
+  Layer->z = z;
+  InsertLayer(Compositor, Layer);
+
+  if (Layer->Visible)
+  {
+    DamageLayerArea(Data, Layer);
+  }
+
+  return EFI_SUCCESS;
+}
+
+EFI_STATUS
+EFIAPI
+SetLayerVisible(
+    IN GAME_GRAPHICS_LIB_DATA *Data,
+    IN GAME_GRAPHICS_LIB_LAYER *Layer,
+    IN BOOLEAN Visible)
+{
+  EFI_STATUS Status;
+
+  Status = CheckLayer(Data, Layer);
+  if (EFI_ERROR(Status))
+  {
+    return Status;
+  }
+
+  if (Layer->Visible == Visible)
+  {
+    return EFI_SUCCESS;
+  }
+
+  Layer->Visible = Visible;
+  DamageLayerArea(Data, Layer);
+
+  return EFI_SUCCESS;
+}
+
+EFI_STATUS
+EFIAPI
+SetLayerColorKey(
+    IN GAME_GRAPHICS_LIB_DATA *Data,
+    IN GAME_GRAPHICS_LIB_LAYER *Layer,
+    IN CONST EFI_GRAPHICS_OUTPUT_BLT_PIXEL *ColorKey OPTIONAL)
+{
+  EFI_STATUS Status;
+
+  Status = CheckLayer(Data, Layer);
+  if (EFI_ERROR(Status))
+  {
+    return Status;
+  }
+
+  Layer->Transparent = (ColorKey != NULL);
+  if (ColorKey != NULL)
+  {
+    Layer->ColorKey = *ColorKey;
+  }
+
+  if (Layer->Visible)
+  {
+    DamageLayerArea(Data, Layer);
+  }
+
+  return EFI_SUCCESS;
+}
+
+EFI_STATUS
+EFIAPI
+CompositeLayers(
+    IN GAME_GRAPHICS_LIB_DATA *Data)
+{
+  COMPOSITOR *Compositor;
+  GAME_GRAPHICS_LIB_LAYER *Layer;
+  GAME_GRAPHICS_LIB_DAMAGE Areas;
+  GAME_GRAPHICS_LIB_RECTANGLE *Rectangle;
+  GAME_GRAPHICS_LIB_RECTANGLE Area;
+
+  if (Data == NULL)
+  {
+    return EFI_INVALID_PARAMETER;
+  }
+
+  Compositor = (COMPOSITOR *)Data->Compositor;
+  if (Compositor == NULL)
+  {
+    return EFI_SUCCESS;
+  }
+
+  if (Compositor->Target != NULL)
+  {
+    DEBUG((DEBUG_ERROR, "CompositeLayers: A layer is being drawn.\n"));
+    return EFI_NOT_READY;
+  }
+
+  // Fills of the application processors may still be drawing into a layer
+  WaitForRenderJobs(Data);
+
+  // Damage of hidden layers is dropped, showing them composites their whole area anyway
+  CopyMem(&Areas, &Compositor->Damage, sizeof(GAME_GRAPHICS_LIB_DAMAGE));
+  Compositor->Damage.Count = 0;
+  for (UINT32 i = 0; i < Compositor->Count; i++)
+  {
+    Layer = Compositor->Layers[i];
+    for (UINT32 j = 0; Layer->Visible && (j < Layer->Damage.Count); j++)
+    {
+      Rectangle = &Layer->Damage.Rectangles[j];
+      if (ClipToScreen(&Data->Screen, (INT64)Layer->x + Rectangle->x, (INT64)Layer->y + Rectangle->y, Rectangle->Width, Rectangle->Height, &Area))
+      {
+        InternalInsertDamage(&Areas, &Area);
+      }
+    }
+    Layer->Damage.Count = 0;
+  }
+
+  for (UINT32 i = 0; i < Areas.Count; i++)
+  {
+    CompositeArea(Data, Compositor, &Areas.Rectangles[i]);
+  }
+
+  return EFI_SUCCESS;
+}
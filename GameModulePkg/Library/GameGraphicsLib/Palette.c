@@ -0,0 +1,245 @@
+#include <Library/DebugLib.h>
+#include <Uefi.h>
+#include <Protocol/GraphicsOutput.h>
+#include <Library/GameGraphicsLib.h>
+#include <Library/BaseLib.h>
+#include <Library/BaseMemoryLib.h>
+#include <Library/MemoryAllocationLib.h>
+#include "GameGraphicsLibInternal.h"
+
+// Bits of a back buffer pixel that hold the color, the reserved byte is ignored when looking up palette entries
+#define PALETTE_COLOR_MASK 0x00FFFFFF
+
+/// @brief Squared distance of two colors, summed over the channels
+STATIC
+UINT32
+ColorDistance(
+    IN UINT32 First,
+    IN UINT32 Second)
+{
+  UINT32 Distance = 0;
+  INT32 Difference;
+
+  for (UINT32 Shift = 0; Shift < 24; Shift += 8)
+  {
+    Difference = (INT32)((First >> Shift) & 0xFF) - (INT32)((Second >> Shift) & 0xFF);
+    Distance += (UINT32)(Difference * Difference);
+  }
+
+  return Distance;
+}
+
+UINT32
+EFIAPI
+InternalPixelValue(
+    IN GAME_GRAPHICS_LIB_DATA *Data,
+    IN CONST EFI_GRAPHICS_OUTPUT_BLT_PIXEL *Color)
+{
+  INTERNAL_PALETTE *Palette = Data->Palette;
+  UINT32 Value = *(CONST UINT32 *)Color;
+  UINT32 Distance;
+  UINT32 BestDistance = MAX_UINT32;
+  UINT32 Best = 0;
+
+  if (Palette == NULL)
+  {
+    return Value;
+  }
+
+  // Palettes hold a handful of colors, so a linear search is cheaper than keeping a hash of them up to date
+  for (UINT32 i = 0; i < Palette->Count; i++)
+  {
+    if (((Palette->Colors[i] ^ Value) & PALETTE_COLOR_MASK) == 0)
+    {
+      return i;
+    }
+
+    Distance = ColorDistance(Palette->Colors[i], Value);
+    if (Distance < BestDistance)
+    {
+      BestDistance = Distance;
+      Best = i;
+    }
+  }
+
+  return Best;
+}
+
+VOID
+EFIAPI
+InternalUpdatePaletteLut(
+    IN GAME_GRAPHICS_LIB_DATA *Data)
+{
+  INTERNAL_PALETTE *Palette = Data->Palette;
+
+  if (Palette == NULL)
+  {
+    return;
+  }
+
+  // Modes without a usable framebuffer never read the converted entries
+  if (Data->PixelFormat == PixelBlueGreenRedReserved8BitPerColor)
+  {
+    CopyMem(Palette->FrameBufferColors, Palette->Colors, sizeof(Palette->FrameBufferColors));
+  }
+  else
+  {
+    InternalConvertSpan32Generic(Palette->FrameBufferColors, Palette->Colors, GAME_GRAPHICS_LIB_PALETTE_SIZE, &Data->PixelLayout);
+  }
+}
+
+/// @brief Stores new colors of palette entries and makes the whole screen show them with the next present
+/// @note The present processor and the render workers read the palette, they have to be idle
+STATIC
+VOID
+StorePaletteColors(
+    IN GAME_GRAPHICS_LIB_DATA *Data,
+    IN UINT32 FirstIndex,
+    IN UINT32 Count,
+    IN CONST EFI_GRAPHICS_OUTPUT_BLT_PIXEL *Colors)
+{
+  INTERNAL_PALETTE *Palette = Data->Palette;
+
+  CopyMem(&Palette->Colors[FirstIndex], Colors, Count * sizeof(UINT32));
+  InternalUpdatePaletteLut(Data);
+
+  // The indices in the back buffer stay the same, only their colors change
+  AddDamageRectangle(Data, 0, 0, Data->Screen.HorizontalResolution, Data->Screen.VerticalResolution);
+}
+
+EFI_STATUS
+EFIAPI
+EnablePaletteMode(
+    IN GAME_GRAPHICS_LIB_DATA *Data,
+    IN CONST EFI_GRAPHICS_OUTPUT_BLT_PIXEL *Colors,
+    IN UINT32 Count)
+{
+  EFI_STATUS Status;
+  INTERNAL_PALETTE *Palette;
+
+  if ((Data == NULL) || (Colors == NULL) || (Count == 0) || (Count > GAME_GRAPHICS_LIB_PALETTE_SIZE))
+  {
+    return EFI_INVALID_PARAMETER;
+  }
+
+  // The whole screen is damaged, which would land in the damage list of the layer
+  if (InternalDrawingLayer(Data))
+  {
+    DEBUG((DEBUG_ERROR, "EnablePaletteMode: A layer is being drawn.\n"));
+    return EFI_NOT_READY;
+  }
+
+  // The back buffer already holds indices, only the colors behind them are replaced
+  if (Data->Palette != NULL)
+  {
+    WaitForRenderJobs(Data);
+    WaitForPresent(Data);
+    Palette = Data->Palette;
+    ZeroMem(Palette->Colors, sizeof(Palette->Colors));
+    Palette->Count = Count;
+    StorePaletteColors(Data, 0, Count, Colors);
+    return EFI_SUCCESS;
+  }
+
+  Palette = AllocateZeroPool(sizeof(INTERNAL_PALETTE));
+  if (Palette == NULL)
+  {
+    return EFI_OUT_OF_RESOURCES;
+  }
+  CopyMem(Palette->Colors, Colors, Count * sizeof(UINT32));
+  Palette->Count = Count;
+
+  // Render jobs read the pixel size of the back buffer they are filling
+  WaitForRenderJobs(Data);
+  Data->Palette = Palette;
+  Data->BackBufferPixelSize = sizeof(UINT8);
+  InternalUpdatePaletteLut(Data);
+
+  // Replaces the back buffer with one of single byte pixels and the same resolution
+  Status = SetRenderResolution(Data, Data->Screen.HorizontalResolution, Data->Screen.VerticalResolution);
+  if (EFI_ERROR(Status))
+  {
+    DEBUG((DEBUG_ERROR, "EnablePaletteMode: Failed to replace the back buffer: %r\n", Status));
+    Data->Palette = NULL;
+    Data->BackBufferPixelSize = sizeof(EFI_GRAPHICS_OUTPUT_BLT_PIXEL);
+    FreePool(Palette);
+    return Status;
+  }
+
+  DEBUG((DEBUG_INFO, "EnablePaletteMode: %u colors, back buffer of %lu bytes.\n", Count, (UINT64)Data->SizeOfBackBuffer));
+  return EFI_SUCCESS;
+}
+
+EFI_STATUS
+EFIAPI
+DisablePaletteMode(
+    IN GAME_GRAPHICS_LIB_DATA *Data)
+{
+  EFI_STATUS Status;
+  INTERNAL_PALETTE *Palette;
+
+  if (Data == NULL)
+  {
+    return EFI_INVALID_PARAMETER;
+  }
+
+  if (Data->Palette == NULL)
+  {
+    return EFI_SUCCESS;
+  }
+
+  WaitForRenderJobs(Data);
+  Palette = Data->Palette;
+  Data->Palette = NULL;
+  Data->BackBufferPixelSize = sizeof(EFI_GRAPHICS_OUTPUT_BLT_PIXEL);
+
+  Status = SetRenderResolution(Data, Data->Screen.HorizontalResolution, Data->Screen.VerticalResolution);
+  if (EFI_ERROR(Status))
+  {
+    DEBUG((DEBUG_ERROR, "DisablePaletteMode: Failed to replace the back buffer: %r\n", Status));
+    Data->Palette = Palette;
+    Data->BackBufferPixelSize = sizeof(UINT8);
+    return Status;
+  }
+
+  FreePool(Palette);
+  return EFI_SUCCESS;
+}
+
+EFI_STATUS
+EFIAPI
+SetPaletteColors(
+    IN GAME_GRAPHICS_LIB_DATA *Data,
+    IN UINT32 FirstIndex,
+    IN UINT32 Count,
+    IN CONST EFI_GRAPHICS_OUTPUT_BLT_PIXEL *Colors)
+{
+  INTERNAL_PALETTE *Palette;
+
+  if ((Data == NULL) || (Colors == NULL) || ((UINT64)FirstIndex + Count > GAME_GRAPHICS_LIB_PALETTE_SIZE))
+  {
+    return EFI_INVALID_PARAMETER;
+  }
+
+  if (Data->Palette == NULL)
+  {
+    DEBUG((DEBUG_ERROR, "SetPaletteColors: No palette is enabled.\n"));
+    return EFI_NOT_STARTED;
+  }
+
+  if (InternalDrawingLayer(Data))
+  {
+    DEBUG((DEBUG_ERROR, "SetPaletteColors: A layer is being drawn.\n"));
+    return EFI_NOT_READY;
+  }
+
+  // The present processor may still be expanding the previous frame with the old colors
+  WaitForRenderJobs(Data);
+  WaitForPresent(Data);
+
+  Palette = Data->Palette;
+  Palette->Count = MAX(Palette->Count, FirstIndex + Count);
+  StorePaletteColors(Data, FirstIndex, Count, Colors);
+
+  return EFI_SUCCESS;
+}
@@ -0,0 +1,555 @@
+#include <Uefi.h>
+#include <Protocol/MpService.h>
+#include <Library/DebugLib.h>
+#include <Library/BaseLib.h>
+#include <Library/BaseMemoryLib.h>
+#include <Library/MemoryAllocationLib.h>
+#include <Library/SynchronizationLib.h>
+#include <Library/UefiBootServicesTableLib.h>
+#include <Library/GameGraphicsLib.h>
+#include "GameGraphicsLibInternal.h"
+
+#define CPUID_VERSION_INFO 0x01
+#define CPUID_ECX_MONITOR BIT3
+
+// Every worker reports completion in its own cache line, so the spinning processors do not share lines
+#define RENDER_CACHE_LINE_SIZE 64
+
+/// @brief Argument of the procedure running on an application processor
+typedef struct _RENDERER RENDERER;
+typedef struct
+{
+    RENDERER *Renderer;
+    UINT32 Index;                // Strip drawn by the worker, the BSP draws the last strip of every job
+    volatile UINT32 *Completed;  // Generation of the last job the worker finished
+    INTERNAL_AP_WORKER Worker;   // Processor of the worker, idles between jobs
+} RENDER_WORKER;
+
+/// @brief Parallel rendering state, stored in GAME_GRAPHICS_LIB_DATA.Renderer
+struct _RENDERER
+{
+    GAME_GRAPHICS_LIB_DATA *Data;
+    EFI_MP_SERVICES_PROTOCOL *MpServices;
+    RENDER_WORKER *Workers;
+    UINT32 WorkerCount;
+    UINT8 *CompletedLines;                   // One cache line per worker, see RENDER_WORKER.Completed
+    volatile UINT32 Generation;              // Incremented by the BSP for every job
+    volatile BOOLEAN Quit;                   // Workers return instead of running the job of the current generation
+    BOOLEAN Busy;                            // TRUE until the BSP waited for the current job
+    INTERNAL_STRIP_FUNCTION Function;        // Job of the current generation
+    UINT32 StripCount;
+    UINT64 Context[INTERNAL_RENDER_JOB_CONTEXT_SIZE / sizeof(UINT64)];
+};
+
+/// @brief Procedure of the application processors, runs jobs until DisableParallelRendering or until it idled
+///        long enough to park, see INTERNAL_AP_WORKER
+/// @note Must not call UEFI services or DEBUG, those are only available on the BSP
+STATIC
+VOID
+EFIAPI
+RenderWorker(
+    IN OUT VOID *Buffer)
+{
+  RENDER_WORKER *Worker = (RENDER_WORKER *)Buffer;
+  RENDERER *Renderer = Worker->Renderer;
+  INTERNAL_FILL_SPAN FillSpan;
+  UINT32 Generation;
+
+  // Every processor checks its own vector state, they do not have to match the BSP
+  FillSpan = InternalBestFillSpan();
+
+  // Started again after parking, the job that woke it up is still pending
+  Generation = *Worker->Completed;
+
+  for (;;)
+  {
+    if (!InternalApWorkerWait(&Worker->Worker, &Renderer->Generation, Generation))
+    {
+      return;
+    }
+    Generation = Renderer->Generation;
+    MemoryFence();
+
+    if (Renderer->Quit)
+    {
+      break;
+    }
+
+    if (Worker->Index + 1 < Renderer->StripCount)
+    {
+      Renderer->Function(Renderer->Data, Renderer->Context, Worker->Index, Renderer->StripCount, FillSpan);
+    }
+
+    MemoryFence();
+    *Worker->Completed = Generation;
+  }
+
+  *Worker->Completed = Generation;
+}
+
+/// @brief Frees the renderer and its worker tables
+STATIC
+VOID
+FreeRenderer(
+    IN RENDERER *Renderer)
+{
+  if (Renderer->Workers != NULL)
+  {
+    FreePool(Renderer->Workers);
+  }
+
+  if (Renderer->CompletedLines != NULL)
+  {
+    FreePool(Renderer->CompletedLines);
+  }
+
+  FreePool(Renderer);
+}
+
+EFI_STATUS
+EFIAPI
+InternalStartApProcedure(
+    IN EFI_MP_SERVICES_PROTOCOL *MpServices,
+    IN UINTN FirstProcessor,
+    IN EFI_AP_PROCEDURE Procedure,
+    IN VOID *Argument,
+    OUT UINTN *Processor,
+    OUT EFI_EVENT *Event)
+{
+  EFI_STATUS Status;
+  EFI_PROCESSOR_INFORMATION ProcessorInfo;
+  UINTN ProcessorCount;
+  UINTN EnabledProcessorCount;
+  UINTN BspNumber;
+
+  Status = MpServices->GetNumberOfProcessors(MpServices, &ProcessorCount, &EnabledProcessorCount);
+  if (EFI_ERROR(Status))
+  {
+    return Status;
+  }
+
+  Status = MpServices->WhoAmI(MpServices, &BspNumber);
+  if (EFI_ERROR(Status))
+  {
+    return Status;
+  }
+
+  for (UINTN Number = FirstProcessor; Number < ProcessorCount; Number++)
+  {
+    if (Number == BspNumber)
+    {
+      continue;
+    }
+
+    Status = MpServices->GetProcessorInfo(MpServices, Number, &ProcessorInfo);
+    if (EFI_ERROR(Status) || ((ProcessorInfo.StatusFlag & PROCESSOR_ENABLED_BIT) == 0))
+    {
+      continue;
+    }
+
+    Status = gBS->CreateEvent(0, TPL_CALLBACK, NULL, NULL, Event);
+    if (EFI_ERROR(Status))
+    {
+      return Status;
+    }
+
+    // Non-blocking, processors that already run a procedure of someone else refuse and are skipped
+    Status = MpServices->StartupThisAP(MpServices, Procedure, Number, *Event, 0, Argument, NULL);
+    if (EFI_ERROR(Status))
+    {
+      gBS->CloseEvent(*Event);
+      continue;
+    }
+
+    *Processor = Number;
+    return EFI_SUCCESS;
+  }
+
+  return EFI_NOT_FOUND;
+}
+
+/// @brief Checks whether the processors can sleep in MONITOR/MWAIT until a worker gets a job
+STATIC
+BOOLEAN
+IsMonitorWaitUsable(
+    VOID)
+{
+#if (defined(MDE_CPU_X64) || defined(MDE_CPU_IA32)) && !defined(GAME_GRAPHICS_LIB_GENERIC_KERNELS)
+  UINT32 Ecx;
+
+  // Application processors run with interrupts disabled, only MWAIT wakes up on a write to memory, HLT would not
+  AsmCpuid(CPUID_VERSION_INFO, NULL, NULL, &Ecx, NULL);
+  return (Ecx & CPUID_ECX_MONITOR) != 0;
+#else
+  return FALSE;
+#endif
+}
+
+EFI_STATUS
+EFIAPI
+InternalStartApWorker(
+    IN EFI_MP_SERVICES_PROTOCOL *MpServices,
+    IN UINTN FirstProcessor,
+    OUT INTERNAL_AP_WORKER *Worker,
+    IN EFI_AP_PROCEDURE Procedure,
+    IN VOID *Argument)
+{
+  EFI_STATUS Status;
+
+  Worker->State = INTERNAL_AP_WORKER_RUNNING;
+  Worker->MonitorWait = IsMonitorWaitUsable();
+  Worker->Event = NULL;
+
+  Status = InternalStartApProcedure(MpServices, FirstProcessor, Procedure, Argument, &Worker->Processor, &Worker->Event);
+  if (EFI_ERROR(Status))
+  {
+    Worker->State = INTERNAL_AP_WORKER_STOPPED;
+    Worker->Event = NULL;
+  }
+
+  return Status;
+}
+
+BOOLEAN
+EFIAPI
+InternalApWorkerWait(
+    IN OUT INTERNAL_AP_WORKER *Worker,
+    IN volatile UINT32 *Generation,
+    IN UINT32 Seen)
+{
+  // Jobs of the next frame usually follow within a few microseconds
+  for (UINT32 Spin = 0; Spin < INTERNAL_AP_IDLE_SPINS; Spin++)
+  {
+    if (*Generation != Seen)
+    {
+      return TRUE;
+    }
+    CpuPause();
+  }
+
+#if (defined(MDE_CPU_X64) || defined(MDE_CPU_IA32)) && !defined(GAME_GRAPHICS_LIB_GENERIC_KERNELS)
+  if (Worker->MonitorWait)
+  {
+    // The write of the BSP to the generation ends the wait, the check after arming the monitor closes the race with it
+    for (;;)
+    {
+      AsmMonitor((UINTN)Generation, 0, 0);
+      if (*Generation != Seen)
+      {
+        return TRUE;
+      }
+      AsmMwait(0, 0);
+    }
+  }
+#endif
+
+  for (UINT32 Spin = 0; Spin < INTERNAL_AP_PARK_SPINS; Spin++)
+  {
+    if (*Generation != Seen)
+    {
+      return TRUE;
+    }
+    CpuPause();
+  }
+
+  // Returning idles the processor, the BSP starts the procedure again for the next job. A job published while
+  // parking is either still taken here, or left to the BSP if it already saw the worker parking.
+  InterlockedCompareExchange32(&Worker->State, INTERNAL_AP_WORKER_RUNNING, INTERNAL_AP_WORKER_PARKING);
+  if ((*Generation != Seen) &&
+      (InterlockedCompareExchange32(&Worker->State, INTERNAL_AP_WORKER_PARKING, INTERNAL_AP_WORKER_RUNNING) == INTERNAL_AP_WORKER_PARKING))
+  {
+    return TRUE;
+  }
+
+  return FALSE;
+}
+
+BOOLEAN
+EFIAPI
+InternalResumeApWorker(
+    IN EFI_MP_SERVICES_PROTOCOL *MpServices,
+    IN OUT INTERNAL_AP_WORKER *Worker,
+    IN EFI_AP_PROCEDURE Procedure,
+    IN VOID *Argument)
+{
+  EFI_STATUS Status;
+
+  // The locked exchange also makes the new generation visible before the state is read
+  if (InterlockedCompareExchange32(&Worker->State, INTERNAL_AP_WORKER_PARKING, INTERNAL_AP_WORKER_STOPPED) == INTERNAL_AP_WORKER_RUNNING)
+  {
+    return TRUE;
+  }
+
+  // MP services only accept a new procedure once they noticed the last one returned, which takes up to a timer period
+  if (Worker->Event != NULL)
+  {
+    if (gBS->CheckEvent(Worker->Event) != EFI_SUCCESS)
+    {
+      return FALSE;
+    }
+    gBS->CloseEvent(Worker->Event);
+    Worker->Event = NULL;
+  }
+
+  Worker->State = INTERNAL_AP_WORKER_RUNNING;
+  MemoryFence();
+  Status = InternalStartApProcedure(MpServices, Worker->Processor, Procedure, Argument, &Worker->Processor, &Worker->Event);
+  if (EFI_ERROR(Status))
+  {
+    Worker->State = INTERNAL_AP_WORKER_STOPPED;
+    Worker->Event = NULL;
+    return FALSE;
+  }
+
+  return TRUE;
+}
+
+VOID
+EFIAPI
+InternalStopApWorker(
+    IN OUT INTERNAL_AP_WORKER *Worker)
+{
+  UINTN EventIndex;
+
+  // The processors only become available to other MP services callers once their procedure returned
+  if (Worker->Event != NULL)
+  {
+    gBS->WaitForEvent(1, &Worker->Event, &EventIndex);
+    gBS->CloseEvent(Worker->Event);
+    Worker->Event = NULL;
+  }
+  Worker->State = INTERNAL_AP_WORKER_STOPPED;
+}
+
+EFI_STATUS
+EFIAPI
+EnableParallelRendering(
+    IN GAME_GRAPHICS_LIB_DATA *Data,
+    IN UINT32 MaxApplicationProcessors)
+{
+  EFI_STATUS Status;
+  EFI_MP_SERVICES_PROTOCOL *MpServices;
+  RENDERER *Renderer;
+  RENDER_WORKER *Worker;
+  UINTN ProcessorCount;
+  UINTN EnabledProcessorCount;
+  UINTN Processor;
+
+  if (Data == NULL)
+  {
+    return EFI_INVALID_PARAMETER;
+  }
+
+  // Starting again with a different processor count
+  DisableParallelRendering(Data);
+
+  Status = gBS->LocateProtocol(&gEfiMpServiceProtocolGuid, NULL, (VOID **)&MpServices);
+  if (EFI_ERROR(Status))
+  {
+    DEBUG((DEBUG_INFO, "EnableParallelRendering: No MP services, drawing on the BSP only.\n"));
+    return EFI_UNSUPPORTED;
+  }
+
+  Status = MpServices->GetNumberOfProcessors(MpServices, &ProcessorCount, &EnabledProcessorCount);
+  if (EFI_ERROR(Status))
+  {
+    return Status;
+  }
+
+  if (EnabledProcessorCount < 2)
+  {
+    DEBUG((DEBUG_INFO, "EnableParallelRendering: No enabled application processors, drawing on the BSP only.\n"));
+    return EFI_UNSUPPORTED;
+  }
+
+  Renderer = AllocateZeroPool(sizeof(RENDERER));
+  if (Renderer == NULL)
+  {
+    return EFI_OUT_OF_RESOURCES;
+  }
+  Renderer->Data = Data;
+  Renderer->MpServices = MpServices;
+  Renderer->Workers = AllocateZeroPool(ProcessorCount * sizeof(RENDER_WORKER));
+  Renderer->CompletedLines = AllocateZeroPool((ProcessorCount + 1) * RENDER_CACHE_LINE_SIZE);
+  if ((Renderer->Workers == NULL) || (Renderer->CompletedLines == NULL))
+  {
+    FreeRenderer(Renderer);
+    return EFI_OUT_OF_RESOURCES;
+  }
+
+  // The procedure keeps running until DisableParallelRendering, or until the workers park after idling
+  Processor = 0;
+  while ((MaxApplicationProcessors == 0) || (Renderer->WorkerCount < MaxApplicationProcessors))
+  {
+    Worker = &Renderer->Workers[Renderer->WorkerCount];
+    Worker->Renderer = Renderer;
+    Worker->Index = Renderer->WorkerCount;
+    Worker->Completed = (volatile UINT32 *)ALIGN_POINTER(&Renderer->CompletedLines[Worker->Index * RENDER_CACHE_LINE_SIZE], RENDER_CACHE_LINE_SIZE);
+
+    Status = InternalStartApWorker(MpServices, Processor, &Worker->Worker, RenderWorker, Worker);
+    if (EFI_ERROR(Status))
+    {
+      break;
+    }
+
+    Renderer->WorkerCount++;
+    Processor = Worker->Worker.Processor + 1;
+  }
+
+  if (Renderer->WorkerCount == 0)
+  {
+    FreeRenderer(Renderer);
+    return EFI_UNSUPPORTED;
+  }
+
+  Data->Renderer = Renderer;
+  Data->RenderProcessors = Renderer->WorkerCount + 1;
+  DEBUG((DEBUG_INFO, "EnableParallelRendering: Drawing on %u processors.\n", Data->RenderProcessors));
+
+  return EFI_SUCCESS;
+}
+
+EFI_STATUS
+EFIAPI
+DisableParallelRendering(
+    IN GAME_GRAPHICS_LIB_DATA *Data)
+{
+  RENDERER *Renderer;
+
+  if (Data == NULL)
+  {
+    return EFI_INVALID_PARAMETER;
+  }
+
+  Renderer = (RENDERER *)Data->Renderer;
+  if (Renderer == NULL)
+  {
+    return EFI_SUCCESS;
+  }
+
+  WaitForRenderJobs(Data);
+
+  Renderer->Quit = TRUE;
+  MemoryFence();
+  Renderer->Generation++;
+
+  for (UINT32 i = 0; i < Renderer->WorkerCount; i++)
+  {
+    InternalStopApWorker(&Renderer->Workers[i].Worker);
+  }
+
+  FreeRenderer(Renderer);
+  Data->Renderer = NULL;
+  Data->RenderProcessors = 1;
+
+  return EFI_SUCCESS;
+}
+
+EFI_STATUS
+EFIAPI
+WaitForRenderJobs(
+    IN GAME_GRAPHICS_LIB_DATA *Data)
+{
+  RENDERER *Renderer;
+
+  if (Data == NULL)
+  {
+    return EFI_INVALID_PARAMETER;
+  }
+
+  Renderer = (RENDERER *)Data->Renderer;
+  if ((Renderer == NULL) || !Renderer->Busy)
+  {
+    return EFI_SUCCESS;
+  }
+
+  for (UINT32 i = 0; i < Renderer->WorkerCount; i++)
+  {
+    while (*Renderer->Workers[i].Completed != Renderer->Generation)
+    {
+      CpuPause();
+    }
+  }
+
+  MemoryFence();
+  Renderer->Busy = FALSE;
+
+  return EFI_SUCCESS;
+}
+
+VOID
+EFIAPI
+InternalStripRange(
+    IN UINT32 Units,
+    IN UINT32 Strip,
+    IN UINT32 StripCount,
+    OUT UINT32 *Begin,
+    OUT UINT32 *End)
+{
+  *Begin = (UINT32)DivU64x32(MultU64x32(Units, Strip), StripCount);
+  *End = (UINT32)DivU64x32(MultU64x32(Units, Strip + 1), StripCount);
+}
+
+UINT32
+EFIAPI
+InternalRenderStripCount(
+    IN GAME_GRAPHICS_LIB_DATA *Data,
+    IN UINT32 Units)
+{
+  RENDERER *Renderer = (RENDERER *)Data->Renderer;
+
+  if ((Renderer == NULL) || (Units < 2))
+  {
+    return 0;
+  }
+
+  return MIN(Units, Renderer->WorkerCount + 1);
+}
+
+BOOLEAN
+EFIAPI
+InternalRunStripJob(
+    IN GAME_GRAPHICS_LIB_DATA *Data,
+    IN INTERNAL_STRIP_FUNCTION Function,
+    IN CONST VOID *Context,
+    IN UINTN ContextSize,
+    IN UINT32 Units)
+{
+  RENDERER *Renderer = (RENDERER *)Data->Renderer;
+  RENDER_WORKER *Worker;
+
+  if ((InternalRenderStripCount(Data, Units) == 0) || (ContextSize > sizeof(Renderer->Context)))
+  {
+    return FALSE;
+  }
+
+  // Only one job is in flight, the next one may draw over the same pixels
+  WaitForRenderJobs(Data);
+
+  CopyMem(Renderer->Context, Context, ContextSize);
+  Renderer->Function = Function;
+  Renderer->StripCount = InternalRenderStripCount(Data, Units);
+  Renderer->Busy = TRUE;
+
+  // The job has to be visible before the workers see the new generation
+  MemoryFence();
+  Renderer->Generation++;
+
+  // Workers that parked after a long idle time may not be available again yet, their strips are drawn here
+  for (UINT32 i = 0; i < Renderer->WorkerCount; i++)
+  {
+    Worker = &Renderer->Workers[i];
+    if (!InternalResumeApWorker(Renderer->MpServices, &Worker->Worker, RenderWorker, Worker))
+    {
+      if (Worker->Index + 1 < Renderer->StripCount)
+      {
+        Function(Data, Renderer->Context, Worker->Index, Renderer->StripCount, gInternalFillSpan);
+      }
+      *Worker->Completed = Renderer->Generation;
+    }
+  }
+
+  Function(Data, Renderer->Context, Renderer->StripCount - 1, Renderer->StripCount, gInternalFillSpan);
+
+  return TRUE;
+}
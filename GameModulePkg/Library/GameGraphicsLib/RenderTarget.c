@@ -0,0 +1,334 @@
+#include <Library/DebugLib.h>
+#include <Uefi.h>
+#include <Protocol/GraphicsOutput.h>
+#include <Library/GameGraphicsLib.h>
+#include <Library/BaseLib.h>
+#include <Library/BaseMemoryLib.h>
+#include <Library/UefiBootServicesTableLib.h>
+#include "GameGraphicsLibInternal.h"
+
+// Source rows scaled into ScaledRows before each Blt, one Blt call per band instead of one per row
+#define SCALED_PRESENT_BAND_ROWS 8
+
+// Back buffer pixels converted to the framebuffer format, or expanded from palette indices, at a time before they are
+// scaled, see InternalPresentScaledDirect
+#define SCALED_CONVERT_CHUNK 64
+
+/// @brief Context of a scaled direct present split across the drawing processors
+typedef struct
+{
+    EFI_GRAPHICS_OUTPUT_BLT_PIXEL *Buffer;
+    GAME_GRAPHICS_LIB_RECTANGLE Rectangle; // Area of the back buffer, in back buffer pixels
+} PRESENT_SCALED_JOB;
+
+EFI_STATUS
+EFIAPI
+SetRenderResolution(
+    IN GAME_GRAPHICS_LIB_DATA *Data,
+    IN UINT32 Width,
+    IN UINT32 Height)
+{
+  EFI_STATUS Status;
+  EFI_GRAPHICS_OUTPUT_BLT_PIXEL *BackBuffer;
+  EFI_GRAPHICS_OUTPUT_BLT_PIXEL *ScaledRows = NULL;
+  EFI_GRAPHICS_OUTPUT_BLT_PIXEL Black = {0, 0, 0, 0};
+  UINTN SizeOfBackBuffer;
+  UINT32 Stride;
+  UINT32 Scale;
+
+  if (Data == NULL)
+  {
+    return EFI_INVALID_PARAMETER;
+  }
+
+  // The present processor reads the second back buffer, which would have to be replaced as well
+  if (Data->Presenter != NULL)
+  {
+    DEBUG((DEBUG_ERROR, "SetRenderResolution: Asynchronous present is enabled.\n"));
+    return EFI_ALREADY_STARTED;
+  }
+
+  // Layers have the pixel size of the back buffer and are placed in its coordinates
+  if (Data->Compositor != NULL)
+  {
+    DEBUG((DEBUG_ERROR, "SetRenderResolution: Layers exist.\n"));
+    return EFI_ALREADY_STARTED;
+  }
+
+  if ((Width == 0) || (Height == 0))
+  {
+    Width = Data->Output.HorizontalResolution;
+    Height = Data->Output.VerticalResolution;
+  }
+
+  Scale = MIN(Data->Output.HorizontalResolution / Width, Data->Output.VerticalResolution / Height);
+  if (Scale == 0)
+  {
+    DEBUG((DEBUG_ERROR, "SetRenderResolution: %ux%u does not fit the screen.\n", Width, Height));
+    return EFI_UNSUPPORTED;
+  }
+
+  InternalBackBufferLayout(Width, Height, Data->BackBufferPixelSize, &Stride, &SizeOfBackBuffer);
+  Status = InternalAllocateBackBuffer(SizeOfBackBuffer, &BackBuffer);
+  if (EFI_ERROR(Status))
+  {
+    DEBUG((DEBUG_ERROR, "SetRenderResolution: Failed to allocate BackBuffer: %r\n", Status));
+    return Status;
+  }
+
+  // Palette indices are expanded into the staging rows for Blt as well, even if they are not scaled
+  if ((Scale > 1) || (Data->Palette != NULL))
+  {
+    Status = gBS->AllocatePool(EfiBootServicesData,
+                               (UINTN)Width * Scale * SCALED_PRESENT_BAND_ROWS * Scale * sizeof(EFI_GRAPHICS_OUTPUT_BLT_PIXEL),
+                               (VOID **)&ScaledRows);
+    if (EFI_ERROR(Status))
+    {
+      DEBUG((DEBUG_ERROR, "SetRenderResolution: Failed to allocate the scaled rows: %r\n", Status));
+      InternalFreeBackBuffer(BackBuffer, SizeOfBackBuffer);
+      return Status;
+    }
+  }
+
+  // Render jobs still write into the old back buffer
+  WaitForRenderJobs(Data);
+  InternalFreeBackBuffer(Data->BackBuffer, Data->SizeOfBackBuffer);
+  if (Data->ScaledRows != NULL)
+  {
+    gBS->FreePool(Data->ScaledRows);
+  }
+
+  Data->BackBuffer = BackBuffer;
+  Data->BackBuffers[0] = BackBuffer;
+  Data->SizeOfBackBuffer = SizeOfBackBuffer;
+  Data->BackBufferStride = Stride;
+  Data->ScaledRows = ScaledRows;
+  Data->Screen.HorizontalResolution = Width;
+  Data->Screen.VerticalResolution = Height;
+  Data->Scale = Scale;
+  Data->OutputX = (Data->Output.HorizontalResolution - Width * Scale) / 2;
+  Data->OutputY = (Data->Output.VerticalResolution - Height * Scale) / 2;
+
+  // Damage is stored in back buffer pixels, the old list does not mean anything anymore
+  Data->Damage.Count = 0;
+
+  DEBUG((DEBUG_INFO, "SetRenderResolution: Rendering at %ux%u, scaled %u times at %u,%u.\n",
+         Width, Height, Scale, Data->OutputX, Data->OutputY));
+
+  // The borders are never presented, they are cleared once together with the rest of the screen
+  Status = Data->GraphicsOutput->Blt(Data->GraphicsOutput,
+                                     &Black,
+                                     EfiBltVideoFill,
+                                     0,
+                                     0,
+                                     0,
+                                     0,
+                                     Data->Output.HorizontalResolution,
+                                     Data->Output.VerticalResolution,
+                                     0);
+  if (EFI_ERROR(Status))
+  {
+    // The back buffer is already replaced, only the borders may still show the old screen
+    DEBUG((DEBUG_WARN, "SetRenderResolution: Failed to clear the screen: %r\n", Status));
+  }
+
+  return EFI_SUCCESS;
+}
+
+VOID
+EFIAPI
+InternalPresentScaledDirect(
+    IN GAME_GRAPHICS_LIB_DATA *Data,
+    IN EFI_GRAPHICS_OUTPUT_BLT_PIXEL *Buffer,
+    IN UINT32 x,
+    IN UINT32 y,
+    IN UINT32 Width,
+    IN UINT32 Height)
+{
+  INTERNAL_PALETTE *Palette = Data->Palette;
+  UINT32 Scale = Data->Scale;
+  UINT32 *Source;
+  UINT32 *Destination;
+  UINT32 Converted[SCALED_CONVERT_CHUNK];
+  UINT32 Count;
+
+  for (UINT32 Row = y; Row < y + Height; Row++)
+  {
+    Source = InternalBackBufferPixel(Data, Buffer, x, Row);
+    Destination = &Data->FrameBuffer[((UINTN)Data->OutputY + (UINTN)Row * Scale) * Data->PixelsPerScanLine +
+                                     Data->OutputX + (UINTN)x * Scale];
+
+    // Every scaled row is written from the back buffer again, reading it back from video memory would be slow
+    if ((Palette == NULL) && (Data->PixelFormat == PixelBlueGreenRedReserved8BitPerColor))
+    {
+      for (UINT32 Copy = 0; Copy < Scale; Copy++)
+      {
+        gInternalScaleSpan(&Destination[(UINTN)Copy * Data->PixelsPerScanLine], Source, Width, Scale);
+      }
+      continue;
+    }
+
+    // Other formats and palette indices are converted once per chunk of source pixels, the copies then scale the
+    // converted pixels
+    for (UINT32 i = 0; i < Width; i += Count)
+    {
+      Count = MIN(SCALED_CONVERT_CHUNK, Width - i);
+      if (Palette != NULL)
+      {
+        InternalExpandSpan8Generic(Converted, (UINT8 *)Source + i, Count, Palette->FrameBufferColors);
+      }
+      else
+      {
+        InternalConvertSpan32Generic(Converted, &Source[i], Count, &Data->PixelLayout);
+      }
+      for (UINT32 Copy = 0; Copy < Scale; Copy++)
+      {
+        gInternalScaleSpan(&Destination[(UINTN)Copy * Data->PixelsPerScanLine + (UINTN)i * Scale], Converted, Count, Scale);
+      }
+    }
+  }
+}
+
+/// @brief Presents one horizontal strip of a PRESENT_SCALED_JOB
+STATIC
+VOID
+EFIAPI
+PresentScaledStrip(
+    IN GAME_GRAPHICS_LIB_DATA *Data,
+    IN CONST VOID *Context,
+    IN UINT32 Strip,
+    IN UINT32 StripCount,
+    IN INTERNAL_FILL_SPAN FillSpan)
+{
+  CONST PRESENT_SCALED_JOB *Job = (CONST PRESENT_SCALED_JOB *)Context;
+  UINT32 Begin;
+  UINT32 End;
+
+  InternalStripRange(Job->Rectangle.Height, Strip, StripCount, &Begin, &End);
+  InternalPresentScaledDirect(Data, Job->Buffer, Job->Rectangle.x, Job->Rectangle.y + Begin, Job->Rectangle.Width, End - Begin);
+
+  // The BSP only fences its own streaming stores in InternalFinishPresent
+  InternalStreamFence();
+}
+
+/// @brief Writes one row of palette indices as colors, scaled up by Scale
+STATIC
+VOID
+ExpandAndScaleRow(
+    OUT UINT32 *Destination,
+    IN CONST UINT8 *Source,
+    IN UINT32 Width,
+    IN UINT32 Scale,
+    IN CONST UINT32 *Lookup)
+{
+  UINT32 Expanded[SCALED_CONVERT_CHUNK];
+  UINT32 Count;
+
+  if (Scale == 1)
+  {
+    InternalExpandSpan8Generic(Destination, Source, Width, Lookup);
+    return;
+  }
+
+  for (UINT32 i = 0; i < Width; i += Count)
+  {
+    Count = MIN(SCALED_CONVERT_CHUNK, Width - i);
+    InternalExpandSpan8Generic(Expanded, &Source[i], Count, Lookup);
+    gInternalScaleSpan(&Destination[(UINTN)i * Scale], Expanded, Count, Scale);
+  }
+}
+
+/// @brief Scales an already clipped area of the back buffer into the video buffer with Blt, a band of rows at a time
+STATIC
+EFI_STATUS
+PresentScaledBlt(
+    IN GAME_GRAPHICS_LIB_DATA *Data,
+    IN UINT32 x,
+    IN UINT32 y,
+    IN UINT32 Width,
+    IN UINT32 Height)
+{
+  EFI_STATUS Status;
+  INTERNAL_PALETTE *Palette = Data->Palette;
+  UINT32 Scale = Data->Scale;
+  UINTN RowPixels = (UINTN)Width * Scale;
+  UINT32 *Scaled;
+  VOID *Source;
+  UINT32 Rows;
+
+  for (UINT32 Band = 0; Band < Height; Band += Rows)
+  {
+    Rows = MIN(SCALED_PRESENT_BAND_ROWS, Height - Band);
+
+    Scaled = (UINT32 *)Data->ScaledRows;
+    for (UINT32 Row = 0; Row < Rows; Row++)
+    {
+      Source = InternalBackBufferPixel(Data, Data->BackBuffer, x, y + Band + Row);
+      if (Palette != NULL)
+      {
+        ExpandAndScaleRow(Scaled, Source, Width, Scale, Palette->Colors);
+      }
+      else
+      {
+        gInternalScaleSpan(Scaled, Source, Width, Scale);
+      }
+      for (UINT32 Copy = 1; Copy < Scale; Copy++)
+      {
+        CopyMem(&Scaled[Copy * RowPixels], Scaled, RowPixels * sizeof(UINT32));
+      }
+      Scaled += Scale * RowPixels;
+    }
+
+    Status = Data->GraphicsOutput->Blt(Data->GraphicsOutput,
+                                       Data->ScaledRows,
+                                       EfiBltBufferToVideo,
+                                       0,
+                                       0,
+                                       Data->OutputX + x * Scale,
+                                       Data->OutputY + (y + Band) * Scale,
+                                       RowPixels,
+                                       Rows * Scale,
+                                       RowPixels * sizeof(EFI_GRAPHICS_OUTPUT_BLT_PIXEL));
+    if (EFI_ERROR(Status))
+    {
+      return Status;
+    }
+  }
+
+  return EFI_SUCCESS;
+}
+
+EFI_STATUS
+EFIAPI
+InternalPresentScaled(
+    IN GAME_GRAPHICS_LIB_DATA *Data,
+    IN UINT32 x,
+    IN UINT32 y,
+    IN UINT32 Width,
+    IN UINT32 Height)
+{
+  PRESENT_SCALED_JOB Job;
+
+  if (Data->PresentMode != GameGraphicsPresentDirect)
+  {
+    return PresentScaledBlt(Data, x, y, Width, Height);
+  }
+
+  // Every source pixel turns into Scale * Scale framebuffer writes, large areas are worth splitting
+  if ((UINT64)Width * Height * Data->Scale * Data->Scale >= INTERNAL_RENDER_JOB_MIN_PIXELS)
+  {
+    Job.Buffer = Data->BackBuffer;
+    Job.Rectangle.x = x;
+    Job.Rectangle.y = y;
+    Job.Rectangle.Width = Width;
+    Job.Rectangle.Height = Height;
+    if (InternalRunStripJob(Data, PresentScaledStrip, &Job, sizeof(Job), Height))
+    {
+      WaitForRenderJobs(Data);
+      return EFI_SUCCESS;
+    }
+  }
+
+  InternalPresentScaledDirect(Data, Data->BackBuffer, x, y, Width, Height);
+  return EFI_SUCCESS;
+}
@@ -0,0 +1,225 @@
+#include <Library/DebugLib.h>
+#include <Uefi.h>
+#include <Protocol/GraphicsOutput.h>
+#include <Library/GameGraphicsLib.h>
+#include <Library/BaseMemoryLib.h>
+#include "GameGraphicsLibInternal.h"
+
+/// @brief Checks if two rectangles share at least one pixel
+STATIC
+BOOLEAN
+RectanglesIntersect(
+    IN GAME_GRAPHICS_LIB_RECTANGLE *First,
+    IN GAME_GRAPHICS_LIB_RECTANGLE *Second)
+{
+  return (First->x < Second->x + Second->Width) && (Second->x < First->x + First->Width) &&
+         (First->y < Second->y + Second->Height) && (Second->y < First->y + First->Height);
+}
+
+/// @brief Moves an area of a back buffer, the areas may overlap
+/// @note Rows are copied in the direction of the move, so no row is overwritten before it was copied
+STATIC
+VOID
+MoveBackBufferArea(
+    IN GAME_GRAPHICS_LIB_DATA *Data,
+    IN EFI_GRAPHICS_OUTPUT_BLT_PIXEL *Buffer,
+    IN GAME_GRAPHICS_LIB_RECTANGLE *Source,
+    IN UINT32 DestinationX,
+    IN UINT32 DestinationY)
+{
+  UINTN RowBytes = (UINTN)Source->Width * Data->BackBufferPixelSize;
+
+  if (DestinationY <= Source->y)
+  {
+    for (UINT32 Row = 0; Row < Source->Height; Row++)
+    {
+      CopyMem(InternalBackBufferPixel(Data, Buffer, DestinationX, DestinationY + Row),
+              InternalBackBufferPixel(Data, Buffer, Source->x, Source->y + Row),
+              RowBytes);
+    }
+  }
+  else
+  {
+    for (UINT32 Row = Source->Height; Row > 0; Row--)
+    {
+      CopyMem(InternalBackBufferPixel(Data, Buffer, DestinationX, DestinationY + Row - 1),
+              InternalBackBufferPixel(Data, Buffer, Source->x, Source->y + Row - 1),
+              RowBytes);
+    }
+  }
+}
+
+/// @brief Moves an area of the screen and of every back buffer, presenting damage the area holds first
+STATIC
+EFI_STATUS
+MoveScreenArea(
+    IN GAME_GRAPHICS_LIB_DATA *Data,
+    IN GAME_GRAPHICS_LIB_RECTANGLE *Source,
+    IN UINT32 DestinationX,
+    IN UINT32 DestinationY)
+{
+  EFI_STATUS Status;
+
+  // The screen has to show what the back buffer holds before it is moved, otherwise stale pixels would move along
+  for (UINT32 i = 0; i < Data->Damage.Count; i++)
+  {
+    if (RectanglesIntersect(&Data->Damage.Rectangles[i], Source))
+    {
+      Status = PresentDamage(Data);
+      if (EFI_ERROR(Status))
+      {
+        return Status;
+      }
+      break;
+    }
+  }
+  WaitForPresent(Data);
+
+  // The firmware moves the pixels within video memory, nothing has to be copied from the back buffer.
+  // The screen holds the back buffer scaled up by Scale, see SetRenderResolution
+  Status = Data->GraphicsOutput->Blt(Data->GraphicsOutput,
+                                     NULL,
+                                     EfiBltVideoToVideo,
+                                     Data->OutputX + Source->x * Data->Scale,
+                                     Data->OutputY + Source->y * Data->Scale,
+                                     Data->OutputX + DestinationX * Data->Scale,
+                                     Data->OutputY + DestinationY * Data->Scale,
+                                     Source->Width * Data->Scale,
+                                     Source->Height * Data->Scale,
+                                     0);
+  if (EFI_ERROR(Status))
+  {
+    DEBUG((DEBUG_ERROR, "ScrollRectangle: Blt failed: %r\n", Status));
+    return Status;
+  }
+
+  // Both back buffers hold the same picture outside of the damage, so both have to move
+  MoveBackBufferArea(Data, Data->BackBuffers[0], Source, DestinationX, DestinationY);
+  if (Data->BackBuffers[1] != NULL)
+  {
+    MoveBackBufferArea(Data, Data->BackBuffers[1], Source, DestinationX, DestinationY);
+  }
+
+  return EFI_SUCCESS;
+}
+
+EFI_STATUS
+EFIAPI
+ScrollRectangle(
+    IN GAME_GRAPHICS_LIB_DATA *Data,
+    IN INT32 x,
+    IN INT32 y,
+    IN INT32 HorizontalSize,
+    IN INT32 VerticalSize,
+    IN INT32 DeltaX,
+    IN INT32 DeltaY,
+    OUT GAME_GRAPHICS_LIB_RECTANGLE *Exposed OPTIONAL,
+    OUT UINTN *ExposedCount OPTIONAL)
+{
+  EFI_STATUS Status;
+  GAME_GRAPHICS_LIB_RECTANGLE View;
+  GAME_GRAPHICS_LIB_RECTANGLE Source;
+  GAME_GRAPHICS_LIB_RECTANGLE Destination;
+  GAME_GRAPHICS_LIB_RECTANGLE Strips[GAME_GRAPHICS_LIB_MAX_SCROLL_EXPOSED];
+  UINT32 DistanceX;
+  UINT32 DistanceY;
+  UINT32 DestinationX;
+  UINT32 DestinationY;
+  UINTN Count = 0;
+
+  if ((Data == NULL) || (DeltaX == MIN_INT32) || (DeltaY == MIN_INT32))
+  {
+    return EFI_INVALID_PARAMETER;
+  }
+
+  if (ExposedCount != NULL)
+  {
+    *ExposedCount = 0;
+  }
+
+  // The next composite would bring back what the layers hold, only the layers themselves can scroll
+  if ((Data->Compositor != NULL) && !InternalDrawingLayer(Data))
+  {
+    DEBUG((DEBUG_ERROR, "ScrollRectangle: Layers exist, scroll within a layer instead.\n"));
+    return EFI_UNSUPPORTED;
+  }
+
+  // Pixels outside of the screen are not stored anywhere, so they can not be moved into the view
+  if (!InternalClipRectangle(Data, x, y, HorizontalSize, VerticalSize, &View) || ((DeltaX == 0) && (DeltaY == 0)))
+  {
+    return EFI_SUCCESS;
+  }
+
+  DistanceX = (UINT32)ABS(DeltaX);
+  DistanceY = (UINT32)ABS(DeltaY);
+  if ((DistanceX >= View.Width) || (DistanceY >= View.Height))
+  {
+    // Nothing of the old content stays visible, the whole view has to be drawn again
+    if (Exposed != NULL)
+    {
+      Exposed[0] = View;
+    }
+    if (ExposedCount != NULL)
+    {
+      *ExposedCount = 1;
+    }
+    return EFI_SUCCESS;
+  }
+
+  Source.x = View.x + ((DeltaX < 0) ? DistanceX : 0);
+  Source.y = View.y + ((DeltaY < 0) ? DistanceY : 0);
+  Source.Width = View.Width - DistanceX;
+  Source.Height = View.Height - DistanceY;
+  DestinationX = View.x + ((DeltaX > 0) ? DistanceX : 0);
+  DestinationY = View.y + ((DeltaY > 0) ? DistanceY : 0);
+
+  WaitForRenderJobs(Data);
+
+  // The layer is composited with the ones above and below it, so the screen can not be moved along
+  if (InternalDrawingLayer(Data))
+  {
+    MoveBackBufferArea(Data, Data->BackBuffer, &Source, DestinationX, DestinationY);
+    Destination.x = DestinationX;
+    Destination.y = DestinationY;
+    Destination.Width = Source.Width;
+    Destination.Height = Source.Height;
+    InternalAddDamage(Data, &Destination);
+  }
+  else
+  {
+    Status = MoveScreenArea(Data, &Source, DestinationX, DestinationY);
+    if (EFI_ERROR(Status))
+    {
+      return Status;
+    }
+  }
+
+  // The rows the content moved away from, then the columns next to it
+  if (DistanceY != 0)
+  {
+    Strips[Count].x = View.x;
+    Strips[Count].y = (DeltaY > 0) ? View.y : View.y + Source.Height;
+    Strips[Count].Width = View.Width;
+    Strips[Count].Height = DistanceY;
+    Count++;
+  }
+  if (DistanceX != 0)
+  {
+    Strips[Count].x = (DeltaX > 0) ? View.x : View.x + Source.Width;
+    Strips[Count].y = DestinationY;
+    Strips[Count].Width = DistanceX;
+    Strips[Count].Height = Source.Height;
+    Count++;
+  }
+
+  if (Exposed != NULL)
+  {
+    CopyMem(Exposed, Strips, Count * sizeof(GAME_GRAPHICS_LIB_RECTANGLE));
+  }
+  if (ExposedCount != NULL)
+  {
+    *ExposedCount = Count;
+  }
+
+  return EFI_SUCCESS;
+}
@@ -0,0 +1,444 @@
+#include <Library/DebugLib.h>
+#include <Uefi.h>
+#include <Library/GameGraphicsLib.h>
+#include <Library/Font8x8.h>
+#include <Library/BaseMemoryLib.h>
+#include <Library/MemoryAllocationLib.h>
+#include "GameGraphicsLibInternal.h"
+
+#define GLYPH_CACHE_BUCKETS 64
+#define GLYPH_CACHE_ENTRIES 256
+
+/// @brief Rasterized character for one combination of scale, colors and back buffer pixel size
+typedef struct _GLYPH_CACHE_ENTRY
+{
+    struct _GLYPH_CACHE_ENTRY *Next; // Next entry in the same hash bucket
+    UINT8 *Pixels;                   // (8 * Scale) x (8 * Scale) pixels, ready to be copied row by row
+    UINTN PixelBytes;                // Size of Pixels in bytes
+    UINT64 LastUse;                  // Value of the cache clock when the entry was last drawn, used for eviction
+    UINT32 Foreground;               // Pixel values, colors or palette indices, see InternalPixelValue
+    UINT32 Background;
+    UINT32 Scale;
+    UINT32 PixelSize;                // Bytes per pixel, palette glyphs are a quarter of the size
+    UINT8 Character;
+    BOOLEAN InUse;
+} GLYPH_CACHE_ENTRY;
+
+/// @brief Glyph cache stored behind GAME_GRAPHICS_LIB_DATA.GlyphCache
+typedef struct
+{
+    GLYPH_CACHE_ENTRY *Buckets[GLYPH_CACHE_BUCKETS];
+    GLYPH_CACHE_ENTRY Entries[GLYPH_CACHE_ENTRIES];
+    UINTN UsedBytes;                  // Sum of PixelBytes of all entries in use
+    UINTN BudgetBytes;                // Limit of UsedBytes, see SetGlyphCacheBudget
+    UINT64 Clock;                     // Incremented on every lookup
+} GLYPH_CACHE;
+
+// All ones for every set bit of a font row byte, zero otherwise. Built by InternalCreateGlyphCache
+STATIC UINT32 mBitMasks[256][FONT_HORIZONTAL_SIZE];
+
+STATIC
+UINTN
+GlyphHash(
+    IN UINT8 Character,
+    IN UINT32 Scale,
+    IN UINT32 Foreground,
+    IN UINT32 Background)
+{
+  UINT32 Hash;
+
+  Hash = Character * 0x9E3779B1u;
+  Hash ^= Scale * 0x85EBCA6Bu;
+  Hash ^= Foreground * 0xC2B2AE35u;
+  Hash ^= (Background * 0x27D4EB2Fu) >> 7;
+  return (Hash ^ (Hash >> 16)) & (GLYPH_CACHE_BUCKETS - 1);
+}
+
+/// @brief Expands one character into a pixel buffer
+/// @details
+/// Every font row byte is turned into 8 pixels with the mBitMasks table, instead of testing bit by bit,
+/// the row is widened by the scale and then copied Scale - 1 times below itself.
+/// @param PixelSize Bytes per pixel, 4 for colors or 1 for palette indices
+STATIC
+VOID
+RasterizeGlyph(
+    IN UINT8 Character,
+    IN UINT32 Scale,
+    IN UINT32 Foreground,
+    IN UINT32 Background,
+    IN UINT32 PixelSize,
+    OUT UINT8 *Pixels)
+{
+  UINT32 Width = FONT_HORIZONTAL_SIZE * Scale;
+  UINTN RowBytes = (UINTN)Width * PixelSize;
+  UINT32 Difference = Foreground ^ Background;
+  UINT8 *Row = Pixels;
+  UINT32 *Mask;
+  UINT32 Pixel;
+
+  for (UINTN BitmapRow = 0; BitmapRow < FONT_VERTICAL_SIZE; BitmapRow++)
+  {
+    Mask = mBitMasks[(UINT8)gFont8x8_basic[Character][BitmapRow]];
+    for (UINTN BitmapColumn = 0; BitmapColumn < FONT_HORIZONTAL_SIZE; BitmapColumn++)
+    {
+      Pixel = Background ^ (Difference & Mask[BitmapColumn]);
+      if (PixelSize == sizeof(UINT32))
+      {
+        for (UINT32 i = 0; i < Scale; i++)
+        {
+          ((UINT32 *)Row)[BitmapColumn * Scale + i] = Pixel;
+        }
+      }
+      else
+      {
+        SetMem(&Row[BitmapColumn * Scale], Scale, (UINT8)Pixel);
+      }
+    }
+
+    for (UINT32 i = 1; i < Scale; i++)
+    {
+      CopyMem(Row + i * RowBytes, Row, RowBytes);
+    }
+    Row += RowBytes * Scale;
+  }
+}
+
+/// @brief Removes an entry from its bucket and frees its pixels
+STATIC
+VOID
+EvictGlyph(
+    IN GLYPH_CACHE *Cache,
+    IN GLYPH_CACHE_ENTRY *Entry)
+{
+  GLYPH_CACHE_ENTRY **Link;
+
+  Link = &Cache->Buckets[GlyphHash(Entry->Character, Entry->Scale, Entry->Foreground, Entry->Background)];
+  while (*Link != Entry)
+  {
+    Link = &(*Link)->Next;
+  }
+  *Link = Entry->Next;
+
+  FreePool(Entry->Pixels);
+  Cache->UsedBytes -= Entry->PixelBytes;
+  Entry->Pixels = NULL;
+  Entry->Next = NULL;
+  Entry->InUse = FALSE;
+}
+
+/// @brief Evicts least recently used entries until Bytes more fit into the budget and a free entry exists
+/// @return A free entry
+STATIC
+GLYPH_CACHE_ENTRY *
+MakeRoom(
+    IN GLYPH_CACHE *Cache,
+    IN UINTN Bytes)
+{
+  GLYPH_CACHE_ENTRY *Free;
+  GLYPH_CACHE_ENTRY *Oldest;
+
+  while (TRUE)
+  {
+    Free = NULL;
+    Oldest = NULL;
+    for (UINTN i = 0; i < GLYPH_CACHE_ENTRIES; i++)
+    {
+      if (!Cache->Entries[i].InUse)
+      {
+        Free = (Free == NULL) ? &Cache->Entries[i] : Free;
+      }
+      else if ((Oldest == NULL) || (Cache->Entries[i].LastUse < Oldest->LastUse))
+      {
+        Oldest = &Cache->Entries[i];
+      }
+    }
+
+    if ((Free != NULL) && (Cache->UsedBytes + Bytes <= Cache->BudgetBytes))
+    {
+      return Free;
+    }
+
+    EvictGlyph(Cache, Oldest);
+  }
+}
+
+/// @brief Finds a rasterized glyph in the cache, rasterizing and inserting it if it is missing
+/// @return Pixels of the glyph, or NULL if the glyph does not fit into the cache
+STATIC
+UINT8 *
+LookupGlyph(
+    IN GLYPH_CACHE *Cache,
+    IN UINT8 Character,
+    IN UINT32 Scale,
+    IN UINT32 Foreground,
+    IN UINT32 Background,
+    IN UINT32 PixelSize)
+{
+  GLYPH_CACHE_ENTRY *Entry;
+  UINTN Bucket;
+  UINTN Bytes;
+
+  Cache->Clock++;
+  Bucket = GlyphHash(Character, Scale, Foreground, Background);
+  for (Entry = Cache->Buckets[Bucket]; Entry != NULL; Entry = Entry->Next)
+  {
+    if ((Entry->Character == Character) &&
+        (Entry->Scale == Scale) &&
+        (Entry->Foreground == Foreground) &&
+        (Entry->Background == Background) &&
+        (Entry->PixelSize == PixelSize))
+    {
+      Entry->LastUse = Cache->Clock;
+      return Entry->Pixels;
+    }
+  }
+
+  Bytes = FONT_HORIZONTAL_SIZE * FONT_VERTICAL_SIZE * Scale * Scale * PixelSize;
+  if (Bytes > Cache->BudgetBytes)
+  {
+    return NULL;
+  }
+
+  Entry = MakeRoom(Cache, Bytes);
+  Entry->Pixels = AllocatePool(Bytes);
+  if (Entry->Pixels == NULL)
+  {
+    return NULL;
+  }
+
+  RasterizeGlyph(Character, Scale, Foreground, Background, PixelSize, Entry->Pixels);
+  Entry->PixelBytes = Bytes;
+  Entry->LastUse = Cache->Clock;
+  Entry->Foreground = Foreground;
+  Entry->Background = Background;
+  Entry->Scale = Scale;
+  Entry->PixelSize = PixelSize;
+  Entry->Character = Character;
+  Entry->InUse = TRUE;
+  Entry->Next = Cache->Buckets[Bucket];
+  Cache->Buckets[Bucket] = Entry;
+  Cache->UsedBytes += Bytes;
+
+  return Entry->Pixels;
+}
+
+EFI_STATUS
+EFIAPI
+InternalCreateGlyphCache(
+    IN OUT GAME_GRAPHICS_LIB_DATA *Data)
+{
+  GLYPH_CACHE *Cache;
+
+  // The expansion table is needed even without a cache, for rasterizing characters on every draw
+  for (UINTN Byte = 0; Byte < 256; Byte++)
+  {
+    for (UINTN Bit = 0; Bit < FONT_HORIZONTAL_SIZE; Bit++)
+    {
+      mBitMasks[Byte][Bit] = ((Byte >> Bit) & 0x1) ? MAX_UINT32 : 0;
+    }
+  }
+
+  Cache = AllocateZeroPool(sizeof(GLYPH_CACHE));
+  if (Cache == NULL)
+  {
+    Data->GlyphCache = NULL;
+    return EFI_OUT_OF_RESOURCES;
+  }
+
+  Cache->BudgetBytes = GAME_GRAPHICS_LIB_DEFAULT_GLYPH_CACHE_BUDGET;
+  Data->GlyphCache = Cache;
+  return EFI_SUCCESS;
+}
+
+VOID
+EFIAPI
+InternalDestroyGlyphCache(
+    IN OUT GAME_GRAPHICS_LIB_DATA *Data)
+{
+  GLYPH_CACHE *Cache = Data->GlyphCache;
+
+  if (Cache == NULL)
+  {
+    return;
+  }
+
+  for (UINTN i = 0; i < GLYPH_CACHE_ENTRIES; i++)
+  {
+    if (Cache->Entries[i].InUse)
+    {
+      FreePool(Cache->Entries[i].Pixels);
+    }
+  }
+
+  FreePool(Cache);
+  Data->GlyphCache = NULL;
+}
+
+EFI_STATUS
+EFIAPI
+SetGlyphCacheBudget(
+    IN GAME_GRAPHICS_LIB_DATA *Data,
+    IN UINTN BudgetBytes)
+{
+  GLYPH_CACHE *Cache;
+
+  if ((Data == NULL) || (Data->GlyphCache == NULL))
+  {
+    return EFI_INVALID_PARAMETER;
+  }
+
+  Cache = Data->GlyphCache;
+  Cache->BudgetBytes = BudgetBytes;
+  for (UINTN i = 0; (i < GLYPH_CACHE_ENTRIES) && (Cache->UsedBytes > BudgetBytes); i++)
+  {
+    if (Cache->Entries[i].InUse)
+    {
+      EvictGlyph(Cache, &Cache->Entries[i]);
+    }
+  }
+
+  return EFI_SUCCESS;
+}
+
+EFI_STATUS
+EFIAPI
+DrawCharacter(
+    IN GAME_GRAPHICS_LIB_DATA *Data,
+    IN UINT32 x,
+    IN UINT32 y,
+    IN CHAR8 Character,
+    IN EFI_GRAPHICS_OUTPUT_BLT_PIXEL *ForegroundColor,
+    IN EFI_GRAPHICS_OUTPUT_BLT_PIXEL *BackgroundColor,
+    IN UINT32 SizeMultipiler)
+{
+  UINTN CurrentCharacter = (UINT8)Character;
+  UINT32 GlyphSize;
+  GAME_GRAPHICS_LIB_RECTANGLE Visible;
+  UINT32 Foreground;
+  UINT32 Background;
+  UINT32 PixelSize;
+  UINT8 *Glyph;
+  UINT8 *Uncached = NULL;
+  UINT8 *Source;
+  UINT8 *Destination;
+
+  if ((Data == NULL) || (ForegroundColor == NULL) || (BackgroundColor == NULL) || (SizeMultipiler == 0))
+  {
+    return EFI_INVALID_PARAMETER;
+  }
+
+  if (CurrentCharacter >= FONT_CHARACTER_COUNT)
+  {
+    DEBUG((DEBUG_ERROR, "DrawCharacter: Invalid character. \n"));
+    return EFI_INVALID_PARAMETER;
+  }
+
+  // A character starting past the right or bottom edge is clipped away entirely
+  if (x >= Data->Screen.HorizontalResolution ||
+      y >= Data->Screen.VerticalResolution)
+  {
+    return EFI_SUCCESS;
+  }
+
+  // The glyph is clipped at the right and bottom edges of the screen, the visible part is still drawn
+  GlyphSize = FONT_HORIZONTAL_SIZE * SizeMultipiler;
+  Visible.x = x;
+  Visible.y = y;
+  Visible.Width = MIN(GlyphSize, Data->Screen.HorizontalResolution - x);
+  Visible.Height = MIN(GlyphSize, Data->Screen.VerticalResolution - y);
+
+  // Glyphs are rasterized in the format of the back buffer, with palette indices instead of colors if it has a palette
+  Foreground = InternalPixelValue(Data, ForegroundColor);
+  Background = InternalPixelValue(Data, BackgroundColor);
+  PixelSize = Data->BackBufferPixelSize;
+
+  Glyph = NULL;
+  if (Data->GlyphCache != NULL)
+  {
+    Glyph = LookupGlyph(Data->GlyphCache,
+                        (UINT8)CurrentCharacter,
+                        SizeMultipiler,
+                        Foreground,
+                        Background,
+                        PixelSize);
+  }
+
+  // Glyphs too big for the cache, or drawn without a cache, are rasterized into a temporary buffer
+  if (Glyph == NULL)
+  {
+    Uncached = AllocatePool(GlyphSize * GlyphSize * PixelSize);
+    if (Uncached == NULL)
+    {
+      return EFI_OUT_OF_RESOURCES;
+    }
+    RasterizeGlyph((UINT8)CurrentCharacter,
+                   SizeMultipiler,
+                   Foreground,
+                   Background,
+                   PixelSize,
+                   Uncached);
+    Glyph = Uncached;
+  }
+
+  // Application processors may still be drawing below the character
+  WaitForRenderJobs(Data);
+
+  Source = Glyph;
+  Destination = InternalBackBufferPixel(Data, Data->BackBuffer, x, y);
+  for (UINT32 Row = 0; Row < Visible.Height; Row++)
+  {
+    CopyMem(Destination, Source, Visible.Width * PixelSize);
+    Source += GlyphSize * PixelSize;
+    Destination += (UINTN)Data->BackBufferStride * PixelSize;
+  }
+
+  if (Uncached != NULL)
+  {
+    FreePool(Uncached);
+  }
+
+  InternalAddDamage(Data, &Visible);
+
+  return EFI_SUCCESS;
+}
+
+EFI_STATUS
+EFIAPI
+DrawText(
+    IN GAME_GRAPHICS_LIB_DATA *Data,
+    IN UINT32 x,
+    IN UINT32 y,
+    IN CHAR8 *Text,
+    IN EFI_GRAPHICS_OUTPUT_BLT_PIXEL *ForegroundColor,
+    IN EFI_GRAPHICS_OUTPUT_BLT_PIXEL *BackgroundColor,
+    IN UINT32 SizeMultipiler)
+{
+  EFI_STATUS Status;
+  UINTN PosX = x;
+  UINTN PosY = y;
+
+  if ((Data == NULL) || (Text == NULL))
+  {
+    return EFI_INVALID_PARAMETER;
+  }
+
+  // The rest of the text is clipped once it runs past the right edge
+  while ((*Text != '\0') && (PosX < Data->Screen.HorizontalResolution))
+  {
+    Status = DrawCharacter(Data,
+                           PosX, PosY,
+                           *Text,
+                           ForegroundColor,
+                           BackgroundColor,
+                           SizeMultipiler);
+    if (EFI_ERROR(Status))
+    {
+      DEBUG((DEBUG_ERROR, "DrawText: DrawCharacter failed: %r\n", Status));
+      return Status;
+    }
+    PosX += FONT_HORIZONTAL_SIZE * SizeMultipiler;
+    Text++;
+  }
+
+  return EFI_SUCCESS;
+}
\ No newline at end of file
@@ -0,0 +1,473 @@
+/** @file
+  Host based benchmarks of GameGraphicsLib.
+
+  Runs the workloads of the GraphicsLibBench application against the mock Graphics Output Protocol,
+  so changes to the rendering kernels can be measured without booting firmware. The results are
+  printed as CSV in the same format as GraphicsLibBench.csv. The mock Blt copies with a plain loop,
+  so the present numbers only compare changes to the library, not to real firmware.
+
+  Usage: GameGraphicsLibBenchHost [iterations] [width] [height]
+
+**/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include <Uefi.h>
+#include <Library/BaseLib.h>
+#include <Library/DebugLib.h>
+#include <Library/GameGraphicsLib.h>
+#include "MockGraphicsOutput.h"
+
+#define BENCH_DEFAULT_ITERATIONS 1000
+#define BENCH_DEFAULT_WIDTH 1280
+#define BENCH_DEFAULT_HEIGHT 800
+#define BENCH_TEXT "Sphinx of quartz"
+
+/// @brief State shared by all workloads
+typedef struct
+{
+  GAME_GRAPHICS_LIB_DATA Data;
+  UINT32 Iterations;
+} BENCH_CONTEXT;
+
+/// @brief Reads the monotonic clock of the host
+/// @return Nanoseconds since an arbitrary point in time
+STATIC
+UINT64
+ReadNanoseconds(
+    VOID)
+{
+  struct timespec Now;
+
+  clock_gettime(CLOCK_MONOTONIC, &Now);
+  return (UINT64)Now.tv_sec * 1000000000 + Now.tv_nsec;
+}
+
+/// @brief Returns the next value of a linear congruential generator, good enough to pick benchmark cells
+STATIC
+UINT32
+NextRandom(
+    IN OUT UINT32 *State)
+{
+  *State = *State * 1664525 + 1013904223;
+  return *State >> 8;
+}
+
+/// @brief Prints the result of a workload as a CSV line
+STATIC
+VOID
+ReportResult(
+    IN CONST CHAR8 *Workload,
+    IN CONST CHAR8 *Parameters,
+    IN UINT64 Operations,
+    IN UINT64 Pixels,
+    IN UINT64 BltBytes,
+    IN UINT64 Nanoseconds)
+{
+  Nanoseconds = MAX(Nanoseconds, 1);
+
+  // Pixels and bytes per nanosecond times 1000 are millions per second
+  printf("%s,%s,%llu,%llu,%llu,%llu\n",
+         Workload,
+         Parameters,
+         (unsigned long long)Operations,
+         (unsigned long long)(Nanoseconds / Operations),
+         (unsigned long long)(Pixels * 1000 / Nanoseconds),
+         (unsigned long long)(BltBytes * 1000 / Nanoseconds));
+}
+
+/// @brief Measures DrawRectangle for square sizes from a single pixel to larger than the screen
+STATIC
+VOID
+BenchmarkDrawRectangle(
+    IN BENCH_CONTEXT *Bench)
+{
+  GAME_GRAPHICS_LIB_DATA *Data = &Bench->Data;
+  EFI_GRAPHICS_OUTPUT_BLT_PIXEL Color = {32, 64, 128, 0};
+  UINT32 Sizes[] = {1, 8, 64, 256, 1024};
+  CHAR8 Parameters[32];
+  UINT64 Start;
+  UINT64 Nanoseconds;
+  UINT64 Pixels;
+
+  for (UINTN i = 0; i < ARRAY_SIZE(Sizes); i++)
+  {
+    Start = ReadNanoseconds();
+    for (UINT32 j = 0; j < Bench->Iterations; j++)
+    {
+      Color.Blue = (UINT8)j;
+      DrawRectangle(Data, 0, 0, Sizes[i], Sizes[i], &Color);
+    }
+    Nanoseconds = ReadNanoseconds() - Start;
+
+    Pixels = (UINT64)MIN(Sizes[i], Data->Screen.HorizontalResolution) * MIN(Sizes[i], Data->Screen.VerticalResolution) * Bench->Iterations;
+    snprintf(Parameters, sizeof(Parameters), "%ux%u", Sizes[i], Sizes[i]);
+    ReportResult("DrawRectangle", Parameters, Bench->Iterations, Pixels, 0, Nanoseconds);
+  }
+
+  UpdateVideoBuffer(Data);
+}
+
+/// @brief Measures ClearScreen
+STATIC
+VOID
+BenchmarkClearScreen(
+    IN BENCH_CONTEXT *Bench)
+{
+  GAME_GRAPHICS_LIB_DATA *Data = &Bench->Data;
+  UINT64 Start;
+  UINT64 Nanoseconds;
+  UINT64 Pixels;
+
+  Start = ReadNanoseconds();
+  for (UINT32 j = 0; j < Bench->Iterations; j++)
+  {
+    ClearScreen(Data);
+  }
+  Nanoseconds = ReadNanoseconds() - Start;
+
+  Pixels = (UINT64)Data->Screen.HorizontalResolution * Data->Screen.VerticalResolution * Bench->Iterations;
+  ReportResult("ClearScreen", "full", Bench->Iterations, Pixels, 0, Nanoseconds);
+
+  UpdateVideoBuffer(Data);
+}
+
+/// @brief Measures DrawText for every size multiplier used by the applications
+STATIC
+VOID
+BenchmarkDrawText(
+    IN BENCH_CONTEXT *Bench)
+{
+  GAME_GRAPHICS_LIB_DATA *Data = &Bench->Data;
+  EFI_GRAPHICS_OUTPUT_BLT_PIXEL White = {255, 255, 255, 0};
+  EFI_GRAPHICS_OUTPUT_BLT_PIXEL Black = {0, 0, 0, 0};
+  UINT32 Scales[] = {1, 2, 4};
+  UINT32 Length = sizeof(BENCH_TEXT) - 1;
+  CHAR8 Parameters[32];
+  UINT64 Start;
+  UINT64 Nanoseconds;
+  UINT64 Pixels;
+
+  for (UINTN i = 0; i < ARRAY_SIZE(Scales); i++)
+  {
+    // The first call fills the glyph cache, the measured calls are the steady state of a game
+    DrawText(Data, 0, 0, BENCH_TEXT, &White, &Black, Scales[i]);
+
+    Start = ReadNanoseconds();
+    for (UINT32 j = 0; j < Bench->Iterations; j++)
+    {
+      DrawText(Data, 0, 0, BENCH_TEXT, &White, &Black, Scales[i]);
+    }
+    Nanoseconds = ReadNanoseconds() - Start;
+
+    Pixels = (UINT64)MIN(Length * 8 * Scales[i], Data->Screen.HorizontalResolution) * MIN(8 * Scales[i], Data->Screen.VerticalResolution) * Bench->Iterations;
+    snprintf(Parameters, sizeof(Parameters), "%u chars scale %u", Length, Scales[i]);
+    ReportResult("DrawText", Parameters, Bench->Iterations, Pixels, 0, Nanoseconds);
+  }
+
+  UpdateVideoBuffer(Data);
+}
+
+/// @brief Measures DrawGrid for several grid sizes with a small, a medium and a full fraction of the cells changing every frame
+STATIC
+VOID
+BenchmarkDrawGrid(
+    IN BENCH_CONTEXT *Bench)
+{
+  GAME_GRAPHICS_LIB_DATA *Data = &Bench->Data;
+  GAME_GRAPHICS_LIB_GRID Grid;
+  EFI_GRAPHICS_OUTPUT_BLT_PIXEL Color = {0, 0, 0, 0};
+  UINT32 GridSizes[][2] = {{60, 50}, {200, 150}, {1000, 1000}};
+  UINT32 ChurnPercent[] = {1, 10, 100};
+  UINT32 Cells;
+  UINT32 Changes;
+  UINT32 Random = 1;
+  CHAR8 Parameters[32];
+  UINT64 ScreenPixels;
+  UINT64 Start;
+  UINT64 Nanoseconds;
+  UINT64 Repainted;
+  UINTN RepaintedCells;
+
+  ScreenPixels = (UINT64)Data->Screen.HorizontalResolution * Data->Screen.VerticalResolution;
+
+  for (UINTN i = 0; i < ARRAY_SIZE(GridSizes); i++)
+  {
+    if (EFI_ERROR(CreateCustomGrid(&Grid, Data->Screen.HorizontalResolution, Data->Screen.VerticalResolution, GridSizes[i][0], GridSizes[i][1], NULL)))
+    {
+      fprintf(stderr, "Failed to create a %ux%u grid\n", GridSizes[i][0], GridSizes[i][1]);
+      continue;
+    }
+
+    Cells = GridSizes[i][0] * GridSizes[i][1];
+    DrawGrid(Data, &Grid, 0, 0);
+
+    for (UINTN j = 0; j < ARRAY_SIZE(ChurnPercent); j++)
+    {
+      Changes = MAX(Cells / 100 * ChurnPercent[j], 1);
+      Nanoseconds = 0;
+      Repainted = 0;
+
+      for (UINT32 Frame = 0; Frame < Bench->Iterations; Frame++)
+      {
+        Color.Green = (UINT8)Frame;
+        for (UINT32 k = 0; k < Changes; k++)
+        {
+          FillCellInGrid(&Grid, NextRandom(&Random) % GridSizes[i][0], NextRandom(&Random) % GridSizes[i][1], &Color);
+        }
+
+        Start = ReadNanoseconds();
+        DrawGridEx(Data, &Grid, 0, 0, NULL, 0, &RepaintedCells);
+        Nanoseconds += ReadNanoseconds() - Start;
+        Repainted += RepaintedCells;
+      }
+
+      snprintf(Parameters, sizeof(Parameters), "%ux%u churn %u%%", GridSizes[i][0], GridSizes[i][1], ChurnPercent[j]);
+      ReportResult("DrawGrid", Parameters, Bench->Iterations, Repainted * ScreenPixels / Cells, 0, Nanoseconds);
+    }
+
+    DeleteGrid(&Grid);
+    UpdateVideoBuffer(Data);
+  }
+}
+
+/// @brief Measures moving a 600x600 grid, redrawing it at the new position compared to scrolling it on screen
+STATIC
+VOID
+BenchmarkMoveGrid(
+    IN BENCH_CONTEXT *Bench)
+{
+  GAME_GRAPHICS_LIB_DATA *Data = &Bench->Data;
+  GAME_GRAPHICS_LIB_GRID Grid;
+  GAME_GRAPHICS_LIB_RECTANGLE Exposed[GAME_GRAPHICS_LIB_MAX_SCROLL_EXPOSED];
+  EFI_GRAPHICS_OUTPUT_BLT_PIXEL Red = {0, 0, 255, 0};
+  EFI_GRAPHICS_OUTPUT_BLT_PIXEL Black = {0, 0, 0, 0};
+  UINTN ExposedCount;
+  INT32 x;
+  INT32 y;
+  INT32 PreviousX;
+  INT32 PreviousY;
+  UINT64 Start;
+  UINT64 Nanoseconds;
+
+  if (EFI_ERROR(CreateCustomGrid(&Grid, 600, 600, 21, 21, NULL)))
+  {
+    fprintf(stderr, "Failed to create the moving grid\n");
+    return;
+  }
+
+  for (UINT32 i = 0; i < Grid.VerticalCellsCount; i++)
+  {
+    for (UINT32 j = 0; j < Grid.HorizontalCellsCount; j++)
+    {
+      if ((i + j) % 2 == 0)
+      {
+        FillCellInGrid(&Grid, i, j, &Red);
+      }
+    }
+  }
+
+  for (UINT32 Scroll = 0; Scroll < 2; Scroll++)
+  {
+    ClearScreen(Data);
+    DrawGrid(Data, &Grid, 0, 0);
+    UpdateVideoBuffer(Data);
+    PreviousX = 0;
+    PreviousY = 0;
+
+    ResetPresentStats(Data);
+    Start = ReadNanoseconds();
+    for (UINT32 Frame = 1; Frame <= Bench->Iterations; Frame++)
+    {
+      x = (Frame * 12) % 240;
+      y = (Frame * 6) % 120;
+
+      if (Scroll == 1)
+      {
+        ScrollRectangle(Data, MIN(x, PreviousX), MIN(y, PreviousY), 600 + ABS(x - PreviousX), 600 + ABS(y - PreviousY),
+                        x - PreviousX, y - PreviousY, Exposed, &ExposedCount);
+        for (UINTN i = 0; i < ExposedCount; i++)
+        {
+          DrawRectangle(Data, Exposed[i].x, Exposed[i].y, Exposed[i].Width, Exposed[i].Height, &Black);
+        }
+      }
+      else
+      {
+        DrawRectangle(Data, PreviousX, PreviousY, 600, 600, &Black);
+        ResizeGrid(&Grid, 600, 600);
+        DrawGrid(Data, &Grid, x, y);
+      }
+      PresentDamage(Data);
+
+      PreviousX = x;
+      PreviousY = y;
+    }
+    Nanoseconds = ReadNanoseconds() - Start;
+
+    ReportResult("MoveGrid", Scroll == 1 ? "600x600 scroll" : "600x600 redraw", Bench->Iterations,
+                 (UINT64)600 * 600 * Bench->Iterations, Data->PresentStats.TotalBytes, Nanoseconds);
+  }
+
+  DeleteGrid(&Grid);
+}
+
+/// @brief Measures full screen and partial updates of the video buffer in every supported present mode
+STATIC
+VOID
+BenchmarkPresent(
+    IN BENCH_CONTEXT *Bench)
+{
+  GAME_GRAPHICS_LIB_DATA *Data = &Bench->Data;
+  UINT32 PartialSizes[] = {16, 64, 256};
+  CHAR8 Parameters[32];
+  UINT32 Width;
+  UINT32 Height;
+  UINT64 Start;
+  UINT64 Nanoseconds;
+
+  for (INT32 Mode = GameGraphicsPresentBlt; Mode <= GameGraphicsPresentDirect; Mode++)
+  {
+    if (EFI_ERROR(SetPresentMode(Data, (GAME_GRAPHICS_LIB_PRESENT_MODE)Mode)))
+    {
+      continue;
+    }
+
+    ResetPresentStats(Data);
+    Start = ReadNanoseconds();
+    for (UINT32 j = 0; j < Bench->Iterations; j++)
+    {
+      UpdateVideoBuffer(Data);
+    }
+    Nanoseconds = ReadNanoseconds() - Start;
+
+    snprintf(Parameters, sizeof(Parameters), "%s %ux%u",
+             Mode == GameGraphicsPresentBlt ? "blt" : "direct",
+             Data->Screen.HorizontalResolution, Data->Screen.VerticalResolution);
+    ReportResult("UpdateVideoBuffer", Parameters, Bench->Iterations,
+                 (UINT64)Data->Screen.HorizontalResolution * Data->Screen.VerticalResolution * Bench->Iterations,
+                 Data->PresentStats.TotalBytes, Nanoseconds);
+
+    for (UINTN i = 0; i < ARRAY_SIZE(PartialSizes); i++)
+    {
+      Width = MIN(PartialSizes[i], Data->Screen.HorizontalResolution);
+      Height = MIN(PartialSizes[i], Data->Screen.VerticalResolution);
+
+      ResetPresentStats(Data);
+      Start = ReadNanoseconds();
+      for (UINT32 j = 0; j < Bench->Iterations; j++)
+      {
+        SmartUpdateVideoBuffer(Data, 0, 0, Width, Height);
+      }
+      Nanoseconds = ReadNanoseconds() - Start;
+
+      snprintf(Parameters, sizeof(Parameters), "%s %ux%u", Mode == GameGraphicsPresentBlt ? "blt" : "direct", Width, Height);
+      ReportResult("SmartUpdateVideoBuffer", Parameters, Bench->Iterations,
+                   (UINT64)Width * Height * Bench->Iterations,
+                   Data->PresentStats.TotalBytes, Nanoseconds);
+    }
+  }
+
+  SetPresentMode(Data, GameGraphicsPresentBlt);
+}
+
+/// @brief Measures frames drawn at a low render resolution and scaled up to the screen, in every supported present mode
+STATIC
+VOID
+BenchmarkScaledPresent(
+    IN BENCH_CONTEXT *Bench)
+{
+  GAME_GRAPHICS_LIB_DATA *Data = &Bench->Data;
+  GAME_GRAPHICS_LIB_SCREEN_DATA Resolutions[] = {{320, 240}, {640, 360}};
+  EFI_GRAPHICS_OUTPUT_BLT_PIXEL Color = {0, 0, 0, 0};
+  CHAR8 Parameters[32];
+  UINT64 Start;
+  UINT64 Nanoseconds;
+
+  for (UINTN i = 0; i < ARRAY_SIZE(Resolutions); i++)
+  {
+    if (EFI_ERROR(SetRenderResolution(Data, Resolutions[i].HorizontalResolution, Resolutions[i].VerticalResolution)))
+    {
+      continue;
+    }
+
+    for (INT32 Mode = GameGraphicsPresentBlt; Mode <= GameGraphicsPresentDirect; Mode++)
+    {
+      if (EFI_ERROR(SetPresentMode(Data, (GAME_GRAPHICS_LIB_PRESENT_MODE)Mode)))
+      {
+        continue;
+      }
+
+      ResetPresentStats(Data);
+      Start = ReadNanoseconds();
+      for (UINT32 j = 0; j < Bench->Iterations; j++)
+      {
+        Color.Green = (UINT8)j;
+        DrawRectangle(Data, 0, 0, Data->Screen.HorizontalResolution, Data->Screen.VerticalResolution, &Color);
+        UpdateVideoBuffer(Data);
+      }
+      Nanoseconds = ReadNanoseconds() - Start;
+
+      snprintf(Parameters, sizeof(Parameters), "%s %ux%u x%u", Mode == GameGraphicsPresentBlt ? "blt" : "direct",
+               Data->Screen.HorizontalResolution, Data->Screen.VerticalResolution, Data->Scale);
+      ReportResult("DrawAndUpdateScaled", Parameters, Bench->Iterations,
+                   (UINT64)Data->Output.HorizontalResolution * Data->Output.VerticalResolution * Bench->Iterations,
+                   Data->PresentStats.TotalBytes, Nanoseconds);
+    }
+  }
+
+  SetPresentMode(Data, GameGraphicsPresentBlt);
+  SetRenderResolution(Data, 0, 0);
+}
+
+/**
+  Standard POSIX C entry point for the host based benchmarks.
+**/
+int main(
+    int argc,
+    char *argv[])
+{
+  BENCH_CONTEXT Bench;
+  UINT32 Width = BENCH_DEFAULT_WIDTH;
+  UINT32 Height = BENCH_DEFAULT_HEIGHT;
+
+  Bench.Iterations = BENCH_DEFAULT_ITERATIONS;
+  if (argc > 1)
+  {
+    Bench.Iterations = MAX((UINT32)strtoul(argv[1], NULL, 0), 1);
+  }
+  if (argc > 3)
+  {
+    Width = (UINT32)strtoul(argv[2], NULL, 0);
+    Height = (UINT32)strtoul(argv[3], NULL, 0);
+  }
+
+  if (EFI_ERROR(MockGraphicsOutputInitialize(Width, Height, PixelBlueGreenRedReserved8BitPerColor, Width)))
+  {
+    fprintf(stderr, "Invalid screen size %ux%u\n", Width, Height);
+    return 1;
+  }
+
+  if (EFI_ERROR(InitializeGraphicMode(&Bench.Data)))
+  {
+    fprintf(stderr, "Failed to initialize the graphics library\n");
+    MockGraphicsOutputFree();
+    return 1;
+  }
+
+  printf("workload,parameters,operations,ns_per_op,mpixels_per_s,blt_mbytes_per_s\n");
+
+  BenchmarkDrawRectangle(&Bench);
+  BenchmarkClearScreen(&Bench);
+  BenchmarkDrawText(&Bench);
+  BenchmarkDrawGrid(&Bench);
+  BenchmarkMoveGrid(&Bench);
+  BenchmarkPresent(&Bench);
+  BenchmarkScaledPresent(&Bench);
+
+  FinishGraphicMode(&Bench.Data);
+  MockGraphicsOutputFree();
+
+  return 0;
+}
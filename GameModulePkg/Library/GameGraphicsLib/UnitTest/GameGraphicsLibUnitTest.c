@@ -0,0 +1,1216 @@
+/** @file
+  Host based unit tests of GameGraphicsLib.
+
+  Every drawing primitive is checked against the CRC32 of a known good back buffer, and every
+  present function against the Blt calls recorded by the mock Graphics Output Protocol.
+  A golden CRC has to be updated when the output of a primitive changes on purpose.
+
+**/
+
+#include <Uefi.h>
+#include <Library/BaseLib.h>
+#include <Library/BaseMemoryLib.h>
+#include <Library/DebugLib.h>
+#include <Library/MemoryAllocationLib.h>
+#include <Library/UnitTestLib.h>
+#include <Library/GameGraphicsLib.h>
+#include "MockGraphicsOutput.h"
+
+#define UNIT_TEST_NAME "GameGraphicsLib Unit Tests"
+#define UNIT_TEST_VERSION "0.1"
+
+#define TEST_SCREEN_WIDTH 320
+#define TEST_SCREEN_HEIGHT 200
+
+// Back buffer CRCs of the drawing tests
+#define GOLDEN_CRC_CLEAR_SCREEN 0x69FF78A6
+#define GOLDEN_CRC_DRAW_RECTANGLE 0xC1826BB1
+#define GOLDEN_CRC_DRAW_GRID 0xF64210C0
+#define GOLDEN_CRC_DRAW_TEXT 0x50C00940
+
+/// @brief Screen that a test suite runs on
+typedef struct
+{
+  UINT32 Width;
+  UINT32 Height;
+  EFI_GRAPHICS_PIXEL_FORMAT PixelFormat;
+  UINT32 PixelsPerScanLine;
+  GAME_GRAPHICS_LIB_DATA Data; // Initialized by the prerequisite of every test
+} GRAPHICS_TEST_CONTEXT;
+
+STATIC GRAPHICS_TEST_CONTEXT mBgrContext = {TEST_SCREEN_WIDTH, TEST_SCREEN_HEIGHT, PixelBlueGreenRedReserved8BitPerColor, TEST_SCREEN_WIDTH};
+STATIC GRAPHICS_TEST_CONTEXT mRgbPaddedContext = {TEST_SCREEN_WIDTH, TEST_SCREEN_HEIGHT, PixelRedGreenBlueReserved8BitPerColor, TEST_SCREEN_WIDTH + 64};
+STATIC GRAPHICS_TEST_CONTEXT mBitMaskContext = {TEST_SCREEN_WIDTH, TEST_SCREEN_HEIGHT, PixelBitMask, TEST_SCREEN_WIDTH};
+STATIC GRAPHICS_TEST_CONTEXT mBltOnlyContext = {TEST_SCREEN_WIDTH, TEST_SCREEN_HEIGHT, PixelBltOnly, TEST_SCREEN_WIDTH};
+
+/// @brief Calculates the CRC32 of the back buffer, without the padding of the rows
+STATIC
+UINT32
+BackBufferCrc(
+    IN GAME_GRAPHICS_LIB_DATA *Data)
+{
+  UINTN RowBytes = Data->Screen.HorizontalResolution * sizeof(EFI_GRAPHICS_OUTPUT_BLT_PIXEL);
+  UINT8 *Visible;
+  UINT32 Crc;
+
+  Visible = AllocatePool(RowBytes * Data->Screen.VerticalResolution);
+  if (Visible == NULL)
+  {
+    return 0;
+  }
+
+  for (UINT32 y = 0; y < Data->Screen.VerticalResolution; y++)
+  {
+    CopyMem(&Visible[y * RowBytes], &Data->BackBuffer[(UINTN)y * Data->BackBufferStride], RowBytes);
+  }
+
+  Crc = CalculateCrc32(Visible, RowBytes * Data->Screen.VerticalResolution);
+  FreePool(Visible);
+  return Crc;
+}
+
+/// @brief Reads a pixel of a color back buffer as a 32-bit value
+STATIC
+UINT32
+BackBufferPixel(
+    IN GAME_GRAPHICS_LIB_DATA *Data,
+    IN UINT32 x,
+    IN UINT32 y)
+{
+  return *(UINT32 *)&Data->BackBuffer[(UINTN)y * Data->BackBufferStride + x];
+}
+
+/// @brief Checks that a recorded Blt copied the given area of the back buffer to the same place on the screen
+STATIC
+BOOLEAN
+IsBufferToVideoRecord(
+    IN MOCK_BLT_RECORD *Record,
+    IN UINTN x,
+    IN UINTN y,
+    IN UINTN Width,
+    IN UINTN Height)
+{
+  return (Record->Operation == EfiBltBufferToVideo) &&
+         (Record->SourceX == x) && (Record->SourceY == y) &&
+         (Record->DestinationX == x) && (Record->DestinationY == y) &&
+         (Record->Width == Width) && (Record->Height == Height);
+}
+
+/// @brief Checks that the screen shows the palette colors of the indices in the back buffer, scaled like the library does
+STATIC
+BOOLEAN
+ScreenShowsPaletteColors(
+    IN GRAPHICS_TEST_CONTEXT *Test,
+    IN CONST EFI_GRAPHICS_OUTPUT_BLT_PIXEL *Colors)
+{
+  GAME_GRAPHICS_LIB_DATA *Data = &Test->Data;
+  EFI_GRAPHICS_OUTPUT_BLT_PIXEL Black = {0, 0, 0, 0};
+  EFI_GRAPHICS_OUTPUT_BLT_PIXEL *Screen;
+  CONST EFI_GRAPHICS_OUTPUT_BLT_PIXEL *Expected;
+  UINT8 *Indices = (UINT8 *)Data->BackBuffer;
+  UINT32 OutputWidth = Data->Screen.HorizontalResolution * Data->Scale;
+  UINT32 OutputHeight = Data->Screen.VerticalResolution * Data->Scale;
+  BOOLEAN Matches = TRUE;
+
+  Screen = AllocatePool((UINTN)Test->Width * Test->Height * sizeof(EFI_GRAPHICS_OUTPUT_BLT_PIXEL));
+  if (Screen == NULL)
+  {
+    return FALSE;
+  }
+
+  if (EFI_ERROR(gMockGraphicsOutput.Protocol.Blt(&gMockGraphicsOutput.Protocol, Screen, EfiBltVideoToBltBuffer, 0, 0, 0, 0,
+                                                 Test->Width, Test->Height, 0)))
+  {
+    FreePool(Screen);
+    return FALSE;
+  }
+
+  for (UINT32 y = 0; (y < Test->Height) && Matches; y++)
+  {
+    for (UINT32 x = 0; (x < Test->Width) && Matches; x++)
+    {
+      Expected = &Black;
+      if ((x >= Data->OutputX) && (x < Data->OutputX + OutputWidth) && (y >= Data->OutputY) && (y < Data->OutputY + OutputHeight))
+      {
+        Expected = &Colors[Indices[(UINTN)((y - Data->OutputY) / Data->Scale) * Data->BackBufferStride + (x - Data->OutputX) / Data->Scale]];
+      }
+      Matches = (CompareMem(&Screen[y * Test->Width + x], Expected, 3) == 0);
+    }
+  }
+
+  FreePool(Screen);
+  return Matches;
+}
+
+/// @brief Creates the mock screen of the context and initializes the library on it
+STATIC
+UNIT_TEST_STATUS
+EFIAPI
+LayersAreCompositedInOrder(
+    IN UNIT_TEST_CONTEXT Context)
+{
+  GRAPHICS_TEST_CONTEXT *Test = (GRAPHICS_TEST_CONTEXT *)Context;
+  EFI_GRAPHICS_OUTPUT_BLT_PIXEL Red = {0, 0, 255, 0};
+  EFI_GRAPHICS_OUTPUT_BLT_PIXEL Green = {0, 255, 0, 0};
+  EFI_GRAPHICS_OUTPUT_BLT_PIXEL White = {255, 255, 255, 0};
+  EFI_GRAPHICS_OUTPUT_BLT_PIXEL Magenta = {255, 0, 255, 0};
+  GAME_GRAPHICS_LIB_LAYER Board;
+  GAME_GRAPHICS_LIB_LAYER Hud;
+  GAME_GRAPHICS_LIB_LAYER Message;
+
+  UT_ASSERT_NOT_EFI_ERROR(CreateLayer(&Test->Data, &Board, 0, 0, Test->Width, Test->Height, 0));
+  UT_ASSERT_NOT_EFI_ERROR(CreateLayer(&Test->Data, &Hud, 0, 0, Test->Width, 20, 1));
+  UT_ASSERT_NOT_EFI_ERROR(CreateLayer(&Test->Data, &Message, 0, 0, Test->Width, Test->Height, 2));
+  UT_ASSERT_STATUS_EQUAL(SetRenderResolution(&Test->Data, 100, 60), EFI_ALREADY_STARTED);
+
+  // Coordinates are relative to the layer, and nothing can be presented until the drawing ends
+  UT_ASSERT_NOT_EFI_ERROR(BeginLayerDrawing(&Test->Data, &Board));
+  UT_ASSERT_STATUS_EQUAL(BeginLayerDrawing(&Test->Data, &Hud), EFI_NOT_READY);
+  UT_ASSERT_STATUS_EQUAL(DeleteLayer(&Test->Data, &Board), EFI_NOT_READY);
+  UT_ASSERT_STATUS_EQUAL(PresentDamage(&Test->Data), EFI_NOT_READY);
+  UT_ASSERT_NOT_EFI_ERROR(DrawRectangle(&Test->Data, 0, 0, Test->Width, Test->Height, &Red));
+  UT_ASSERT_NOT_EFI_ERROR(EndLayerDrawing(&Test->Data));
+  UT_ASSERT_STATUS_EQUAL(EndLayerDrawing(&Test->Data), EFI_NOT_STARTED);
+
+  UT_ASSERT_NOT_EFI_ERROR(BeginLayerDrawing(&Test->Data, &Hud));
+  UT_ASSERT_NOT_EFI_ERROR(DrawRectangle(&Test->Data, 0, 0, Test->Width, 20, &Green));
+  UT_ASSERT_NOT_EFI_ERROR(EndLayerDrawing(&Test->Data));
+
+  // Pixels with the color key show the board through the message
+  UT_ASSERT_NOT_EFI_ERROR(SetLayerColorKey(&Test->Data, &Message, &Magenta));
+  UT_ASSERT_NOT_EFI_ERROR(BeginLayerDrawing(&Test->Data, &Message));
+  UT_ASSERT_NOT_EFI_ERROR(DrawRectangle(&Test->Data, 0, 0, Test->Width, Test->Height, &Magenta));
+  UT_ASSERT_NOT_EFI_ERROR(DrawRectangle(&Test->Data, 100, 80, 50, 30, &White));
+  UT_ASSERT_NOT_EFI_ERROR(EndLayerDrawing(&Test->Data));
+
+  UT_ASSERT_NOT_EFI_ERROR(PresentDamage(&Test->Data));
+  UT_ASSERT_EQUAL(BackBufferPixel(&Test->Data, 5, 5), *(UINT32 *)&Green);
+  UT_ASSERT_EQUAL(BackBufferPixel(&Test->Data, 5, 50), *(UINT32 *)&Red);
+  UT_ASSERT_EQUAL(BackBufferPixel(&Test->Data, 120, 90), *(UINT32 *)&White);
+  UT_ASSERT_EQUAL(MockGraphicsOutputFrameBufferCrc(), BackBufferCrc(&Test->Data));
+
+  // Hiding the message brings the board back without drawing it again
+  MockGraphicsOutputResetRecords();
+  UT_ASSERT_NOT_EFI_ERROR(SetLayerVisible(&Test->Data, &Message, FALSE));
+  UT_ASSERT_NOT_EFI_ERROR(PresentDamage(&Test->Data));
+  UT_ASSERT_EQUAL(BackBufferPixel(&Test->Data, 120, 90), *(UINT32 *)&Red);
+  UT_ASSERT_EQUAL(MockGraphicsOutputFrameBufferCrc(), BackBufferCrc(&Test->Data));
+
+  // Only the pixels the HUD changed are composited and presented
+  MockGraphicsOutputResetRecords();
+  UT_ASSERT_NOT_EFI_ERROR(BeginLayerDrawing(&Test->Data, &Hud));
+  UT_ASSERT_NOT_EFI_ERROR(DrawRectangle(&Test->Data, 30, 4, 12, 8, &White));
+  UT_ASSERT_NOT_EFI_ERROR(EndLayerDrawing(&Test->Data));
+  UT_ASSERT_NOT_EFI_ERROR(PresentDamage(&Test->Data));
+  UT_ASSERT_EQUAL(gMockGraphicsOutput.BltCount, 1);
+  UT_ASSERT_TRUE(IsBufferToVideoRecord(&gMockGraphicsOutput.Records[0], 30, 4, 12, 8));
+
+  // The area the HUD left shows the board, clipped where the HUD moved off screen
+  UT_ASSERT_NOT_EFI_ERROR(MoveLayer(&Test->Data, &Hud, 0, Test->Height - 10));
+  UT_ASSERT_NOT_EFI_ERROR(PresentDamage(&Test->Data));
+  UT_ASSERT_EQUAL(BackBufferPixel(&Test->Data, 5, 5), *(UINT32 *)&Red);
+  UT_ASSERT_EQUAL(BackBufferPixel(&Test->Data, 5, Test->Height - 1), *(UINT32 *)&Green);
+  MockGraphicsOutputResetRecords();
+  UT_ASSERT_NOT_EFI_ERROR(BeginLayerDrawing(&Test->Data, &Hud));
+  UT_ASSERT_NOT_EFI_ERROR(DrawRectangle(&Test->Data, 30, 4, 12, 8, &Red));
+  UT_ASSERT_NOT_EFI_ERROR(EndLayerDrawing(&Test->Data));
+  UT_ASSERT_NOT_EFI_ERROR(PresentDamage(&Test->Data));
+  UT_ASSERT_EQUAL(gMockGraphicsOutput.BltCount, 1);
+  UT_ASSERT_TRUE(IsBufferToVideoRecord(&gMockGraphicsOutput.Records[0], 30, Test->Height - 6, 12, 6));
+
+  // An opaque board on top hides the HUD
+  UT_ASSERT_NOT_EFI_ERROR(SetLayerOrder(&Test->Data, &Board, 3));
+  UT_ASSERT_NOT_EFI_ERROR(PresentDamage(&Test->Data));
+  UT_ASSERT_EQUAL(BackBufferPixel(&Test->Data, 5, Test->Height - 1), *(UINT32 *)&Red);
+
+  // Once the last layer is gone, the back buffer is drawn directly again
+  UT_ASSERT_NOT_EFI_ERROR(DeleteLayer(&Test->Data, &Message));
+  UT_ASSERT_NOT_EFI_ERROR(DeleteLayer(&Test->Data, &Hud));
+  UT_ASSERT_NOT_EFI_ERROR(DeleteLayer(&Test->Data, &Board));
+  UT_ASSERT_EQUAL(Test->Data.Compositor, NULL);
+  UT_ASSERT_EQUAL(BackBufferPixel(&Test->Data, 5, 50), 0);
+  UT_ASSERT_NOT_EFI_ERROR(PresentDamage(&Test->Data));
+  UT_ASSERT_EQUAL(MockGraphicsOutputFrameBufferCrc(), BackBufferCrc(&Test->Data));
+  UT_ASSERT_NOT_EFI_ERROR(SetRenderResolution(&Test->Data, 100, 60));
+
+  return UNIT_TEST_PASSED;
+}
+
+UNIT_TEST_STATUS
+EFIAPI
+LayersKeyPaletteIndices(
+    IN UNIT_TEST_CONTEXT Context)
+{
+  GRAPHICS_TEST_CONTEXT *Test = (GRAPHICS_TEST_CONTEXT *)Context;
+  EFI_GRAPHICS_OUTPUT_BLT_PIXEL Colors[4] = {{0, 0, 0, 0}, {0, 0, 255, 0}, {0, 255, 0, 0}, {255, 0, 255, 0}};
+  GAME_GRAPHICS_LIB_LAYER Board;
+  GAME_GRAPHICS_LIB_LAYER Overlay;
+  UINT8 *Indices;
+
+  UT_ASSERT_NOT_EFI_ERROR(EnablePaletteMode(&Test->Data, Colors, ARRAY_SIZE(Colors)));
+
+  // The board leaves a black border, the overlay is keyed except for one rectangle
+  UT_ASSERT_NOT_EFI_ERROR(CreateLayer(&Test->Data, &Board, 10, 10, 100, 100, 0));
+  UT_ASSERT_NOT_EFI_ERROR(CreateLayer(&Test->Data, &Overlay, -20, -20, 100, 100, 1));
+  UT_ASSERT_STATUS_EQUAL(DisablePaletteMode(&Test->Data), EFI_ALREADY_STARTED);
+  UT_ASSERT_NOT_EFI_ERROR(BeginLayerDrawing(&Test->Data, &Board));
+  UT_ASSERT_STATUS_EQUAL(SetPaletteColors(&Test->Data, 0, 1, Colors), EFI_NOT_READY);
+  UT_ASSERT_NOT_EFI_ERROR(DrawRectangle(&Test->Data, 0, 0, 100, 100, &Colors[1]));
+  UT_ASSERT_NOT_EFI_ERROR(EndLayerDrawing(&Test->Data));
+  UT_ASSERT_NOT_EFI_ERROR(SetLayerColorKey(&Test->Data, &Overlay, &Colors[3]));
+  UT_ASSERT_NOT_EFI_ERROR(BeginLayerDrawing(&Test->Data, &Overlay));
+  UT_ASSERT_NOT_EFI_ERROR(DrawRectangle(&Test->Data, 0, 0, 100, 100, &Colors[3]));
+  UT_ASSERT_NOT_EFI_ERROR(DrawRectangle(&Test->Data, 40, 40, 10, 10, &Colors[2]));
+  UT_ASSERT_NOT_EFI_ERROR(EndLayerDrawing(&Test->Data));
+
+  UT_ASSERT_NOT_EFI_ERROR(UpdateVideoBuffer(&Test->Data));
+  Indices = (UINT8 *)Test->Data.BackBuffer;
+  UT_ASSERT_EQUAL(Indices[5 * Test->Data.BackBufferStride + 5], 0);
+  UT_ASSERT_EQUAL(Indices[15 * Test->Data.BackBufferStride + 15], 1);
+  UT_ASSERT_EQUAL(Indices[25 * Test->Data.BackBufferStride + 25], 2);
+  UT_ASSERT_EQUAL(Indices[150 * Test->Data.BackBufferStride + 150], 0);
+  UT_ASSERT_TRUE(ScreenShowsPaletteColors(Test, Colors));
+
+  UT_ASSERT_NOT_EFI_ERROR(DeleteLayer(&Test->Data, &Overlay));
+  UT_ASSERT_NOT_EFI_ERROR(DeleteLayer(&Test->Data, &Board));
+
+  return UNIT_TEST_PASSED;
+}
+
+UNIT_TEST_STATUS
+EFIAPI
+InitializeGraphicsPrerequisite(
+    IN UNIT_TEST_CONTEXT Context)
+{
+  GRAPHICS_TEST_CONTEXT *Test = (GRAPHICS_TEST_CONTEXT *)Context;
+
+  if (EFI_ERROR(MockGraphicsOutputInitialize(Test->Width, Test->Height, Test->PixelFormat, Test->PixelsPerScanLine)))
+  {
+    return UNIT_TEST_ERROR_PREREQUISITE_NOT_MET;
+  }
+
+  ZeroMem(&Test->Data, sizeof(Test->Data));
+  if (EFI_ERROR(InitializeGraphicMode(&Test->Data)))
+  {
+    MockGraphicsOutputFree();
+    return UNIT_TEST_ERROR_PREREQUISITE_NOT_MET;
+  }
+
+  // The back buffer is not cleared by the library, the tests start from a known state
+  ClearScreen(&Test->Data);
+  Test->Data.Damage.Count = 0;
+  MockGraphicsOutputResetRecords();
+
+  return UNIT_TEST_PASSED;
+}
+
+/// @brief Releases the library and the mock screen
+STATIC
+VOID
+EFIAPI
+FinishGraphicsCleanup(
+    IN UNIT_TEST_CONTEXT Context)
+{
+  GRAPHICS_TEST_CONTEXT *Test = (GRAPHICS_TEST_CONTEXT *)Context;
+
+  FinishGraphicMode(&Test->Data);
+  MockGraphicsOutputFree();
+}
+
+UNIT_TEST_STATUS
+EFIAPI
+InitializeGraphicModeReadsMode(
+    IN UNIT_TEST_CONTEXT Context)
+{
+  GRAPHICS_TEST_CONTEXT *Test = (GRAPHICS_TEST_CONTEXT *)Context;
+
+  UT_ASSERT_EQUAL(Test->Data.Screen.HorizontalResolution, Test->Width);
+  UT_ASSERT_EQUAL(Test->Data.Screen.VerticalResolution, Test->Height);
+  UT_ASSERT_TRUE(Test->Data.BackBufferStride >= Test->Width);
+  UT_ASSERT_EQUAL(Test->Data.BackBufferStride * sizeof(EFI_GRAPHICS_OUTPUT_BLT_PIXEL) % GAME_GRAPHICS_LIB_BACK_BUFFER_ALIGNMENT, 0);
+  UT_ASSERT_EQUAL(Test->Data.SizeOfBackBuffer, Test->Data.BackBufferStride * Test->Height * sizeof(EFI_GRAPHICS_OUTPUT_BLT_PIXEL));
+  UT_ASSERT_EQUAL((UINTN)Test->Data.BackBuffer & EFI_PAGE_MASK, 0);
+  UT_ASSERT_EQUAL(Test->Data.DirectPresentSupported, Test->PixelFormat != PixelBltOnly);
+  UT_ASSERT_EQUAL(Test->Data.PresentMode, GameGraphicsPresentBlt);
+
+  return UNIT_TEST_PASSED;
+}
+
+UNIT_TEST_STATUS
+EFIAPI
+SelectGraphicModePicksCheapestMode(
+    IN UNIT_TEST_CONTEXT Context)
+{
+  GRAPHICS_TEST_CONTEXT *Test = (GRAPHICS_TEST_CONTEXT *)Context;
+  GAME_GRAPHICS_LIB_MODE_REQUEST Request = {300, 200, 30, 20, 0};
+  EFI_GRAPHICS_OUTPUT_BLT_PIXEL Color = {40, 80, 120, 0};
+
+  // Mode 0 is the 320x200 BGR screen of the context
+  UT_ASSERT_NOT_EFI_ERROR(MockGraphicsOutputAddMode(640, 480, PixelBlueGreenRedReserved8BitPerColor, 640));
+  UT_ASSERT_NOT_EFI_ERROR(MockGraphicsOutputAddMode(300, 200, PixelBltOnly, 300));
+  UT_ASSERT_NOT_EFI_ERROR(MockGraphicsOutputAddMode(300, 200, PixelRedGreenBlueReserved8BitPerColor, 300));
+  UT_ASSERT_NOT_EFI_ERROR(MockGraphicsOutputAddMode(300, 200, PixelBlueGreenRedReserved8BitPerColor, 304));
+  UT_ASSERT_NOT_EFI_ERROR(MockGraphicsOutputAddMode(310, 200, PixelBlueGreenRedReserved8BitPerColor, 310));
+  UT_ASSERT_NOT_EFI_ERROR(MockGraphicsOutputAddMode(200, 150, PixelBlueGreenRedReserved8BitPerColor, 200));
+
+  // Fewest pixels in a format that needs no conversion, and the grid divides it evenly
+  UT_ASSERT_NOT_EFI_ERROR(SelectGraphicMode(&Test->Data, &Request));
+  UT_ASSERT_EQUAL(gMockGraphicsOutput.Mode.Mode, 4);
+  UT_ASSERT_EQUAL(Test->Data.Screen.HorizontalResolution, 300);
+  UT_ASSERT_EQUAL(Test->Data.Screen.VerticalResolution, 200);
+  UT_ASSERT_EQUAL(Test->Data.BackBufferStride, 304);
+  UT_ASSERT_EQUAL(Test->Data.SizeOfBackBuffer, 304 * 200 * sizeof(EFI_GRAPHICS_OUTPUT_BLT_PIXEL));
+  UT_ASSERT_EQUAL(Test->Data.PixelsPerScanLine, 304);
+  UT_ASSERT_TRUE(Test->Data.DirectPresentSupported);
+
+  UT_ASSERT_NOT_EFI_ERROR(DrawRectangle(&Test->Data, 10, 10, 280, 180, &Color));
+  UT_ASSERT_NOT_EFI_ERROR(SetPresentMode(&Test->Data, GameGraphicsPresentDirect));
+  UT_ASSERT_NOT_EFI_ERROR(UpdateVideoBuffer(&Test->Data));
+  UT_ASSERT_EQUAL(MockGraphicsOutputFrameBufferCrc(), BackBufferCrc(&Test->Data));
+
+  // The current mode wins ties, so nothing is switched again
+  UT_ASSERT_NOT_EFI_ERROR(SelectGraphicMode(&Test->Data, &Request));
+  UT_ASSERT_EQUAL(gMockGraphicsOutput.SetModeCount, 1);
+
+  Request.MinHorizontalResolution = 4000;
+  UT_ASSERT_STATUS_EQUAL(SelectGraphicMode(&Test->Data, &Request), EFI_NOT_FOUND);
+  UT_ASSERT_EQUAL(gMockGraphicsOutput.Mode.Mode, 4);
+
+  // The cleanup finishes the library once more, on the restored mode
+  UT_ASSERT_NOT_EFI_ERROR(FinishGraphicMode(&Test->Data));
+  UT_ASSERT_EQUAL(gMockGraphicsOutput.Mode.Mode, 0);
+  UT_ASSERT_NOT_EFI_ERROR(InitializeGraphicMode(&Test->Data));
+
+  return UNIT_TEST_PASSED;
+}
+
+UNIT_TEST_STATUS
+EFIAPI
+ClearScreenMatchesGolden(
+    IN UNIT_TEST_CONTEXT Context)
+{
+  GRAPHICS_TEST_CONTEXT *Test = (GRAPHICS_TEST_CONTEXT *)Context;
+  EFI_GRAPHICS_OUTPUT_BLT_PIXEL Color = {0x12, 0x34, 0x56, 0};
+
+  UT_ASSERT_NOT_EFI_ERROR(DrawRectangle(&Test->Data, 0, 0, Test->Width, Test->Height, &Color));
+  UT_ASSERT_NOT_EFI_ERROR(ClearScreen(&Test->Data));
+  UT_ASSERT_EQUAL(BackBufferCrc(&Test->Data), GOLDEN_CRC_CLEAR_SCREEN);
+
+  return UNIT_TEST_PASSED;
+}
+
+UNIT_TEST_STATUS
+EFIAPI
+DrawRectangleMatchesGolden(
+    IN UNIT_TEST_CONTEXT Context)
+{
+  GRAPHICS_TEST_CONTEXT *Test = (GRAPHICS_TEST_CONTEXT *)Context;
+  EFI_GRAPHICS_OUTPUT_BLT_PIXEL Red = {0, 0, 255, 0};
+  EFI_GRAPHICS_OUTPUT_BLT_PIXEL Green = {0, 255, 0, 0};
+  EFI_GRAPHICS_OUTPUT_BLT_PIXEL Blue = {255, 0, 0, 0};
+  EFI_GRAPHICS_OUTPUT_BLT_PIXEL Gray = {128, 128, 128, 0};
+
+  // Inside, clipped at the top left, clipped at the bottom right, single pixels and spans of odd lengths
+  UT_ASSERT_NOT_EFI_ERROR(DrawRectangle(&Test->Data, 10, 20, 100, 50, &Red));
+  UT_ASSERT_NOT_EFI_ERROR(DrawRectangle(&Test->Data, -15, -5, 40, 30, &Green));
+  UT_ASSERT_NOT_EFI_ERROR(DrawRectangle(&Test->Data, Test->Width - 30, Test->Height - 10, 100, 100, &Blue));
+  UT_ASSERT_NOT_EFI_ERROR(DrawRectangle(&Test->Data, 200, 100, 1, 1, &Gray));
+  UT_ASSERT_NOT_EFI_ERROR(DrawRectangle(&Test->Data, 201, 101, 7, 3, &Gray));
+
+  UT_ASSERT_EQUAL(BackBufferCrc(&Test->Data), GOLDEN_CRC_DRAW_RECTANGLE);
+
+  return UNIT_TEST_PASSED;
+}
+
+UNIT_TEST_STATUS
+EFIAPI
+DrawGridMatchesGolden(
+    IN UNIT_TEST_CONTEXT Context)
+{
+  GRAPHICS_TEST_CONTEXT *Test = (GRAPHICS_TEST_CONTEXT *)Context;
+  GAME_GRAPHICS_LIB_GRID Grid;
+  EFI_GRAPHICS_OUTPUT_BLT_PIXEL Color = {0, 0, 0, 0};
+  UINTN Repainted;
+  UINT32 Crc;
+
+  // Cells of 13 x 9.7 pixels, so the cell borders are not evenly spaced
+  UT_ASSERT_NOT_EFI_ERROR(CreateCustomGrid(&Grid, 260, 146, 20, 15, NULL));
+
+  for (UINT32 y = 0; y < 15; y++)
+  {
+    for (UINT32 x = 0; x < 20; x++)
+    {
+      if (((x + y) % 3) == 0)
+      {
+        Color.Red = (UINT8)(x * 12);
+        Color.Green = (UINT8)(y * 17);
+        Color.Blue = (UINT8)((x ^ y) * 8);
+        UT_ASSERT_NOT_EFI_ERROR(FillCellInGrid(&Grid, x, y, &Color));
+      }
+    }
+  }
+
+  UT_ASSERT_NOT_EFI_ERROR(DrawGrid(&Test->Data, &Grid, 30, 40));
+  Crc = BackBufferCrc(&Test->Data);
+
+  // Drawing an unchanged grid again repaints nothing
+  UT_ASSERT_NOT_EFI_ERROR(DrawGridEx(&Test->Data, &Grid, 30, 40, NULL, 0, &Repainted));
+  UT_ASSERT_EQUAL(Repainted, 0);
+  UT_ASSERT_EQUAL(BackBufferCrc(&Test->Data), Crc);
+
+  DeleteGrid(&Grid);
+
+  UT_ASSERT_EQUAL(Crc, GOLDEN_CRC_DRAW_GRID);
+
+  return UNIT_TEST_PASSED;
+}
+
+/// @brief Checks that a cell of a grid drawn at x, y shows the 2x2 pattern of GridPatternsAreScaledToCells
+STATIC
+BOOLEAN
+CellShowsPattern(
+    IN GAME_GRAPHICS_LIB_DATA *Data,
+    IN GAME_GRAPHICS_LIB_GRID *Grid,
+    IN UINT32 x,
+    IN UINT32 y,
+    IN UINT32 Column,
+    IN UINT32 Row,
+    IN UINT32 *Pattern)
+{
+  UINT32 Left = x + Grid->ColumnOffsets[Column];
+  UINT32 Top = y + Grid->RowOffsets[Row];
+  UINT32 Width = Grid->ColumnOffsets[Column + 1] - Grid->ColumnOffsets[Column];
+  UINT32 Height = Grid->RowOffsets[Row + 1] - Grid->RowOffsets[Row];
+  UINT32 *Pixels = (UINT32 *)Data->BackBuffer;
+
+  for (UINT32 j = 0; j < Height; j++)
+  {
+    for (UINT32 i = 0; i < Width; i++)
+    {
+      if (Pixels[(Top + j) * Data->BackBufferStride + Left + i] != Pattern[(j * 2 / Height) * 2 + (i * 2 / Width)])
+      {
+        return FALSE;
+      }
+    }
+  }
+
+  return TRUE;
+}
+
+UNIT_TEST_STATUS
+EFIAPI
+GridPatternsAreScaledToCells(
+    IN UNIT_TEST_CONTEXT Context)
+{
+  GRAPHICS_TEST_CONTEXT *Test = (GRAPHICS_TEST_CONTEXT *)Context;
+  GAME_GRAPHICS_LIB_GRID Grid;
+  GAME_GRAPHICS_LIB_GRID_CELL_PATTERN Pattern;
+  EFI_GRAPHICS_OUTPUT_BLT_PIXEL Color = {10, 20, 30, 0};
+  UINT32 Pixels[4] = {0x00FF0000, 0x0000FF00, 0x000000FF, 0x00FFFFFF};
+
+  // Cells of 13 x 9.7 pixels, so the pattern is scaled to 13 x 9 and 13 x 10 pixels
+  UT_ASSERT_NOT_EFI_ERROR(CreateCustomGrid(&Grid, 260, 146, 20, 15, NULL));
+  Pattern.SizeX = 2;
+  Pattern.SizeY = 2;
+  Pattern.Pattern = (EFI_GRAPHICS_OUTPUT_BLT_PIXEL *)Pixels;
+  UT_ASSERT_NOT_EFI_ERROR(SetGridCellPattern(&Grid, 1, &Pattern));
+  UT_ASSERT_STATUS_EQUAL(SetGridCellPattern(&Grid, 0, &Pattern), EFI_INVALID_PARAMETER);
+
+  for (UINT32 y = 0; y < 15; y++)
+  {
+    UT_ASSERT_NOT_EFI_ERROR(FillCellInGridWithPattern(&Grid, y, y, 1));
+  }
+  UT_ASSERT_NOT_EFI_ERROR(FillCellInGrid(&Grid, 3, 3, &Color));
+  UT_ASSERT_NOT_EFI_ERROR(DrawGrid(&Test->Data, &Grid, 30, 40));
+
+  for (UINT32 y = 0; y < 15; y++)
+  {
+    UT_ASSERT_EQUAL(CellShowsPattern(&Test->Data, &Grid, 30, 40, y, y, Pixels), y != 3);
+  }
+
+  // The pattern is scaled again to cells of 10 x 6.7 pixels, and cells whose pattern is removed show their color
+  UT_ASSERT_NOT_EFI_ERROR(ResizeGrid(&Grid, 200, 100));
+  UT_ASSERT_NOT_EFI_ERROR(DrawGrid(&Test->Data, &Grid, 30, 40));
+  UT_ASSERT_TRUE(CellShowsPattern(&Test->Data, &Grid, 30, 40, 1, 1, Pixels));
+  UT_ASSERT_TRUE(CellShowsPattern(&Test->Data, &Grid, 30, 40, 2, 2, Pixels));
+  UT_ASSERT_NOT_EFI_ERROR(SetGridCellPattern(&Grid, 1, NULL));
+  UT_ASSERT_NOT_EFI_ERROR(DrawGrid(&Test->Data, &Grid, 30, 40));
+  UT_ASSERT_EQUAL(*(UINT32 *)&Test->Data.BackBuffer[(40 + Grid.RowOffsets[1]) * Test->Data.BackBufferStride + 30 + Grid.ColumnOffsets[1]], 0);
+
+  DeleteGrid(&Grid);
+
+  return UNIT_TEST_PASSED;
+}
+
+UNIT_TEST_STATUS
+EFIAPI
+GridRejectsOversizedCounts(
+    IN UNIT_TEST_CONTEXT Context)
+{
+  GAME_GRAPHICS_LIB_GRID Grid;
+  EFI_GRAPHICS_OUTPUT_BLT_PIXEL *Bitmap;
+
+  // The offset tables of MAX_UINT32 columns or rows would wrap, and so would the index of 65536 x 65537 cells
+  UT_ASSERT_STATUS_EQUAL(CreateCustomGrid(&Grid, 100, 100, MAX_UINT32, 1, NULL), EFI_INVALID_PARAMETER);
+  UT_ASSERT_STATUS_EQUAL(CreateCustomGrid(&Grid, 100, 100, 1, MAX_UINT32, NULL), EFI_INVALID_PARAMETER);
+  UT_ASSERT_STATUS_EQUAL(CreateCustomGrid(&Grid, 100, 100, 65536, 65537, NULL), EFI_INVALID_PARAMETER);
+
+  // A bitmap of the caller becomes the color bitmap of the grid and is freed with it
+  Bitmap = AllocateZeroPool(4 * 3 * sizeof(EFI_GRAPHICS_OUTPUT_BLT_PIXEL));
+  UT_ASSERT_NOT_NULL(Bitmap);
+  UT_ASSERT_NOT_EFI_ERROR(CreateCustomGrid(&Grid, 100, 100, 4, 3, Bitmap));
+  UT_ASSERT_TRUE(Grid.ColorsBitmap == Bitmap);
+  DeleteGrid(&Grid);
+
+  return UNIT_TEST_PASSED;
+}
+
+UNIT_TEST_STATUS
+EFIAPI
+DrawTextMatchesGolden(
+    IN UNIT_TEST_CONTEXT Context)
+{
+  GRAPHICS_TEST_CONTEXT *Test = (GRAPHICS_TEST_CONTEXT *)Context;
+  EFI_GRAPHICS_OUTPUT_BLT_PIXEL White = {255, 255, 255, 0};
+  EFI_GRAPHICS_OUTPUT_BLT_PIXEL Black = {0, 0, 0, 0};
+  EFI_GRAPHICS_OUTPUT_BLT_PIXEL Yellow = {0, 255, 255, 0};
+  EFI_GRAPHICS_OUTPUT_BLT_PIXEL Blue = {128, 0, 0, 0};
+  UINT32 Crc;
+
+  UT_ASSERT_NOT_EFI_ERROR(DrawText(&Test->Data, 4, 4, "Score: 0123456789", &White, &Black, 1));
+  UT_ASSERT_NOT_EFI_ERROR(DrawText(&Test->Data, 10, 30, "Game Over!", &Yellow, &Blue, 3));
+  // The second character is cut by the right edge, only its visible columns are drawn
+  UT_ASSERT_NOT_EFI_ERROR(DrawText(&Test->Data, Test->Width - 24, 100, "OK", &White, &Blue, 2));
+  Crc = BackBufferCrc(&Test->Data);
+
+  // The second time the glyphs come from the cache, the pixels have to be the same
+  UT_ASSERT_NOT_EFI_ERROR(ClearScreen(&Test->Data));
+  UT_ASSERT_NOT_EFI_ERROR(DrawText(&Test->Data, 4, 4, "Score: 0123456789", &White, &Black, 1));
+  UT_ASSERT_NOT_EFI_ERROR(DrawText(&Test->Data, 10, 30, "Game Over!", &Yellow, &Blue, 3));
+  UT_ASSERT_NOT_EFI_ERROR(DrawText(&Test->Data, Test->Width - 24, 100, "OK", &White, &Blue, 2));
+  UT_ASSERT_EQUAL(BackBufferCrc(&Test->Data), Crc);
+
+  // Characters starting past the right or bottom edge are clipped away entirely, the text before them is still drawn
+  UT_ASSERT_NOT_EFI_ERROR(DrawText(&Test->Data, Test->Width - 24, 100, "OKOK", &White, &Blue, 2));
+  UT_ASSERT_NOT_EFI_ERROR(DrawText(&Test->Data, 4, Test->Height, "Hidden", &White, &Blue, 1));
+  UT_ASSERT_NOT_EFI_ERROR(DrawCharacter(&Test->Data, Test->Width, 0, 'A', &White, &Blue, 1));
+  UT_ASSERT_EQUAL(BackBufferCrc(&Test->Data), Crc);
+
+  UT_ASSERT_EQUAL(Crc, GOLDEN_CRC_DRAW_TEXT);
+
+  return UNIT_TEST_PASSED;
+}
+
+UNIT_TEST_STATUS
+EFIAPI
+ParallelRenderingFallsBackToSerial(
+    IN UNIT_TEST_CONTEXT Context)
+{
+  GRAPHICS_TEST_CONTEXT *Test = (GRAPHICS_TEST_CONTEXT *)Context;
+  EFI_GRAPHICS_OUTPUT_BLT_PIXEL Color = {1, 2, 3, 0};
+
+  // The mock boot services have no MP Services Protocol
+  UT_ASSERT_STATUS_EQUAL(EnableParallelRendering(&Test->Data, 0), EFI_UNSUPPORTED);
+  UT_ASSERT_EQUAL(Test->Data.Renderer, NULL);
+  UT_ASSERT_EQUAL(Test->Data.RenderProcessors, 1);
+
+  UT_ASSERT_NOT_EFI_ERROR(DrawRectangle(&Test->Data, 0, 0, Test->Width, Test->Height, &Color));
+  UT_ASSERT_NOT_EFI_ERROR(ClearScreen(&Test->Data));
+  UT_ASSERT_NOT_EFI_ERROR(WaitForRenderJobs(&Test->Data));
+  UT_ASSERT_EQUAL(BackBufferCrc(&Test->Data), GOLDEN_CRC_CLEAR_SCREEN);
+
+  UT_ASSERT_NOT_EFI_ERROR(DisableParallelRendering(&Test->Data));
+
+  return UNIT_TEST_PASSED;
+}
+
+UNIT_TEST_STATUS
+EFIAPI
+UpdateVideoBufferCopiesScreenOnce(
+    IN UNIT_TEST_CONTEXT Context)
+{
+  GRAPHICS_TEST_CONTEXT *Test = (GRAPHICS_TEST_CONTEXT *)Context;
+  EFI_GRAPHICS_OUTPUT_BLT_PIXEL Color = {10, 20, 30, 0};
+
+  UT_ASSERT_NOT_EFI_ERROR(DrawRectangle(&Test->Data, 5, 5, 50, 50, &Color));
+  UT_ASSERT_NOT_EFI_ERROR(ResetPresentStats(&Test->Data));
+  UT_ASSERT_NOT_EFI_ERROR(UpdateVideoBuffer(&Test->Data));
+
+  UT_ASSERT_EQUAL(gMockGraphicsOutput.BltCount, 1);
+  UT_ASSERT_TRUE(IsBufferToVideoRecord(&gMockGraphicsOutput.Records[0], 0, 0, Test->Width, Test->Height));
+  UT_ASSERT_EQUAL(gMockGraphicsOutput.BltBytes, Test->Width * Test->Height * sizeof(EFI_GRAPHICS_OUTPUT_BLT_PIXEL));
+  UT_ASSERT_EQUAL(Test->Data.PresentStats.TotalBytes, Test->Width * Test->Height * sizeof(EFI_GRAPHICS_OUTPUT_BLT_PIXEL));
+  UT_ASSERT_EQUAL(Test->Data.PresentStats.PresentCount, 1);
+  UT_ASSERT_EQUAL(Test->Data.Damage.Count, 0);
+
+  // The BGR framebuffer holds the same bytes as the back buffer
+  UT_ASSERT_EQUAL(MockGraphicsOutputFrameBufferCrc(), BackBufferCrc(&Test->Data));
+
+  return UNIT_TEST_PASSED;
+}
+
+UNIT_TEST_STATUS
+EFIAPI
+SmartUpdateVideoBufferClips(
+    IN UNIT_TEST_CONTEXT Context)
+{
+  GRAPHICS_TEST_CONTEXT *Test = (GRAPHICS_TEST_CONTEXT *)Context;
+
+  UT_ASSERT_NOT_EFI_ERROR(SmartUpdateVideoBuffer(&Test->Data, -10, -20, 30, 40));
+  UT_ASSERT_NOT_EFI_ERROR(SmartUpdateVideoBuffer(&Test->Data, Test->Width - 5, Test->Height - 5, 20, 20));
+
+  UT_ASSERT_EQUAL(gMockGraphicsOutput.BltCount, 2);
+  UT_ASSERT_TRUE(IsBufferToVideoRecord(&gMockGraphicsOutput.Records[0], 0, 0, 20, 20));
+  UT_ASSERT_TRUE(IsBufferToVideoRecord(&gMockGraphicsOutput.Records[1], Test->Width - 5, Test->Height - 5, 5, 5));
+
+  // Areas that are completely off screen do not call Blt at all
+  UT_ASSERT_NOT_EFI_ERROR(SmartUpdateVideoBuffer(&Test->Data, Test->Width, 0, 10, 10));
+  UT_ASSERT_NOT_EFI_ERROR(SmartUpdateVideoBuffer(&Test->Data, -10, -10, 10, 10));
+  UT_ASSERT_EQUAL(gMockGraphicsOutput.BltCount, 2);
+  UT_ASSERT_EQUAL(gMockGraphicsOutput.BltBytes, (20 * 20 + 5 * 5) * sizeof(EFI_GRAPHICS_OUTPUT_BLT_PIXEL));
+
+  return UNIT_TEST_PASSED;
+}
+
+UNIT_TEST_STATUS
+EFIAPI
+PresentDamageCopiesDamagedAreas(
+    IN UNIT_TEST_CONTEXT Context)
+{
+  GRAPHICS_TEST_CONTEXT *Test = (GRAPHICS_TEST_CONTEXT *)Context;
+  EFI_GRAPHICS_OUTPUT_BLT_PIXEL Color = {200, 100, 50, 0};
+  BOOLEAN FoundFirst = FALSE;
+  BOOLEAN FoundSecond = FALSE;
+
+  // Far enough apart that merging them would copy more than twice their area
+  UT_ASSERT_NOT_EFI_ERROR(DrawRectangle(&Test->Data, 10, 10, 20, 20, &Color));
+  UT_ASSERT_NOT_EFI_ERROR(DrawRectangle(&Test->Data, 250, 150, 30, 10, &Color));
+  UT_ASSERT_EQUAL(Test->Data.Damage.Count, 2);
+
+  UT_ASSERT_NOT_EFI_ERROR(PresentDamage(&Test->Data));
+  UT_ASSERT_EQUAL(gMockGraphicsOutput.BltCount, 2);
+  for (UINTN i = 0; i < gMockGraphicsOutput.BltCount; i++)
+  {
+    FoundFirst |= IsBufferToVideoRecord(&gMockGraphicsOutput.Records[i], 10, 10, 20, 20);
+    FoundSecond |= IsBufferToVideoRecord(&gMockGraphicsOutput.Records[i], 250, 150, 30, 10);
+  }
+  UT_ASSERT_TRUE(FoundFirst);
+  UT_ASSERT_TRUE(FoundSecond);
+  UT_ASSERT_EQUAL(Test->Data.Damage.Count, 0);
+  UT_ASSERT_EQUAL(MockGraphicsOutputFrameBufferCrc(), BackBufferCrc(&Test->Data));
+
+  // Nothing changed since, so nothing is copied
+  MockGraphicsOutputResetRecords();
+  UT_ASSERT_NOT_EFI_ERROR(PresentDamage(&Test->Data));
+  UT_ASSERT_EQUAL(gMockGraphicsOutput.BltCount, 0);
+
+  return UNIT_TEST_PASSED;
+}
+
+UNIT_TEST_STATUS
+EFIAPI
+ScrollRectangleMovesScreenAndBackBuffer(
+    IN UNIT_TEST_CONTEXT Context)
+{
+  GRAPHICS_TEST_CONTEXT *Test = (GRAPHICS_TEST_CONTEXT *)Context;
+  EFI_GRAPHICS_OUTPUT_BLT_PIXEL Color = {200, 100, 50, 0};
+  EFI_GRAPHICS_OUTPUT_BLT_PIXEL Other = {20, 180, 90, 0};
+  GAME_GRAPHICS_LIB_RECTANGLE Exposed[GAME_GRAPHICS_LIB_MAX_SCROLL_EXPOSED];
+  EFI_GRAPHICS_OUTPUT_BLT_PIXEL *Before;
+  UINT32 *Pixels = (UINT32 *)Test->Data.BackBuffer;
+  UINTN ExposedCount;
+  UINTN VideoToVideo = 0;
+
+  UT_ASSERT_NOT_EFI_ERROR(DrawRectangle(&Test->Data, 40, 30, 100, 80, &Color));
+  UT_ASSERT_NOT_EFI_ERROR(DrawText(&Test->Data, 44, 34, "Move", &Other, &Color, 1));
+  UT_ASSERT_NOT_EFI_ERROR(PresentDamage(&Test->Data));
+
+  // Not presented yet, so it has to be presented before the screen is moved
+  UT_ASSERT_NOT_EFI_ERROR(DrawRectangle(&Test->Data, 70, 60, 10, 10, &Other));
+  Before = AllocateCopyPool(Test->Data.SizeOfBackBuffer, Test->Data.BackBuffer);
+  UT_ASSERT_NOT_NULL(Before);
+  MockGraphicsOutputResetRecords();
+
+  UT_ASSERT_NOT_EFI_ERROR(ScrollRectangle(&Test->Data, 40, 30, 112, 86, 12, 6, Exposed, &ExposedCount));
+  for (UINTN i = 0; i < gMockGraphicsOutput.BltCount; i++)
+  {
+    if (gMockGraphicsOutput.Records[i].Operation == EfiBltVideoToVideo)
+    {
+      VideoToVideo++;
+      UT_ASSERT_EQUAL(gMockGraphicsOutput.Records[i].Bytes, 100 * 80 * sizeof(EFI_GRAPHICS_OUTPUT_BLT_PIXEL));
+    }
+  }
+  UT_ASSERT_EQUAL(VideoToVideo, 1);
+  UT_ASSERT_EQUAL(Test->Data.Damage.Count, 0);
+  UT_ASSERT_EQUAL(MockGraphicsOutputFrameBufferCrc(), BackBufferCrc(&Test->Data));
+
+  for (UINT32 y = 36; y < 116; y++)
+  {
+    for (UINT32 x = 52; x < 152; x++)
+    {
+      UT_ASSERT_EQUAL(Pixels[y * Test->Data.BackBufferStride + x], ((UINT32 *)Before)[(y - 6) * Test->Data.BackBufferStride + x - 12]);
+    }
+  }
+  FreePool(Before);
+
+  // The rows above the moved content, then the columns left of it
+  UT_ASSERT_EQUAL(ExposedCount, 2);
+  UT_ASSERT_TRUE((Exposed[0].x == 40) && (Exposed[0].y == 30) && (Exposed[0].Width == 112) && (Exposed[0].Height == 6));
+  UT_ASSERT_TRUE((Exposed[1].x == 40) && (Exposed[1].y == 36) && (Exposed[1].Width == 12) && (Exposed[1].Height == 80));
+
+  // Moving further than the area is wide leaves nothing to move
+  MockGraphicsOutputResetRecords();
+  UT_ASSERT_NOT_EFI_ERROR(ScrollRectangle(&Test->Data, 40, 30, 112, 86, -200, 0, Exposed, &ExposedCount));
+  UT_ASSERT_EQUAL(gMockGraphicsOutput.BltCount, 0);
+  UT_ASSERT_EQUAL(ExposedCount, 1);
+
+  return UNIT_TEST_PASSED;
+}
+
+UNIT_TEST_STATUS
+EFIAPI
+ScaledPresentReplicatesPixels(
+    IN UNIT_TEST_CONTEXT Context)
+{
+  GRAPHICS_TEST_CONTEXT *Test = (GRAPHICS_TEST_CONTEXT *)Context;
+  EFI_GRAPHICS_OUTPUT_BLT_PIXEL White = {255, 255, 255, 0};
+  EFI_GRAPHICS_OUTPUT_BLT_PIXEL Red = {0, 0, 255, 0};
+  EFI_GRAPHICS_OUTPUT_BLT_PIXEL Teal = {160, 128, 0, 0};
+  EFI_GRAPHICS_OUTPUT_BLT_PIXEL Black = {0, 0, 0, 0};
+  EFI_GRAPHICS_OUTPUT_BLT_PIXEL *Screen;
+  EFI_GRAPHICS_OUTPUT_BLT_PIXEL *Expected;
+  BOOLEAN Inside;
+
+  // Whatever was on screen before has to be gone from the borders
+  UT_ASSERT_NOT_EFI_ERROR(DrawRectangle(&Test->Data, 0, 0, Test->Width, Test->Height, &White));
+  UT_ASSERT_NOT_EFI_ERROR(UpdateVideoBuffer(&Test->Data));
+
+  // 100x60 fits 3 times into 320x200, centered with 10 pixel borders
+  UT_ASSERT_NOT_EFI_ERROR(SetRenderResolution(&Test->Data, 100, 60));
+  UT_ASSERT_EQUAL(Test->Data.Screen.HorizontalResolution, 100);
+  UT_ASSERT_EQUAL(Test->Data.Screen.VerticalResolution, 60);
+  UT_ASSERT_EQUAL(Test->Data.Scale, 3);
+  UT_ASSERT_EQUAL(Test->Data.OutputX, 10);
+  UT_ASSERT_EQUAL(Test->Data.OutputY, 10);
+  UT_ASSERT_STATUS_EQUAL(SetRenderResolution(&Test->Data, Test->Width + 1, 60), EFI_UNSUPPORTED);
+
+  UT_ASSERT_NOT_EFI_ERROR(DrawRectangle(&Test->Data, 3, 7, 41, 33, &Red));
+  UT_ASSERT_NOT_EFI_ERROR(DrawText(&Test->Data, 20, 30, "Scaled", &Teal, &Black, 1));
+  if (Test->Data.DirectPresentSupported)
+  {
+    UT_ASSERT_NOT_EFI_ERROR(SetPresentMode(&Test->Data, GameGraphicsPresentDirect));
+  }
+  UT_ASSERT_NOT_EFI_ERROR(PresentDamage(&Test->Data));
+
+  Screen = AllocatePool((UINTN)Test->Width * Test->Height * sizeof(EFI_GRAPHICS_OUTPUT_BLT_PIXEL));
+  UT_ASSERT_NOT_NULL(Screen);
+  UT_ASSERT_NOT_EFI_ERROR(gMockGraphicsOutput.Protocol.Blt(&gMockGraphicsOutput.Protocol, Screen, EfiBltVideoToBltBuffer, 0, 0, 0, 0,
+                                                           Test->Width, Test->Height, 0));
+  for (UINT32 y = 0; y < Test->Height; y++)
+  {
+    for (UINT32 x = 0; x < Test->Width; x++)
+    {
+      Inside = (x >= 10) && (x < 310) && (y >= 10) && (y < 190);
+      Expected = Inside ? &Test->Data.BackBuffer[((y - 10) / 3) * Test->Data.BackBufferStride + (x - 10) / 3] : &Black;
+      UT_ASSERT_MEM_EQUAL(&Screen[y * Test->Width + x], Expected, 3);
+    }
+  }
+  FreePool(Screen);
+
+  return UNIT_TEST_PASSED;
+}
+
+UNIT_TEST_STATUS
+EFIAPI
+CenteredPresentKeepsOffsets(
+    IN UNIT_TEST_CONTEXT Context)
+{
+  GRAPHICS_TEST_CONTEXT *Test = (GRAPHICS_TEST_CONTEXT *)Context;
+  EFI_GRAPHICS_OUTPUT_BLT_PIXEL White = {255, 255, 255, 0};
+  EFI_GRAPHICS_OUTPUT_BLT_PIXEL Red = {0, 0, 255, 0};
+  EFI_GRAPHICS_OUTPUT_BLT_PIXEL Teal = {160, 128, 0, 0};
+  EFI_GRAPHICS_OUTPUT_BLT_PIXEL Black = {0, 0, 0, 0};
+  EFI_GRAPHICS_OUTPUT_BLT_PIXEL *Screen;
+  EFI_GRAPHICS_OUTPUT_BLT_PIXEL *Expected;
+  BOOLEAN Inside;
+
+  UT_ASSERT_NOT_EFI_ERROR(DrawRectangle(&Test->Data, 0, 0, Test->Width, Test->Height, &White));
+  UT_ASSERT_NOT_EFI_ERROR(UpdateVideoBuffer(&Test->Data));
+
+  // 200x150 does not fit twice into 320x200, it is presented unscaled with borders of 60 and 25 pixels
+  UT_ASSERT_NOT_EFI_ERROR(SetRenderResolution(&Test->Data, 200, 150));
+  UT_ASSERT_EQUAL(Test->Data.Scale, 1);
+  UT_ASSERT_EQUAL(Test->Data.OutputX, 60);
+  UT_ASSERT_EQUAL(Test->Data.OutputY, 25);
+
+  UT_ASSERT_NOT_EFI_ERROR(DrawRectangle(&Test->Data, 3, 7, 41, 33, &Red));
+  UT_ASSERT_NOT_EFI_ERROR(DrawText(&Test->Data, 20, 60, "Centered", &Teal, &Black, 1));
+  if (Test->Data.DirectPresentSupported)
+  {
+    UT_ASSERT_NOT_EFI_ERROR(SetPresentMode(&Test->Data, GameGraphicsPresentDirect));
+  }
+  UT_ASSERT_NOT_EFI_ERROR(PresentDamage(&Test->Data));
+
+  // Scrolled pixels have to end up where the presented ones are
+  UT_ASSERT_NOT_EFI_ERROR(ScrollRectangle(&Test->Data, 0, 0, 200, 150, 7, 5, NULL, NULL));
+
+  Screen = AllocatePool((UINTN)Test->Width * Test->Height * sizeof(EFI_GRAPHICS_OUTPUT_BLT_PIXEL));
+  UT_ASSERT_NOT_NULL(Screen);
+  UT_ASSERT_NOT_EFI_ERROR(gMockGraphicsOutput.Protocol.Blt(&gMockGraphicsOutput.Protocol, Screen, EfiBltVideoToBltBuffer, 0, 0, 0, 0,
+                                                           Test->Width, Test->Height, 0));
+  for (UINT32 y = 0; y < Test->Height; y++)
+  {
+    for (UINT32 x = 0; x < Test->Width; x++)
+    {
+      Inside = (x >= 60) && (x < 260) && (y >= 25) && (y < 175);
+      Expected = Inside ? &Test->Data.BackBuffer[(y - 25) * Test->Data.BackBufferStride + (x - 60)] : &Black;
+      UT_ASSERT_MEM_EQUAL(&Screen[y * Test->Width + x], Expected, 3);
+    }
+  }
+  FreePool(Screen);
+
+  return UNIT_TEST_PASSED;
+}
+
+UNIT_TEST_STATUS
+EFIAPI
+SwapAndPresentFallsBackToPresentDamage(
+    IN UNIT_TEST_CONTEXT Context)
+{
+  GRAPHICS_TEST_CONTEXT *Test = (GRAPHICS_TEST_CONTEXT *)Context;
+  EFI_GRAPHICS_OUTPUT_BLT_PIXEL Color = {90, 60, 30, 0};
+  EFI_GRAPHICS_OUTPUT_BLT_PIXEL *BackBuffer = Test->Data.BackBuffer;
+
+  // The mock boot services have no MP Services Protocol, BltOnly modes have no framebuffer either
+  UT_ASSERT_STATUS_EQUAL(EnableAsyncPresent(&Test->Data), EFI_UNSUPPORTED);
+  UT_ASSERT_EQUAL(Test->Data.Presenter, NULL);
+  UT_ASSERT_EQUAL(Test->Data.BackBuffers[1], NULL);
+
+  UT_ASSERT_NOT_EFI_ERROR(DrawRectangle(&Test->Data, 10, 10, 20, 20, &Color));
+  UT_ASSERT_NOT_EFI_ERROR(DrawRectangle(&Test->Data, 250, 150, 30, 10, &Color));
+  MockGraphicsOutputResetRecords();
+
+  UT_ASSERT_NOT_EFI_ERROR(SwapAndPresent(&Test->Data));
+  UT_ASSERT_NOT_EFI_ERROR(WaitForPresent(&Test->Data));
+  UT_ASSERT_EQUAL(gMockGraphicsOutput.BltCount, 2);
+  UT_ASSERT_EQUAL(Test->Data.Damage.Count, 0);
+  UT_ASSERT_EQUAL(Test->Data.BackBuffer, BackBuffer);
+  UT_ASSERT_EQUAL(Test->Data.PresentStats.AsyncCycles, 0);
+  UT_ASSERT_EQUAL(MockGraphicsOutputFrameBufferCrc(), BackBufferCrc(&Test->Data));
+
+  UT_ASSERT_NOT_EFI_ERROR(DisableAsyncPresent(&Test->Data));
+
+  return UNIT_TEST_PASSED;
+}
+
+UNIT_TEST_STATUS
+EFIAPI
+DirectPresentMatchesBlt(
+    IN UNIT_TEST_CONTEXT Context)
+{
+  GRAPHICS_TEST_CONTEXT *Test = (GRAPHICS_TEST_CONTEXT *)Context;
+  EFI_GRAPHICS_OUTPUT_BLT_PIXEL Red = {0, 0, 255, 0};
+  EFI_GRAPHICS_OUTPUT_BLT_PIXEL Teal = {160, 128, 0, 0};
+  EFI_GRAPHICS_OUTPUT_BLT_PIXEL Black = {0, 0, 0, 0};
+  UINT32 BltCrc;
+
+  UT_ASSERT_NOT_EFI_ERROR(DrawRectangle(&Test->Data, 3, 7, 91, 33, &Red));
+  UT_ASSERT_NOT_EFI_ERROR(DrawText(&Test->Data, 40, 60, "Direct", &Teal, &Black, 2));
+
+  UT_ASSERT_NOT_EFI_ERROR(UpdateVideoBuffer(&Test->Data));
+  BltCrc = MockGraphicsOutputFrameBufferCrc();
+  ZeroMem(gMockGraphicsOutput.FrameBuffer, (UINTN)Test->PixelsPerScanLine * Test->Height * sizeof(UINT32));
+  MockGraphicsOutputResetRecords();
+
+  UT_ASSERT_NOT_EFI_ERROR(SetPresentMode(&Test->Data, GameGraphicsPresentDirect));
+  UT_ASSERT_NOT_EFI_ERROR(UpdateVideoBuffer(&Test->Data));
+  UT_ASSERT_EQUAL(gMockGraphicsOutput.BltCount, 0);
+  UT_ASSERT_EQUAL(MockGraphicsOutputFrameBufferCrc(), BltCrc);
+
+  // Partial direct presents convert and place the pixels the same way
+  ZeroMem(gMockGraphicsOutput.FrameBuffer, (UINTN)Test->PixelsPerScanLine * Test->Height * sizeof(UINT32));
+  UT_ASSERT_NOT_EFI_ERROR(SmartUpdateVideoBuffer(&Test->Data, 0, 0, Test->Width, Test->Height / 2));
+  UT_ASSERT_NOT_EFI_ERROR(SmartUpdateVideoBuffer(&Test->Data, 0, Test->Height / 2, Test->Width, Test->Height));
+  UT_ASSERT_EQUAL(MockGraphicsOutputFrameBufferCrc(), BltCrc);
+
+  return UNIT_TEST_PASSED;
+}
+
+UNIT_TEST_STATUS
+EFIAPI
+DirectPresentRequiresFrameBuffer(
+    IN UNIT_TEST_CONTEXT Context)
+{
+  GRAPHICS_TEST_CONTEXT *Test = (GRAPHICS_TEST_CONTEXT *)Context;
+
+  UT_ASSERT_STATUS_EQUAL(SetPresentMode(&Test->Data, GameGraphicsPresentDirect), EFI_UNSUPPORTED);
+  UT_ASSERT_EQUAL(Test->Data.PresentMode, GameGraphicsPresentBlt);
+  UT_ASSERT_STATUS_EQUAL(SetFrameBufferWriteCombining(&Test->Data, TRUE), EFI_UNSUPPORTED);
+
+  UT_ASSERT_NOT_EFI_ERROR(UpdateVideoBuffer(&Test->Data));
+  UT_ASSERT_EQUAL(gMockGraphicsOutput.BltCount, 1);
+
+  return UNIT_TEST_PASSED;
+}
+
+UNIT_TEST_STATUS
+EFIAPI
+WriteCombiningIsRestored(
+    IN UNIT_TEST_CONTEXT Context)
+{
+  GRAPHICS_TEST_CONTEXT *Test = (GRAPHICS_TEST_CONTEXT *)Context;
+  EFI_GRAPHICS_OUTPUT_BLT_PIXEL Color = {200, 100, 50, 0};
+
+  UT_ASSERT_EQUAL(Test->Data.FrameBufferAttributes, MOCK_GRAPHICS_OUTPUT_FRAME_BUFFER_ATTRIBUTES);
+  UT_ASSERT_FALSE(Test->Data.FrameBufferWriteCombining);
+
+  // Only the cache type changes, enabling it again does not call the GCD services
+  UT_ASSERT_NOT_EFI_ERROR(SetFrameBufferWriteCombining(&Test->Data, TRUE));
+  UT_ASSERT_NOT_EFI_ERROR(SetFrameBufferWriteCombining(&Test->Data, TRUE));
+  UT_ASSERT_TRUE(Test->Data.FrameBufferWriteCombining);
+  UT_ASSERT_EQUAL(gMockGraphicsOutput.FrameBufferAttributes, EFI_MEMORY_WC | EFI_MEMORY_XP);
+  UT_ASSERT_EQUAL(gMockGraphicsOutput.SetAttributesCount, 1);
+
+  UT_ASSERT_NOT_EFI_ERROR(DrawRectangle(&Test->Data, 20, 20, 100, 50, &Color));
+  UT_ASSERT_NOT_EFI_ERROR(SetPresentMode(&Test->Data, GameGraphicsPresentDirect));
+  UT_ASSERT_NOT_EFI_ERROR(UpdateVideoBuffer(&Test->Data));
+  UT_ASSERT_EQUAL(MockGraphicsOutputFrameBufferCrc(), BackBufferCrc(&Test->Data));
+
+  // The cleanup finishes the library once more, with the attributes of the firmware
+  UT_ASSERT_NOT_EFI_ERROR(FinishGraphicMode(&Test->Data));
+  UT_ASSERT_EQUAL(gMockGraphicsOutput.FrameBufferAttributes, MOCK_GRAPHICS_OUTPUT_FRAME_BUFFER_ATTRIBUTES);
+  UT_ASSERT_EQUAL(gMockGraphicsOutput.SetAttributesCount, 2);
+  UT_ASSERT_NOT_EFI_ERROR(InitializeGraphicMode(&Test->Data));
+
+  return UNIT_TEST_PASSED;
+}
+
+UNIT_TEST_STATUS
+EFIAPI
+PaletteIndicesAreExpanded(
+    IN UNIT_TEST_CONTEXT Context)
+{
+  GRAPHICS_TEST_CONTEXT *Test = (GRAPHICS_TEST_CONTEXT *)Context;
+  EFI_GRAPHICS_OUTPUT_BLT_PIXEL Colors[4] = {{0, 0, 0, 0}, {0, 0, 255, 0}, {160, 128, 0, 0}, {255, 255, 255, 0}};
+  EFI_GRAPHICS_OUTPUT_BLT_PIXEL Pink = {200, 200, 255, 0};
+  EFI_GRAPHICS_OUTPUT_BLT_PIXEL Orange = {0, 128, 255, 0};
+  UINT8 *Indices;
+  UINT32 BltCrc;
+
+  UT_ASSERT_STATUS_EQUAL(SetPaletteColors(&Test->Data, 0, 1, &Orange), EFI_NOT_STARTED);
+  UT_ASSERT_STATUS_EQUAL(EnablePaletteMode(&Test->Data, Colors, GAME_GRAPHICS_LIB_PALETTE_SIZE + 1), EFI_INVALID_PARAMETER);
+
+  // One byte per pixel, the rows are still padded to whole cache lines
+  UT_ASSERT_NOT_EFI_ERROR(EnablePaletteMode(&Test->Data, Colors, ARRAY_SIZE(Colors)));
+  UT_ASSERT_EQUAL(Test->Data.BackBufferPixelSize, 1);
+  UT_ASSERT_EQUAL(Test->Data.BackBufferStride, ALIGN_VALUE(Test->Width, GAME_GRAPHICS_LIB_BACK_BUFFER_ALIGNMENT));
+  UT_ASSERT_EQUAL(Test->Data.SizeOfBackBuffer, (UINTN)Test->Data.BackBufferStride * Test->Height);
+  UT_ASSERT_STATUS_EQUAL(SetPaletteColors(&Test->Data, GAME_GRAPHICS_LIB_PALETTE_SIZE - 1, 2, Colors), EFI_INVALID_PARAMETER);
+
+  // Colors that are not in the palette are drawn with the closest entry
+  UT_ASSERT_NOT_EFI_ERROR(ClearScreen(&Test->Data));
+  UT_ASSERT_NOT_EFI_ERROR(DrawRectangle(&Test->Data, 3, 7, 91, 33, &Colors[1]));
+  UT_ASSERT_NOT_EFI_ERROR(DrawRectangle(&Test->Data, 200, 100, 50, 50, &Pink));
+  UT_ASSERT_NOT_EFI_ERROR(DrawText(&Test->Data, 40, 60, "Palette", &Colors[2], &Colors[0], 2));
+  Indices = (UINT8 *)Test->Data.BackBuffer;
+  UT_ASSERT_EQUAL(Indices[0], 0);
+  UT_ASSERT_EQUAL(Indices[7 * Test->Data.BackBufferStride + 3], 1);
+  UT_ASSERT_EQUAL(Indices[149 * Test->Data.BackBufferStride + 249], 3);
+
+  UT_ASSERT_NOT_EFI_ERROR(UpdateVideoBuffer(&Test->Data));
+  UT_ASSERT_TRUE(ScreenShowsPaletteColors(Test, Colors));
+
+  if (Test->Data.DirectPresentSupported)
+  {
+    BltCrc = MockGraphicsOutputFrameBufferCrc();
+    ZeroMem(gMockGraphicsOutput.FrameBuffer, (UINTN)Test->PixelsPerScanLine * Test->Height * sizeof(UINT32));
+    MockGraphicsOutputResetRecords();
+    UT_ASSERT_NOT_EFI_ERROR(SetPresentMode(&Test->Data, GameGraphicsPresentDirect));
+    UT_ASSERT_NOT_EFI_ERROR(UpdateVideoBuffer(&Test->Data));
+    UT_ASSERT_EQUAL(gMockGraphicsOutput.BltCount, 0);
+    UT_ASSERT_EQUAL(MockGraphicsOutputFrameBufferCrc(), BltCrc);
+  }
+
+  // A new color of an entry reaches every pixel that uses it with the next present, nothing is drawn again
+  Test->Data.Damage.Count = 0;
+  UT_ASSERT_NOT_EFI_ERROR(SetPaletteColors(&Test->Data, 1, 1, &Orange));
+  Colors[1] = Orange;
+  UT_ASSERT_EQUAL(Test->Data.Damage.Count, 1);
+  UT_ASSERT_NOT_EFI_ERROR(PresentDamage(&Test->Data));
+  UT_ASSERT_TRUE(ScreenShowsPaletteColors(Test, Colors));
+
+  UT_ASSERT_NOT_EFI_ERROR(DisablePaletteMode(&Test->Data));
+  UT_ASSERT_EQUAL(Test->Data.Palette, NULL);
+  UT_ASSERT_EQUAL(Test->Data.BackBufferPixelSize, sizeof(EFI_GRAPHICS_OUTPUT_BLT_PIXEL));
+  UT_ASSERT_EQUAL(Test->Data.SizeOfBackBuffer, (UINTN)Test->Data.BackBufferStride * Test->Height * sizeof(EFI_GRAPHICS_OUTPUT_BLT_PIXEL));
+  UT_ASSERT_NOT_EFI_ERROR(DrawRectangle(&Test->Data, 10, 10, 20, 20, &Pink));
+  UT_ASSERT_MEM_EQUAL(&Test->Data.BackBuffer[10 * Test->Data.BackBufferStride + 10], &Pink, sizeof(Pink));
+
+  return UNIT_TEST_PASSED;
+}
+
+UNIT_TEST_STATUS
+EFIAPI
+PaletteScaledPresentReplicatesPixels(
+    IN UNIT_TEST_CONTEXT Context)
+{
+  GRAPHICS_TEST_CONTEXT *Test = (GRAPHICS_TEST_CONTEXT *)Context;
+  EFI_GRAPHICS_OUTPUT_BLT_PIXEL Colors[3] = {{0, 0, 0, 0}, {0, 0, 255, 0}, {160, 128, 0, 0}};
+  EFI_GRAPHICS_OUTPUT_BLT_PIXEL White = {255, 255, 255, 0};
+
+  UT_ASSERT_NOT_EFI_ERROR(DrawRectangle(&Test->Data, 0, 0, Test->Width, Test->Height, &White));
+  UT_ASSERT_NOT_EFI_ERROR(UpdateVideoBuffer(&Test->Data));
+
+  // The palette keeps the render resolution, and the render resolution keeps the palette
+  UT_ASSERT_NOT_EFI_ERROR(SetRenderResolution(&Test->Data, 100, 60));
+  UT_ASSERT_NOT_EFI_ERROR(EnablePaletteMode(&Test->Data, Colors, ARRAY_SIZE(Colors)));
+  UT_ASSERT_EQUAL(Test->Data.Screen.HorizontalResolution, 100);
+  UT_ASSERT_EQUAL(Test->Data.Scale, 3);
+  UT_ASSERT_NOT_EFI_ERROR(SetRenderResolution(&Test->Data, 99, 61));
+  UT_ASSERT_EQUAL(Test->Data.BackBufferPixelSize, 1);
+  UT_ASSERT_EQUAL(Test->Data.BackBufferStride, 128);
+
+  UT_ASSERT_NOT_EFI_ERROR(ClearScreen(&Test->Data));
+  UT_ASSERT_NOT_EFI_ERROR(DrawRectangle(&Test->Data, 3, 7, 41, 33, &Colors[1]));
+  UT_ASSERT_NOT_EFI_ERROR(DrawText(&Test->Data, 20, 30, "Scaled", &Colors[2], &Colors[0], 1));
+  if (Test->Data.DirectPresentSupported)
+  {
+    UT_ASSERT_NOT_EFI_ERROR(SetPresentMode(&Test->Data, GameGraphicsPresentDirect));
+  }
+  UT_ASSERT_NOT_EFI_ERROR(PresentDamage(&Test->Data));
+  UT_ASSERT_TRUE(ScreenShowsPaletteColors(Test, Colors));
+
+  return UNIT_TEST_PASSED;
+}
+
+/**
+  Registers and runs all test suites.
+
+  @retval EFI_SUCCESS           All test suites were run.
+  @retval EFI_OUT_OF_RESOURCES  There was not enough memory to register the tests.
+
+**/
+EFI_STATUS
+EFIAPI
+UefiTestMain(
+    VOID)
+{
+  EFI_STATUS Status;
+  UNIT_TEST_FRAMEWORK_HANDLE Framework = NULL;
+  UNIT_TEST_SUITE_HANDLE DrawingTests;
+  UNIT_TEST_SUITE_HANDLE PresentTests;
+  UNIT_TEST_SUITE_HANDLE RgbPresentTests;
+  UNIT_TEST_SUITE_HANDLE BitMaskPresentTests;
+  UNIT_TEST_SUITE_HANDLE BltOnlyTests;
+  UNIT_TEST_SUITE_HANDLE PaletteTests;
+  UNIT_TEST_SUITE_HANDLE LayerTests;
+
+  DEBUG((DEBUG_INFO, "%a v%a\n", UNIT_TEST_NAME, UNIT_TEST_VERSION));
+
+  Status = InitUnitTestFramework(&Framework, UNIT_TEST_NAME, gEfiCallerBaseName, UNIT_TEST_VERSION);
+  if (EFI_ERROR(Status))
+  {
+    DEBUG((DEBUG_ERROR, "UefiTestMain: Failed to initialize the unit test framework: %r\n", Status));
+    goto Exit;
+  }
+
+  Status = CreateUnitTestSuite(&DrawingTests, Framework, "Drawing primitives", "GameGraphicsLib.Drawing", NULL, NULL);
+  if (EFI_ERROR(Status))
+  {
+    goto Exit;
+  }
+  AddTestCase(DrawingTests, "InitializeGraphicMode reads the current mode", "Initialize", InitializeGraphicModeReadsMode, InitializeGraphicsPrerequisite, FinishGraphicsCleanup, &mBgrContext);
+  AddTestCase(DrawingTests, "SelectGraphicMode picks the cheapest mode", "SelectGraphicMode", SelectGraphicModePicksCheapestMode, InitializeGraphicsPrerequisite, FinishGraphicsCleanup, &mBgrContext);
+  AddTestCase(DrawingTests, "ClearScreen matches the golden CRC", "ClearScreen", ClearScreenMatchesGolden, InitializeGraphicsPrerequisite, FinishGraphicsCleanup, &mBgrContext);
+  AddTestCase(DrawingTests, "DrawRectangle matches the golden CRC", "DrawRectangle", DrawRectangleMatchesGolden, InitializeGraphicsPrerequisite, FinishGraphicsCleanup, &mBgrContext);
+  AddTestCase(DrawingTests, "DrawGrid matches the golden CRC", "DrawGrid", DrawGridMatchesGolden, InitializeGraphicsPrerequisite, FinishGraphicsCleanup, &mBgrContext);
+  AddTestCase(DrawingTests, "Grid patterns are scaled to the cell sizes", "GridPattern", GridPatternsAreScaledToCells, InitializeGraphicsPrerequisite, FinishGraphicsCleanup, &mBgrContext);
+  AddTestCase(DrawingTests, "CreateCustomGrid rejects counts that overflow its tables", "GridLimits", GridRejectsOversizedCounts, InitializeGraphicsPrerequisite, FinishGraphicsCleanup, &mBgrContext);
+  AddTestCase(DrawingTests, "DrawText matches the golden CRC", "DrawText", DrawTextMatchesGolden, InitializeGraphicsPrerequisite, FinishGraphicsCleanup, &mBgrContext);
+  AddTestCase(DrawingTests, "Parallel rendering falls back to the BSP without MP services", "ParallelRendering", ParallelRenderingFallsBackToSerial, InitializeGraphicsPrerequisite, FinishGraphicsCleanup, &mBgrContext);
+
+  Status = CreateUnitTestSuite(&PresentTests, Framework, "Present with a BGR framebuffer", "GameGraphicsLib.Present.Bgr", NULL, NULL);
+  if (EFI_ERROR(Status))
+  {
+    goto Exit;
+  }
+  AddTestCase(PresentTests, "UpdateVideoBuffer copies the screen with one Blt", "UpdateVideoBuffer", UpdateVideoBufferCopiesScreenOnce, InitializeGraphicsPrerequisite, FinishGraphicsCleanup, &mBgrContext);
+  AddTestCase(PresentTests, "SmartUpdateVideoBuffer clips to the screen", "SmartUpdateVideoBuffer", SmartUpdateVideoBufferClips, InitializeGraphicsPrerequisite, FinishGraphicsCleanup, &mBgrContext);
+  AddTestCase(PresentTests, "PresentDamage copies only the damaged areas", "PresentDamage", PresentDamageCopiesDamagedAreas, InitializeGraphicsPrerequisite, FinishGraphicsCleanup, &mBgrContext);
+  AddTestCase(PresentTests, "Direct present matches Blt", "Direct", DirectPresentMatchesBlt, InitializeGraphicsPrerequisite, FinishGraphicsCleanup, &mBgrContext);
+  AddTestCase(PresentTests, "ScrollRectangle moves the screen and the back buffer", "Scroll", ScrollRectangleMovesScreenAndBackBuffer, InitializeGraphicsPrerequisite, FinishGraphicsCleanup, &mBgrContext);
+  AddTestCase(PresentTests, "Scaled present replicates the pixels of the render target", "Scaled", ScaledPresentReplicatesPixels, InitializeGraphicsPrerequisite, FinishGraphicsCleanup, &mBgrContext);
+  AddTestCase(PresentTests, "Unscaled render targets are centered", "Centered", CenteredPresentKeepsOffsets, InitializeGraphicsPrerequisite, FinishGraphicsCleanup, &mBgrContext);
+  AddTestCase(PresentTests, "SetFrameBufferWriteCombining is undone by FinishGraphicMode", "WriteCombining", WriteCombiningIsRestored, InitializeGraphicsPrerequisite, FinishGraphicsCleanup, &mBgrContext);
+  AddTestCase(PresentTests, "SwapAndPresent falls back to PresentDamage without MP services", "SwapAndPresent", SwapAndPresentFallsBackToPresentDamage, InitializeGraphicsPrerequisite, FinishGraphicsCleanup, &mBgrContext);
+
+  Status = CreateUnitTestSuite(&RgbPresentTests, Framework, "Present with a padded RGB framebuffer", "GameGraphicsLib.Present.Rgb", NULL, NULL);
+  if (EFI_ERROR(Status))
+  {
+    goto Exit;
+  }
+  AddTestCase(RgbPresentTests, "InitializeGraphicMode reads the current mode", "Initialize", InitializeGraphicModeReadsMode, InitializeGraphicsPrerequisite, FinishGraphicsCleanup, &mRgbPaddedContext);
+  AddTestCase(RgbPresentTests, "Direct present matches Blt", "Direct", DirectPresentMatchesBlt, InitializeGraphicsPrerequisite, FinishGraphicsCleanup, &mRgbPaddedContext);
+  AddTestCase(RgbPresentTests, "Scaled present replicates the pixels of the render target", "Scaled", ScaledPresentReplicatesPixels, InitializeGraphicsPrerequisite, FinishGraphicsCleanup, &mRgbPaddedContext);
+  AddTestCase(RgbPresentTests, "Unscaled render targets are centered", "Centered", CenteredPresentKeepsOffsets, InitializeGraphicsPrerequisite, FinishGraphicsCleanup, &mRgbPaddedContext);
+
+  Status = CreateUnitTestSuite(&BitMaskPresentTests, Framework, "Present with a PixelBitMask framebuffer", "GameGraphicsLib.Present.BitMask", NULL, NULL);
+  if (EFI_ERROR(Status))
+  {
+    goto Exit;
+  }
+  AddTestCase(BitMaskPresentTests, "InitializeGraphicMode reads the current mode", "Initialize", InitializeGraphicModeReadsMode, InitializeGraphicsPrerequisite, FinishGraphicsCleanup, &mBitMaskContext);
+  AddTestCase(BitMaskPresentTests, "Direct present matches Blt", "Direct", DirectPresentMatchesBlt, InitializeGraphicsPrerequisite, FinishGraphicsCleanup, &mBitMaskContext);
+  AddTestCase(BitMaskPresentTests, "Scaled present replicates the pixels of the render target", "Scaled", ScaledPresentReplicatesPixels, InitializeGraphicsPrerequisite, FinishGraphicsCleanup, &mBitMaskContext);
+  AddTestCase(BitMaskPresentTests, "Unscaled render targets are centered", "Centered", CenteredPresentKeepsOffsets, InitializeGraphicsPrerequisite, FinishGraphicsCleanup, &mBitMaskContext);
+
+  Status = CreateUnitTestSuite(&BltOnlyTests, Framework, "Present without a framebuffer", "GameGraphicsLib.Present.BltOnly", NULL, NULL);
+  if (EFI_ERROR(Status))
+  {
+    goto Exit;
+  }
+  AddTestCase(BltOnlyTests, "InitializeGraphicMode reads the current mode", "Initialize", InitializeGraphicModeReadsMode, InitializeGraphicsPrerequisite, FinishGraphicsCleanup, &mBltOnlyContext);
+  AddTestCase(BltOnlyTests, "Direct present is rejected", "Direct", DirectPresentRequiresFrameBuffer, InitializeGraphicsPrerequisite, FinishGraphicsCleanup, &mBltOnlyContext);
+  AddTestCase(BltOnlyTests, "Scaled present replicates the pixels of the render target", "Scaled", ScaledPresentReplicatesPixels, InitializeGraphicsPrerequisite, FinishGraphicsCleanup, &mBltOnlyContext);
+  AddTestCase(BltOnlyTests, "Unscaled render targets are centered", "Centered", CenteredPresentKeepsOffsets, InitializeGraphicsPrerequisite, FinishGraphicsCleanup, &mBltOnlyContext);
+  AddTestCase(BltOnlyTests, "SwapAndPresent falls back to PresentDamage", "SwapAndPresent", SwapAndPresentFallsBackToPresentDamage, InitializeGraphicsPrerequisite, FinishGraphicsCleanup, &mBltOnlyContext);
+
+  Status = CreateUnitTestSuite(&PaletteTests, Framework, "Palette back buffers", "GameGraphicsLib.Palette", NULL, NULL);
+  if (EFI_ERROR(Status))
+  {
+    goto Exit;
+  }
+  AddTestCase(PaletteTests, "Palette indices are expanded on a BGR framebuffer", "Bgr", PaletteIndicesAreExpanded, InitializeGraphicsPrerequisite, FinishGraphicsCleanup, &mBgrContext);
+  AddTestCase(PaletteTests, "Palette indices are expanded on a PixelBitMask framebuffer", "BitMask", PaletteIndicesAreExpanded, InitializeGraphicsPrerequisite, FinishGraphicsCleanup, &mBitMaskContext);
+  AddTestCase(PaletteTests, "Palette indices are expanded without a framebuffer", "BltOnly", PaletteIndicesAreExpanded, InitializeGraphicsPrerequisite, FinishGraphicsCleanup, &mBltOnlyContext);
+  AddTestCase(PaletteTests, "Scaled present expands the palette on a padded RGB framebuffer", "Scaled", PaletteScaledPresentReplicatesPixels, InitializeGraphicsPrerequisite, FinishGraphicsCleanup, &mRgbPaddedContext);
+  AddTestCase(PaletteTests, "Scaled present expands the palette without a framebuffer", "ScaledBltOnly", PaletteScaledPresentReplicatesPixels, InitializeGraphicsPrerequisite, FinishGraphicsCleanup, &mBltOnlyContext);
+
+  Status = CreateUnitTestSuite(&LayerTests, Framework, "Layers", "GameGraphicsLib.Layers", NULL, NULL);
+  if (EFI_ERROR(Status))
+  {
+    goto Exit;
+  }
+  AddTestCase(LayerTests, "Layers are composited in z order and only where they changed", "Composite", LayersAreCompositedInOrder, InitializeGraphicsPrerequisite, FinishGraphicsCleanup, &mBgrContext);
+  AddTestCase(LayerTests, "Color keys of palette layers are compared as indices", "Palette", LayersKeyPaletteIndices, InitializeGraphicsPrerequisite, FinishGraphicsCleanup, &mBitMaskContext);
+
+  Status = RunAllTestSuites(Framework);
+
+Exit:
+  if (Framework != NULL)
+  {
+    FreeUnitTestFramework(Framework);
+  }
+
+  return Status;
+}
+
+/**
+  Standard POSIX C entry point for host based unit test execution.
+**/
+int main(
+    int argc,
+    char *argv[])
+{
+  return UefiTestMain();
+}
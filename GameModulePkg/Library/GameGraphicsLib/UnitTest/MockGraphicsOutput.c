@@ -0,0 +1,567 @@
+#include <Uefi.h>
+#include <Pi/PiDxeCis.h>
+#include <Protocol/GraphicsOutput.h>
+#include <Library/BaseLib.h>
+#include <Library/BaseMemoryLib.h>
+#include <Library/MemoryAllocationLib.h>
+#include <Library/DebugLib.h>
+#include "MockGraphicsOutput.h"
+
+MOCK_GRAPHICS_OUTPUT gMockGraphicsOutput;
+
+STATIC EFI_BOOT_SERVICES mMockBootServices;
+STATIC EFI_SYSTEM_TABLE mMockSystemTable;
+STATIC EFI_DXE_SERVICES mMockDxeServices;
+
+// Normally provided by UefiBootServicesTableLib, which host applications can not use
+EFI_HANDLE gImageHandle = NULL;
+EFI_SYSTEM_TABLE *gST = NULL;
+EFI_BOOT_SERVICES *gBS = NULL;
+
+// Normally provided by DxeServicesTableLib
+EFI_DXE_SERVICES *gDS = NULL;
+
+/// @brief Converts a BLT pixel to the pixel format of the framebuffer
+STATIC
+UINT32
+ToFrameBufferPixel(
+    IN EFI_GRAPHICS_OUTPUT_BLT_PIXEL *Pixel)
+{
+  if (gMockGraphicsOutput.Info.PixelFormat == PixelRedGreenBlueReserved8BitPerColor)
+  {
+    return Pixel->Red | ((UINT32)Pixel->Green << 8) | ((UINT32)Pixel->Blue << 16);
+  }
+
+  // The 8 bits of a channel are the top bits of its 10 bit field, the low bits stay 0
+  if (gMockGraphicsOutput.Info.PixelFormat == PixelBitMask)
+  {
+    return ((UINT32)Pixel->Blue << 2) | ((UINT32)Pixel->Green << 12) | ((UINT32)Pixel->Red << 22);
+  }
+
+  return Pixel->Blue | ((UINT32)Pixel->Green << 8) | ((UINT32)Pixel->Red << 16);
+}
+
+/// @brief Converts a framebuffer pixel back to a BLT pixel
+STATIC
+VOID
+FromFrameBufferPixel(
+    IN UINT32 Value,
+    OUT EFI_GRAPHICS_OUTPUT_BLT_PIXEL *Pixel)
+{
+  Pixel->Green = (UINT8)(Value >> 8);
+  Pixel->Reserved = 0;
+  if (gMockGraphicsOutput.Info.PixelFormat == PixelBitMask)
+  {
+    Pixel->Blue = (UINT8)(Value >> 2);
+    Pixel->Green = (UINT8)(Value >> 12);
+    Pixel->Red = (UINT8)(Value >> 22);
+  }
+  else if (gMockGraphicsOutput.Info.PixelFormat == PixelRedGreenBlueReserved8BitPerColor)
+  {
+    Pixel->Red = (UINT8)Value;
+    Pixel->Blue = (UINT8)(Value >> 16);
+  }
+  else
+  {
+    Pixel->Blue = (UINT8)Value;
+    Pixel->Red = (UINT8)(Value >> 16);
+  }
+}
+
+STATIC
+EFI_STATUS
+EFIAPI
+MockQueryMode(
+    IN EFI_GRAPHICS_OUTPUT_PROTOCOL *This,
+    IN UINT32 ModeNumber,
+    OUT UINTN *SizeOfInfo,
+    OUT EFI_GRAPHICS_OUTPUT_MODE_INFORMATION **Info)
+{
+  if ((SizeOfInfo == NULL) || (Info == NULL) || (ModeNumber >= This->Mode->MaxMode))
+  {
+    return EFI_INVALID_PARAMETER;
+  }
+
+  *SizeOfInfo = sizeof(EFI_GRAPHICS_OUTPUT_MODE_INFORMATION);
+  *Info = AllocateCopyPool(sizeof(EFI_GRAPHICS_OUTPUT_MODE_INFORMATION), &gMockGraphicsOutput.Modes[ModeNumber]);
+  return (*Info == NULL) ? EFI_OUT_OF_RESOURCES : EFI_SUCCESS;
+}
+
+/// @brief Checks the parameters of a mode passed to MockGraphicsOutputInitialize or MockGraphicsOutputAddMode
+STATIC
+BOOLEAN
+IsValidMode(
+    IN UINT32 Width,
+    IN UINT32 Height,
+    IN EFI_GRAPHICS_PIXEL_FORMAT PixelFormat,
+    IN UINT32 PixelsPerScanLine)
+{
+  return (Width != 0) && (Height != 0) && (PixelsPerScanLine >= Width) &&
+         ((PixelFormat == PixelBlueGreenRedReserved8BitPerColor) ||
+          (PixelFormat == PixelRedGreenBlueReserved8BitPerColor) ||
+          (PixelFormat == PixelBitMask) ||
+          (PixelFormat == PixelBltOnly));
+}
+
+/// @brief Stores the parameters of a mode, PixelBitMask modes get the masks of MOCK_GRAPHICS_OUTPUT_BIT_MASK_*
+STATIC
+VOID
+SetModeInformation(
+    OUT EFI_GRAPHICS_OUTPUT_MODE_INFORMATION *Info,
+    IN UINT32 Width,
+    IN UINT32 Height,
+    IN EFI_GRAPHICS_PIXEL_FORMAT PixelFormat,
+    IN UINT32 PixelsPerScanLine)
+{
+  ZeroMem(Info, sizeof(EFI_GRAPHICS_OUTPUT_MODE_INFORMATION));
+  Info->HorizontalResolution = Width;
+  Info->VerticalResolution = Height;
+  Info->PixelFormat = PixelFormat;
+  Info->PixelsPerScanLine = PixelsPerScanLine;
+  if (PixelFormat == PixelBitMask)
+  {
+    Info->PixelInformation.RedMask = MOCK_GRAPHICS_OUTPUT_BIT_MASK_RED;
+    Info->PixelInformation.GreenMask = MOCK_GRAPHICS_OUTPUT_BIT_MASK_GREEN;
+    Info->PixelInformation.BlueMask = MOCK_GRAPHICS_OUTPUT_BIT_MASK_BLUE;
+  }
+}
+
+/// @brief Replaces the framebuffer with a black one of the given mode and makes it the current mode
+STATIC
+EFI_STATUS
+SwitchMode(
+    IN UINT32 ModeNumber)
+{
+  MOCK_GRAPHICS_OUTPUT *Mock = &gMockGraphicsOutput;
+  EFI_GRAPHICS_OUTPUT_MODE_INFORMATION *Info = &Mock->Modes[ModeNumber];
+  UINT32 *FrameBuffer;
+
+  FrameBuffer = AllocateZeroPool((UINTN)Info->PixelsPerScanLine * Info->VerticalResolution * sizeof(UINT32));
+  if (FrameBuffer == NULL)
+  {
+    return EFI_OUT_OF_RESOURCES;
+  }
+
+  if (Mock->FrameBuffer != NULL)
+  {
+    FreePool(Mock->FrameBuffer);
+  }
+  Mock->FrameBuffer = FrameBuffer;
+  Mock->Info = *Info;
+  Mock->Mode.Mode = ModeNumber;
+  Mock->Mode.FrameBufferBase = 0;
+  Mock->Mode.FrameBufferSize = 0;
+  Mock->FrameBufferAttributes = MOCK_GRAPHICS_OUTPUT_FRAME_BUFFER_ATTRIBUTES;
+  if (Info->PixelFormat != PixelBltOnly)
+  {
+    Mock->Mode.FrameBufferBase = (EFI_PHYSICAL_ADDRESS)(UINTN)FrameBuffer;
+    Mock->Mode.FrameBufferSize = (UINTN)Info->PixelsPerScanLine * Info->VerticalResolution * sizeof(UINT32);
+  }
+
+  return EFI_SUCCESS;
+}
+
+STATIC
+EFI_STATUS
+EFIAPI
+MockSetMode(
+    IN EFI_GRAPHICS_OUTPUT_PROTOCOL *This,
+    IN UINT32 ModeNumber)
+{
+  EFI_STATUS Status;
+
+  if (ModeNumber >= This->Mode->MaxMode)
+  {
+    return EFI_UNSUPPORTED;
+  }
+
+  // Like the firmware, setting a mode clears the screen even if it is the current one
+  Status = SwitchMode(ModeNumber);
+  if (!EFI_ERROR(Status))
+  {
+    gMockGraphicsOutput.SetModeCount++;
+  }
+
+  return Status;
+}
+
+STATIC
+EFI_STATUS
+EFIAPI
+MockBlt(
+    IN EFI_GRAPHICS_OUTPUT_PROTOCOL *This,
+    IN OUT EFI_GRAPHICS_OUTPUT_BLT_PIXEL *BltBuffer OPTIONAL,
+    IN EFI_GRAPHICS_OUTPUT_BLT_OPERATION BltOperation,
+    IN UINTN SourceX,
+    IN UINTN SourceY,
+    IN UINTN DestinationX,
+    IN UINTN DestinationY,
+    IN UINTN Width,
+    IN UINTN Height,
+    IN UINTN Delta OPTIONAL)
+{
+  MOCK_GRAPHICS_OUTPUT *Mock = &gMockGraphicsOutput;
+  UINTN Stride = Mock->Info.PixelsPerScanLine;
+  UINTN ScreenWidth = Mock->Info.HorizontalResolution;
+  UINTN ScreenHeight = Mock->Info.VerticalResolution;
+  EFI_GRAPHICS_OUTPUT_BLT_PIXEL *Row;
+  MOCK_BLT_RECORD *Record;
+
+  if ((BltOperation >= EfiGraphicsOutputBltOperationMax) || (Width == 0) || (Height == 0))
+  {
+    return EFI_INVALID_PARAMETER;
+  }
+
+  if (Delta == 0)
+  {
+    Delta = Width * sizeof(EFI_GRAPHICS_OUTPUT_BLT_PIXEL);
+  }
+
+  // Same checks as the firmware, areas on the screen have to be inside of it
+  if ((BltOperation == EfiBltVideoToBltBuffer) || (BltOperation == EfiBltVideoToVideo))
+  {
+    if ((SourceX + Width > ScreenWidth) || (SourceY + Height > ScreenHeight))
+    {
+      return EFI_INVALID_PARAMETER;
+    }
+  }
+  if (BltOperation != EfiBltVideoToBltBuffer)
+  {
+    if ((DestinationX + Width > ScreenWidth) || (DestinationY + Height > ScreenHeight))
+    {
+      return EFI_INVALID_PARAMETER;
+    }
+  }
+
+  if (Mock->BltCount < MOCK_GRAPHICS_OUTPUT_MAX_BLT_RECORDS)
+  {
+    Record = &Mock->Records[Mock->BltCount];
+    Record->Operation = BltOperation;
+    Record->SourceX = SourceX;
+    Record->SourceY = SourceY;
+    Record->DestinationX = DestinationX;
+    Record->DestinationY = DestinationY;
+    Record->Width = Width;
+    Record->Height = Height;
+    Record->Bytes = (UINT64)Width * Height * sizeof(EFI_GRAPHICS_OUTPUT_BLT_PIXEL);
+  }
+  Mock->BltCount++;
+  Mock->BltBytes += (UINT64)Width * Height * sizeof(EFI_GRAPHICS_OUTPUT_BLT_PIXEL);
+
+  switch (BltOperation)
+  {
+  case EfiBltVideoFill:
+    for (UINTN y = 0; y < Height; y++)
+    {
+      for (UINTN x = 0; x < Width; x++)
+      {
+        Mock->FrameBuffer[(DestinationY + y) * Stride + DestinationX + x] = ToFrameBufferPixel(BltBuffer);
+      }
+    }
+    break;
+
+  case EfiBltVideoToBltBuffer:
+    for (UINTN y = 0; y < Height; y++)
+    {
+      Row = (EFI_GRAPHICS_OUTPUT_BLT_PIXEL *)((UINT8 *)BltBuffer + (DestinationY + y) * Delta);
+      for (UINTN x = 0; x < Width; x++)
+      {
+        FromFrameBufferPixel(Mock->FrameBuffer[(SourceY + y) * Stride + SourceX + x], &Row[DestinationX + x]);
+      }
+    }
+    break;
+
+  case EfiBltBufferToVideo:
+    for (UINTN y = 0; y < Height; y++)
+    {
+      Row = (EFI_GRAPHICS_OUTPUT_BLT_PIXEL *)((UINT8 *)BltBuffer + (SourceY + y) * Delta);
+      for (UINTN x = 0; x < Width; x++)
+      {
+        Mock->FrameBuffer[(DestinationY + y) * Stride + DestinationX + x] = ToFrameBufferPixel(&Row[SourceX + x]);
+      }
+    }
+    break;
+
+  default:
+    // Overlapping areas are copied the same way as CopyMem, rows in the right order
+    if (DestinationY <= SourceY)
+    {
+      for (UINTN y = 0; y < Height; y++)
+      {
+        CopyMem(&Mock->FrameBuffer[(DestinationY + y) * Stride + DestinationX], &Mock->FrameBuffer[(SourceY + y) * Stride + SourceX], Width * sizeof(UINT32));
+      }
+    }
+    else
+    {
+      for (UINTN y = Height; y > 0; y--)
+      {
+        CopyMem(&Mock->FrameBuffer[(DestinationY + y - 1) * Stride + DestinationX], &Mock->FrameBuffer[(SourceY + y - 1) * Stride + SourceX], Width * sizeof(UINT32));
+      }
+    }
+    break;
+  }
+
+  return EFI_SUCCESS;
+}
+
+STATIC
+EFI_STATUS
+EFIAPI
+MockLocateProtocol(
+    IN EFI_GUID *Protocol,
+    IN VOID *Registration OPTIONAL,
+    OUT VOID **Interface)
+{
+  if ((Protocol == NULL) || (Interface == NULL))
+  {
+    return EFI_INVALID_PARAMETER;
+  }
+
+  if (!CompareGuid(Protocol, &gEfiGraphicsOutputProtocolGuid) || (gMockGraphicsOutput.FrameBuffer == NULL))
+  {
+    *Interface = NULL;
+    return EFI_NOT_FOUND;
+  }
+
+  *Interface = &gMockGraphicsOutput.Protocol;
+  return EFI_SUCCESS;
+}
+
+STATIC
+EFI_STATUS
+EFIAPI
+MockAllocatePages(
+    IN EFI_ALLOCATE_TYPE Type,
+    IN EFI_MEMORY_TYPE MemoryType,
+    IN UINTN Pages,
+    IN OUT EFI_PHYSICAL_ADDRESS *Memory)
+{
+  VOID *Buffer;
+
+  if (Type != AllocateAnyPages)
+  {
+    return EFI_UNSUPPORTED;
+  }
+
+  Buffer = AllocateAlignedPages(Pages, EFI_PAGE_SIZE);
+  if (Buffer == NULL)
+  {
+    return EFI_OUT_OF_RESOURCES;
+  }
+
+  *Memory = (EFI_PHYSICAL_ADDRESS)(UINTN)Buffer;
+  return EFI_SUCCESS;
+}
+
+STATIC
+EFI_STATUS
+EFIAPI
+MockFreePages(
+    IN EFI_PHYSICAL_ADDRESS Memory,
+    IN UINTN Pages)
+{
+  FreeAlignedPages((VOID *)(UINTN)Memory, Pages);
+  return EFI_SUCCESS;
+}
+
+/// @brief Checks that a range of the GCD memory space is the framebuffer of the current mode
+STATIC
+BOOLEAN
+IsFrameBufferRange(
+    IN EFI_PHYSICAL_ADDRESS BaseAddress,
+    IN UINT64 Length)
+{
+  EFI_GRAPHICS_OUTPUT_PROTOCOL_MODE *Mode = &gMockGraphicsOutput.Mode;
+
+  return (Mode->FrameBufferBase != 0) && (BaseAddress >= Mode->FrameBufferBase) &&
+         (BaseAddress + Length <= Mode->FrameBufferBase + EFI_PAGES_TO_SIZE(EFI_SIZE_TO_PAGES(Mode->FrameBufferSize)));
+}
+
+STATIC
+EFI_STATUS
+EFIAPI
+MockGetMemorySpaceDescriptor(
+    IN EFI_PHYSICAL_ADDRESS BaseAddress,
+    OUT EFI_GCD_MEMORY_SPACE_DESCRIPTOR *Descriptor)
+{
+  if (!IsFrameBufferRange(BaseAddress, 1))
+  {
+    return EFI_NOT_FOUND;
+  }
+
+  ZeroMem(Descriptor, sizeof(EFI_GCD_MEMORY_SPACE_DESCRIPTOR));
+  Descriptor->BaseAddress = gMockGraphicsOutput.Mode.FrameBufferBase;
+  Descriptor->Length = EFI_PAGES_TO_SIZE(EFI_SIZE_TO_PAGES(gMockGraphicsOutput.Mode.FrameBufferSize));
+  Descriptor->Capabilities = MOCK_GRAPHICS_OUTPUT_FRAME_BUFFER_CAPABILITIES;
+  Descriptor->Attributes = gMockGraphicsOutput.FrameBufferAttributes;
+  Descriptor->GcdMemoryType = EfiGcdMemoryTypeMemoryMappedIo;
+  return EFI_SUCCESS;
+}
+
+STATIC
+EFI_STATUS
+EFIAPI
+MockSetMemorySpaceAttributes(
+    IN EFI_PHYSICAL_ADDRESS BaseAddress,
+    IN UINT64 Length,
+    IN UINT64 Attributes)
+{
+  // Like the GCD services, only the framebuffer as a whole is accepted and only supported attributes
+  if (!IsFrameBufferRange(BaseAddress, Length) || (BaseAddress != gMockGraphicsOutput.Mode.FrameBufferBase) ||
+      ((Attributes & ~MOCK_GRAPHICS_OUTPUT_FRAME_BUFFER_CAPABILITIES) != 0))
+  {
+    return EFI_UNSUPPORTED;
+  }
+
+  gMockGraphicsOutput.FrameBufferAttributes = Attributes;
+  gMockGraphicsOutput.SetAttributesCount++;
+  return EFI_SUCCESS;
+}
+
+STATIC
+EFI_STATUS
+EFIAPI
+MockAllocatePool(
+    IN EFI_MEMORY_TYPE PoolType,
+    IN UINTN Size,
+    OUT VOID **Buffer)
+{
+  *Buffer = AllocatePool(Size);
+  return (*Buffer == NULL) ? EFI_OUT_OF_RESOURCES : EFI_SUCCESS;
+}
+
+STATIC
+EFI_STATUS
+EFIAPI
+MockFreePool(
+    IN VOID *Buffer)
+{
+  FreePool(Buffer);
+  return EFI_SUCCESS;
+}
+
+EFI_STATUS
+EFIAPI
+MockGraphicsOutputInitialize(
+    IN UINT32 Width,
+    IN UINT32 Height,
+    IN EFI_GRAPHICS_PIXEL_FORMAT PixelFormat,
+    IN UINT32 PixelsPerScanLine)
+{
+  MOCK_GRAPHICS_OUTPUT *Mock = &gMockGraphicsOutput;
+  EFI_STATUS Status;
+
+  if (!IsValidMode(Width, Height, PixelFormat, PixelsPerScanLine))
+  {
+    return EFI_INVALID_PARAMETER;
+  }
+
+  ZeroMem(Mock, sizeof(MOCK_GRAPHICS_OUTPUT));
+  SetModeInformation(&Mock->Modes[0], Width, Height, PixelFormat, PixelsPerScanLine);
+
+  Mock->Mode.MaxMode = 1;
+  Mock->Mode.Info = &Mock->Info;
+  Mock->Mode.SizeOfInfo = sizeof(EFI_GRAPHICS_OUTPUT_MODE_INFORMATION);
+  Status = SwitchMode(0);
+  if (EFI_ERROR(Status))
+  {
+    return Status;
+  }
+
+  Mock->Protocol.QueryMode = MockQueryMode;
+  Mock->Protocol.SetMode = MockSetMode;
+  Mock->Protocol.Blt = MockBlt;
+  Mock->Protocol.Mode = &Mock->Mode;
+
+  ZeroMem(&mMockBootServices, sizeof(mMockBootServices));
+  mMockBootServices.LocateProtocol = MockLocateProtocol;
+  mMockBootServices.AllocatePool = MockAllocatePool;
+  mMockBootServices.FreePool = MockFreePool;
+  mMockBootServices.AllocatePages = MockAllocatePages;
+  mMockBootServices.FreePages = MockFreePages;
+
+  ZeroMem(&mMockDxeServices, sizeof(mMockDxeServices));
+  mMockDxeServices.GetMemorySpaceDescriptor = MockGetMemorySpaceDescriptor;
+  mMockDxeServices.SetMemorySpaceAttributes = MockSetMemorySpaceAttributes;
+
+  ZeroMem(&mMockSystemTable, sizeof(mMockSystemTable));
+  mMockSystemTable.BootServices = &mMockBootServices;
+
+  gST = &mMockSystemTable;
+  gBS = &mMockBootServices;
+  gDS = &mMockDxeServices;
+
+  return EFI_SUCCESS;
+}
+
+EFI_STATUS
+EFIAPI
+MockGraphicsOutputAddMode(
+    IN UINT32 Width,
+    IN UINT32 Height,
+    IN EFI_GRAPHICS_PIXEL_FORMAT PixelFormat,
+    IN UINT32 PixelsPerScanLine)
+{
+  MOCK_GRAPHICS_OUTPUT *Mock = &gMockGraphicsOutput;
+
+  if (!IsValidMode(Width, Height, PixelFormat, PixelsPerScanLine))
+  {
+    return EFI_INVALID_PARAMETER;
+  }
+
+  if (Mock->Mode.MaxMode >= MOCK_GRAPHICS_OUTPUT_MAX_MODES)
+  {
+    return EFI_OUT_OF_RESOURCES;
+  }
+
+  SetModeInformation(&Mock->Modes[Mock->Mode.MaxMode], Width, Height, PixelFormat, PixelsPerScanLine);
+  Mock->Mode.MaxMode++;
+
+  return EFI_SUCCESS;
+}
+
+VOID
+EFIAPI
+MockGraphicsOutputResetRecords(
+    VOID)
+{
+  gMockGraphicsOutput.BltCount = 0;
+  gMockGraphicsOutput.BltBytes = 0;
+}
+
+UINT32
+EFIAPI
+MockGraphicsOutputFrameBufferCrc(
+    VOID)
+{
+  MOCK_GRAPHICS_OUTPUT *Mock = &gMockGraphicsOutput;
+  UINT32 *Visible;
+  UINT32 Crc;
+
+  // The padding at the end of the rows is never written, so it is left out
+  Visible = AllocatePool((UINTN)Mock->Info.HorizontalResolution * Mock->Info.VerticalResolution * sizeof(UINT32));
+  ASSERT(Visible != NULL);
+  for (UINTN y = 0; y < Mock->Info.VerticalResolution; y++)
+  {
+    CopyMem(&Visible[y * Mock->Info.HorizontalResolution], &Mock->FrameBuffer[y * Mock->Info.PixelsPerScanLine], Mock->Info.HorizontalResolution * sizeof(UINT32));
+  }
+
+  Crc = CalculateCrc32(Visible, (UINTN)Mock->Info.HorizontalResolution * Mock->Info.VerticalResolution * sizeof(UINT32));
+  FreePool(Visible);
+  return Crc;
+}
+
+VOID
+EFIAPI
+MockGraphicsOutputFree(
+    VOID)
+{
+  if (gMockGraphicsOutput.FrameBuffer != NULL)
+  {
+    FreePool(gMockGraphicsOutput.FrameBuffer);
+  }
+
+  ZeroMem(&gMockGraphicsOutput, sizeof(MOCK_GRAPHICS_OUTPUT));
+  gBS = NULL;
+  gST = NULL;
+}
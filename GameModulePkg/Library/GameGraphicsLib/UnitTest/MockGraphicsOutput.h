@@ -0,0 +1,111 @@
+#ifndef _MOCK_GRAPHICS_OUTPUT_H_
+#define _MOCK_GRAPHICS_OUTPUT_H_
+
+/// @file
+/// Mock Graphics Output Protocol for host based tests of GameGraphicsLib
+/// The mock owns a linear framebuffer in host memory and records every Blt call, so tests can check
+/// both what was copied to the screen and how. SetMode replaces the framebuffer with a black one of the new mode. gBS only provides the services GameGraphicsLib uses:
+/// LocateProtocol finds the mock, AllocatePool, FreePool, AllocatePages and FreePages use MemoryAllocationLib.
+/// gDS describes the framebuffer as uncached MMIO that can be switched to the other cache types.
+
+#include <Uefi.h>
+#include <Pi/PiDxeCis.h>
+#include <Protocol/GraphicsOutput.h>
+
+/// @brief Number of Blt calls that are recorded, later calls are only counted
+#define MOCK_GRAPHICS_OUTPUT_MAX_BLT_RECORDS 256
+
+/// @brief Number of modes the mock can report, see MockGraphicsOutputAddMode
+#define MOCK_GRAPHICS_OUTPUT_MAX_MODES 8
+
+/// @brief Channel masks of PixelBitMask modes, 10 bits per channel with blue in the low bits
+#define MOCK_GRAPHICS_OUTPUT_BIT_MASK_RED   0x3FF00000
+#define MOCK_GRAPHICS_OUTPUT_BIT_MASK_GREEN 0x000FFC00
+#define MOCK_GRAPHICS_OUTPUT_BIT_MASK_BLUE  0x000003FF
+
+/// @brief GCD memory attributes of a framebuffer after SetMode, and the attributes it supports
+#define MOCK_GRAPHICS_OUTPUT_FRAME_BUFFER_ATTRIBUTES   (EFI_MEMORY_UC | EFI_MEMORY_XP)
+#define MOCK_GRAPHICS_OUTPUT_FRAME_BUFFER_CAPABILITIES (EFI_MEMORY_UC | EFI_MEMORY_WC | EFI_MEMORY_WT | EFI_MEMORY_WB | EFI_MEMORY_XP)
+
+/// @brief One call of Blt
+typedef struct
+{
+    EFI_GRAPHICS_OUTPUT_BLT_OPERATION Operation;
+    UINTN SourceX;
+    UINTN SourceY;
+    UINTN DestinationX;
+    UINTN DestinationY;
+    UINTN Width;
+    UINTN Height;
+    UINT64 Bytes; // Size of the copied or filled area in BLT pixels
+} MOCK_BLT_RECORD;
+
+/// @brief State of the mock
+typedef struct
+{
+    EFI_GRAPHICS_OUTPUT_PROTOCOL Protocol;
+    EFI_GRAPHICS_OUTPUT_PROTOCOL_MODE Mode;
+    EFI_GRAPHICS_OUTPUT_MODE_INFORMATION Info;                 // Current mode, a copy of one of Modes
+    EFI_GRAPHICS_OUTPUT_MODE_INFORMATION Modes[MOCK_GRAPHICS_OUTPUT_MAX_MODES]; // Mode.MaxMode entries, returned by QueryMode
+    UINTN SetModeCount;                                        // Number of successful SetMode calls
+    UINT32 *FrameBuffer;                                       // Video memory in the pixel format of Info, PixelsPerScanLine pixels per row
+    UINT64 FrameBufferAttributes;                              // GCD memory attributes of the framebuffer
+    UINTN SetAttributesCount;                                  // Number of successful SetMemorySpaceAttributes calls
+    MOCK_BLT_RECORD Records[MOCK_GRAPHICS_OUTPUT_MAX_BLT_RECORDS];
+    UINTN BltCount;                                            // Number of Blt calls since the last reset, may exceed the records
+    UINT64 BltBytes;                                           // Bytes of all Blt calls since the last reset
+} MOCK_GRAPHICS_OUTPUT;
+
+/// @brief The mock that gBS->LocateProtocol returns
+extern MOCK_GRAPHICS_OUTPUT gMockGraphicsOutput;
+
+/// @brief Creates the mock and installs the boot services table
+/// @param Width Horizontal resolution
+/// @param Height Vertical resolution
+/// @param PixelFormat PixelBlueGreenRedReserved8BitPerColor, PixelRedGreenBlueReserved8BitPerColor, PixelBitMask or
+///        PixelBltOnly
+/// @param PixelsPerScanLine Framebuffer stride in pixels, at least Width
+/// @return EFI_SUCCESS if the function executed successfully, otherwise an error code.
+/// @note With PixelBltOnly the framebuffer exists for Blt, but FrameBufferBase is 0 like on real hardware
+EFI_STATUS
+EFIAPI
+MockGraphicsOutputInitialize(
+    IN UINT32 Width,
+    IN UINT32 Height,
+    IN EFI_GRAPHICS_PIXEL_FORMAT PixelFormat,
+    IN UINT32 PixelsPerScanLine);
+
+/// @brief Adds a mode that QueryMode reports and SetMode can switch to, the current mode does not change
+/// @param Width Horizontal resolution
+/// @param Height Vertical resolution
+/// @param PixelFormat Same formats as MockGraphicsOutputInitialize
+/// @param PixelsPerScanLine Framebuffer stride in pixels, at least Width
+/// @return EFI_SUCCESS if the function executed successfully, otherwise an error code.
+EFI_STATUS
+EFIAPI
+MockGraphicsOutputAddMode(
+    IN UINT32 Width,
+    IN UINT32 Height,
+    IN EFI_GRAPHICS_PIXEL_FORMAT PixelFormat,
+    IN UINT32 PixelsPerScanLine);
+
+/// @brief Forgets all recorded Blt calls
+VOID
+EFIAPI
+MockGraphicsOutputResetRecords(
+    VOID);
+
+/// @brief Calculates the CRC32 of the visible part of the framebuffer, without the padding of the rows
+/// @return CRC32 of the visible pixels
+UINT32
+EFIAPI
+MockGraphicsOutputFrameBufferCrc(
+    VOID);
+
+/// @brief Frees the framebuffer of the mock
+VOID
+EFIAPI
+MockGraphicsOutputFree(
+    VOID);
+
+#endif // _MOCK_GRAPHICS_OUTPUT_H_
@@ -0,0 +1,315 @@
+#include <Uefi.h>
+#include <Protocol/SimpleTextInEx.h>
+#include <Library/DebugLib.h>
+#include <Library/BaseLib.h>
+#include <Library/BaseMemoryLib.h>
+#include <Library/GameLoopLib.h>
+#include <Library/UefiBootServicesTableLib.h>
+#include <Library/GameInputLib.h>
+
+// Key notification functions receive no context, so the initialized instance is kept here
+STATIC GAME_INPUT *mGameInput = NULL;
+
+// Keys with a scan code that notification functions are registered for
+STATIC CONST UINT16 mNotifyScanCodes[] = {
+    SCAN_UP, SCAN_DOWN, SCAN_RIGHT, SCAN_LEFT,
+    SCAN_HOME, SCAN_END, SCAN_INSERT, SCAN_DELETE, SCAN_PAGE_UP, SCAN_PAGE_DOWN,
+    SCAN_ESC};
+
+// Control characters that notification functions are registered for, printable characters are registered as a range
+STATIC CONST CHAR16 mNotifyControlCharacters[] = {
+    CHAR_BACKSPACE, CHAR_TAB, CHAR_CARRIAGE_RETURN};
+
+/// @brief Appends a key event to the ring buffer
+/// @note Only called by one producer at a time, either the notification function or the console fallback
+STATIC
+VOID
+PushEvent(
+    IN GAME_INPUT *Input,
+    IN EFI_INPUT_KEY *Key,
+    IN UINT32 ShiftState,
+    IN UINT64 Timestamp)
+{
+  UINT32 Head = Input->Head;
+  GAME_INPUT_EVENT *Event;
+
+  if (Head - Input->Tail >= GAME_INPUT_RING_SIZE)
+  {
+    Input->Stats.DroppedEvents++;
+    return;
+  }
+
+  Event = &Input->Events[Head & (GAME_INPUT_RING_SIZE - 1)];
+  Event->Key = *Key;
+  Event->ShiftState = ShiftState;
+  Event->Timestamp = Timestamp;
+
+  // The event has to be complete before the consumer can see the new head
+  MemoryFence();
+  Input->Head = Head + 1;
+}
+
+/// @brief Called by the console driver for every registered key, at a raised TPL
+STATIC
+EFI_STATUS
+EFIAPI
+KeyNotify(
+    IN EFI_KEY_DATA *KeyData)
+{
+  UINT64 Timestamp = GetGameLoopCycleCounter();
+
+  if (mGameInput != NULL)
+  {
+    PushEvent(mGameInput, &KeyData->Key, KeyData->KeyState.KeyShiftState, Timestamp);
+  }
+
+  return EFI_SUCCESS;
+}
+
+/// @brief Reads one key from the console input
+/// @return EFI_SUCCESS if a key was read, otherwise the error of the console
+STATIC
+EFI_STATUS
+ReadConsoleKey(
+    IN GAME_INPUT *Input,
+    OUT EFI_INPUT_KEY *Key,
+    OUT UINT32 *ShiftState)
+{
+  EFI_KEY_DATA KeyData;
+  EFI_STATUS Status;
+
+  if (Input->ConInEx != NULL)
+  {
+    Status = Input->ConInEx->ReadKeyStrokeEx(Input->ConInEx, &KeyData);
+    *Key = KeyData.Key;
+    *ShiftState = KeyData.KeyState.KeyShiftState;
+    return Status;
+  }
+
+  *ShiftState = 0;
+  return gST->ConIn->ReadKeyStroke(gST->ConIn, Key);
+}
+
+/// @brief Empties the console input queue
+/// @details
+/// With key notifications the queued keys are duplicates of events that are already in the ring buffer,
+/// so they are dropped, this also keeps the console queue from overflowing. Without key notifications
+/// this is the only source of events, so the keys are moved into the ring buffer.
+STATIC
+VOID
+PollConsole(
+    IN GAME_INPUT *Input)
+{
+  EFI_INPUT_KEY Key;
+  UINT32 ShiftState;
+
+  while (ReadConsoleKey(Input, &Key, &ShiftState) == EFI_SUCCESS)
+  {
+    if (Input->NotifyCount == 0)
+    {
+      PushEvent(Input, &Key, ShiftState, GetGameLoopCycleCounter());
+    }
+  }
+}
+
+/// @brief Registers the notification function for one key
+/// @return EFI_SUCCESS if the function executed successfully, otherwise an error code.
+STATIC
+EFI_STATUS
+RegisterKey(
+    IN GAME_INPUT *Input,
+    IN UINT16 ScanCode,
+    IN CHAR16 UnicodeChar)
+{
+  EFI_KEY_DATA KeyData;
+  EFI_STATUS Status;
+
+  if (Input->NotifyCount == GAME_INPUT_MAX_NOTIFY_KEYS)
+  {
+    return EFI_OUT_OF_RESOURCES;
+  }
+
+  // Zero shift and toggle states match the key with any modifiers
+  ZeroMem(&KeyData, sizeof(KeyData));
+  KeyData.Key.ScanCode = ScanCode;
+  KeyData.Key.UnicodeChar = UnicodeChar;
+
+  Status = Input->ConInEx->RegisterKeyNotify(Input->ConInEx, &KeyData, KeyNotify, &Input->NotifyHandles[Input->NotifyCount]);
+  if (!EFI_ERROR(Status))
+  {
+    Input->NotifyCount++;
+  }
+
+  return Status;
+}
+
+/// @brief Unregisters all notification functions
+STATIC
+VOID
+UnregisterKeys(
+    IN GAME_INPUT *Input)
+{
+  while (Input->NotifyCount > 0)
+  {
+    Input->NotifyCount--;
+    Input->ConInEx->UnregisterKeyNotify(Input->ConInEx, Input->NotifyHandles[Input->NotifyCount]);
+  }
+}
+
+EFI_STATUS
+EFIAPI
+InitializeGameInput(
+    OUT GAME_INPUT *Input)
+{
+  EFI_STATUS Status;
+
+  if (Input == NULL)
+  {
+    return EFI_INVALID_PARAMETER;
+  }
+
+  if (mGameInput != NULL)
+  {
+    DEBUG((DEBUG_ERROR, "InitializeGameInput: Input is already initialized.\n"));
+    return EFI_ALREADY_STARTED;
+  }
+
+  ZeroMem(Input, sizeof(GAME_INPUT));
+
+  Status = gBS->HandleProtocol(gST->ConsoleInHandle, &gEfiSimpleTextInputExProtocolGuid, (VOID **)&Input->ConInEx);
+  if (EFI_ERROR(Status))
+  {
+    DEBUG((DEBUG_INFO, "InitializeGameInput: No Simple Text Input Ex protocol, reading the console input instead.\n"));
+    Input->ConInEx = NULL;
+    return EFI_SUCCESS;
+  }
+
+  mGameInput = Input;
+
+  for (UINTN i = 0; !EFI_ERROR(Status) && (i < ARRAY_SIZE(mNotifyScanCodes)); i++)
+  {
+    Status = RegisterKey(Input, mNotifyScanCodes[i], CHAR_NULL);
+  }
+
+  for (UINTN i = 0; !EFI_ERROR(Status) && (i < ARRAY_SIZE(mNotifyControlCharacters)); i++)
+  {
+    Status = RegisterKey(Input, SCAN_NULL, mNotifyControlCharacters[i]);
+  }
+
+  for (CHAR16 Character = L' '; !EFI_ERROR(Status) && (Character <= L'~'); Character++)
+  {
+    Status = RegisterKey(Input, SCAN_NULL, Character);
+  }
+
+  // Keys without a notification would only be seen by reading the console, so either all keys are notified or none
+  if (EFI_ERROR(Status))
+  {
+    DEBUG((DEBUG_INFO, "InitializeGameInput: Key notifications are not available: %r\n", Status));
+    UnregisterKeys(Input);
+  }
+
+  // Keys pressed before this point belong to whatever was on screen before
+  PollConsole(Input);
+  Input->Tail = Input->Head;
+
+  return EFI_SUCCESS;
+}
+
+EFI_STATUS
+EFIAPI
+GetGameInputEvent(
+    IN GAME_INPUT *Input,
+    OUT GAME_INPUT_EVENT *Event)
+{
+  UINT32 Tail;
+
+  if ((Input == NULL) || (Event == NULL))
+  {
+    return EFI_INVALID_PARAMETER;
+  }
+
+  PollConsole(Input);
+
+  Tail = Input->Tail;
+  if (Tail == Input->Head)
+  {
+    return EFI_NOT_READY;
+  }
+
+  *Event = Input->Events[Tail & (GAME_INPUT_RING_SIZE - 1)];
+
+  // The event has to be copied before the producer can overwrite its slot
+  MemoryFence();
+  Input->Tail = Tail + 1;
+
+  if (Input->PendingTimestamp == 0)
+  {
+    Input->PendingTimestamp = Event->Timestamp;
+  }
+
+  return EFI_SUCCESS;
+}
+
+EFI_STATUS
+EFIAPI
+FlushGameInput(
+    IN GAME_INPUT *Input)
+{
+  if (Input == NULL)
+  {
+    return EFI_INVALID_PARAMETER;
+  }
+
+  PollConsole(Input);
+  Input->Tail = Input->Head;
+  Input->PendingTimestamp = 0;
+
+  return EFI_SUCCESS;
+}
+
+VOID
+EFIAPI
+GameInputFramePresented(
+    IN GAME_INPUT *Input)
+{
+  UINT64 Latency;
+
+  if ((Input == NULL) || (Input->PendingTimestamp == 0))
+  {
+    return;
+  }
+
+  Latency = GetGameLoopCycleCounter() - Input->PendingTimestamp;
+  Input->PendingTimestamp = 0;
+
+  Input->Stats.Samples++;
+  Input->Stats.LastLatencyCycles = Latency;
+  Input->Stats.TotalLatencyCycles += Latency;
+  if (Latency > Input->Stats.MaxLatencyCycles)
+  {
+    Input->Stats.MaxLatencyCycles = Latency;
+  }
+}
+
+EFI_STATUS
+EFIAPI
+FinishGameInput(
+    IN GAME_INPUT *Input)
+{
+  if (Input == NULL)
+  {
+    return EFI_INVALID_PARAMETER;
+  }
+
+  if (Input->ConInEx != NULL)
+  {
+    UnregisterKeys(Input);
+  }
+
+  if (mGameInput == Input)
+  {
+    mGameInput = NULL;
+  }
+
+  return EFI_SUCCESS;
+}
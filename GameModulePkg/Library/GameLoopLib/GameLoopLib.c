@@ -0,0 +1,367 @@
+#include <Uefi.h>
+#include <Library/DebugLib.h>
+#include <Library/BaseLib.h>
+#include <Library/BaseMemoryLib.h>
+#include <Library/TimerLib.h>
+#include <Library/UefiBootServicesTableLib.h>
+#include <Library/GameLoopLib.h>
+
+// Length of the stall used to measure the cycle counter frequency
+#define CALIBRATION_MICROSECONDS 10000
+
+/// @brief Measures the frequency of the cycle counter against the boot services stall
+/// @return Counter cycles per second
+STATIC
+UINT64
+CalibrateCycleCounter(
+    VOID)
+{
+  UINT64 Start;
+
+  Start = GetGameLoopCycleCounter();
+  gBS->Stall(CALIBRATION_MICROSECONDS);
+  return MultU64x32(GetGameLoopCycleCounter() - Start, 1000000 / CALIBRATION_MICROSECONDS);
+}
+
+/// @brief Sleeps until the frame timer fires or, if WaitForInput is set, a key is pressed
+/// @param Loop The data structure that is used to store the loop variables
+/// @param WaitForInput TRUE if a key stroke should end the wait as well
+/// @param FrameTimerSignaled Receives TRUE if the wait ended because of the frame timer
+/// @return EFI_SUCCESS if the function executed successfully, otherwise an error code.
+STATIC
+EFI_STATUS
+WaitForFrameOrKey(
+    IN GAME_LOOP *Loop,
+    IN BOOLEAN WaitForInput,
+    OUT BOOLEAN *FrameTimerSignaled)
+{
+  EFI_EVENT Events[2];
+  UINTN Index;
+  EFI_STATUS Status;
+
+  Events[0] = Loop->FrameTimerEvent;
+  Events[1] = Loop->ConIn->WaitForKey;
+
+  if (Loop->Config.WaitMode == GameLoopWaitForEvent)
+  {
+    Status = gBS->WaitForEvent(WaitForInput ? 2 : 1, Events, &Index);
+    if (EFI_ERROR(Status))
+    {
+      return Status;
+    }
+
+    *FrameTimerSignaled = (BOOLEAN)(Index == 0);
+    return EFI_SUCCESS;
+  }
+
+  // The timer interrupt that signals the frame timer also wakes the processor up,
+  // so a signal is noticed at most one timer tick late
+  while (TRUE)
+  {
+    if (gBS->CheckEvent(Events[0]) == EFI_SUCCESS)
+    {
+      *FrameTimerSignaled = TRUE;
+      return EFI_SUCCESS;
+    }
+
+    if (WaitForInput && (gBS->CheckEvent(Events[1]) == EFI_SUCCESS))
+    {
+      *FrameTimerSignaled = FALSE;
+      return EFI_SUCCESS;
+    }
+
+    CpuSleep();
+  }
+}
+
+/// @brief Passes all pending key strokes to the input handler
+STATIC
+VOID
+DrainInput(
+    IN GAME_LOOP *Loop,
+    IN GAME_LOOP_INPUT_HANDLER InputHandler,
+    IN VOID *Context)
+{
+  EFI_INPUT_KEY Key;
+
+  while (Loop->Running && (Loop->ConIn->ReadKeyStroke(Loop->ConIn, &Key) == EFI_SUCCESS))
+  {
+    InputHandler(Context, &Key);
+  }
+}
+
+EFI_STATUS
+EFIAPI
+InitializeGameLoop(
+    OUT GAME_LOOP *Loop,
+    IN GAME_LOOP_CONFIG *Config)
+{
+  EFI_STATUS Status;
+
+  if ((Loop == NULL) || (Config == NULL) ||
+      (Config->TickRate == 0) || (Config->RenderRate == 0) || (Config->RenderRate > 10000000) ||
+      (Config->MaxCatchUpTicks == 0) ||
+      ((Config->WaitMode != GameLoopWaitForEvent) && (Config->WaitMode != GameLoopCpuSleep)))
+  {
+    return EFI_INVALID_PARAMETER;
+  }
+
+  ZeroMem(Loop, sizeof(GAME_LOOP));
+  Loop->ConIn = gST->ConIn;
+  CopyMem(&Loop->Config, Config, sizeof(GAME_LOOP_CONFIG));
+
+  Loop->Stats.CyclesPerSecond = CalibrateCycleCounter();
+  Loop->TickCycles = DivU64x32(Loop->Stats.CyclesPerSecond, Config->TickRate);
+  if (Loop->TickCycles == 0)
+  {
+    DEBUG((DEBUG_ERROR, "InitializeGameLoop: Cycle counter is too slow for %u ticks per second\n", Config->TickRate));
+    return EFI_UNSUPPORTED;
+  }
+
+  Status = gBS->CreateEvent(EVT_TIMER, TPL_NOTIFY, NULL, NULL, &Loop->FrameTimerEvent);
+  if (EFI_ERROR(Status))
+  {
+    DEBUG((DEBUG_ERROR, "InitializeGameLoop: Failed to create frame timer: %r\n", Status));
+    return Status;
+  }
+
+  // Timer period is in 100 ns units
+  Status = gBS->SetTimer(Loop->FrameTimerEvent, TimerPeriodic, 10000000 / Config->RenderRate);
+  if (EFI_ERROR(Status))
+  {
+    DEBUG((DEBUG_ERROR, "InitializeGameLoop: Failed to set frame timer: %r\n", Status));
+    gBS->CloseEvent(Loop->FrameTimerEvent);
+    Loop->FrameTimerEvent = NULL;
+    return Status;
+  }
+
+  return EFI_SUCCESS;
+}
+
+EFI_STATUS
+EFIAPI
+RunGameLoop(
+    IN GAME_LOOP *Loop,
+    IN GAME_LOOP_INPUT_HANDLER InputHandler OPTIONAL,
+    IN GAME_LOOP_TICK_HANDLER TickHandler,
+    IN GAME_LOOP_RENDER_HANDLER RenderHandler OPTIONAL,
+    IN VOID *Context OPTIONAL)
+{
+  EFI_STATUS Status;
+  BOOLEAN FrameTimerSignaled;
+  BOOLEAN FramePending = FALSE;
+  UINT32 Ticks;
+  UINT32 SkippedInRow = 0;
+  UINT64 Accumulator = 0;
+  UINT64 Remainder;
+  UINT64 WaitStart;
+  UINT64 IdleCycles;
+  UINT64 Now;
+
+  if ((Loop == NULL) || (Loop->FrameTimerEvent == NULL) || (TickHandler == NULL))
+  {
+    return EFI_INVALID_PARAMETER;
+  }
+
+  Loop->Running = TRUE;
+  Loop->FrameStart = GetGameLoopCycleCounter();
+
+  while (Loop->Running)
+  {
+    // Sleeping until the next frame, key strokes are handled as soon as they arrive.
+    // A frame that became due while the previous one was running starts right away
+    IdleCycles = 0;
+    FrameTimerSignaled = FramePending;
+    FramePending = FALSE;
+    while (Loop->Running && !FrameTimerSignaled)
+    {
+      WaitStart = GetGameLoopCycleCounter();
+      Status = WaitForFrameOrKey(Loop, (BOOLEAN)(InputHandler != NULL), &FrameTimerSignaled);
+      IdleCycles += GetGameLoopCycleCounter() - WaitStart;
+      if (EFI_ERROR(Status))
+      {
+        DEBUG((DEBUG_ERROR, "RunGameLoop: Failed to wait for the next frame: %r\n", Status));
+        Loop->Running = FALSE;
+        return Status;
+      }
+
+      if (InputHandler != NULL)
+      {
+        DrainInput(Loop, InputHandler, Context);
+      }
+    }
+
+    if (!Loop->Running)
+    {
+      break;
+    }
+
+    Now = GetGameLoopCycleCounter();
+    Loop->Stats.LastFrameCycles = Now - Loop->FrameStart;
+    Loop->Stats.LastIdleCycles = IdleCycles;
+    Loop->Stats.TotalFrameCycles += Loop->Stats.LastFrameCycles;
+    Loop->Stats.TotalIdleCycles += IdleCycles;
+    Accumulator += Loop->Stats.LastFrameCycles;
+    Loop->FrameStart = Now;
+
+    // Running logic for every whole tick period that passed
+    for (Ticks = 0; Loop->Running && (Accumulator >= Loop->TickCycles); Ticks++)
+    {
+      if (Ticks == Loop->Config.MaxCatchUpTicks)
+      {
+        // Dropping the backlog, so the game slows down during a stall instead of fast forwarding after it
+        Loop->Stats.DroppedTicks += DivU64x64Remainder(Accumulator, Loop->TickCycles, &Remainder);
+        Accumulator = Remainder;
+        break;
+      }
+
+      if (InputHandler != NULL)
+      {
+        DrainInput(Loop, InputHandler, Context);
+      }
+
+      Status = TickHandler(Context);
+      if (EFI_ERROR(Status))
+      {
+        Loop->Running = FALSE;
+        return Status;
+      }
+
+      Accumulator -= Loop->TickCycles;
+      Loop->Stats.TickCount++;
+    }
+
+    if (!Loop->Running)
+    {
+      break;
+    }
+
+    // If the next frame is already due, this one is behind. Skipping it lets the logic catch up
+    if (gBS->CheckEvent(Loop->FrameTimerEvent) == EFI_SUCCESS)
+    {
+      FramePending = TRUE;
+      if (SkippedInRow < Loop->Config.MaxFrameSkip)
+      {
+        SkippedInRow++;
+        Loop->Stats.SkippedFrames++;
+        continue;
+      }
+    }
+    SkippedInRow = 0;
+
+    if (RenderHandler != NULL)
+    {
+      Status = RenderHandler(Context, (UINT32)DivU64x64Remainder(LShiftU64(Accumulator, 16), Loop->TickCycles, NULL));
+      if (EFI_ERROR(Status))
+      {
+        Loop->Running = FALSE;
+        return Status;
+      }
+    }
+    Loop->Stats.FrameCount++;
+  }
+
+  return EFI_SUCCESS;
+}
+
+VOID
+EFIAPI
+StopGameLoop(
+    IN GAME_LOOP *Loop)
+{
+  if (Loop != NULL)
+  {
+    Loop->Running = FALSE;
+  }
+}
+
+EFI_STATUS
+EFIAPI
+GameLoopWaitForKey(
+    IN GAME_LOOP *Loop,
+    OUT EFI_INPUT_KEY *Key OPTIONAL)
+{
+  EFI_INPUT_KEY IgnoredKey;
+  EFI_STATUS Status;
+  UINTN Index;
+
+  if (Loop == NULL)
+  {
+    return EFI_INVALID_PARAMETER;
+  }
+
+  if (Key == NULL)
+  {
+    Key = &IgnoredKey;
+  }
+
+  // WaitForKey can be signaled without a key being available, so reading until a key is actually returned
+  while (TRUE)
+  {
+    Status = Loop->ConIn->ReadKeyStroke(Loop->ConIn, Key);
+    if (Status != EFI_NOT_READY)
+    {
+      return Status;
+    }
+
+    if (Loop->Config.WaitMode == GameLoopWaitForEvent)
+    {
+      Status = gBS->WaitForEvent(1, &Loop->ConIn->WaitForKey, &Index);
+      if (EFI_ERROR(Status))
+      {
+        return Status;
+      }
+    }
+    else
+    {
+      CpuSleep();
+    }
+  }
+}
+
+UINT64
+EFIAPI
+GetGameLoopCycleCounter(
+    VOID)
+{
+#if defined(MDE_CPU_IA32) || defined(MDE_CPU_X64)
+  return AsmReadTsc();
+#else
+  return GetPerformanceCounter();
+#endif
+}
+
+UINT32
+EFIAPI
+GetGameLoopIdlePercent(
+    IN GAME_LOOP *Loop)
+{
+  if ((Loop == NULL) || (Loop->Stats.TotalFrameCycles == 0))
+  {
+    return 0;
+  }
+
+  return (UINT32)DivU64x64Remainder(MultU64x32(Loop->Stats.TotalIdleCycles, 100), Loop->Stats.TotalFrameCycles, NULL);
+}
+
+EFI_STATUS
+EFIAPI
+FinishGameLoop(
+    IN GAME_LOOP *Loop)
+{
+  EFI_STATUS Status;
+
+  if (Loop == NULL)
+  {
+    return EFI_INVALID_PARAMETER;
+  }
+
+  if (Loop->FrameTimerEvent == NULL)
+  {
+    return EFI_SUCCESS;
+  }
+
+  Status = gBS->CloseEvent(Loop->FrameTimerEvent);
+  Loop->FrameTimerEvent = NULL;
+  return Status;
+}
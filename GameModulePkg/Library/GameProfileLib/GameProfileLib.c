@@ -0,0 +1,292 @@
+#include <Uefi.h>
+#include <Library/DebugLib.h>
+#include <Library/BaseLib.h>
+#include <Library/BaseMemoryLib.h>
+#include <Library/UefiBootServicesTableLib.h>
+#include <Library/GameGraphicsLib.h>
+#include <Library/GameLoopLib.h>
+#include <Library/GameProfileLib.h>
+
+// Length of the stall used to measure the cycle counter frequency
+#define CALIBRATION_MICROSECONDS 10000
+
+// Names of the phases in the report, in the order of GAME_PROFILE_PHASE
+STATIC CONST CHAR8 *mPhaseNames[GameProfilePhaseMax] = {
+    "Input", "Logic", "Grid", "Text", "Present", "Frame"};
+
+/// @brief Returns the histogram bucket that counts a time
+STATIC
+UINT32
+BucketIndex(
+    IN UINT64 Cycles)
+{
+  UINT32 HighBit;
+
+  if (Cycles < GAME_PROFILE_SUB_BUCKETS)
+  {
+    return (UINT32)Cycles;
+  }
+
+  // The highest bit selects the power of two, the bits below it select the bucket within it
+  HighBit = (UINT32)HighBitSet64(Cycles);
+  return (HighBit - GAME_PROFILE_SUB_BUCKET_BITS + 1) * GAME_PROFILE_SUB_BUCKETS +
+         ((UINT32)RShiftU64(Cycles, HighBit - GAME_PROFILE_SUB_BUCKET_BITS) & (GAME_PROFILE_SUB_BUCKETS - 1));
+}
+
+/// @brief Returns the longest time that is counted in a histogram bucket
+STATIC
+UINT64
+BucketUpperBound(
+    IN UINT32 Bucket)
+{
+  UINT32 HighBit;
+
+  if (Bucket < GAME_PROFILE_SUB_BUCKETS)
+  {
+    return Bucket;
+  }
+
+  HighBit = Bucket / GAME_PROFILE_SUB_BUCKETS - 1 + GAME_PROFILE_SUB_BUCKET_BITS;
+  return LShiftU64(GAME_PROFILE_SUB_BUCKETS + (Bucket % GAME_PROFILE_SUB_BUCKETS) + 1, HighBit - GAME_PROFILE_SUB_BUCKET_BITS) - 1;
+}
+
+/// @brief Converts counter cycles to microseconds
+STATIC
+UINT64
+CyclesToMicroseconds(
+    IN GAME_PROFILE *Profile,
+    IN UINT64 Cycles)
+{
+  return DivU64x64Remainder(MultU64x32(Cycles, 1000000), Profile->CyclesPerSecond, NULL);
+}
+
+/// @brief Adds one measurement to a phase
+STATIC
+VOID
+RecordPhase(
+    IN GAME_PROFILE_PHASE_DATA *Phase,
+    IN UINT64 Cycles)
+{
+  if ((Phase->Count == 0) || (Cycles < Phase->MinCycles))
+  {
+    Phase->MinCycles = Cycles;
+  }
+
+  if (Cycles > Phase->MaxCycles)
+  {
+    Phase->MaxCycles = Cycles;
+  }
+
+  Phase->Count++;
+  Phase->TotalCycles += Cycles;
+  Phase->Buckets[BucketIndex(Cycles)]++;
+}
+
+EFI_STATUS
+EFIAPI
+InitializeGameProfile(
+    OUT GAME_PROFILE *Profile,
+    IN UINT32 TargetFrameRate)
+{
+  UINT64 Start;
+
+  if ((Profile == NULL) || (TargetFrameRate == 0))
+  {
+    return EFI_INVALID_PARAMETER;
+  }
+
+  ZeroMem(Profile, sizeof(GAME_PROFILE));
+
+  Start = GetGameLoopCycleCounter();
+  gBS->Stall(CALIBRATION_MICROSECONDS);
+  Profile->CyclesPerSecond = MultU64x32(GetGameLoopCycleCounter() - Start, 1000000 / CALIBRATION_MICROSECONDS);
+  if (Profile->CyclesPerSecond == 0)
+  {
+    DEBUG((DEBUG_ERROR, "InitializeGameProfile: Cycle counter does not run\n"));
+    return EFI_UNSUPPORTED;
+  }
+
+  Profile->TargetFrameCycles = DivU64x32(Profile->CyclesPerSecond, TargetFrameRate);
+
+  return EFI_SUCCESS;
+}
+
+VOID
+EFIAPI
+GameProfileBegin(
+    IN GAME_PROFILE *Profile,
+    IN GAME_PROFILE_PHASE Phase)
+{
+  if ((Profile == NULL) || (Phase >= GameProfilePhaseMax))
+  {
+    return;
+  }
+
+  Profile->Phases[Phase].Start = GetGameLoopCycleCounter();
+}
+
+VOID
+EFIAPI
+GameProfileEnd(
+    IN GAME_PROFILE *Profile,
+    IN GAME_PROFILE_PHASE Phase)
+{
+  UINT64 End = GetGameLoopCycleCounter();
+  GAME_PROFILE_PHASE_DATA *PhaseData;
+
+  if ((Profile == NULL) || (Phase >= GameProfilePhaseMax))
+  {
+    return;
+  }
+
+  PhaseData = &Profile->Phases[Phase];
+  if (PhaseData->Start == 0)
+  {
+    return;
+  }
+
+  RecordPhase(PhaseData, End - PhaseData->Start);
+  PhaseData->Start = 0;
+}
+
+VOID
+EFIAPI
+GameProfileFrame(
+    IN GAME_PROFILE *Profile)
+{
+  UINT64 Now = GetGameLoopCycleCounter();
+  UINT64 Cycles;
+
+  if (Profile == NULL)
+  {
+    return;
+  }
+
+  // The first marker only starts the first frame
+  if (Profile->LastFrame != 0)
+  {
+    Cycles = Now - Profile->LastFrame;
+    RecordPhase(&Profile->Phases[GameProfilePhaseFrame], Cycles);
+    Profile->FrameGraph[Profile->FrameGraphNext] = Cycles;
+    Profile->FrameGraphNext = (Profile->FrameGraphNext + 1) % GAME_PROFILE_GRAPH_FRAMES;
+  }
+
+  Profile->LastFrame = Now;
+}
+
+EFI_STATUS
+EFIAPI
+GetGameProfilePhaseStats(
+    IN GAME_PROFILE *Profile,
+    IN GAME_PROFILE_PHASE Phase,
+    OUT GAME_PROFILE_PHASE_STATS *Stats)
+{
+  GAME_PROFILE_PHASE_DATA *PhaseData;
+  UINT64 Threshold;
+  UINT64 Counted = 0;
+  UINT32 Bucket;
+
+  if ((Profile == NULL) || (Phase >= GameProfilePhaseMax) || (Stats == NULL))
+  {
+    return EFI_INVALID_PARAMETER;
+  }
+
+  ZeroMem(Stats, sizeof(GAME_PROFILE_PHASE_STATS));
+  PhaseData = &Profile->Phases[Phase];
+  if (PhaseData->Count == 0)
+  {
+    return EFI_SUCCESS;
+  }
+
+  // Smallest bucket that, together with all shorter ones, holds 99 percent of the measurements
+  Threshold = DivU64x32(MultU64x32(PhaseData->Count, 99) + 99, 100);
+  for (Bucket = 0; Bucket < GAME_PROFILE_BUCKETS - 1; Bucket++)
+  {
+    Counted += PhaseData->Buckets[Bucket];
+    if (Counted >= Threshold)
+    {
+      break;
+    }
+  }
+
+  Stats->Count = PhaseData->Count;
+  Stats->Min = CyclesToMicroseconds(Profile, PhaseData->MinCycles);
+  Stats->Average = CyclesToMicroseconds(Profile, DivU64x64Remainder(PhaseData->TotalCycles, PhaseData->Count, NULL));
+  Stats->P99 = CyclesToMicroseconds(Profile, MIN(BucketUpperBound(Bucket), PhaseData->MaxCycles));
+  Stats->Max = CyclesToMicroseconds(Profile, PhaseData->MaxCycles);
+
+  return EFI_SUCCESS;
+}
+
+VOID
+EFIAPI
+GameProfileReport(
+    IN GAME_PROFILE *Profile)
+{
+  GAME_PROFILE_PHASE_STATS Stats;
+
+  if (Profile == NULL)
+  {
+    return;
+  }
+
+  for (UINT32 Phase = 0; Phase < GameProfilePhaseMax; Phase++)
+  {
+    GetGameProfilePhaseStats(Profile, (GAME_PROFILE_PHASE)Phase, &Stats);
+    if (Stats.Count == 0)
+    {
+      continue;
+    }
+
+    DEBUG((DEBUG_INFO, "%a: %lu samples, min %lu us, avg %lu us, p99 %lu us, max %lu us\n",
+           mPhaseNames[Phase], Stats.Count, Stats.Min, Stats.Average, Stats.P99, Stats.Max));
+  }
+}
+
+EFI_STATUS
+EFIAPI
+DrawGameProfileOverlay(
+    IN GAME_PROFILE *Profile,
+    IN GAME_GRAPHICS_LIB_DATA *Data,
+    IN INT32 x,
+    IN INT32 y,
+    IN UINT32 Height)
+{
+  EFI_GRAPHICS_OUTPUT_BLT_PIXEL Background = {0, 0, 0, 0};
+  EFI_GRAPHICS_OUTPUT_BLT_PIXEL OnTime = {0, 192, 0, 0};
+  EFI_GRAPHICS_OUTPUT_BLT_PIXEL Late = {0, 0, 255, 0};
+  EFI_GRAPHICS_OUTPUT_BLT_PIXEL Target = {255, 255, 255, 0};
+  UINT64 Cycles;
+  UINT32 BarHeight;
+  UINT32 Frame;
+  EFI_STATUS Status;
+
+  if ((Profile == NULL) || (Data == NULL) || (Height == 0) || (Profile->TargetFrameCycles == 0))
+  {
+    return EFI_INVALID_PARAMETER;
+  }
+
+  Status = DrawRectangle(Data, x, y, GAME_PROFILE_GRAPH_FRAMES, Height, &Background);
+  if (EFI_ERROR(Status))
+  {
+    return Status;
+  }
+
+  // Oldest frame first, frames that were not recorded yet are 0 and draw no bar
+  Frame = Profile->FrameGraphNext;
+  for (INT32 Column = 0; Column < GAME_PROFILE_GRAPH_FRAMES; Column++)
+  {
+    Cycles = Profile->FrameGraph[Frame];
+    Frame = (Frame + 1) % GAME_PROFILE_GRAPH_FRAMES;
+
+    BarHeight = (UINT32)MIN(Height, DivU64x64Remainder(MultU64x32(Cycles, Height), MultU64x32(Profile->TargetFrameCycles, 2), NULL));
+    if (BarHeight == 0)
+    {
+      continue;
+    }
+
+    DrawRectangle(Data, x + Column, y + Height - BarHeight, 1, BarHeight, (Cycles > Profile->TargetFrameCycles) ? &Late : &OnTime);
+  }
+
+  return DrawRectangle(Data, x, y + Height - Height / 2, GAME_PROFILE_GRAPH_FRAMES, 1, &Target);
+}